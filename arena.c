@@ -0,0 +1,133 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+#include "ftgl-utils.h"
+
+/* Alignment of every allocation, enough for any type the library stores */
+#define ARENA_ALIGNMENT 16
+
+typedef struct arena_block_t
+{
+    struct arena_block_t *next;
+    size_t size;
+    size_t used;
+} arena_block_t;
+
+/* Offset of the first usable byte of a block */
+#define ARENA_HEADER_SIZE \
+    ((sizeof(arena_block_t) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+
+// -------------------------------------------------------------- arena_new ---
+arena_t *
+arena_new( size_t block_size )
+{
+    arena_t *self = (arena_t *) malloc( sizeof(arena_t) );
+
+    if( !self )
+    {
+        freetype_gl_error( Out_Of_Memory );
+        return NULL;
+    }
+    self->blocks      = NULL;
+    self->block_size  = block_size;
+    self->block_count = 0;
+    self->capacity    = 0;
+    self->used        = 0;
+    self->allocations = 0;
+    return self;
+}
+
+
+// ----------------------------------------------------------- arena_delete ---
+void
+arena_delete( arena_t *self )
+{
+    arena_block_t *block, *next;
+
+    assert( self );
+
+    for( block = self->blocks; block; block = next )
+    {
+        next = block->next;
+        free( block );
+    }
+    free( self );
+}
+
+
+// ------------------------------------------------------------ arena_alloc ---
+void *
+arena_alloc( arena_t *self,
+             size_t size )
+{
+    arena_block_t *block;
+    size_t block_size;
+
+    assert( self );
+
+    block = self->blocks;
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    if( !block || block->size - block->used < size )
+    {
+        block_size = size > self->block_size ? size : self->block_size;
+        block = (arena_block_t *) malloc( ARENA_HEADER_SIZE + block_size );
+        if( !block )
+        {
+            freetype_gl_error( Out_Of_Memory );
+            return NULL;
+        }
+        block->size = block_size;
+        block->used = 0;
+
+        /* A block of its own for a large request keeps the current block
+         * in use for the next small ones */
+        if( self->blocks && block_size > self->block_size )
+        {
+            block->next = self->blocks->next;
+            self->blocks->next = block;
+        }
+        else
+        {
+            block->next = self->blocks;
+            self->blocks = block;
+        }
+        self->block_count++;
+        self->capacity += ARENA_HEADER_SIZE + block_size;
+    }
+
+    block->used += size;
+    self->used += size;
+    self->allocations++;
+    return (char *) block + ARENA_HEADER_SIZE + block->used - size;
+}
+
+
+// ----------------------------------------------------------- arena_calloc ---
+void *
+arena_calloc( arena_t *self,
+              size_t count,
+              size_t size )
+{
+    void *memory = arena_alloc( self, count * size );
+
+    if( memory )
+        memset( memory, 0, count * size );
+    return memory;
+}
+
+
+// ----------------------------------------------------------- arena_memory ---
+size_t
+arena_memory( const arena_t *self )
+{
+    assert( self );
+
+    return sizeof(arena_t) + self->capacity;
+}
@@ -0,0 +1,143 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+namespace ftgl {
+#endif
+
+/**
+ * @file   arena.h
+ *
+ * @defgroup arena Arena
+ *
+ * The arena hands out memory from large blocks and never frees it piecewise:
+ * everything it allocated is released at once when it is deleted. It is used
+ * by @ref texture-font to store glyphs and their kerning tables, so that
+ * fonts with many glyphs neither fragment the heap nor free each glyph on
+ * deletion.
+ *
+ * <b>Example Usage</b>:
+ * @code
+ * #include "arena.h"
+ *
+ * int main( int arrgc, char *argv[] )
+ * {
+ *   arena_t * arena = arena_new( 4096 );
+ *   float * values = (float *) arena_calloc( arena, 256, sizeof(float) );
+ *
+ *   arena_delete( arena );
+ *
+ *   return 0;
+ * }
+ * @endcode
+ *
+ * @{
+ */
+
+/**
+ *  Generic arena structure.
+ *
+ * @memberof arena
+ */
+typedef struct arena_t
+{
+    /** Most recently allocated block, linked to the previous ones. */
+    struct arena_block_t * blocks;
+
+    /** Default size (in bytes) of a block. */
+    size_t block_size;
+
+    /** Number of blocks. */
+    size_t block_count;
+
+    /** Bytes obtained from the heap for the blocks. */
+    size_t capacity;
+
+    /** Bytes handed out, including alignment. */
+    size_t used;
+
+    /** Number of allocations. */
+    size_t allocations;
+} arena_t;
+
+
+/**
+ * Creates a new empty arena.
+ *
+ * @param   block_size  default size in bytes of the blocks allocated from the
+ *                      heap, larger requests get a block of their own
+ * @return              a new empty arena
+ *
+ */
+  arena_t *
+  arena_new( size_t block_size );
+
+
+/**
+ *  Deletes an arena and everything allocated from it.
+ *
+ *  @param self an arena structure
+ *
+ */
+  void
+  arena_delete( arena_t *self );
+
+
+/**
+ *  Allocates memory from an arena, aligned for any type.
+ *
+ *  @param  self  an arena structure
+ *  @param  size  size in bytes
+ *  @return       uninitialized memory, valid until the arena is deleted, or
+ *                NULL if memory is exhausted
+ */
+  void *
+  arena_alloc( arena_t *self,
+               size_t size );
+
+
+/**
+ *  Allocates zeroed memory from an arena, aligned for any type.
+ *
+ *  @param  self   an arena structure
+ *  @param  count  number of items
+ *  @param  size   size in bytes of an item
+ *  @return        zeroed memory, valid until the arena is deleted, or NULL if
+ *                 memory is exhausted
+ */
+  void *
+  arena_calloc( arena_t *self,
+                size_t count,
+                size_t size );
+
+
+/**
+ *  Returns the memory used by the arena.
+ *
+ *  @param  self  an arena structure
+ *  @return       allocated size in bytes
+ */
+  size_t
+  arena_memory( const arena_t *self );
+
+/** @} */
+
+#ifdef __cplusplus
+}
+}
+#endif
+
+#endif /* __ARENA_H__ */
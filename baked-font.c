@@ -0,0 +1,560 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32) || defined(_WIN64)
+#  define WIN32_LEAN_AND_MEAN
+#  define NOMINMAX
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+#include "baked-font.h"
+#include "ftgl-utils.h"
+
+/* Record sizes and header offsets of the file format, see baked-font.h */
+#define BAKED_FONT_HEADER_SIZE  104
+#define BAKED_GLYPH_SIZE        80
+#define BAKED_KERNING_SIZE      8
+#define BAKED_FONT_ALIGNMENT    16
+
+#define BAKED_VERSION           8
+#define BAKED_METRICS           16
+#define BAKED_RENDERMODE        44
+#define BAKED_OUTLINE           48
+#define BAKED_ATLAS_SIZE        52
+#define BAKED_SPECIAL           64
+#define BAKED_GLYPH_COUNT       80
+#define BAKED_GLYPHS_OFFSET     84
+#define BAKED_KERNING_COUNT     88
+#define BAKED_KERNING_OFFSET    92
+#define BAKED_ATLAS_OFFSET      96
+#define BAKED_FILE_SIZE         100
+
+static const char baked_font_magic[8] = { 'F', 'T', 'G', 'L', 'B', 'A', 'K', 'E' };
+
+
+// --------------------------------------------------------- little endian ---
+static uint32_t
+baked_u32( const unsigned char *p )
+{
+    return (uint32_t) p[0] | (uint32_t) p[1] << 8 |
+           (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static float
+baked_f32( const unsigned char *p )
+{
+    uint32_t u = baked_u32( p );
+    float f;
+
+    memcpy( &f, &u, sizeof(f) );
+    return f;
+}
+
+static unsigned char *
+baked_put_u32( unsigned char *p, uint32_t value )
+{
+    p[0] = (unsigned char) value;
+    p[1] = (unsigned char) (value >> 8);
+    p[2] = (unsigned char) (value >> 16);
+    p[3] = (unsigned char) (value >> 24);
+    return p + 4;
+}
+
+static unsigned char *
+baked_put_f32( unsigned char *p, float value )
+{
+    uint32_t u;
+
+    memcpy( &u, &value, sizeof(u) );
+    return baked_put_u32( p, u );
+}
+
+
+// ------------------------------------------------------- baked_font_parse ---
+/* Decode the header and check that the sections fit in the file */
+static int
+baked_font_parse( baked_font_t *self )
+{
+    const unsigned char *p = self->base;
+    uint64_t glyphs, kerning, atlas, end;
+    size_t i;
+
+    if( self->size < BAKED_FONT_HEADER_SIZE ||
+        memcmp( p, baked_font_magic, sizeof(baked_font_magic) ) ||
+        baked_u32( p + BAKED_VERSION ) != BAKED_FONT_VERSION ||
+        baked_u32( p + BAKED_FILE_SIZE ) != self->size )
+        return 0;
+
+    self->font_size           = baked_f32( p + BAKED_METRICS );
+    self->height              = baked_f32( p + BAKED_METRICS + 4 );
+    self->linegap             = baked_f32( p + BAKED_METRICS + 8 );
+    self->ascender            = baked_f32( p + BAKED_METRICS + 12 );
+    self->descender           = baked_f32( p + BAKED_METRICS + 16 );
+    self->underline_position  = baked_f32( p + BAKED_METRICS + 20 );
+    self->underline_thickness = baked_f32( p + BAKED_METRICS + 24 );
+    self->rendermode          = (rendermode_t) baked_u32( p + BAKED_RENDERMODE );
+    self->outline_thickness   = baked_f32( p + BAKED_OUTLINE );
+    self->atlas_width         = baked_u32( p + BAKED_ATLAS_SIZE );
+    self->atlas_height        = baked_u32( p + BAKED_ATLAS_SIZE + 4 );
+    self->atlas_depth         = baked_u32( p + BAKED_ATLAS_SIZE + 8 );
+    for( i = 0; i < 4; i++ )
+        self->special[i] = baked_f32( p + BAKED_SPECIAL + 4 * i );
+    self->glyph_count         = baked_u32( p + BAKED_GLYPH_COUNT );
+    self->kerning_count       = baked_u32( p + BAKED_KERNING_COUNT );
+
+    glyphs  = baked_u32( p + BAKED_GLYPHS_OFFSET );
+    kerning = baked_u32( p + BAKED_KERNING_OFFSET );
+    atlas   = baked_u32( p + BAKED_ATLAS_OFFSET );
+    end     = self->size;
+    if( (self->atlas_depth != 1 && self->atlas_depth != 3 && self->atlas_depth != 4) ||
+        self->atlas_width < 2 || self->atlas_height < 2 ||
+        glyphs + (uint64_t) self->glyph_count * BAKED_GLYPH_SIZE > end ||
+        kerning + (uint64_t) self->kerning_count * BAKED_KERNING_SIZE > end ||
+        atlas + (uint64_t) self->atlas_width * self->atlas_height * self->atlas_depth > end )
+        return 0;
+
+    self->glyphs  = self->base + glyphs;
+    self->kerning = self->base + kerning;
+    self->pixels  = self->base + atlas;
+    return 1;
+}
+
+
+// --------------------------------------------- baked_font_new_from_memory ---
+baked_font_t *
+baked_font_new_from_memory( void * base,
+                            size_t size )
+{
+    baked_font_t *self;
+
+    assert( base );
+
+    self = (baked_font_t *) calloc( 1, sizeof(baked_font_t) );
+    if( !self )
+    {
+        freetype_gl_error( Out_Of_Memory );
+        return NULL;
+    }
+    self->base = (unsigned char *) base;
+    self->size = size;
+    self->references = 1;
+    if( !baked_font_parse( self ) )
+    {
+        freetype_gl_error( Font_Unavailable );
+        free( self );
+        return NULL;
+    }
+    return self;
+}
+
+
+// -------------------------------------------------------- baked_font_load ---
+baked_font_t *
+baked_font_load( const char * filename )
+{
+    baked_font_t *self;
+    void *base = NULL;
+    size_t size = 0;
+
+    assert( filename );
+
+    /* Copy-on-write mapping, so that the atlas can be written */
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE file, mapping;
+    LARGE_INTEGER file_size;
+
+    file = CreateFileA( filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+    if( file != INVALID_HANDLE_VALUE )
+    {
+        if( GetFileSizeEx( file, &file_size ) && file_size.QuadPart > 0 &&
+            (mapping = CreateFileMappingA( file, NULL, PAGE_WRITECOPY, 0, 0, NULL )) )
+        {
+            base = MapViewOfFile( mapping, FILE_MAP_COPY, 0, 0, 0 );
+            size = (size_t) file_size.QuadPart;
+            CloseHandle( mapping );
+        }
+        CloseHandle( file );
+    }
+#else
+    struct stat st;
+    int fd = open( filename, O_RDONLY );
+
+    if( fd >= 0 )
+    {
+        if( !fstat( fd, &st ) && st.st_size > 0 )
+        {
+            base = mmap( NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 );
+            if( base == MAP_FAILED )
+                base = NULL;
+            size = st.st_size;
+        }
+        close( fd );
+    }
+#endif
+    if( !base )
+    {
+        freetype_gl_error( Cannot_Load_File );
+        return NULL;
+    }
+
+    if( !(self = baked_font_new_from_memory( base, size )) )
+    {
+#if defined(_WIN32) || defined(_WIN64)
+        UnmapViewOfFile( base );
+#else
+        munmap( base, size );
+#endif
+        return NULL;
+    }
+    self->mapped = 1;
+    return self;
+}
+
+
+// ------------------------------------------------------- baked_font_probe ---
+int
+baked_font_probe( const void * data,
+                  size_t size )
+{
+    return data && size >= sizeof(baked_font_magic) &&
+        !memcmp( data, baked_font_magic, sizeof(baked_font_magic) );
+}
+
+
+// ----------------------------------------------------- baked_font_release ---
+void
+baked_font_release( baked_font_t * self )
+{
+    assert( self );
+    assert( self->references );
+
+    if( --self->references )
+        return;
+    if( self->mapped )
+    {
+#if defined(_WIN32) || defined(_WIN64)
+        UnmapViewOfFile( self->base );
+#else
+        munmap( self->base, self->size );
+#endif
+    }
+    free( self );
+}
+
+
+// -------------------------------------------------------- baked_font_find ---
+int
+baked_font_find( const baked_font_t * self,
+                 uint32_t codepoint,
+                 baked_glyph_t * glyph )
+{
+    size_t low = 0, high = self->glyph_count, middle;
+    const unsigned char *p;
+    uint32_t found;
+
+    assert( self );
+    assert( glyph );
+
+    while( low < high )
+    {
+        middle = low + (high - low) / 2;
+        found = baked_u32( self->glyphs + middle * BAKED_GLYPH_SIZE );
+        if( found < codepoint )
+            low = middle + 1;
+        else if( found > codepoint )
+            high = middle;
+        else
+            break;
+    }
+    if( low >= high )
+        return 0;
+
+    p = self->glyphs + middle * BAKED_GLYPH_SIZE;
+    glyph->codepoint     = baked_u32( p );
+    glyph->x             = baked_u32( p + 4 );
+    glyph->y             = baked_u32( p + 8 );
+    glyph->width         = baked_u32( p + 12 );
+    glyph->height        = baked_u32( p + 16 );
+    glyph->offset_x      = (int32_t) baked_u32( p + 20 );
+    glyph->offset_y      = (int32_t) baked_u32( p + 24 );
+    glyph->advance_x     = baked_f32( p + 28 );
+    glyph->advance_y     = baked_f32( p + 32 );
+    glyph->s0            = baked_f32( p + 36 );
+    glyph->t0            = baked_f32( p + 40 );
+    glyph->s1            = baked_f32( p + 44 );
+    glyph->t1            = baked_f32( p + 48 );
+    glyph->data_x        = baked_u32( p + 52 );
+    glyph->data_y        = baked_u32( p + 56 );
+    glyph->data_width    = baked_u32( p + 60 );
+    glyph->data_height   = baked_u32( p + 64 );
+    glyph->glyphmode     = baked_u32( p + 68 );
+    glyph->kerning_first = baked_u32( p + 72 );
+    glyph->kerning_count = baked_u32( p + 76 );
+
+    /* A bitmap out of the atlas would be read out of the file */
+    if( (uint64_t) glyph->x + glyph->width > self->atlas_width ||
+        (uint64_t) glyph->y + glyph->height > self->atlas_height ||
+        (uint64_t) glyph->data_x + glyph->data_width > self->atlas_width ||
+        (uint64_t) glyph->data_y + glyph->data_height > self->atlas_height )
+        return 0;
+
+    /* A range out of the file means no kerning rather than a bad read */
+    if( (uint64_t) glyph->kerning_first + glyph->kerning_count > self->kerning_count )
+        glyph->kerning_count = 0;
+    return 1;
+}
+
+
+// ------------------------------------------------- baked_font_get_kerning ---
+void
+baked_font_get_kerning( const baked_font_t * self,
+                        const baked_glyph_t * glyph,
+                        texture_glyph_kerning_t * pairs )
+{
+    const unsigned char *p = self->kerning +
+        (size_t) glyph->kerning_first * BAKED_KERNING_SIZE;
+    uint32_t i;
+
+    for( i = 0; i < glyph->kerning_count; i++, p += BAKED_KERNING_SIZE )
+    {
+        pairs[i].codepoint = baked_u32( p );
+        pairs[i].kerning = (int16_t) (int32_t) baked_u32( p + 4 );
+    }
+}
+
+
+// ---------------------------------------------------- baked_glyph_compare ---
+static int
+baked_glyph_compare( const void *a, const void *b )
+{
+    uint32_t ca = (*(const texture_glyph_t **) a)->codepoint;
+    uint32_t cb = (*(const texture_glyph_t **) b)->codepoint;
+
+    return (ca > cb) - (ca < cb);
+}
+
+
+// ------------------------------------------------------- baked_push_pair ---
+/* Append a kerning pair if its left glyph is saved and it is not zero */
+static void
+baked_push_pair( vector_t *pairs,
+                 texture_glyph_t **glyphs, size_t count,
+                 uint32_t left, float kerning )
+{
+    texture_glyph_t key, *pkey = &key;
+    texture_glyph_kerning_t pair;
+
+    key.codepoint = left;
+    if( !bsearch( &pkey, glyphs, count, sizeof(texture_glyph_t *), baked_glyph_compare ) )
+        return;
+    kerning *= KERNING_COMPACT_SCALE;
+    pair.codepoint = left;
+    pair.kerning = (int16_t) (kerning < INT16_MIN ? INT16_MIN :
+                              kerning > INT16_MAX ? INT16_MAX : roundf( kerning ));
+    if( pair.kerning )
+        vector_push_back( pairs, &pair );
+}
+
+
+// ------------------------------------------------------ baked_glyph_pairs ---
+/* Append the kerning pairs of a glyph with the saved glyphs, by left
+ * codepoint */
+static void
+baked_glyph_pairs( texture_font_t *font, texture_glyph_t *glyph,
+                   texture_glyph_t **glyphs, size_t count,
+                   vector_t *pairs )
+{
+    texture_glyph_kerning_t *pair;
+    float **page;
+    size_t i, j;
+
+    /* Lazy kerning is only known pair by pair */
+    if( font->kerning_mode == KERNING_LAZY )
+    {
+        for( i = 0; i < count; i++ )
+            baked_push_pair( pairs, glyphs, count, glyphs[i]->codepoint,
+                             texture_font_get_kerning( font, glyphs[i]->codepoint,
+                                                       glyph->codepoint ) );
+        return;
+    }
+
+    if( glyph->kerning_compact )
+    {
+        for( i = 0; i < glyph->kerning_compact->size; i++ )
+        {
+            pair = (texture_glyph_kerning_t *) vector_get( glyph->kerning_compact, i );
+            baked_push_pair( pairs, glyphs, count, pair->codepoint,
+                             pair->kerning / (float) KERNING_COMPACT_SCALE );
+        }
+        return;
+    }
+
+    for( i = 0; i < glyph->kerning->size; i++ )
+    {
+        page = (float **) vector_get( glyph->kerning, i );
+        if( !*page )
+            continue;
+        for( j = 0; j < 0x100; j++ )
+            if( (*page)[j] )
+                baked_push_pair( pairs, glyphs, count, (uint32_t) (i << 8 | j), (*page)[j] );
+    }
+}
+
+
+// -------------------------------------------------------- baked_font_save ---
+int
+baked_font_save( texture_font_t * font,
+                 const char * filename )
+{
+    texture_atlas_t *atlas = font->atlas;
+    texture_glyph_t *glyph, **glyphs = NULL, *special = atlas->special;
+    size_t i, count = 0, size, glyphs_offset, kerning_offset, atlas_offset;
+    size_t atlas_size = atlas->width * atlas->height * atlas->depth;
+    size_t *first = NULL;
+    vector_t *pairs = NULL;
+    texture_glyph_kerning_t *pair;
+    unsigned char *data = NULL, *p;
+    font_mode_t mode = font->mode;
+    FILE *file;
+    int status = 0;
+
+    assert( font );
+    assert( filename );
+
+    /* Glyph records have no channel */
+    if( atlas->channels > 1 )
+    {
+        freetype_gl_error( Font_Unavailable );
+        return 0;
+    }
+
+    /* Glyphs of the current render mode, by codepoint */
+    glyphs = (texture_glyph_t **) malloc( (vector_glyphs_size( font->glyphs ) + 1) *
+                                          sizeof(texture_glyph_t *) );
+    first = (size_t *) malloc( (vector_glyphs_size( font->glyphs ) + 1) * sizeof(size_t) );
+    pairs = vector_new( sizeof(texture_glyph_kerning_t) );
+    if( !glyphs || !first || !pairs )
+        goto oom;
+    GLYPHS_ITERATOR( i, glyph, font->glyphs ) {
+        if( glyph->rendermode == font->rendermode &&
+            glyph->outline_thickness == font->outline_thickness )
+            glyphs[count++] = glyph;
+    } GLYPHS_ITERATOR_END
+    qsort( glyphs, count, sizeof(texture_glyph_t *), baked_glyph_compare );
+
+    /* Kerning pairs of each glyph, keeping the face open for lazy kerning */
+    font->mode = MODE_ALWAYS_OPEN;
+    for( i = 0; i < count; i++ )
+    {
+        first[i] = pairs->size;
+        baked_glyph_pairs( font, glyphs[i], glyphs, count, pairs );
+    }
+    first[count] = pairs->size;
+    font->mode = mode;
+    texture_font_close( font, MODE_AUTO_CLOSE, MODE_AUTO_CLOSE );
+
+    glyphs_offset = (BAKED_FONT_HEADER_SIZE + BAKED_FONT_ALIGNMENT - 1) &
+        ~(size_t)(BAKED_FONT_ALIGNMENT - 1);
+    kerning_offset = glyphs_offset + count * BAKED_GLYPH_SIZE;
+    atlas_offset = (kerning_offset + pairs->size * BAKED_KERNING_SIZE +
+                    BAKED_FONT_ALIGNMENT - 1) & ~(size_t)(BAKED_FONT_ALIGNMENT - 1);
+    size = atlas_offset + atlas_size;
+    if( size > UINT32_MAX )
+        goto oom;
+    data = (unsigned char *) calloc( 1, size );
+    if( !data )
+        goto oom;
+
+    memcpy( data, baked_font_magic, sizeof(baked_font_magic) );
+    p = baked_put_u32( data + BAKED_VERSION, BAKED_FONT_VERSION );
+    p = baked_put_u32( p, 0 );
+    p = baked_put_f32( p, font->size );
+    p = baked_put_f32( p, font->height );
+    p = baked_put_f32( p, font->linegap );
+    p = baked_put_f32( p, font->ascender );
+    p = baked_put_f32( p, font->descender );
+    p = baked_put_f32( p, font->underline_position );
+    p = baked_put_f32( p, font->underline_thickness );
+    p = baked_put_u32( p, font->rendermode );
+    p = baked_put_f32( p, font->outline_thickness );
+    p = baked_put_u32( p, (uint32_t) atlas->width );
+    p = baked_put_u32( p, (uint32_t) atlas->height );
+    p = baked_put_u32( p, (uint32_t) atlas->depth );
+    p = baked_put_f32( p, special ? special->s0 : 0 );
+    p = baked_put_f32( p, special ? special->t0 : 0 );
+    p = baked_put_f32( p, special ? special->s1 : 0 );
+    p = baked_put_f32( p, special ? special->t1 : 0 );
+    p = baked_put_u32( p, (uint32_t) count );
+    p = baked_put_u32( p, (uint32_t) glyphs_offset );
+    p = baked_put_u32( p, (uint32_t) pairs->size );
+    p = baked_put_u32( p, (uint32_t) kerning_offset );
+    p = baked_put_u32( p, (uint32_t) atlas_offset );
+    baked_put_u32( p, (uint32_t) size );
+
+    for( i = 0; i < count; i++ )
+    {
+        glyph = glyphs[i];
+        p = data + glyphs_offset + i * BAKED_GLYPH_SIZE;
+        p = baked_put_u32( p, glyph->codepoint );
+        p = baked_put_u32( p, (uint32_t) glyph->x );
+        p = baked_put_u32( p, (uint32_t) glyph->y );
+        p = baked_put_u32( p, (uint32_t) glyph->width );
+        p = baked_put_u32( p, (uint32_t) glyph->height );
+        p = baked_put_u32( p, (uint32_t) glyph->offset_x );
+        p = baked_put_u32( p, (uint32_t) glyph->offset_y );
+        p = baked_put_f32( p, glyph->advance_x );
+        p = baked_put_f32( p, glyph->advance_y );
+        p = baked_put_f32( p, glyph->s0 );
+        p = baked_put_f32( p, glyph->t0 );
+        p = baked_put_f32( p, glyph->s1 );
+        p = baked_put_f32( p, glyph->t1 );
+        p = baked_put_u32( p, (uint32_t) glyph->data_x );
+        p = baked_put_u32( p, (uint32_t) glyph->data_y );
+        p = baked_put_u32( p, (uint32_t) glyph->data_width );
+        p = baked_put_u32( p, (uint32_t) glyph->data_height );
+        p = baked_put_u32( p, glyph->glyphmode );
+        p = baked_put_u32( p, (uint32_t) first[i] );
+        baked_put_u32( p, (uint32_t) (first[i+1] - first[i]) );
+    }
+    p = data + kerning_offset;
+    for( i = 0; i < pairs->size; i++ )
+    {
+        pair = (texture_glyph_kerning_t *) vector_get( pairs, i );
+        p = baked_put_u32( p, pair->codepoint );
+        p = baked_put_u32( p, (uint32_t) (int32_t) pair->kerning );
+    }
+    memcpy( data + atlas_offset, atlas->data, atlas_size );
+
+    if( !(file = fopen( filename, "wb" )) )
+    {
+        freetype_gl_error( Cannot_Load_File );
+        goto done;
+    }
+    status = fwrite( data, size, 1, file ) == 1;
+    status = !fclose( file ) && status;
+    if( !status )
+        freetype_gl_error( Cannot_Load_File );
+    goto done;
+
+oom:
+    freetype_gl_error( Out_Of_Memory );
+done:
+    free( data );
+    if( pairs )
+        vector_delete( pairs );
+    free( first );
+    free( glyphs );
+    return status;
+}
@@ -0,0 +1,257 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#ifndef __BAKED_FONT_H__
+#define __BAKED_FONT_H__
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "texture-font.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef __cplusplus
+namespace ftgl {
+#endif
+
+/**
+ * @file   baked-font.h
+ *
+ * @defgroup baked-font Baked font
+ *
+ * A baked font is a font rendered offline (see makefont --binary) and saved
+ * with its atlas in a single binary file, that is mapped in memory as is
+ * when loaded. The atlas of the texture font made from it points into the
+ * mapped file, and its glyphs are unpacked when first looked up, so loading
+ * takes the same time whatever the number of glyphs.
+ *
+ * Baked fonts need no FreeType at run time: texture_font_new_from_file also
+ * opens them, copying their glyphs into a shared atlas such as the one of a
+ * font manager, and they are the only fonts of a build with
+ * FTGL_NO_FREETYPE.
+ *
+ * The file is little-endian with 32 bits fields, so that it is the same on
+ * every platform, and holds only offsets from its start:
+ *
+ *  - a header: magic "FTGLBAKE", version, font metrics, render mode, atlas
+ *    size and depth, texture coordinates of the atlas special glyph, then
+ *    count and offset of the glyphs, the kerning pairs and the atlas pixels
+ *  - the glyphs, sorted by codepoint, each with its metrics, texture
+ *    coordinates and the range of its kerning pairs
+ *  - the kerning pairs, grouped by right glyph and sorted by left codepoint,
+ *    in 1/KERNING_COMPACT_SCALE pixels
+ *  - the atlas pixels, row by row
+ *
+ * <b>Example Usage</b>:
+ * @code
+ * #include "baked-font.h"
+ *
+ * int main( int arrgc, char *argv[] )
+ * {
+ *   baked_font_t * baked = baked_font_load( "font.ftgl" );
+ *   texture_font_t * font = texture_font_new_from_baked( baked );
+ *   texture_atlas_t * atlas = font->atlas;
+ *
+ *   baked_font_release( baked );
+ *   ...
+ *   texture_font_delete( font );
+ *   texture_atlas_delete( atlas );
+ *   return 0;
+ * }
+ * @endcode
+ *
+ * @{
+ */
+
+/** Version of the baked font format */
+#define BAKED_FONT_VERSION 1
+
+/**
+ * A glyph of a baked font, decoded from the file.
+ */
+typedef struct baked_glyph_t
+{
+    /** Unicode codepoint, 0 for the glyph of missing codepoints */
+    uint32_t codepoint;
+
+    /** Position and size of the glyph in the atlas, padding included */
+    uint32_t x, y, width, height;
+
+    /** Glyph offset */
+    int32_t offset_x, offset_y;
+
+    /** Advance */
+    float advance_x, advance_y;
+
+    /** Texture coordinates */
+    float s0, t0, s1, t1;
+
+    /** Position and size of the glyph in the atlas, padding excluded */
+    uint32_t data_x, data_y, data_width, data_height;
+
+    /** Glyph mode */
+    uint32_t glyphmode;
+
+    /** Index of the first kerning pair of the glyph */
+    uint32_t kerning_first;
+
+    /** Number of kerning pairs of the glyph */
+    uint32_t kerning_count;
+} baked_glyph_t;
+
+/**
+ * A baked font file, mapped in memory.
+ */
+typedef struct baked_font_t
+{
+    /** Start of the file in memory */
+    unsigned char * base;
+
+    /** Size of the file */
+    size_t size;
+
+    /** Whether base is a mapping of the file to unmap on release */
+    int mapped;
+
+    /** Number of references, the file is released when it drops to 0 */
+    size_t references;
+
+    /** Font size */
+    float font_size;
+
+    /** Font metrics */
+    float height, linegap, ascender, descender;
+
+    /** Underline metrics */
+    float underline_position, underline_thickness;
+
+    /** Render mode the glyphs were rendered in */
+    rendermode_t rendermode;
+
+    /** Outline thickness the glyphs were rendered with */
+    float outline_thickness;
+
+    /** Atlas size and depth */
+    size_t atlas_width, atlas_height, atlas_depth;
+
+    /** Texture coordinates of the atlas special glyph (s0, t0, s1, t1) */
+    float special[4];
+
+    /** Number of glyphs */
+    size_t glyph_count;
+
+    /** Number of kerning pairs */
+    size_t kerning_count;
+
+    /** Glyph records */
+    const unsigned char * glyphs;
+
+    /** Kerning records */
+    const unsigned char * kerning;
+
+    /** Atlas pixels */
+    unsigned char * pixels;
+} baked_font_t;
+
+
+/**
+ * Maps a baked font file in memory. The pages are private to the process:
+ * writing the atlas does not change the file.
+ *
+ * @param   filename  a file written by baked_font_save
+ * @return            a baked font with one reference, or NULL if the file
+ *                    cannot be mapped or is not a valid baked font
+ */
+  baked_font_t *
+  baked_font_load( const char * filename );
+
+
+/**
+ * Uses a baked font already in memory, e.g. embedded in the program.
+ *
+ * @param   base  start of the baked font, which must outlive the font and
+ *                must be writable if its atlas is modified
+ * @param   size  size of the baked font
+ * @return        a baked font with one reference, or NULL if the memory is
+ *                not a valid baked font
+ */
+  baked_font_t *
+  baked_font_new_from_memory( void * base,
+                              size_t size );
+
+
+/**
+ * Tells whether memory starts like a baked font, e.g. to choose between
+ * baked_font_new_from_memory and FreeType.
+ *
+ * @param   data  start of a file
+ * @param   size  number of bytes available at data
+ * @return        1 if data starts with the baked font magic, 0 otherwise
+ */
+  int
+  baked_font_probe( const void * data,
+                    size_t size );
+
+
+/**
+ *  Drops a reference to a baked font, unmapping it with the last one.
+ *
+ *  @param self a baked font
+ */
+  void
+  baked_font_release( baked_font_t * self );
+
+
+/**
+ *  Looks up a glyph by binary search.
+ *
+ *  @param  self       a baked font
+ *  @param  codepoint  the codepoint
+ *  @param  glyph      set to the glyph when found
+ *  @return            1 if found, 0 otherwise or if its rectangle does not
+ *                     fit in the atlas
+ */
+  int
+  baked_font_find( const baked_font_t * self,
+                   uint32_t codepoint,
+                   baked_glyph_t * glyph );
+
+
+/**
+ *  Decodes the kerning pairs of a glyph.
+ *
+ *  @param  self   a baked font
+ *  @param  glyph  a glyph of the font
+ *  @param  pairs  glyph->kerning_count pairs to fill, sorted by codepoint
+ */
+  void
+  baked_font_get_kerning( const baked_font_t * self,
+                          const baked_glyph_t * glyph,
+                          texture_glyph_kerning_t * pairs );
+
+
+/**
+ *  Saves the glyphs, kerning and atlas of a texture font as a baked font.
+ *
+ *  @param  font      a texture font, with the glyphs of a single render mode,
+ *                    in an atlas packing its channels together
+ *  @param  filename  the file to write
+ *  @return           1 on success, 0 otherwise
+ */
+  int
+  baked_font_save( texture_font_t * font,
+                   const char * filename );
+
+/** @} */
+
+#ifdef __cplusplus
+}
+}
+#endif
+
+#endif /* __BAKED_FONT_H__ */
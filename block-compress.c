@@ -0,0 +1,812 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#ifdef FREETYPE_GL_THREADS
+# if defined(_WIN32) || defined(_WIN64)
+#  define WIN32_LEAN_AND_MEAN
+#  define NOMINMAX
+#  include <windows.h>
+# else
+#  include <pthread.h>
+# endif
+#endif
+#include "block-compress.h"
+
+/* Bytes of a block */
+#define BC4_BLOCK 8
+#define BC7_BLOCK 16
+
+/* Weights of the 16 colors between two BC7 endpoints, in 1/64 */
+static const int bc7_weights[16] = {
+    0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+/* Weights of the 4 colors or alphas between two endpoints of mode 5 */
+static const int bc7_weights2[4] = { 0, 21, 43, 64 };
+
+
+// ------------------------------------------------------------ block_fetch ---
+/* The 16 pixels of a block as RGBA, or grey levels for BC4, repeating the
+ * last column and row of the image past its edges */
+static void
+block_fetch( const unsigned char *pixels, size_t width, size_t height,
+             size_t depth, size_t bx, size_t by, unsigned char out[16][4] )
+{
+    const unsigned char *src;
+    size_t i, x, y, c;
+
+    for( i = 0; i < 16; i++ ) {
+        x = bx * 4 + (i & 3);
+        y = by * 4 + (i >> 2);
+        if( x >= width )
+            x = width - 1;
+        if( y >= height )
+            y = height - 1;
+        src = pixels + (y * width + x) * depth;
+        for( c = 0; c < 4; c++ )
+            out[i][c] = c < depth ? src[c] : 255;
+    }
+}
+
+
+// ---------------------------------------------------------- bc4_palette ---
+/* The 8 levels of a BC4 block: 6 interpolated ones and 0 and 255 when the
+ * first endpoint is not above the second */
+static void
+bc4_palette( int r0, int r1, int palette[8] )
+{
+    int i;
+
+    palette[0] = r0;
+    palette[1] = r1;
+    if( r0 > r1 ) {
+        for( i = 2; i < 8; i++ )
+            palette[i] = ((8 - i) * r0 + (i - 1) * r1 + 3) / 7;
+    } else {
+        for( i = 2; i < 6; i++ )
+            palette[i] = ((6 - i) * r0 + (i - 1) * r1 + 2) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+/* The nearest levels of the palette of endpoints, returns the error */
+static int
+bc4_indices( const unsigned char v[16], int r0, int r1, int indices[16] )
+{
+    int palette[8], i, k, d, best, error = 0;
+
+    bc4_palette( r0, r1, palette );
+    for( i = 0; i < 16; i++ ) {
+        best = 256 * 256;
+        for( k = 0; k < 8; k++ ) {
+            d = (palette[k] - v[i]) * (palette[k] - v[i]);
+            if( d < best ) {
+                best = d;
+                indices[i] = k;
+            }
+        }
+        error += best;
+    }
+    return error;
+}
+
+/* Least squares endpoints of the 8 level palette for its indices */
+static void
+bc4_refine( const unsigned char v[16], const int indices[16], int *r0, int *r1 )
+{
+    double a = 0, b = 0, c = 0, x0 = 0, x1 = 0, t, det;
+    int i;
+
+    for( i = 0; i < 16; i++ ) {
+        t = indices[i] == 0 ? 0 : indices[i] == 1 ? 1 : (indices[i] - 1) / 7.0;
+        a += (1 - t) * (1 - t);
+        b += (1 - t) * t;
+        c += t * t;
+        x0 += (1 - t) * v[i];
+        x1 += t * v[i];
+    }
+    det = a * c - b * b;
+    if( det < 1e-9 )
+        return;
+    *r0 = (int) floor( (c * x0 - b * x1) / det + 0.5 );
+    *r1 = (int) floor( (a * x1 - b * x0) / det + 0.5 );
+    *r0 = *r0 < 0 ? 0 : *r0 > 255 ? 255 : *r0;
+    *r1 = *r1 < 0 ? 0 : *r1 > 255 ? 255 : *r1;
+}
+
+// ----------------------------------------------------------- bc4_encode ---
+/* Encode a block both ways, 8 levels between the extremes or 6 between
+ * those of the levels other than 0 and 255, keeping the closest */
+static void
+bc4_encode( const unsigned char v[16], unsigned char *block )
+{
+    int indices[16], trial[16], r0 = 0, r1 = 255, t0, t1, error, e, i;
+    int lo = 255, hi = 0, lo6 = 255, hi6 = 0;
+    unsigned long long bits = 0;
+
+    for( i = 0; i < 16; i++ ) {
+        lo = v[i] < lo ? v[i] : lo;
+        hi = v[i] > hi ? v[i] : hi;
+        if( v[i] && v[i] < 255 ) {
+            lo6 = v[i] < lo6 ? v[i] : lo6;
+            hi6 = v[i] > hi6 ? v[i] : hi6;
+        }
+    }
+
+    /* 6 levels, with 0 and 255 exact: glyph edges between them */
+    if( lo6 > hi6 )
+        lo6 = 0, hi6 = 255;
+    r0 = lo6;
+    r1 = hi6;
+    error = bc4_indices( v, r0, r1, indices );
+
+    /* 8 levels, refined for their indices */
+    if( error && hi > lo ) {
+        t0 = hi;
+        t1 = lo;
+        for( i = 0; i < 2; i++ ) {
+            e = bc4_indices( v, t0, t1, trial );
+            if( e < error ) {
+                error = e;
+                r0 = t0;
+                r1 = t1;
+                memcpy( indices, trial, sizeof(indices) );
+            }
+            bc4_refine( v, trial, &t0, &t1 );
+            if( t0 <= t1 )
+                break;
+        }
+    }
+
+    block[0] = (unsigned char) r0;
+    block[1] = (unsigned char) r1;
+    for( i = 15; i >= 0; i-- )
+        bits = bits << 3 | (unsigned long long) indices[i];
+    for( i = 0; i < 6; i++ )
+        block[2 + i] = (unsigned char) (bits >> (8 * i));
+}
+
+// ----------------------------------------------------------- bc4_decode ---
+static void
+bc4_decode( const unsigned char *block, unsigned char out[16] )
+{
+    unsigned long long bits = 0;
+    int palette[8], i;
+
+    bc4_palette( block[0], block[1], palette );
+    for( i = 5; i >= 0; i-- )
+        bits = bits << 8 | block[2 + i];
+    for( i = 0; i < 16; i++ )
+        out[i] = (unsigned char) palette[(bits >> (3 * i)) & 7];
+}
+
+
+// ---------------------------------------------------------- bc7_quantize ---
+/* An endpoint as 7 bits a channel and a p-bit shared by its channels,
+ * the p-bit making it closest */
+static void
+bc7_quantize( const double e[4], int q[4], int *p )
+{
+    double error[2] = { 0, 0 }, d;
+    int bit, c, v, qs[2][4];
+
+    for( bit = 0; bit < 2; bit++ )
+        for( c = 0; c < 4; c++ ) {
+            v = (int) floor( (e[c] - bit) / 2 + 0.5 );
+            v = v < 0 ? 0 : v > 127 ? 127 : v;
+            qs[bit][c] = v;
+            d = (v << 1 | bit) - e[c];
+            error[bit] += d * d;
+        }
+    *p = error[1] < error[0];
+    memcpy( q, qs[*p], sizeof(qs[0]) );
+}
+
+/* The nearest colors between quantized endpoints, returns the error */
+static int
+bc7_indices( const unsigned char px[16][4], const int q[2][4], const int p[2],
+             int indices[16] )
+{
+    int palette[16][4], e0, e1, i, k, c, d, sum, best, error = 0;
+
+    for( c = 0; c < 4; c++ ) {
+        e0 = q[0][c] << 1 | p[0];
+        e1 = q[1][c] << 1 | p[1];
+        for( k = 0; k < 16; k++ )
+            palette[k][c] = ((64 - bc7_weights[k]) * e0 + bc7_weights[k] * e1 + 32) >> 6;
+    }
+    for( i = 0; i < 16; i++ ) {
+        best = 4 * 256 * 256;
+        for( k = 0; k < 16; k++ ) {
+            for( c = 0, sum = 0; c < 4; c++ ) {
+                d = palette[k][c] - px[i][c];
+                sum += d * d;
+            }
+            if( sum < best ) {
+                best = sum;
+                indices[i] = k;
+            }
+        }
+        error += best;
+    }
+    return error;
+}
+
+/* Least squares endpoints for the indices of the colors */
+static int
+bc7_refine( const unsigned char px[16][4], const int indices[16], double e[2][4] )
+{
+    double a = 0, b = 0, c2 = 0, x0[4] = { 0 }, x1[4] = { 0 }, t, det;
+    int i, c;
+
+    for( i = 0; i < 16; i++ ) {
+        t = bc7_weights[indices[i]] / 64.0;
+        a += (1 - t) * (1 - t);
+        b += (1 - t) * t;
+        c2 += t * t;
+        for( c = 0; c < 4; c++ ) {
+            x0[c] += (1 - t) * px[i][c];
+            x1[c] += t * px[i][c];
+        }
+    }
+    det = a * c2 - b * b;
+    if( det < 1e-9 )
+        return 0;
+    for( c = 0; c < 4; c++ ) {
+        e[0][c] = (c2 * x0[c] - b * x1[c]) / det;
+        e[1][c] = (a * x1[c] - b * x0[c]) / det;
+        e[0][c] = e[0][c] < 0 ? 0 : e[0][c] > 255 ? 255 : e[0][c];
+        e[1][c] = e[1][c] < 0 ? 0 : e[1][c] > 255 ? 255 : e[1][c];
+    }
+    return 1;
+}
+
+/* Append bits to a block, least significant first */
+static void
+bc7_put( unsigned char *block, int *pos, unsigned int value, int count )
+{
+    int i;
+
+    for( i = 0; i < count; i++, (*pos)++ )
+        if( value >> i & 1 )
+            block[*pos >> 3] |= (unsigned char) (1 << (*pos & 7));
+}
+
+static unsigned int
+bc7_get( const unsigned char *block, int *pos, int count )
+{
+    unsigned int value = 0;
+    int i;
+
+    for( i = 0; i < count; i++, (*pos)++ )
+        value |= (unsigned int) (block[*pos >> 3] >> (*pos & 7) & 1) << i;
+    return value;
+}
+
+// ------------------------------------------------------------- bc7_axis ---
+/* Endpoints of the first channels of the colors at the ends of their
+ * principal axis, found by power iteration */
+static void
+bc7_axis( const unsigned char px[16][4], int channels, double e[2][4] )
+{
+    double mean[4] = { 0 }, cov[4][4] = { { 0 } }, axis[4] = { 1, 1, 1, 1 };
+    double next[4], d[4], t, lo = 0, hi = 0, norm;
+    int i, k, c;
+
+    for( i = 0; i < 16; i++ )
+        for( c = 0; c < channels; c++ )
+            mean[c] += px[i][c] / 16.0;
+    for( i = 0; i < 16; i++ ) {
+        for( c = 0; c < channels; c++ )
+            d[c] = px[i][c] - mean[c];
+        for( c = 0; c < channels; c++ )
+            for( k = 0; k < channels; k++ )
+                cov[c][k] += d[c] * d[k];
+    }
+    for( i = 0; i < 8; i++ ) {
+        for( c = 0, norm = 0; c < channels; c++ ) {
+            for( k = 0, next[c] = 0; k < channels; k++ )
+                next[c] += cov[c][k] * axis[k];
+            norm += next[c] * next[c];
+        }
+        if( norm < 1e-12 )
+            break;
+        norm = sqrt( norm );
+        for( c = 0; c < channels; c++ )
+            axis[c] = next[c] / norm;
+    }
+    if( i == 0 )
+        axis[0] = axis[1] = axis[2] = axis[3] = 0;
+    for( i = 0; i < 16; i++ ) {
+        for( c = 0, t = 0; c < channels; c++ )
+            t += (px[i][c] - mean[c]) * axis[c];
+        lo = !i || t < lo ? t : lo;
+        hi = !i || t > hi ? t : hi;
+    }
+    for( c = 0; c < channels; c++ ) {
+        e[0][c] = mean[c] + lo * axis[c];
+        e[1][c] = mean[c] + hi * axis[c];
+        e[0][c] = e[0][c] < 0 ? 0 : e[0][c] > 255 ? 255 : e[0][c];
+        e[1][c] = e[1][c] < 0 ? 0 : e[1][c] > 255 ? 255 : e[1][c];
+    }
+}
+
+// ---------------------------------------------------------- bc7_encode6 ---
+/* Encode a block in mode 6: endpoints at the ends of the principal axis
+ * of the colors, then refined for the indices they give. Returns the
+ * error. */
+static int
+bc7_encode6( const unsigned char px[16][4], unsigned char *block )
+{
+    double e[2][4];
+    int q[2][4], p[2], tq[2][4], tp[2], indices[16], trial[16];
+    int i, c, error, err, swap, pos = 0;
+
+    bc7_axis( px, 4, e );
+    bc7_quantize( e[0], q[0], &p[0] );
+    bc7_quantize( e[1], q[1], &p[1] );
+    error = bc7_indices( px, q, p, indices );
+
+    /* A flat block: endpoints on either side of its color */
+    if( error && !memcmp( q[0], q[1], sizeof(q[0]) ) && p[0] == p[1] ) {
+        for( c = 0; c < 4; c++ ) {
+            tq[0][c] = px[0][c] >> 1;
+            tq[1][c] = (px[0][c] - 1) < 0 ? 0 : (px[0][c] - 1) >> 1;
+        }
+        tp[0] = 0;
+        tp[1] = 1;
+        if( (err = bc7_indices( px, tq, tp, trial )) < error ) {
+            error = err;
+            memcpy( q, tq, sizeof(q) );
+            memcpy( p, tp, sizeof(p) );
+            memcpy( indices, trial, sizeof(indices) );
+        }
+    }
+
+    memcpy( trial, indices, sizeof(trial) );
+    for( i = 0; i < 2 && error; i++ ) {
+        if( !bc7_refine( px, trial, e ) )
+            break;
+        bc7_quantize( e[0], tq[0], &tp[0] );
+        bc7_quantize( e[1], tq[1], &tp[1] );
+        if( (err = bc7_indices( px, tq, tp, trial )) >= error )
+            break;
+        error = err;
+        memcpy( q, tq, sizeof(q) );
+        memcpy( p, tp, sizeof(p) );
+        memcpy( indices, trial, sizeof(indices) );
+    }
+
+    /* The first index has an implicit top bit of 0 */
+    swap = indices[0] >= 8;
+    memset( block, 0, BC7_BLOCK );
+    bc7_put( block, &pos, 1 << 6, 7 );
+    for( c = 0; c < 4; c++ ) {
+        bc7_put( block, &pos, (unsigned int) q[swap][c], 7 );
+        bc7_put( block, &pos, (unsigned int) q[!swap][c], 7 );
+    }
+    bc7_put( block, &pos, (unsigned int) p[swap], 1 );
+    bc7_put( block, &pos, (unsigned int) p[!swap], 1 );
+    for( i = 0; i < 16; i++ )
+        bc7_put( block, &pos, (unsigned int) (swap ? 15 - indices[i] : indices[i]),
+                 i ? 4 : 3 );
+    return error;
+}
+
+// ----------------------------------------------------------- bc7_fit5 ---
+/* Endpoints and 4 level indices of channels first to last of the colors in
+ * mode 5, 7 bit colors or 8 bit alphas, refined for their indices. Returns
+ * the error. */
+static int
+bc7_fit5( const unsigned char px[16][4], int first, int last, int bits,
+          int q[2][4], int indices[16] )
+{
+    double e[2][4], a, b, c2, x0, x1, t, det;
+    int levels[2][4], palette[4][4], trial[16], tq[2][4];
+    int pass, i, k, c, d, sum, best, err, error = -1;
+
+    if( first == 3 ) {
+        e[0][3] = e[1][3] = px[0][3];
+        for( i = 1; i < 16; i++ ) {
+            e[0][3] = px[i][3] < e[0][3] ? px[i][3] : e[0][3];
+            e[1][3] = px[i][3] > e[1][3] ? px[i][3] : e[1][3];
+        }
+    } else {
+        bc7_axis( px, 3, e );
+    }
+    for( pass = 0; pass < 3; pass++ ) {
+        for( k = 0; k < 2; k++ )
+            for( c = first; c < last; c++ ) {
+                tq[k][c] = (int) floor( e[k][c] * ((1 << bits) - 1) / 255 + 0.5 );
+                levels[k][c] = bits == 8 ? tq[k][c] : tq[k][c] << 1 | tq[k][c] >> 6;
+            }
+        for( k = 0; k < 4; k++ )
+            for( c = first; c < last; c++ )
+                palette[k][c] = ((64 - bc7_weights2[k]) * levels[0][c] +
+                                 bc7_weights2[k] * levels[1][c] + 32) >> 6;
+        for( i = 0, err = 0; i < 16; i++ ) {
+            best = 4 * 256 * 256;
+            for( k = 0; k < 4; k++ ) {
+                for( c = first, sum = 0; c < last; c++ ) {
+                    d = palette[k][c] - px[i][c];
+                    sum += d * d;
+                }
+                if( sum < best ) {
+                    best = sum;
+                    trial[i] = k;
+                }
+            }
+            err += best;
+        }
+        if( error >= 0 && err >= error )
+            break;
+        error = err;
+        for( c = first; c < last; c++ )
+            q[0][c] = tq[0][c], q[1][c] = tq[1][c];
+        memcpy( indices, trial, sizeof(trial) );
+        if( !error )
+            break;
+
+        /* Least squares endpoints for the indices */
+        a = b = c2 = 0;
+        for( i = 0; i < 16; i++ ) {
+            t = bc7_weights2[trial[i]] / 64.0;
+            a += (1 - t) * (1 - t);
+            b += (1 - t) * t;
+            c2 += t * t;
+        }
+        det = a * c2 - b * b;
+        if( det < 1e-9 )
+            break;
+        for( c = first; c < last; c++ ) {
+            for( i = 0, x0 = x1 = 0; i < 16; i++ ) {
+                t = bc7_weights2[trial[i]] / 64.0;
+                x0 += (1 - t) * px[i][c];
+                x1 += t * px[i][c];
+            }
+            e[0][c] = (c2 * x0 - b * x1) / det;
+            e[1][c] = (a * x1 - b * x0) / det;
+            e[0][c] = e[0][c] < 0 ? 0 : e[0][c] > 255 ? 255 : e[0][c];
+            e[1][c] = e[1][c] < 0 ? 0 : e[1][c] > 255 ? 255 : e[1][c];
+        }
+    }
+    return error;
+}
+
+// ---------------------------------------------------------- bc7_encode5 ---
+/* Encode a block in mode 5: colors and alphas with endpoints and indices
+ * of their own, for alpha that does not follow color. Returns the error. */
+static int
+bc7_encode5( const unsigned char px[16][4], unsigned char *block )
+{
+    int q[2][4], colors[16], alphas[16], error, i, c, swap, swap_alpha, pos = 0;
+
+    error = bc7_fit5( px, 0, 3, 7, q, colors ) + bc7_fit5( px, 3, 4, 8, q, alphas );
+
+    /* The first indices have an implicit top bit of 0 */
+    swap = colors[0] >= 2;
+    swap_alpha = alphas[0] >= 2;
+    memset( block, 0, BC7_BLOCK );
+    bc7_put( block, &pos, 1 << 5, 6 );
+    bc7_put( block, &pos, 0, 2 );
+    for( c = 0; c < 3; c++ ) {
+        bc7_put( block, &pos, (unsigned int) q[swap][c], 7 );
+        bc7_put( block, &pos, (unsigned int) q[!swap][c], 7 );
+    }
+    bc7_put( block, &pos, (unsigned int) q[swap_alpha][3], 8 );
+    bc7_put( block, &pos, (unsigned int) q[!swap_alpha][3], 8 );
+    for( i = 0; i < 16; i++ )
+        bc7_put( block, &pos, (unsigned int) (swap ? 3 - colors[i] : colors[i]),
+                 i ? 2 : 1 );
+    for( i = 0; i < 16; i++ )
+        bc7_put( block, &pos, (unsigned int) (swap_alpha ? 3 - alphas[i] : alphas[i]),
+                 i ? 2 : 1 );
+    return error;
+}
+
+// ----------------------------------------------------------- bc7_encode ---
+/* Encode a block in mode 6, or in mode 5 when that is closer */
+static void
+bc7_encode( const unsigned char px[16][4], unsigned char *block )
+{
+    unsigned char mode5[BC7_BLOCK];
+    int error;
+
+    if( !(error = bc7_encode6( px, block )) )
+        return;
+    if( bc7_encode5( px, mode5 ) < error )
+        memcpy( block, mode5, BC7_BLOCK );
+}
+
+// ----------------------------------------------------------- bc7_decode ---
+static void
+bc7_decode( const unsigned char *block, unsigned char out[16][4] )
+{
+    int e[2][4], i, c, w, wa, pos;
+
+    if( (block[0] & 0x3F) == 0x20 ) {
+        /* Mode 5, without rotation */
+        pos = 8;
+        for( c = 0; c < 3; c++ )
+            for( i = 0; i < 2; i++ ) {
+                e[i][c] = (int) bc7_get( block, &pos, 7 );
+                e[i][c] = e[i][c] << 1 | e[i][c] >> 6;
+            }
+        e[0][3] = (int) bc7_get( block, &pos, 8 );
+        e[1][3] = (int) bc7_get( block, &pos, 8 );
+        for( i = 0; i < 16; i++ ) {
+            w = bc7_weights2[bc7_get( block, &pos, i ? 2 : 1 )];
+            for( c = 0; c < 3; c++ )
+                out[i][c] = (unsigned char) (((64 - w) * e[0][c] + w * e[1][c] + 32) >> 6);
+        }
+        for( i = 0; i < 16; i++ ) {
+            wa = bc7_weights2[bc7_get( block, &pos, i ? 2 : 1 )];
+            out[i][3] = (unsigned char) (((64 - wa) * e[0][3] + wa * e[1][3] + 32) >> 6);
+        }
+        return;
+    }
+    if( (block[0] & 0x7F) != 0x40 ) {
+        for( i = 0; i < 16; i++ ) {
+            out[i][0] = out[i][2] = out[i][3] = 255;
+            out[i][1] = 0;
+        }
+        return;
+    }
+    pos = 7;
+    for( c = 0; c < 4; c++ ) {
+        e[0][c] = (int) bc7_get( block, &pos, 7 ) << 1;
+        e[1][c] = (int) bc7_get( block, &pos, 7 ) << 1;
+    }
+    i = (int) bc7_get( block, &pos, 1 );
+    for( c = 0; c < 4; c++ )
+        e[0][c] |= i;
+    i = (int) bc7_get( block, &pos, 1 );
+    for( c = 0; c < 4; c++ )
+        e[1][c] |= i;
+    for( i = 0; i < 16; i++ ) {
+        w = bc7_weights[bc7_get( block, &pos, i ? 4 : 3 )];
+        for( c = 0; c < 4; c++ )
+            out[i][c] = (unsigned char) (((64 - w) * e[0][c] + w * e[1][c] + 32) >> 6);
+    }
+}
+
+
+// ------------------------------------------------------ block_compress_at ---
+/* Compress the block at a column and row of blocks */
+static void
+block_compress_at( block_format_t format, const unsigned char *pixels,
+                   size_t width, size_t height, size_t depth,
+                   size_t bx, size_t by, unsigned char *blocks )
+{
+    unsigned char px[16][4], v[16];
+    size_t columns = (width + 3) / 4, i;
+
+    block_fetch( pixels, width, height, depth, bx, by, px );
+    if( format == BLOCK_BC4 ) {
+        for( i = 0; i < 16; i++ )
+            v[i] = px[i][0];
+        bc4_encode( v, blocks + (by * columns + bx) * BC4_BLOCK );
+    } else {
+        bc7_encode( (const unsigned char (*)[4]) px,
+                    blocks + (by * columns + bx) * BC7_BLOCK );
+    }
+}
+
+/* Rows of blocks a thread compresses, every step rows from the first */
+typedef struct block_job_t
+{
+    block_format_t format;
+    const unsigned char *pixels;
+    size_t width, height, depth;
+    unsigned char *blocks;
+    size_t first, step;
+    int started;
+} block_job_t;
+
+// ----------------------------------------------------- block_compress_job ---
+#if defined(_WIN32) || defined(_WIN64)
+static DWORD WINAPI
+#else
+static void *
+#endif
+block_compress_job( void * data )
+{
+    block_job_t *job = (block_job_t *) data;
+    size_t rows = (job->height + 3) / 4, columns = (job->width + 3) / 4, x, y;
+
+    for( y = job->first; y < rows; y += job->step )
+        for( x = 0; x < columns; x++ )
+            block_compress_at( job->format, job->pixels, job->width, job->height,
+                               job->depth, x, y, job->blocks );
+    return 0;
+}
+
+
+// -------------------------------------------------- block_compress_format ---
+block_format_t
+block_compress_format( size_t depth )
+{
+    return depth == 1 ? BLOCK_BC4 : BLOCK_BC7;
+}
+
+// ---------------------------------------------------- block_compress_name ---
+const char *
+block_compress_name( block_format_t format )
+{
+    return format == BLOCK_BC4 ? "BC4" : "BC7";
+}
+
+// ---------------------------------------------------- block_compress_size ---
+size_t
+block_compress_size( block_format_t format,
+                     size_t width,
+                     size_t height )
+{
+    return ((width + 3) / 4) * ((height + 3) / 4) *
+           (format == BLOCK_BC4 ? BC4_BLOCK : BC7_BLOCK);
+}
+
+// --------------------------------------------------------- block_compress ---
+void
+block_compress( block_format_t format,
+                const unsigned char * pixels,
+                size_t width,
+                size_t height,
+                size_t depth,
+                unsigned char * blocks,
+                size_t threads )
+{
+    block_job_t jobs[64];
+    size_t i;
+#ifdef FREETYPE_GL_THREADS
+# if defined(_WIN32) || defined(_WIN64)
+    HANDLE handles[64];
+# else
+    pthread_t handles[64];
+# endif
+#endif
+
+    assert( pixels && blocks );
+    assert( format == BLOCK_BC4 ? depth == 1 : depth == 3 || depth == 4 );
+
+    if( !width || !height )
+        return;
+    if( threads < 1 )
+        threads = 1;
+    if( threads > 64 )
+        threads = 64;
+    if( threads > (height + 3) / 4 )
+        threads = (height + 3) / 4;
+    for( i = 0; i < threads; ++i )
+    {
+        jobs[i].format = format;
+        jobs[i].pixels = pixels;
+        jobs[i].width = width;
+        jobs[i].height = height;
+        jobs[i].depth = depth;
+        jobs[i].blocks = blocks;
+        jobs[i].first = i;
+        jobs[i].step = threads;
+        jobs[i].started = 0;
+#ifdef FREETYPE_GL_THREADS
+        if( threads > 1 )
+        {
+# if defined(_WIN32) || defined(_WIN64)
+            handles[i] = CreateThread( NULL, 0, block_compress_job, jobs + i, 0, NULL );
+            jobs[i].started = handles[i] != NULL;
+# else
+            jobs[i].started = !pthread_create( &handles[i], NULL,
+                                               block_compress_job, jobs + i );
+# endif
+        }
+#endif
+        /* Without a thread, do its share here */
+        if( !jobs[i].started )
+            block_compress_job( jobs + i );
+    }
+#ifdef FREETYPE_GL_THREADS
+    for( i = 0; i < threads; ++i )
+    {
+        if( !jobs[i].started )
+            continue;
+# if defined(_WIN32) || defined(_WIN64)
+        WaitForSingleObject( handles[i], INFINITE );
+        CloseHandle( handles[i] );
+# else
+        pthread_join( handles[i], NULL );
+# endif
+    }
+#endif
+}
+
+// ---------------------------------------------------- block_compress_rect ---
+void
+block_compress_rect( block_format_t format,
+                     const unsigned char * pixels,
+                     size_t width,
+                     size_t height,
+                     size_t depth,
+                     size_t x,
+                     size_t y,
+                     size_t rect_width,
+                     size_t rect_height,
+                     unsigned char * blocks )
+{
+    size_t bx, by;
+
+    assert( pixels && blocks );
+    assert( x + rect_width <= width && y + rect_height <= height );
+
+    if( !rect_width || !rect_height )
+        return;
+    for( by = y / 4; by <= (y + rect_height - 1) / 4; by++ )
+        for( bx = x / 4; bx <= (x + rect_width - 1) / 4; bx++ )
+            block_compress_at( format, pixels, width, height, depth, bx, by, blocks );
+}
+
+// ------------------------------------------------------- block_decompress ---
+void
+block_decompress( block_format_t format,
+                  const unsigned char * blocks,
+                  size_t width,
+                  size_t height,
+                  unsigned char * pixels )
+{
+    unsigned char px[16][4], v[16];
+    size_t columns = (width + 3) / 4, rows = (height + 3) / 4, bx, by, x, y, i;
+
+    assert( blocks && pixels );
+
+    for( by = 0; by < rows; by++ )
+        for( bx = 0; bx < columns; bx++ ) {
+            if( format == BLOCK_BC4 )
+                bc4_decode( blocks + (by * columns + bx) * BC4_BLOCK, v );
+            else
+                bc7_decode( blocks + (by * columns + bx) * BC7_BLOCK, px );
+            for( i = 0; i < 16; i++ ) {
+                x = bx * 4 + (i & 3);
+                y = by * 4 + (i >> 2);
+                if( x >= width || y >= height )
+                    continue;
+                if( format == BLOCK_BC4 )
+                    pixels[y * width + x] = v[i];
+                else
+                    memcpy( pixels + (y * width + x) * 4, px[i], 4 );
+            }
+        }
+}
+
+// ---------------------------------------------------- block_compress_psnr ---
+double
+block_compress_psnr( block_format_t format,
+                     const unsigned char * pixels,
+                     size_t width,
+                     size_t height,
+                     size_t depth,
+                     const unsigned char * blocks )
+{
+    size_t channels = format == BLOCK_BC4 ? 1 : 4, i, c;
+    unsigned char *decoded;
+    double sum = 0, d;
+
+    if( !width || !height )
+        return 99;
+    if( !(decoded = (unsigned char *) malloc( width * height * channels )) )
+        return -1;
+    block_decompress( format, blocks, width, height, decoded );
+    for( i = 0; i < width * height; i++ )
+        for( c = 0; c < depth; c++ ) {
+            d = (double) decoded[i * channels + c] - pixels[i * depth + c];
+            sum += d * d;
+        }
+    free( decoded );
+    if( !sum )
+        return 99;
+    return 10 * log10( 255.0 * 255.0 * width * height * depth / sum );
+}
@@ -0,0 +1,208 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#ifndef __BLOCK_COMPRESS_H__
+#define __BLOCK_COMPRESS_H__
+
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+namespace ftgl {
+#endif
+
+/**
+ * @file   block-compress.h
+ *
+ * @defgroup block-compress Block compression
+ *
+ * Compression of images to the 4x4 blocks of the BC4 (RGTC1) and BC7
+ * (BPTC) texture formats, which GPUs sample without decompressing them:
+ * a quarter of the memory of grey levels, and of RGBA pixels.
+ *
+ * BC4 blocks hold a single channel, for atlases of depth 1 such as signed
+ * distance fields. BC7 blocks hold RGBA pixels, for atlases of depth 3 or
+ * 4, and are encoded in mode 6, one pair of 7.7.7.7 endpoints with a p-bit
+ * each and 16 interpolated colors, or in mode 5 when closer, colors and
+ * alphas apart, as around the white glyphs of an RGBA atlas with its
+ * transparent black padding. Images of any size are
+ * compressed, the blocks past their right and bottom edges repeating
+ * their last column and row.
+ *
+ * Everything is done on the CPU, on several threads when built with them,
+ * and images decode back to measure the error against the original.
+ *
+ * <b>Example Usage</b>:
+ * @code
+ * #include "block-compress.h"
+ *
+ * int main( int arrgc, char *argv[] )
+ * {
+ *   unsigned char grey[16] = { 0 }, block[8];
+ *
+ *   block_compress( BLOCK_BC4, grey, 4, 4, 1, block, 1 );
+ *
+ *   return 0;
+ * }
+ * @endcode
+ *
+ * @{
+ */
+
+/**
+ * Block compressed formats.
+ */
+typedef enum block_format_t
+{
+    /**
+     * BC4 (GL_COMPRESSED_RED_RGTC1): a channel in 8 bytes a block
+     */
+    BLOCK_BC4 = 0,
+
+    /**
+     * BC7 (GL_COMPRESSED_RGBA_BPTC_UNORM): RGBA pixels in 16 bytes a block
+     */
+    BLOCK_BC7
+} block_format_t;
+
+
+/**
+ * Returns the format an image of a depth compresses to.
+ *
+ * @param   depth  1, 3 or 4 bytes a pixel
+ * @return         BLOCK_BC4 for depth 1, BLOCK_BC7 otherwise
+ */
+  block_format_t
+  block_compress_format( size_t depth );
+
+
+/**
+ * Returns the name of a format.
+ *
+ * @param   format  a block compressed format
+ * @return          its name, such as "BC4"
+ */
+  const char *
+  block_compress_name( block_format_t format );
+
+
+/**
+ * Returns the size of a compressed image.
+ *
+ * @param   format  a block compressed format
+ * @param   width   width of the image in pixels
+ * @param   height  height of the image in pixels
+ * @return          bytes of its blocks, row after row of blocks
+ */
+  size_t
+  block_compress_size( block_format_t format,
+                       size_t width,
+                       size_t height );
+
+
+/**
+ * Compresses an image.
+ *
+ * @param  format   a block compressed format
+ * @param  pixels   width * height pixels of depth bytes, row after row
+ * @param  width    width of the image
+ * @param  height   height of the image
+ * @param  depth    1 for BLOCK_BC4, 3 or 4 for BLOCK_BC7 (alpha then
+ *                  being 255)
+ * @param  blocks   block_compress_size bytes
+ * @param  threads  number of threads the rows of blocks are compressed on,
+ *                  0 or 1 to compress them on the calling thread
+ */
+  void
+  block_compress( block_format_t format,
+                  const unsigned char * pixels,
+                  size_t width,
+                  size_t height,
+                  size_t depth,
+                  unsigned char * blocks,
+                  size_t threads );
+
+
+/**
+ * Compresses again the blocks of an image a rectangle of pixels touches,
+ * the others being left as they are.
+ *
+ * @param  format   a block compressed format
+ * @param  pixels   width * height pixels of depth bytes, row after row
+ * @param  width    width of the image
+ * @param  height   height of the image
+ * @param  depth    bytes a pixel (see block_compress)
+ * @param  x        left of the rectangle
+ * @param  y        top of the rectangle
+ * @param  rect_width   width of the rectangle
+ * @param  rect_height  height of the rectangle
+ * @param  blocks   block_compress_size bytes, the image compressed
+ */
+  void
+  block_compress_rect( block_format_t format,
+                       const unsigned char * pixels,
+                       size_t width,
+                       size_t height,
+                       size_t depth,
+                       size_t x,
+                       size_t y,
+                       size_t rect_width,
+                       size_t rect_height,
+                       unsigned char * blocks );
+
+
+/**
+ * Decompresses an image compressed by block_compress. BC7 blocks of modes
+ * other than 5 and 6, or mode 5 blocks with a rotation, decode to magenta.
+ *
+ * @param  format   a block compressed format
+ * @param  blocks   block_compress_size bytes
+ * @param  width    width of the image
+ * @param  height   height of the image
+ * @param  pixels   width * height grey levels for BLOCK_BC4, RGBA pixels
+ *                  for BLOCK_BC7
+ */
+  void
+  block_decompress( block_format_t format,
+                    const unsigned char * blocks,
+                    size_t width,
+                    size_t height,
+                    unsigned char * pixels );
+
+
+/**
+ * Measures the peak signal to noise ratio of a compressed image against
+ * the original, over its depth channels.
+ *
+ * @param  format   a block compressed format
+ * @param  pixels   width * height pixels of depth bytes, the original
+ * @param  width    width of the image
+ * @param  height   height of the image
+ * @param  depth    bytes a pixel (see block_compress)
+ * @param  blocks   block_compress_size bytes, the image compressed
+ * @return          the PSNR in dB, 99 or more when nearly lossless, a
+ *                  negative value if out of memory
+ */
+  double
+  block_compress_psnr( block_format_t format,
+                       const unsigned char * pixels,
+                       size_t width,
+                       size_t height,
+                       size_t depth,
+                       const unsigned char * blocks );
+
+/** @} */
+
+#ifdef __cplusplus
+}
+}
+#endif
+
+#endif /* __BLOCK_COMPRESS_H__ */
@@ -0,0 +1,130 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <assert.h>
+#include <stdlib.h>
+#include "cmap-cache.h"
+#include "ftgl-utils.h"
+
+
+// --------------------------------------------------------- cmap_cache_new ---
+cmap_cache_t *
+cmap_cache_new( void )
+{
+    cmap_cache_t *self = (cmap_cache_t *) calloc( 1, sizeof(cmap_cache_t) );
+
+    if( !self )
+        freetype_gl_error( Out_Of_Memory );
+    return self;
+}
+
+
+// ------------------------------------------------------ cmap_cache_delete ---
+void
+cmap_cache_delete( cmap_cache_t *self )
+{
+    size_t i;
+
+    assert( self );
+
+    for( i = 0; i < CMAP_CACHE_PAGES; i++ )
+        free( self->pages[i] );
+    if( self->astral )
+        hash_table_delete( self->astral );
+    free( self );
+}
+
+
+// --------------------------------------------------------- cmap_cache_set ---
+int
+cmap_cache_set( cmap_cache_t *self,
+                uint32_t codepoint,
+                uint32_t index )
+{
+    uint32_t *page;
+    int covered = cmap_cache_covers( self, codepoint );
+
+    assert( self );
+
+    if( codepoint < 0x10000 ) {
+        page = self->pages[codepoint / CMAP_CACHE_PAGE_SIZE];
+        if( !page ) {
+            if( !index )
+                return 1;
+            page = (uint32_t *) calloc( CMAP_CACHE_PAGE_SIZE, sizeof(uint32_t) );
+            if( !page ) {
+                freetype_gl_error( Out_Of_Memory );
+                return 0;
+            }
+            self->pages[codepoint / CMAP_CACHE_PAGE_SIZE] = page;
+        }
+        page[codepoint % CMAP_CACHE_PAGE_SIZE] = index;
+        if( index )
+            self->covered[codepoint / 32] |= 1u << (codepoint % 32);
+        else
+            self->covered[codepoint / 32] &= ~(1u << (codepoint % 32));
+    } else if( index ) {
+        if( !self->astral &&
+            !(self->astral = hash_table_new( sizeof(uint32_t), sizeof(uint32_t) )) )
+            return 0;
+        if( !hash_table_set( self->astral, &codepoint, &index ) )
+            return 0;
+    } else if( covered ) {
+        hash_table_erase( self->astral, &codepoint );
+    }
+
+    self->count += (index != 0) - covered;
+    return 1;
+}
+
+
+// --------------------------------------------------------- cmap_cache_get ---
+uint32_t
+cmap_cache_get( const cmap_cache_t *self,
+                uint32_t codepoint )
+{
+    const uint32_t *page, *index;
+
+    assert( self );
+
+    if( codepoint < 0x10000 ) {
+        page = self->pages[codepoint / CMAP_CACHE_PAGE_SIZE];
+        return page ? page[codepoint % CMAP_CACHE_PAGE_SIZE] : 0;
+    }
+    if( !self->astral )
+        return 0;
+    index = (const uint32_t *) hash_table_get( self->astral, &codepoint );
+    return index ? *index : 0;
+}
+
+
+// ------------------------------------------------------ cmap_cache_covers ---
+int
+cmap_cache_covers( const cmap_cache_t *self,
+                   uint32_t codepoint )
+{
+    assert( self );
+
+    if( codepoint < 0x10000 )
+        return (self->covered[codepoint / 32] >> (codepoint % 32)) & 1;
+    return self->astral && hash_table_get( self->astral, &codepoint );
+}
+
+
+// ------------------------------------------------------ cmap_cache_memory ---
+size_t
+cmap_cache_memory( const cmap_cache_t *self )
+{
+    size_t i, size = sizeof(cmap_cache_t);
+
+    assert( self );
+
+    for( i = 0; i < CMAP_CACHE_PAGES; i++ )
+        if( self->pages[i] )
+            size += CMAP_CACHE_PAGE_SIZE * sizeof(uint32_t);
+    if( self->astral )
+        size += hash_table_memory( self->astral );
+    return size;
+}
@@ -0,0 +1,155 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#ifndef __CMAP_CACHE_H__
+#define __CMAP_CACHE_H__
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "hash-table.h"
+
+#ifdef __cplusplus
+namespace ftgl {
+#endif
+
+/**
+ * @file   cmap-cache.h
+ *
+ * @defgroup cmap-cache Cmap cache
+ *
+ * The cmap cache maps Unicode codepoints to the glyph indices of a face. It
+ * is filled once from the character map of the face (see @ref texture-font)
+ * so that resolving a codepoint never goes through FreeType again. Codepoints
+ * of the Basic Multilingual Plane are found in pages of 256 indices,
+ * allocated only for the pages the face covers, and the other planes in a
+ * hash table. A bitmap of the covered BMP codepoints tells at once whether
+ * a face has a glyph for a codepoint.
+ *
+ * <b>Example Usage</b>:
+ * @code
+ * #include "cmap-cache.h"
+ *
+ * int main( int arrgc, char *argv[] )
+ * {
+ *   cmap_cache_t * cmap = cmap_cache_new( );
+ *
+ *   cmap_cache_set( cmap, 'A', 36 );
+ *   if( cmap_cache_covers( cmap, 'A' ) )
+ *     printf( "%u\n", cmap_cache_get( cmap, 'A' ) );
+ *   cmap_cache_delete( cmap );
+ *
+ *   return 0;
+ * }
+ * @endcode
+ *
+ * @{
+ */
+
+/** Number of codepoints of a page of the BMP */
+#define CMAP_CACHE_PAGE_SIZE 256
+
+/** Number of pages of the BMP */
+#define CMAP_CACHE_PAGES (0x10000 / CMAP_CACHE_PAGE_SIZE)
+
+/**
+ *  Cmap cache structure.
+ *
+ * @memberof cmap-cache
+ */
+typedef struct cmap_cache_t
+{
+    /** Glyph indices of the BMP by page, NULL for pages with no glyph */
+    uint32_t * pages[CMAP_CACHE_PAGES];
+
+    /** One bit per BMP codepoint, set if the face has a glyph for it */
+    uint32_t covered[0x10000 / 32];
+
+    /** Glyph indices of the codepoints beyond the BMP, NULL if none */
+    hash_table_t * astral;
+
+    /** Number of codepoints with a glyph */
+    size_t count;
+} cmap_cache_t;
+
+
+/**
+ * Creates a new empty cmap cache.
+ *
+ * @return  a new cmap cache, where no codepoint is covered, or NULL if
+ *          memory is exhausted
+ */
+  cmap_cache_t *
+  cmap_cache_new( void );
+
+
+/**
+ *  Deletes a cmap cache.
+ *
+ *  @param self a cmap cache
+ */
+  void
+  cmap_cache_delete( cmap_cache_t *self );
+
+
+/**
+ *  Records the glyph index of a codepoint.
+ *
+ *  @param  self       a cmap cache
+ *  @param  codepoint  a Unicode codepoint
+ *  @param  index      its glyph index, 0 if the face has no glyph for it
+ *  @return            1 on success, 0 if memory is exhausted
+ */
+  int
+  cmap_cache_set( cmap_cache_t *self,
+                  uint32_t codepoint,
+                  uint32_t index );
+
+
+/**
+ *  Returns the glyph index of a codepoint.
+ *
+ *  @param  self       a cmap cache
+ *  @param  codepoint  a Unicode codepoint
+ *  @return            its glyph index, 0 if the face has no glyph for it
+ */
+  uint32_t
+  cmap_cache_get( const cmap_cache_t *self,
+                  uint32_t codepoint );
+
+
+/**
+ *  Tells whether the face has a glyph for a codepoint.
+ *
+ *  @param  self       a cmap cache
+ *  @param  codepoint  a Unicode codepoint
+ *  @return            1 if covered, 0 otherwise
+ */
+  int
+  cmap_cache_covers( const cmap_cache_t *self,
+                     uint32_t codepoint );
+
+
+/**
+ *  Returns the memory used by a cmap cache.
+ *
+ *  @param  self  a cmap cache
+ *  @return       allocated size in bytes
+ */
+  size_t
+  cmap_cache_memory( const cmap_cache_t *self );
+
+/** @} */
+
+#ifdef __cplusplus
+}
+}
+#endif
+
+#endif /* __CMAP_CACHE_H__ */
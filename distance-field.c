@@ -8,6 +8,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "edtaa3func.h"
+#include "distance-field.h"
 
 
 double *
@@ -71,9 +72,19 @@ unsigned char *
 make_distance_mapb( unsigned char *img,
                     unsigned int width, unsigned int height )
 {
-    double * data    = (double *) calloc( width * height, sizeof(double) );
     unsigned char *out = (unsigned char *) malloc( width * height * sizeof(unsigned char) );
-    unsigned int i;
+
+    make_distance_mapb_rows( img, width, height, out, width );
+    return out;
+}
+
+void
+make_distance_mapb_rows( const unsigned char *img,
+                         unsigned int width, unsigned int height,
+                         unsigned char *out, size_t stride )
+{
+    double * data    = (double *) calloc( width * height, sizeof(double) );
+    unsigned int i, j;
 
     // find minimum and maximum values
     double img_min = DBL_MAX;
@@ -96,10 +107,9 @@ make_distance_mapb( unsigned char *img,
     data = make_distance_mapd(data, width, height);
 
     // map values from 0.0 - 1.0 to 0 - 255
-    for( i=0; i<width*height; ++i)
-        out[i] = (unsigned char)(255*(1-data[i]));
+    for( i=0; i<height; ++i)
+        for( j=0; j<width; ++j)
+            out[i*stride + j] = (unsigned char)(255*(1-data[i*width + j]));
 
     free( data );
-
-    return out;
 }
@@ -6,6 +6,8 @@
 #ifndef __DISTANCE_FIELD_H__
 #define __DISTANCE_FIELD_H__
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 namespace ftgl {
@@ -57,6 +59,21 @@ unsigned char *
 make_distance_mapb( unsigned char *img,
                     unsigned int width, unsigned int height );
 
+/**
+ * Create a distance field from the given image into the rows of another
+ * image, such as a texture atlas.
+ *
+ * @param img     A greyscale image.
+ * @param width   The width of the given image.
+ * @param height  The height of the given image.
+ * @param out     Where the first pixel of the distance field goes.
+ * @param stride  Bytes between the rows of out.
+ */
+void
+make_distance_mapb_rows( const unsigned char *img,
+                         unsigned int width, unsigned int height,
+                         unsigned char *out, size_t stride );
+
 /** @} */
 
 #ifdef __cplusplus
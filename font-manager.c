@@ -98,9 +98,8 @@ font_manager_delete_font( font_manager_t * self,
 
     for( i=0; i<self->fonts->size;++i )
     {
-        other = (texture_font_t *) vector_get( self->fonts, i );
-        if ( (strcmp(font->filename, other->filename) == 0)
-               && ( font->size == other->size) )
+        other = *(texture_font_t **) vector_get( self->fonts, i );
+        if ( other == font )
         {
             vector_erase( self->fonts, i);
             break;
@@ -111,6 +110,31 @@ font_manager_delete_font( font_manager_t * self,
 
 
 
+// --------------------------------------------------- font_manager_repack ---
+vector_t *
+font_manager_repack( font_manager_t * self )
+{
+    vector_t *regions, *remap;
+
+    assert( self );
+
+    if( vector_size( self->fonts ) )
+        return texture_font_repack( (texture_font_t **) self->fonts->items,
+                                    vector_size( self->fonts ) );
+
+    /* No glyph left, the special region only */
+    if( !(regions = vector_new( sizeof(ivec4) )) )
+    {
+        freetype_gl_error( Out_Of_Memory );
+        return NULL;
+    }
+    remap = texture_atlas_repack( self->atlas, regions );
+    vector_delete( regions );
+    return remap;
+}
+
+
+
 // ----------------------------------------- font_manager_get_from_filename ---
 texture_font_t *
 font_manager_get_from_filename( font_manager_t *self,
@@ -133,6 +157,8 @@ font_manager_get_from_filename( font_manager_t *self,
     if( font )
     {
         vector_push_back( self->fonts, &font );
+        /* The fonts of a manager follow their atlas when it grows */
+        texture_atlas_attach( self->atlas, font );
         texture_font_load_glyphs( font, self->cache );
         return font;
     }
@@ -49,7 +49,8 @@ namespace ftgl {
  */
 typedef struct font_manager_t {
     /**
-     * Texture atlas to hold font glyphs.
+     * Texture atlas to hold font glyphs, the fonts being attached to it
+     * (see texture_atlas_attach).
      */
     texture_atlas_t * atlas;
 
@@ -95,7 +96,8 @@ typedef struct font_manager_t {
 /**
  *  Deletes a font from the font manager.
  *
- *  Note that font glyphs are not removed from the atlas.
+ *  Note that font glyphs are not removed from the atlas until it is
+ *  repacked with font_manager_repack.
  *
  *  @param self a font manager.
  *  @param font font to be deleted
@@ -106,6 +108,17 @@ typedef struct font_manager_t {
                             texture_font_t * font );
 
 
+/**
+ *  Pack the atlas again with the glyphs of the fonts of the manager (see
+ *  texture_font_repack), getting back the space of deleted fonts.
+ *  @param self a font manager.
+ *  @return the remap table of texture_atlas_repack, to be deleted with
+ *          vector_delete, or NULL if the glyphs do not fit anymore
+ */
+  vector_t *
+  font_manager_repack( font_manager_t * self );
+
+
 /**
  *  Request for a font based on a filename.
  *
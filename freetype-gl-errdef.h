@@ -35,6 +35,10 @@ FTGL_ERRORDEF_( Load_Color_Not_Available,		0x0B,
 		"FT_LOAD_COLOR not available" )
 FTGL_ERRORDEF_( No_Fixed_Size_In_Color_Font,		0x0C,
 		"No fixed size in color font" )
+FTGL_ERRORDEF_( Glyph_Cache_Unavailable,		0x0D,
+		"glyph cache file cannot be written" )
+FTGL_ERRORDEF_( Glyph_Cache_Corrupt,			0x0E,
+		"stale or corrupt glyph cache file dropped" )
 
 FTGL_ERROR_END_LIST
 
@@ -13,6 +13,7 @@
 #include "vector.h"
 #include "texture-atlas.h"
 #include "texture-font.h"
+#include "baked-font.h"
 #include "ftgl-utils.h"
 
 #ifdef IMPLEMENT_FREETYPE_GL
@@ -20,8 +21,15 @@
 #include "texture-atlas.c"
 #include "texture-font.c"
 #include "vector.c"
+#include "hash-table.c"
+#include "arena.c"
+#include "cmap-cache.c"
+#include "glyph-cache.c"
+#include "baked-font.c"
+#include "block-compress.c"
 #include "utf8-utils.c"
 #include "distance-field.c"
+#include "pixel-convert.c"
 #include "edtaa3func.c"
 #include "ftgl-utils.c"
 #endif
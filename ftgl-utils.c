@@ -52,7 +52,9 @@ __THREAD const char * freetype_gl_message=NULL;
 #define FTGL_ERROR_END_LIST
 
 const char* freetype_gl_errstrs[] = {
+#ifndef FTGL_NO_FREETYPE
   #include <freetype/fterrdef.h>
+#endif
   #include "freetype-gl-errdef.h"
   [FTGL_ERR_MAX+1] = NULL
 };
@@ -0,0 +1,412 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "glyph-cache.h"
+#include "ftgl-utils.h"
+
+/* Header of a cache file */
+typedef struct glyph_cache_header_t
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    glyph_cache_params_t params;
+} glyph_cache_header_t;
+
+/* A record is its payload size and checksum followed by the payload: the
+ * glyph, its kerning pairs, then its bitmap */
+#define GLYPH_CACHE_RECORD_HEADER (2 * sizeof(uint32_t))
+
+static const char glyph_cache_magic[8] = { 'F', 'T', 'G', 'L', 'G', 'L', 'Y', 'C' };
+
+/* A cached glyph and the offset of its bitmap in the file contents, or
+ * GLYPH_CACHE_NO_BITMAP if it was cached by this process */
+typedef struct glyph_cache_entry_t
+{
+    glyph_cache_glyph_t glyph;
+    size_t bitmap;
+} glyph_cache_entry_t;
+
+#define GLYPH_CACHE_NO_BITMAP ((size_t) -1)
+
+typedef struct glyph_cache_pair_t
+{
+    uint32_t left;
+    uint32_t right;
+} glyph_cache_pair_t;
+
+
+// ------------------------------------------------------- glyph_cache_hash ---
+uint64_t
+glyph_cache_hash( const void * data,
+                  size_t size,
+                  uint64_t seed )
+{
+    const unsigned char *bytes = (const unsigned char *) data;
+    uint64_t hash = seed;
+    size_t i;
+
+    /* FNV-1a */
+    for( i = 0; i < size; i++ )
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+
+// -------------------------------------------------------- glyph_cache_new ---
+glyph_cache_t *
+glyph_cache_new( const char * directory )
+{
+    glyph_cache_t *self;
+
+    assert( directory );
+
+    self = (glyph_cache_t *) calloc( 1, sizeof(glyph_cache_t) );
+    if( !self )
+    {
+        freetype_gl_error( Out_Of_Memory );
+        return NULL;
+    }
+    self->directory = strdup( directory );
+    self->glyphs = hash_table_new( sizeof(uint32_t), sizeof(glyph_cache_entry_t) );
+    self->kerning = hash_table_new( sizeof(glyph_cache_pair_t), sizeof(float) );
+    if( !self->directory || !self->glyphs || !self->kerning )
+    {
+        glyph_cache_delete( self );
+        freetype_gl_error( Out_Of_Memory );
+        return NULL;
+    }
+    return self;
+}
+
+
+// ------------------------------------------------------ glyph_cache_close ---
+static void
+glyph_cache_close( glyph_cache_t * self )
+{
+    if( self->file )
+        fclose( self->file );
+    free( self->data );
+    free( self->path );
+    self->file = NULL;
+    self->data = NULL;
+    self->path = NULL;
+    self->available = 0;
+    self->records = 0;
+    hash_table_clear( self->glyphs );
+    hash_table_clear( self->kerning );
+}
+
+
+// ----------------------------------------------------- glyph_cache_delete ---
+void
+glyph_cache_delete( glyph_cache_t * self )
+{
+    assert( self );
+
+    if( self->glyphs && self->kerning )
+        glyph_cache_close( self );
+    if( self->glyphs )
+        hash_table_delete( self->glyphs );
+    if( self->kerning )
+        hash_table_delete( self->kerning );
+    free( self->directory );
+    free( self );
+}
+
+
+// ------------------------------------------------------ glyph_cache_parse ---
+/* Index the records of the file contents, returning the size of its valid
+ * part, 0 if the header does not match */
+static size_t
+glyph_cache_parse( glyph_cache_t * self,
+                   size_t size )
+{
+    const unsigned char *data = self->data;
+    glyph_cache_header_t header;
+    size_t offset = sizeof(glyph_cache_header_t);
+
+    if( size < sizeof(header) )
+        return 0;
+    memcpy( &header, data, sizeof(header) );
+    if( memcmp( header.magic, glyph_cache_magic, sizeof(header.magic) ) ||
+        header.version != GLYPH_CACHE_VERSION ||
+        header.byte_order != 0x01020304 ||
+        memcmp( &header.params, &self->params, sizeof(header.params) ) )
+        return 0;
+
+    while( size - offset >= GLYPH_CACHE_RECORD_HEADER )
+    {
+        const unsigned char *payload = data + offset + GLYPH_CACHE_RECORD_HEADER;
+        glyph_cache_entry_t entry;
+        glyph_cache_kerning_t pair;
+        glyph_cache_pair_t key;
+        uint32_t length, checksum, k;
+        uint64_t expected;
+
+        memcpy( &length, data + offset, sizeof(uint32_t) );
+        memcpy( &checksum, data + offset + sizeof(uint32_t), sizeof(uint32_t) );
+        if( length < sizeof(glyph_cache_glyph_t) ||
+            length > size - offset - GLYPH_CACHE_RECORD_HEADER ||
+            checksum != (uint32_t) glyph_cache_hash( payload, length,
+                                                     GLYPH_CACHE_HASH_SEED ) )
+            break;
+
+        memcpy( &entry.glyph, payload, sizeof(glyph_cache_glyph_t) );
+        expected = sizeof(glyph_cache_glyph_t)
+            + (uint64_t) entry.glyph.kerning_count * sizeof(glyph_cache_kerning_t)
+            + (uint64_t) entry.glyph.width * entry.glyph.height * self->params.depth;
+        /* A record written without the previous ones in view lacks some
+         * kerning pairs */
+        if( expected != length || entry.glyph.sequence != self->records )
+            break;
+
+        payload += sizeof(glyph_cache_glyph_t);
+        for( k = 0; k < entry.glyph.kerning_count; k++ )
+        {
+            memcpy( &pair, payload, sizeof(pair) );
+            key.left = pair.left;
+            key.right = pair.right;
+            hash_table_set( self->kerning, &key, &pair.kerning );
+            payload += sizeof(pair);
+        }
+        entry.bitmap = payload - data;
+        hash_table_set( self->glyphs, &entry.glyph.codepoint, &entry );
+        self->records++;
+        offset += GLYPH_CACHE_RECORD_HEADER + length;
+    }
+    return offset;
+}
+
+
+// ----------------------------------------------------- glyph_cache_select ---
+int
+glyph_cache_select( glyph_cache_t * self,
+                    const glyph_cache_params_t * params )
+{
+    glyph_cache_header_t header;
+    size_t size = 0, valid = 0;
+    FILE *file;
+
+    assert( self );
+    assert( params );
+
+    if( self->path && !memcmp( &self->params, params, sizeof(*params) ) )
+        return self->available;
+
+    glyph_cache_close( self );
+    self->params = *params;
+    /* "/", 16 hex digits, ".glyphs" */
+    self->path = (char *) malloc( strlen( self->directory ) + 25 );
+    if( !self->path )
+    {
+        freetype_gl_error( Out_Of_Memory );
+        return 0;
+    }
+    sprintf( self->path, "%s/%016llx.glyphs", self->directory,
+             (unsigned long long) glyph_cache_hash( params, sizeof(*params),
+                                                    GLYPH_CACHE_HASH_SEED ) );
+
+    if( (file = fopen( self->path, "rb" )) )
+    {
+        if( !fseek( file, 0, SEEK_END ) )
+        {
+            long end = ftell( file );
+            size = end > 0 ? (size_t) end : 0;
+        }
+        rewind( file );
+        if( size && (self->data = (unsigned char *) malloc( size )) )
+        {
+            if( fread( self->data, 1, size, file ) == size )
+                valid = glyph_cache_parse( self, size );
+        }
+        fclose( file );
+    }
+
+    /* Start a missing or stale file over, cut a corrupt one back */
+    if( !valid || valid < size )
+    {
+        if( size )
+        {
+            self->dropped++;
+            freetype_gl_warning( Glyph_Cache_Corrupt );
+        }
+        if( (file = fopen( self->path, "wb" )) )
+        {
+            if( valid )
+                fwrite( self->data, 1, valid, file );
+            else
+            {
+                memset( &header, 0, sizeof(header) );
+                memcpy( header.magic, glyph_cache_magic, sizeof(header.magic) );
+                header.version = GLYPH_CACHE_VERSION;
+                header.byte_order = 0x01020304;
+                header.params = *params;
+                fwrite( &header, sizeof(header), 1, file );
+            }
+            fclose( file );
+        }
+    }
+
+    self->file = fopen( self->path, "ab" );
+    self->available = self->file != NULL;
+    if( !self->available )
+        freetype_gl_warning( Glyph_Cache_Unavailable );
+    return self->available;
+}
+
+
+// ------------------------------------------------------- glyph_cache_find ---
+const glyph_cache_glyph_t *
+glyph_cache_find( glyph_cache_t * self,
+                  uint32_t codepoint,
+                  const unsigned char ** bitmap )
+{
+    glyph_cache_entry_t *entry;
+
+    assert( self );
+
+    entry = (glyph_cache_entry_t *) hash_table_get( self->glyphs, &codepoint );
+    if( !self->available || !entry || entry->bitmap == GLYPH_CACHE_NO_BITMAP )
+    {
+        self->misses++;
+        return NULL;
+    }
+    self->hits++;
+    *bitmap = self->data + entry->bitmap;
+    return &entry->glyph;
+}
+
+
+// -------------------------------------------------------- glyph_cache_add ---
+int
+glyph_cache_add( glyph_cache_t * self,
+                 const glyph_cache_glyph_t * glyph,
+                 const unsigned char * bitmap,
+                 glyph_cache_kerning_func kerning,
+                 void * data )
+{
+    glyph_cache_entry_t entry, *other;
+    glyph_cache_kerning_t *pairs = NULL, pair;
+    glyph_cache_pair_t key;
+    size_t i, count = 0, bitmap_size, length;
+    unsigned char *record;
+    uint32_t value;
+    int status;
+
+    assert( self );
+    assert( glyph );
+
+    if( !self->available ||
+        hash_table_get( self->glyphs, &glyph->codepoint ) )
+        return 0;
+
+    /* Pairs with every glyph cached before, both ways, and with itself */
+    if( kerning )
+    {
+        pairs = (glyph_cache_kerning_t *) malloc(
+            (2 * hash_table_size( self->glyphs ) + 1) * sizeof(*pairs) );
+        if( !pairs )
+        {
+            freetype_gl_error( Out_Of_Memory );
+            return 0;
+        }
+        for( i = 0; i < hash_table_capacity( self->glyphs ); i++ )
+        {
+            if( !(other = (glyph_cache_entry_t *) hash_table_value_at( self->glyphs, i )) )
+                continue;
+            pair.left = other->glyph.codepoint;
+            pair.right = glyph->codepoint;
+            if( (pair.kerning = kerning( data, other->glyph.glyph_index, glyph->glyph_index )) )
+                pairs[count++] = pair;
+            pair.left = glyph->codepoint;
+            pair.right = other->glyph.codepoint;
+            if( (pair.kerning = kerning( data, glyph->glyph_index, other->glyph.glyph_index )) )
+                pairs[count++] = pair;
+        }
+        pair.left = pair.right = glyph->codepoint;
+        if( (pair.kerning = kerning( data, glyph->glyph_index, glyph->glyph_index )) )
+            pairs[count++] = pair;
+    }
+
+    entry.glyph = *glyph;
+    entry.glyph.sequence = (uint32_t) self->records;
+    entry.glyph.kerning_count = (uint32_t) count;
+    entry.bitmap = GLYPH_CACHE_NO_BITMAP;
+    bitmap_size = (size_t) glyph->width * glyph->height * self->params.depth;
+    length = sizeof(glyph_cache_glyph_t) + count * sizeof(glyph_cache_kerning_t) + bitmap_size;
+
+    record = (unsigned char *) malloc( GLYPH_CACHE_RECORD_HEADER + length );
+    if( !record )
+    {
+        free( pairs );
+        freetype_gl_error( Out_Of_Memory );
+        return 0;
+    }
+    memcpy( record + GLYPH_CACHE_RECORD_HEADER, &entry.glyph, sizeof(glyph_cache_glyph_t) );
+    if( count )
+        memcpy( record + GLYPH_CACHE_RECORD_HEADER + sizeof(glyph_cache_glyph_t),
+                pairs, count * sizeof(glyph_cache_kerning_t) );
+    memcpy( record + GLYPH_CACHE_RECORD_HEADER + length - bitmap_size, bitmap, bitmap_size );
+    value = (uint32_t) length;
+    memcpy( record, &value, sizeof(uint32_t) );
+    value = (uint32_t) glyph_cache_hash( record + GLYPH_CACHE_RECORD_HEADER, length,
+                                         GLYPH_CACHE_HASH_SEED );
+    memcpy( record + sizeof(uint32_t), &value, sizeof(uint32_t) );
+
+    /* One write per record, so that concurrent writers interleave whole
+     * records at worst */
+    status = fwrite( record, GLYPH_CACHE_RECORD_HEADER + length, 1, self->file ) == 1 &&
+             !fflush( self->file );
+    free( record );
+
+    if( status )
+    {
+        for( i = 0; i < count; i++ )
+        {
+            key.left = pairs[i].left;
+            key.right = pairs[i].right;
+            hash_table_set( self->kerning, &key, &pairs[i].kerning );
+        }
+        hash_table_set( self->glyphs, &glyph->codepoint, &entry );
+        self->records++;
+        self->stores++;
+    }
+    free( pairs );
+    return status;
+}
+
+
+// ---------------------------------------------------- glyph_cache_kerning ---
+int
+glyph_cache_kerning( const glyph_cache_t * self,
+                     uint32_t left,
+                     uint32_t right,
+                     float * kerning )
+{
+    glyph_cache_pair_t pair = { left, right };
+    float *value;
+
+    assert( self );
+
+    if( (value = (float *) hash_table_get( self->kerning, &pair )) )
+    {
+        *kerning = *value;
+        return 1;
+    }
+    /* Pairs of cached glyphs that are not stored are zero */
+    if( hash_table_get( self->glyphs, &left ) && hash_table_get( self->glyphs, &right ) )
+    {
+        *kerning = 0;
+        return 1;
+    }
+    return 0;
+}
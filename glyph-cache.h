@@ -0,0 +1,291 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#ifndef __GLYPH_CACHE_H__
+#define __GLYPH_CACHE_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "hash-table.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef __cplusplus
+namespace ftgl {
+#endif
+
+/**
+ * @file   glyph-cache.h
+ *
+ * @defgroup glyph-cache Glyph cache
+ *
+ * A glyph cache keeps rasterized glyphs on disk, so that a font loaded again
+ * by a later process is filled from the cache instead of FreeType. There is
+ * one file per font contents and rendering parameters in the cache
+ * directory, made of a header followed by one record per glyph holding its
+ * metrics, its bitmap as stored in the atlas and its kerning with the glyphs
+ * cached before it, so that the kerning of any two cached glyphs is known.
+ *
+ * Records are appended as glyphs are rasterized and carry a checksum. A file
+ * written by another version or for other parameters is started over, and a
+ * file whose tail is corrupt (e.g. a process killed while appending, or two
+ * processes appending at once) is cut back to its last valid record.
+ *
+ * It is used by @ref texture-font through texture_font_set_cache.
+ *
+ * @{
+ */
+
+/** Version of the cache file format */
+#define GLYPH_CACHE_VERSION 1
+
+/**
+ * Parameters a glyph bitmap depends on, the key of a cache file.
+ */
+typedef struct glyph_cache_params_t
+{
+    /** Hash of the font file contents */
+    uint64_t font_hash;
+
+    /** Font size */
+    float size;
+
+    /** Outline thickness */
+    float outline_thickness;
+
+    /** Padding: left, right, top, bottom */
+    float padding[4];
+
+    /** Render mode */
+    int32_t rendermode;
+
+    /** Atlas depth */
+    uint32_t depth;
+
+    /** Whether hinting is on */
+    uint8_t hinting;
+
+    /** Whether the LCD filter is on */
+    uint8_t filtering;
+
+    /** LCD filter weights */
+    uint8_t lcd_weights[5];
+
+    /** Unused, zero */
+    uint8_t reserved;
+} glyph_cache_params_t;
+
+/**
+ * A cached glyph, as stored at the start of its record.
+ */
+typedef struct glyph_cache_glyph_t
+{
+    /** Unicode codepoint */
+    uint32_t codepoint;
+
+    /** Glyph index in the font */
+    uint32_t glyph_index;
+
+    /** Size of the bitmap, padding included */
+    uint32_t width, height;
+
+    /** Size of the glyph in the bitmap, padding excluded */
+    uint32_t data_width, data_height;
+
+    /** Left and top padding */
+    int32_t padding_left, padding_top;
+
+    /** Left and top bearing of the bitmap */
+    int32_t left, top;
+
+    /** Advance */
+    float advance_x, advance_y;
+
+    /** Number of records before this one in the file, all of which it has
+        its kerning pairs with */
+    uint32_t sequence;
+
+    /** Number of kerning pairs following in the record */
+    uint32_t kerning_count;
+} glyph_cache_glyph_t;
+
+/**
+ * A kerning pair of a cached glyph.
+ */
+typedef struct glyph_cache_kerning_t
+{
+    /** Left codepoint */
+    uint32_t left;
+
+    /** Right codepoint */
+    uint32_t right;
+
+    /** Kerning value in pixels */
+    float kerning;
+} glyph_cache_kerning_t;
+
+/**
+ * Kerning between two glyph indices, used to complete the kerning pairs of
+ * a glyph being cached.
+ */
+typedef float (*glyph_cache_kerning_func)( void *data,
+                                           uint32_t left,
+                                           uint32_t right );
+
+/**
+ * Glyph cache structure.
+ */
+typedef struct glyph_cache_t
+{
+    /** Cache directory */
+    char * directory;
+
+    /** Path of the selected cache file, NULL if none */
+    char * path;
+
+    /** Parameters of the selected cache file */
+    glyph_cache_params_t params;
+
+    /** Whether the selected file could be opened */
+    int available;
+
+    /** Selected file, open for appending */
+    FILE * file;
+
+    /** Contents of the file when it was selected */
+    unsigned char * data;
+
+    /** Codepoint to cached glyph and bitmap offset in data */
+    hash_table_t * glyphs;
+
+    /** Non-zero kerning pairs of the cached glyphs */
+    hash_table_t * kerning;
+
+    /** Number of records in the selected file */
+    size_t records;
+
+    /** Number of glyphs found in the cache */
+    size_t hits;
+
+    /** Number of glyphs asked for and not found */
+    size_t misses;
+
+    /** Number of glyphs added to the cache */
+    size_t stores;
+
+    /** Number of stale or corrupt files or records dropped */
+    size_t dropped;
+} glyph_cache_t;
+
+
+/**
+ * Creates a glyph cache using a directory.
+ *
+ * @param   directory  an existing directory the cache files are kept in
+ * @return             a new glyph cache with no file selected, or NULL if
+ *                     memory is exhausted
+ */
+  glyph_cache_t *
+  glyph_cache_new( const char * directory );
+
+
+/**
+ *  Deletes a glyph cache, leaving its files in place.
+ *
+ *  @param self a glyph cache
+ */
+  void
+  glyph_cache_delete( glyph_cache_t * self );
+
+
+/**
+ *  Selects the cache file for some parameters, reading it the first time.
+ *
+ *  @param  self    a glyph cache
+ *  @param  params  the rendering parameters, with unused bytes zeroed
+ *  @return         1 if the file can be used, 0 otherwise
+ */
+  int
+  glyph_cache_select( glyph_cache_t * self,
+                      const glyph_cache_params_t * params );
+
+
+/**
+ *  Looks up a glyph in the selected file.
+ *
+ *  @param  self       a glyph cache
+ *  @param  codepoint  the codepoint
+ *  @param  bitmap     set to the glyph bitmap, width * height * depth bytes
+ *  @return            the cached glyph, or NULL if not found
+ */
+  const glyph_cache_glyph_t *
+  glyph_cache_find( glyph_cache_t * self,
+                    uint32_t codepoint,
+                    const unsigned char ** bitmap );
+
+
+/**
+ *  Adds a glyph to the selected file, with its kerning pairs with every
+ *  glyph already cached.
+ *
+ *  @param  self     a glyph cache
+ *  @param  glyph    the glyph, sequence and kerning_count are ignored
+ *  @param  bitmap   the glyph bitmap, width * height * depth bytes
+ *  @param  kerning  kerning between two glyph indices, NULL if the font has
+ *                   no kerning
+ *  @param  data     passed to kerning
+ *  @return          1 on success, 0 otherwise
+ */
+  int
+  glyph_cache_add( glyph_cache_t * self,
+                   const glyph_cache_glyph_t * glyph,
+                   const unsigned char * bitmap,
+                   glyph_cache_kerning_func kerning,
+                   void * data );
+
+
+/**
+ *  Gets the kerning of two cached glyphs.
+ *
+ *  @param  self     a glyph cache
+ *  @param  left     left codepoint
+ *  @param  right    right codepoint
+ *  @param  kerning  set to the kerning when known
+ *  @return          1 if both glyphs are cached, 0 otherwise
+ */
+  int
+  glyph_cache_kerning( const glyph_cache_t * self,
+                       uint32_t left,
+                       uint32_t right,
+                       float * kerning );
+
+
+/**
+ *  Hashes bytes, in chunks if the previous hash is given as seed.
+ *
+ *  @param  data  bytes to hash
+ *  @param  size  number of bytes
+ *  @param  seed  GLYPH_CACHE_HASH_SEED, or the hash of the previous chunk
+ *  @return       a 64 bits hash
+ */
+  uint64_t
+  glyph_cache_hash( const void * data,
+                    size_t size,
+                    uint64_t seed );
+
+/** Initial seed of glyph_cache_hash */
+#define GLYPH_CACHE_HASH_SEED 0xcbf29ce484222325ULL
+
+/** @} */
+
+#ifdef __cplusplus
+}
+}
+#endif
+
+#endif /* __GLYPH_CACHE_H__ */
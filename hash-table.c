@@ -0,0 +1,305 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hash-table.h"
+#include "ftgl-utils.h"
+
+#define HASH_TABLE_MIN_CAPACITY 16
+
+// -------------------------------------------------------- hash_table_hash ---
+/* Multiplicative hash of the key, one 32 bit word at a time with independent
+ * multiplications, then a MurmurHash3 finalizer. It is never 0 since 0 marks
+ * empty slots. */
+static uint32_t
+hash_table_hash( const hash_table_t *self, const void *key )
+{
+    const unsigned char *bytes = (const unsigned char *) key;
+    uint32_t hash = (uint32_t) self->key_size;
+    uint32_t word, seed = 0x9e3779b1u;
+    size_t i;
+
+    for( i = 0; i + 4 <= self->key_size; i += 4 )
+    {
+        memcpy( &word, bytes + i, 4 );
+        hash += (word ^ seed) * 0xcc9e2d51u;
+        seed += 0x7f4a7c15u;
+    }
+    for( word = 0; i < self->key_size; ++i )
+        word = (word << 8) | bytes[i];
+    hash += (word ^ seed) * 0x1b873593u;
+
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash ? hash : 1;
+}
+
+
+// -------------------------------------------------------- hash_table_item ---
+static char *
+hash_table_item( const hash_table_t *self, size_t index )
+{
+    return (char *)(self->items) + index * self->item_size;
+}
+
+
+// -------------------------------------------------------- hash_table_find ---
+/* Slot holding key, or the empty slot where it would be inserted */
+static size_t
+hash_table_find( const hash_table_t *self, const void *key, uint32_t hash )
+{
+    size_t mask = self->capacity - 1;
+    size_t i = hash & mask;
+
+    while( self->hashes[i] )
+    {
+        if( self->hashes[i] == hash &&
+            memcmp( hash_table_item( self, i ), key, self->key_size ) == 0 )
+        {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+
+// ------------------------------------------------------ hash_table_rehash ---
+static int
+hash_table_rehash( hash_table_t *self, size_t capacity )
+{
+    uint32_t *hashes = self->hashes;
+    char *items = (char *) self->items;
+    size_t old_capacity = self->capacity;
+    size_t i, j;
+
+    self->hashes = (uint32_t *) calloc( capacity, sizeof(uint32_t) );
+    self->items = malloc( capacity * self->item_size );
+    if( !self->hashes || !self->items )
+    {
+        free( self->hashes );
+        free( self->items );
+        self->hashes = hashes;
+        self->items = items;
+        freetype_gl_error( Out_Of_Memory );
+        return 0;
+    }
+    self->capacity = capacity;
+
+    for( i = 0; i < old_capacity; ++i )
+    {
+        if( !hashes[i] )
+            continue;
+        j = hash_table_find( self, items + i * self->item_size, hashes[i] );
+        self->hashes[j] = hashes[i];
+        memcpy( hash_table_item( self, j ), items + i * self->item_size,
+                self->item_size );
+    }
+    free( hashes );
+    free( items );
+    return 1;
+}
+
+
+// --------------------------------------------------------- hash_table_new ---
+hash_table_t *
+hash_table_new( size_t key_size, size_t value_size )
+{
+    hash_table_t *self = (hash_table_t *) malloc( sizeof(hash_table_t) );
+    size_t align;
+    assert( key_size );
+
+    if( !self )
+    {
+        freetype_gl_error( Out_Of_Memory );
+        return NULL;
+    }
+    align = (key_size >= 8 || value_size >= 8) ? 8 :
+            (key_size >= 4 || value_size >= 4) ? 4 : 1;
+    self->key_size     = key_size;
+    self->value_size   = value_size;
+    self->value_offset = (key_size + align - 1) & ~(align - 1);
+    self->item_size    = (self->value_offset + value_size + align - 1) & ~(align - 1);
+    self->size       = 0;
+    self->capacity   = HASH_TABLE_MIN_CAPACITY;
+    self->hashes     = (uint32_t *) calloc( self->capacity, sizeof(uint32_t) );
+    self->items      = malloc( self->capacity * self->item_size );
+    if( !self->hashes || !self->items )
+    {
+        free( self->hashes );
+        free( self->items );
+        free( self );
+        freetype_gl_error( Out_Of_Memory );
+        return NULL;
+    }
+    return self;
+}
+
+
+// ------------------------------------------------------ hash_table_delete ---
+void
+hash_table_delete( hash_table_t *self )
+{
+    assert( self );
+
+    free( self->hashes );
+    free( self->items );
+    free( self );
+}
+
+
+// --------------------------------------------------------- hash_table_get ---
+void *
+hash_table_get( const hash_table_t *self,
+                const void *key )
+{
+    size_t i;
+
+    assert( self );
+
+    i = hash_table_find( self, key, hash_table_hash( self, key ) );
+    if( !self->hashes[i] )
+        return NULL;
+    return hash_table_item( self, i ) + self->value_offset;
+}
+
+
+// --------------------------------------------------------- hash_table_set ---
+void *
+hash_table_set( hash_table_t *self,
+                const void *key,
+                const void *value )
+{
+    uint32_t hash;
+    size_t i;
+    char *item;
+
+    assert( self );
+
+    /* Keep the load factor under 3/4 so that probe runs stay short */
+    if( (self->size + 1) * 4 > self->capacity * 3 &&
+        !hash_table_rehash( self, self->capacity * 2 ) )
+        return NULL;
+
+    hash = hash_table_hash( self, key );
+    i = hash_table_find( self, key, hash );
+    item = hash_table_item( self, i );
+    if( !self->hashes[i] )
+    {
+        self->hashes[i] = hash;
+        memcpy( item, key, self->key_size );
+        self->size++;
+    }
+    memcpy( item + self->value_offset, value, self->value_size );
+    return item + self->value_offset;
+}
+
+
+// ------------------------------------------------------- hash_table_erase ---
+int
+hash_table_erase( hash_table_t *self,
+                  const void *key )
+{
+    size_t mask, i, j, home;
+
+    assert( self );
+
+    mask = self->capacity - 1;
+    i = hash_table_find( self, key, hash_table_hash( self, key ) );
+    if( !self->hashes[i] )
+        return 0;
+
+    /* Backward shift deletion: move up the following slots of the probe run
+     * that would no longer be reachable, so no tombstones are needed */
+    for( j = (i + 1) & mask; self->hashes[j]; j = (j + 1) & mask )
+    {
+        home = self->hashes[j] & mask;
+        if( ((j - home) & mask) >= ((j - i) & mask) )
+        {
+            self->hashes[i] = self->hashes[j];
+            memcpy( hash_table_item( self, i ), hash_table_item( self, j ),
+                    self->item_size );
+            i = j;
+        }
+    }
+    self->hashes[i] = 0;
+    self->size--;
+    return 1;
+}
+
+
+// ------------------------------------------------------- hash_table_clear ---
+void
+hash_table_clear( hash_table_t *self )
+{
+    assert( self );
+
+    memset( self->hashes, 0, self->capacity * sizeof(uint32_t) );
+    self->size = 0;
+}
+
+
+// -------------------------------------------------------- hash_table_size ---
+size_t
+hash_table_size( const hash_table_t *self )
+{
+    assert( self );
+
+    return self->size;
+}
+
+
+// ---------------------------------------------------- hash_table_capacity ---
+size_t
+hash_table_capacity( const hash_table_t *self )
+{
+    assert( self );
+
+    return self->capacity;
+}
+
+
+// ------------------------------------------------------ hash_table_key_at ---
+const void *
+hash_table_key_at( const hash_table_t *self,
+                   size_t index )
+{
+    assert( self );
+    assert( index < self->capacity );
+
+    if( !self->hashes[index] )
+        return NULL;
+    return hash_table_item( self, index );
+}
+
+
+// ---------------------------------------------------- hash_table_value_at ---
+void *
+hash_table_value_at( const hash_table_t *self,
+                     size_t index )
+{
+    assert( self );
+    assert( index < self->capacity );
+
+    if( !self->hashes[index] )
+        return NULL;
+    return hash_table_item( self, index ) + self->value_offset;
+}
+
+
+// ------------------------------------------------------ hash_table_memory ---
+size_t
+hash_table_memory( const hash_table_t *self )
+{
+    assert( self );
+
+    return sizeof(hash_table_t) +
+        self->capacity * (sizeof(uint32_t) + self->item_size);
+}
@@ -0,0 +1,218 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#ifndef __HASH_TABLE_H__
+#define __HASH_TABLE_H__
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+namespace ftgl {
+#endif
+
+/**
+ * @file   hash-table.h
+ *
+ * @defgroup hash-table Hash table
+ *
+ * The hash table maps fixed size keys to fixed size values, compared and
+ * hashed bytewise. It uses open addressing with linear probing, so that
+ * lookups touch a single contiguous run of slots, and keeps its slots in one
+ * array that can be iterated by index. It is used by @ref texture-font to
+ * store glyphs and to cache kerning pairs.
+ *
+ * <b>Example Usage</b>:
+ * @code
+ * #include "hash-table.h"
+ *
+ * int main( int arrgc, char *argv[] )
+ * {
+ *   uint32_t key = 42;
+ *   float value = 1.5f;
+ *   hash_table_t * table = hash_table_new( sizeof(uint32_t), sizeof(float) );
+ *   hash_table_set( table, &key, &value );
+ *
+ *   value = * (float *) hash_table_get( table, &key );
+ *   hash_table_delete( table );
+ *
+ *   return 0;
+ * }
+ * @endcode
+ *
+ * @{
+ */
+
+/**
+ *  Generic hash table structure.
+ *
+ * @memberof hash_table
+ */
+typedef struct hash_table_t
+{
+    /** Hash of each slot's key, 0 marks an empty slot. */
+    uint32_t * hashes;
+
+    /** Slots, each holding a key immediately followed by its value. */
+    void * items;
+
+    /** Number of slots, always a power of two. */
+    size_t capacity;
+
+    /** Number of used slots. */
+    size_t size;
+
+    /** Size (in bytes) of a key. */
+    size_t key_size;
+
+    /** Size (in bytes) of a value. */
+    size_t value_size;
+
+    /** Offset (in bytes) of the value within a slot, keeping it aligned. */
+    size_t value_offset;
+
+    /** Size (in bytes) of a slot. */
+    size_t item_size;
+} hash_table_t;
+
+
+/**
+ * Creates a new empty hash table.
+ *
+ * @param   key_size    key size in bytes
+ * @param   value_size  value size in bytes
+ * @return              a new empty hash table
+ *
+ */
+  hash_table_t *
+  hash_table_new( size_t key_size, size_t value_size );
+
+
+/**
+ *  Deletes a hash table.
+ *
+ *  @param self a hash table structure
+ *
+ */
+  void
+  hash_table_delete( hash_table_t *self );
+
+
+/**
+ *  Returns a pointer to the value stored for a key.
+ *
+ *  @param  self  a hash table structure
+ *  @param  key   the key to look for
+ *  @return       pointer on the value, or NULL if the key is not present
+ */
+  void *
+  hash_table_get( const hash_table_t *self,
+                  const void *key );
+
+
+/**
+ *  Stores a value for a key, replacing any previous value.
+ *
+ *  @param  self   a hash table structure
+ *  @param  key    the key to store the value for
+ *  @param  value  the value to be copied in the table
+ *  @return        pointer on the stored value (valid until the next insertion
+ *                 or erasure), or NULL if memory is exhausted
+ */
+  void *
+  hash_table_set( hash_table_t *self,
+                  const void *key,
+                  const void *value );
+
+
+/**
+ *  Removes a key and its value.
+ *
+ *  @param  self  a hash table structure
+ *  @param  key   the key to be removed
+ *  @return       1 if the key was present, 0 otherwise
+ */
+  int
+  hash_table_erase( hash_table_t *self,
+                    const void *key );
+
+
+/**
+ *  Removes all keys.
+ *
+ *  @param  self  a hash table structure
+ */
+  void
+  hash_table_clear( hash_table_t *self );
+
+
+/**
+ *  Returns the number of keys
+ *
+ *  @param  self  a hash table structure
+ *  @return       number of keys
+ */
+  size_t
+  hash_table_size( const hash_table_t *self );
+
+
+/**
+ *  Returns the number of slots, for iterating with hash_table_key_at and
+ *  hash_table_value_at.
+ *
+ *  @param  self  a hash table structure
+ *  @return       number of slots
+ */
+  size_t
+  hash_table_capacity( const hash_table_t *self );
+
+
+/**
+ *  Returns the key stored in a slot.
+ *
+ *  @param  self   a hash table structure
+ *  @param  index  slot index, less than hash_table_capacity
+ *  @return        pointer on the key, or NULL if the slot is empty
+ */
+  const void *
+  hash_table_key_at( const hash_table_t *self,
+                     size_t index );
+
+
+/**
+ *  Returns the value stored in a slot.
+ *
+ *  @param  self   a hash table structure
+ *  @param  index  slot index, less than hash_table_capacity
+ *  @return        pointer on the value, or NULL if the slot is empty
+ */
+  void *
+  hash_table_value_at( const hash_table_t *self,
+                       size_t index );
+
+
+/**
+ *  Returns the memory used by the table.
+ *
+ *  @param  self  a hash table structure
+ *  @return       allocated size in bytes
+ */
+  size_t
+  hash_table_memory( const hash_table_t *self );
+
+/** @} */
+
+#ifdef __cplusplus
+}
+}
+#endif
+
+#endif /* __HASH_TABLE_H__ */
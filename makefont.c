@@ -7,6 +7,8 @@
 #include "vec234.h"
 #include "vector.h"
 #include "freetype-gl.h"
+#include "utf8-utils.h"
+#include "block-compress.h"
 
 #include <errno.h>
 #include <stdio.h>
@@ -40,9 +42,7 @@ void libattopng_destroy(libattopng_t *png);
 int libattopng_save(libattopng_t *png, const char *filename);
 // end.
 
-#ifdef __APPLE__
 char *strrstr(const char *haystack, const char *needle);
-#endif
 
 static char *base_name(const char *path) {
     char *base = strrchr( path, '/' );
@@ -58,7 +58,13 @@ void print_help()
              "--header <header file> --size <font size> "
              "--variable <variable name> --texture <texture size> "
              "--padding <left,right,top,bottom> --spacing <spacing value> "
-             "--rendermode <one of 'normal', 'outline_edge', 'outline_positive', 'outline_negative' or 'sdf'>\n" );
+             "--rendermode <one of 'normal', 'outline_edge', 'outline_positive', 'outline_negative' or 'sdf'> "
+             "--kerning <one of 'pages' or 'compact'> "
+             "--threads <rasterizing threads> "
+             "--charset <UTF-8 file of the characters> "
+             "--pack <one of 'input' or 'offline'> "
+             "--compress <one of 'none' or 'bc'> "
+             "--binary <baked font file>\n" );
 }
 
 // ------------------------------------------------------------- dump image ---
@@ -197,10 +203,15 @@ void print_glyph(FILE * file, texture_glyph_t * glyph)
         for( k=0; k < vector_size(glyph->kerning); ++k ) {
             float *kerning = *(float **) vector_get( glyph->kerning, k);
             int l;
-            fprintf( file, "{" );
-            for( l=0; l<0xff; l++ )
-                fprintf( file, " %ff,", kerning[l] );
-            fprintf( file, " %ff }", kerning[0xFF] );
+            // Pages of codepoints without kerning are not allocated
+            if (!kerning) {
+                fprintf( file, "{ 0 }" );
+            } else {
+                fprintf( file, "{" );
+                for( l=0; l<0xff; l++ )
+                    fprintf( file, " %ff,", kerning[l] );
+                fprintf( file, " %ff }", kerning[0xFF] );
+            }
 
             if( k < (vector_size(glyph->kerning)-1))
                 fprintf( file, ",\n" );
@@ -210,6 +221,328 @@ void print_glyph(FILE * file, texture_glyph_t * glyph)
     fprintf( file, " };\n" );
 }
 
+void print_glyph_compact(FILE * file, texture_glyph_t * glyph, const char * variable_name)
+{
+    size_t k, count = glyph->kerning_compact ? vector_size(glyph->kerning_compact) : 0;
+
+    if (count) {
+        fprintf( file, "static const texture_glyph_kerning_t %s_kerning_%08x[] = {", variable_name, glyph->codepoint );
+        for( k=0; k < count; ++k ) {
+            texture_glyph_kerning_t *pair = (texture_glyph_kerning_t *) vector_get( glyph->kerning_compact, k );
+            fprintf( file, "%s{%u, %d}", !k ? "\n  " : k % 8 ? ", " : ",\n  ", pair->codepoint, pair->kerning );
+        }
+        fprintf( file, " };\n" );
+    }
+    fprintf( file, "texture_glyph_t %s_glyph_%08x = ", variable_name, glyph->codepoint );
+    fprintf( file, "  {%u, ", glyph->codepoint );
+    fprintf( file, "%" PRIzu ", %" PRIzu ", ", glyph->width, glyph->height );
+    fprintf( file, "%d, %d, ", glyph->offset_x, glyph->offset_y );
+    fprintf( file, "%ff, %ff, ", glyph->advance_x, glyph->advance_y );
+    fprintf( file, "%ff, %ff, %ff, %ff, ", glyph->s0, glyph->t0, glyph->s1, glyph->t1 );
+    if (count)
+        fprintf( file, "%" PRIzu ", %s_kerning_%08x };\n", count, variable_name, glyph->codepoint );
+    else
+        fprintf( file, "0, NULL };\n" );
+}
+
+// ---------------------------------------------------------- glyph_compare ---
+static int glyph_compare( const void *a, const void *b )
+{
+    uint32_t left  = (*(texture_glyph_t * const *) a)->codepoint;
+    uint32_t right = (*(texture_glyph_t * const *) b)->codepoint;
+    return left < right ? -1 : left > right;
+}
+
+// --------------------------------------------------------- read_charset ---
+// Characters of a UTF-8 file, line breaks and other control characters
+// aside
+static char *
+read_charset( const char * filename )
+{
+    FILE * file = fopen( filename, "rb" );
+    char * charset = NULL;
+    long size, i, k = 0;
+
+    if ( !file )
+        return NULL;
+    if ( fseek( file, 0, SEEK_END ) || (size = ftell( file )) < 0 ||
+         fseek( file, 0, SEEK_SET ) || !(charset = malloc( size + 1 )) ||
+         fread( charset, 1, size, file ) != (size_t) size )
+    {
+        free( charset );
+        fclose( file );
+        return NULL;
+    }
+    fclose( file );
+    for ( i = 0; i < size; ++i )
+        if ( (unsigned char) charset[i] >= 0x20 && charset[i] != 0x7f )
+            charset[k++] = charset[i];
+    charset[k] = 0;
+    return charset;
+}
+
+// ------------------------------------------------------------- new_font ---
+static texture_font_t *
+new_font( texture_atlas_t * atlas, float size, const char * filename,
+          const float * padding, rendermode_t rendermode,
+          kerning_mode_t kerning_mode, size_t threads )
+{
+    texture_font_t * font = texture_font_new_from_file( atlas, size, filename );
+    int i;
+
+    if ( !font )
+        return NULL;
+    for ( i = 0; i < 4; ++i )
+        if ( 0 != padding[i] )
+            switch ( i ) {
+                case 0: font->padding_left = padding[i]; break;
+                case 1: font->padding_right = padding[i]; break;
+                case 2: font->padding_top = padding[i]; break;
+                case 3: font->padding_bottom = padding[i]; break;
+            }
+    font->rendermode = rendermode;
+    font->kerning_mode = kerning_mode;
+    if ( threads )
+        font->threads = threads;
+    return font;
+}
+
+// ------------------------------------------------------------ offline_t ---
+// Glyphs rasterized once for offline packing, in pages of a scratch atlas,
+// and the densest packing found for them in the atlas
+typedef struct {
+    texture_font_t * font;
+    texture_atlas_t * scratch;
+    texture_glyph_t ** glyphs;  // each once, in codepoint order
+    ivec2 * sizes;
+    size_t * order;
+    size_t count, placed;
+    texture_atlas_packer_t packer;
+} offline_t;
+
+// Scratch pages are at least that large, so that there are few of them
+#define OFFLINE_PAGE 1024
+
+// The size glyphs are rasterized at first when searching for the largest
+// size that fits, sizes around being estimated from theirs
+#define OFFLINE_PILOT_SIZE 32
+
+// --------------------------------------------------------- offline_free ---
+static void
+offline_free( offline_t * self )
+{
+    if ( self->font )
+        texture_font_delete( self->font );
+    if ( self->scratch )
+        texture_atlas_delete( self->scratch );
+    free( self->glyphs );
+    free( self->sizes );
+    free( self->order );
+    memset( self, 0, sizeof(*self) );
+}
+
+// --------------------------------------------------------- offline_load ---
+// Rasterize a charset with a font, whose atlas is replaced with a scratch
+// atlas, and plan the densest packing of its glyphs in an atlas like
+// target. Returns 0 if out of memory.
+static int
+offline_load( offline_t * self, texture_font_t * font, const char * charset,
+              const texture_atlas_t * target, size_t threads )
+{
+    size_t page = target->width > OFFLINE_PAGE ? target->width : OFFLINE_PAGE;
+    size_t i, k = 0;
+    texture_glyph_t * glyph;
+
+    memset( self, 0, sizeof(*self) );
+    self->font = font;
+    if ( !(self->scratch = texture_atlas_new( page, page, target->depth )) )
+        return 0;
+    self->scratch->max_pages = (size_t) -1;
+    self->scratch->spacing_horiz = target->spacing_horiz;
+    self->scratch->spacing_vert = target->spacing_vert;
+    font->atlas = self->scratch;
+
+    // Nothing is missed with as many pages as needed, but for glyphs
+    // larger than a page
+    texture_font_load_glyphs( font, charset );
+
+    self->count = vector_glyphs_size( font->glyphs );
+    self->glyphs = malloc( (self->count + 1) * sizeof(texture_glyph_t *) );
+    self->sizes = malloc( (self->count + 1) * sizeof(ivec2) );
+    self->order = malloc( (self->count + 1) * sizeof(size_t) );
+    if ( !self->glyphs || !self->sizes || !self->order )
+        return 0;
+    GLYPHS_ITERATOR(i, glyph, font->glyphs) {
+        self->glyphs[k++] = glyph;
+    }
+    GLYPHS_ITERATOR_END
+    qsort( self->glyphs, k, sizeof(texture_glyph_t *), glyph_compare );
+
+    // Glyphs of missing codepoints are shared
+    for ( i = self->count = 0; i < k; ++i )
+    {
+        if ( self->count && self->glyphs[self->count-1] == self->glyphs[i] )
+            continue;
+        self->glyphs[self->count] = self->glyphs[i];
+        self->sizes[self->count].x = self->glyphs[i]->width;
+        self->sizes[self->count++].y = self->glyphs[i]->height;
+    }
+    self->placed = texture_atlas_plan( target, self->sizes, self->count, threads,
+                                       &self->packer, self->order );
+    return 1;
+}
+
+// ------------------------------------------------------ offline_estimate ---
+// Whether the glyphs of a font would fit at another size with the packing
+// planned for them, their sizes scaled from those rasterized: padding aside,
+// and the pixel antialiasing adds aside
+static int
+offline_estimate( const offline_t * self, float size, float reference,
+                  const texture_atlas_t * target )
+{
+    int padding_x = (int) (self->font->padding_left + self->font->padding_right);
+    int padding_y = (int) (self->font->padding_top + self->font->padding_bottom);
+    texture_atlas_t * atlas;
+    size_t i, placed = 0;
+
+    if ( !(atlas = texture_atlas_new_with_packer( target->width, target->height,
+                                                  1, self->packer )) )
+        return 0;
+    atlas->spacing_horiz = target->spacing_horiz;
+    atlas->spacing_vert = target->spacing_vert;
+    if ( target->align > 1 )
+        texture_atlas_set_align( atlas, target->align );
+    for ( i = 0; i < self->count; ++i )
+    {
+        ivec2 estimate = self->sizes[self->order[i]];
+        int width = estimate.x - padding_x - 1, height = estimate.y - padding_y - 1;
+
+        if ( width > 0 && height > 0 )
+        {
+            estimate.x = (int) ceilf( width * size / reference ) + 1 + padding_x;
+            estimate.y = (int) ceilf( height * size / reference ) + 1 + padding_y;
+        }
+        if ( texture_atlas_get_region( atlas, estimate.x, estimate.y ).x < 0 )
+            break;
+        placed++;
+    }
+    texture_atlas_delete( atlas );
+    return placed == self->count;
+}
+
+// ---------------------------------------------------------- offline_font ---
+// Rasterize the glyphs of a font once, at its size or, with auto_size, at
+// the largest one that fits, and pack them in a new atlas like target with
+// the densest packing found. Sizes are searched on estimates from the last
+// glyphs rasterized, each size tried being cloned from the same face: the
+// size found is the largest known to fit that estimates do not rule out.
+// Returns NULL if they do not fit.
+static texture_font_t *
+offline_font( texture_font_t * font, const char * charset, int auto_size,
+              const texture_atlas_t * target, size_t threads )
+{
+    offline_t best, last;
+    texture_atlas_t * atlas;
+    texture_glyph_t * glyph;
+    ivec4 region;
+    int low = 3, high = (int) target->width + 1, lower, upper, next, fits;
+    float size = font->size;
+    size_t i;
+
+    memset( &best, 0, sizeof(best) );
+    while ( font )
+    {
+        if ( !offline_load( &last, font, charset, target, threads ) )
+        {
+            offline_free( &last );
+            break;
+        }
+        fits = last.placed == last.count;
+        if ( fits )
+            low = (int) size;
+        else
+            high = (int) size;
+
+        // The largest size between those known to fit and not to that is
+        // estimated to fit, the next one up if none has been found yet
+        for ( lower = low + 1, upper = high - 1, next = 0; auto_size && lower <= upper; )
+        {
+            int middle = (lower + upper) / 2;
+            if ( offline_estimate( &last, middle, size, target ) )
+            {
+                next = middle;
+                lower = middle + 1;
+            }
+            else
+                upper = middle - 1;
+        }
+        if ( auto_size && !next && !fits && !best.font && low + 1 < high )
+            next = low + 1;
+
+        font = next ? texture_font_clone( last.font, next ) : NULL;
+        size = next;
+        if ( fits )
+        {
+            offline_free( &best );
+            best = last;
+        }
+        else
+            offline_free( &last );
+    }
+    if ( !best.font )
+        return NULL;
+
+    // Regions allocated in the planned order with the planned packer land
+    // where they did when planning
+    if ( !(atlas = texture_atlas_new_with_packer( target->width, target->height,
+                                                  target->depth, best.packer )) )
+    {
+        offline_free( &best );
+        return NULL;
+    }
+    atlas->spacing_horiz = target->spacing_horiz;
+    atlas->spacing_vert = target->spacing_vert;
+    if ( target->align > 1 )
+        texture_atlas_set_align( atlas, target->align );
+    for ( i = 0; i < best.count; ++i )
+    {
+        texture_atlas_t * page;
+
+        glyph = best.glyphs[best.order[i]];
+        page = texture_atlas_get_page( best.scratch, glyph->page );
+        region = texture_atlas_get_region( atlas, glyph->width, glyph->height );
+        if ( glyph->width && glyph->height )
+            texture_atlas_set_region( atlas, region.x, region.y, glyph->width, glyph->height,
+                                      page->data + (glyph->y * page->width + glyph->x) * page->depth,
+                                      page->width * page->depth );
+        glyph->data_x += region.x - (int) glyph->x;
+        glyph->data_y += region.y - (int) glyph->y;
+        glyph->x = region.x;
+        glyph->y = region.y;
+        glyph->page = 0;
+        if ( best.font->scaletex )
+        {
+            glyph->s0 = glyph->x / (float) atlas->width;
+            glyph->t0 = glyph->y / (float) atlas->height;
+            glyph->s1 = (glyph->x + glyph->width) / (float) atlas->width;
+            glyph->t1 = (glyph->y + glyph->height) / (float) atlas->height;
+        }
+        else
+        {
+            glyph->s0 = glyph->x - 0.5;
+            glyph->t0 = glyph->y - 0.5;
+            glyph->s1 = glyph->x + glyph->width - 0.5;
+            glyph->t1 = glyph->y + glyph->height - 0.5;
+        }
+    }
+
+    font = best.font;
+    font->atlas = atlas;
+    best.font = NULL;
+    offline_free( &best );
+    return font;
+}
+
 // ------------------------------------------------------------------- main ---
 int main( int argc, char **argv )
 {
@@ -226,6 +559,7 @@ int main( int argc, char **argv )
     float font_size = 0.0;
     const char * font_filename   = NULL;
     const char * header_filename = NULL;
+    const char * binary_filename = NULL;
     const char * variable_name   = "font";
     int show_help = 0;
     size_t texture_width = 0;
@@ -233,12 +567,22 @@ int main( int argc, char **argv )
     float padding[4] = {0,0,0,0}; // left,right,top,bottom
     size_t spacing = 0;
     rendermode_t rendermode = RENDER_NORMAL;
+    kerning_mode_t kerning_mode = KERNING_EAGER;
+    size_t threads = 0;
+    char * charset = NULL;
+    int offline = 0;
+    int compress = 0;
     const char *rendermodes[5];
     rendermodes[RENDER_NORMAL] = "normal";
     rendermodes[RENDER_OUTLINE_EDGE] = "outline edge";
     rendermodes[RENDER_OUTLINE_POSITIVE] = "outline added";
     rendermodes[RENDER_OUTLINE_NEGATIVE] = "outline removed";
     rendermodes[RENDER_SIGNED_DISTANCE_FIELD] = "signed distance field";
+    const char *packers[4];
+    packers[PACKER_SKYLINE] = "offline, skyline";
+    packers[PACKER_MAXRECTS] = "offline, maxrects";
+    packers[PACKER_GUILLOTINE] = "offline, guillotine";
+    packers[PACKER_SHELF] = "offline, shelf";
 
     for ( arg = 1; arg < argc; ++arg )
     {
@@ -286,6 +630,28 @@ int main( int argc, char **argv )
             continue;
         }
 
+        if ( 0 == strcmp( "--binary", argv[arg] ) || 0 == strcmp( "-b", argv[arg] )  )
+        {
+            ++arg;
+
+            if ( binary_filename )
+            {
+                fprintf( stderr, "Multiple --binary parameters.\n" );
+                print_help();
+                exit( 1 );
+            }
+
+            if ( arg >= argc )
+            {
+                fprintf( stderr, "No binary file given.\n" );
+                print_help();
+                exit( 1 );
+            }
+
+            binary_filename = argv[arg];
+            continue;
+        }
+
         if ( 0 == strcmp( "--help", argv[arg] ) || 0 == strcmp( "-h", argv[arg] ) )
         {
             show_help = 1;
@@ -487,6 +853,153 @@ int main( int argc, char **argv )
             continue;
         }
 
+        if ( 0 == strcmp( "--kerning", argv[arg] ) || 0 == strcmp( "-k", argv[arg] ) )
+        {
+            ++arg;
+
+            if ( arg >= argc )
+            {
+                fprintf( stderr, "No kerning storage given.\n" );
+                print_help();
+                exit( 1 );
+            }
+
+            if( 0 == strcmp( "pages", argv[arg] ) )
+            {
+                kerning_mode = KERNING_EAGER;
+            }
+            else if( 0 == strcmp( "compact", argv[arg] ) )
+            {
+                kerning_mode = KERNING_COMPACT;
+            }
+            else
+            {
+                fprintf( stderr, "No valid kerning storage given.\n" );
+                print_help();
+                exit( 1 );
+            }
+
+            continue;
+        }
+
+        if ( 0 == strcmp( "--threads", argv[arg] ) || 0 == strcmp( "-j", argv[arg] ) )
+        {
+            ++arg;
+
+            if ( 0 != threads )
+            {
+                fprintf( stderr, "Multiple --threads parameters.\n" );
+                print_help();
+                exit( 1 );
+            }
+
+            if ( arg >= argc )
+            {
+                fprintf( stderr, "No thread count given.\n" );
+                print_help();
+                exit( 1 );
+            }
+
+            errno = 0;
+
+            threads = atoi( argv[arg] );
+
+            if ( errno || !threads )
+            {
+                fprintf( stderr, "No valid thread count given.\n" );
+                print_help();
+                exit( 1 );
+            }
+
+            continue;
+        }
+
+        if ( 0 == strcmp( "--charset", argv[arg] ) || 0 == strcmp( "-c", argv[arg] ) )
+        {
+            ++arg;
+
+            if ( charset )
+            {
+                fprintf( stderr, "Multiple --charset parameters.\n" );
+                print_help();
+                exit( 1 );
+            }
+
+            if ( arg >= argc )
+            {
+                fprintf( stderr, "No charset file given.\n" );
+                print_help();
+                exit( 1 );
+            }
+
+            if ( !(charset = read_charset( argv[arg] )) )
+            {
+                fprintf( stderr, "Cannot read charset file \"%s\".\n", argv[arg] );
+                exit( 1 );
+            }
+
+            font_cache = charset;
+            continue;
+        }
+
+        if ( 0 == strcmp( "--pack", argv[arg] ) || 0 == strcmp( "-pk", argv[arg] ) )
+        {
+            ++arg;
+
+            if ( arg >= argc )
+            {
+                fprintf( stderr, "No packing given.\n" );
+                print_help();
+                exit( 1 );
+            }
+
+            if( 0 == strcmp( "input", argv[arg] ) )
+            {
+                offline = 0;
+            }
+            else if( 0 == strcmp( "offline", argv[arg] ) )
+            {
+                offline = 1;
+            }
+            else
+            {
+                fprintf( stderr, "No valid packing given.\n" );
+                print_help();
+                exit( 1 );
+            }
+
+            continue;
+        }
+
+        if ( 0 == strcmp( "--compress", argv[arg] ) || 0 == strcmp( "-z", argv[arg] ) )
+        {
+            ++arg;
+
+            if ( arg >= argc )
+            {
+                fprintf( stderr, "No compression given.\n" );
+                print_help();
+                exit( 1 );
+            }
+
+            if( 0 == strcmp( "none", argv[arg] ) )
+            {
+                compress = 0;
+            }
+            else if( 0 == strcmp( "bc", argv[arg] ) )
+            {
+                compress = 1;
+            }
+            else
+            {
+                fprintf( stderr, "No valid compression given.\n" );
+                print_help();
+                exit( 1 );
+            }
+
+            continue;
+        }
+
         fprintf( stderr, "Unknown parameter %s\n", argv[arg] );
         print_help();
         exit( 1 );
@@ -543,18 +1056,33 @@ int main( int argc, char **argv )
     texture_atlas_t * atlas = texture_atlas_new( texture_width, texture_width, depth );
     if ( 0 != spacing)
         atlas->spacing_horiz = atlas->spacing_vert = spacing;
+    // Glyphs aligned to the 4x4 blocks of compressed textures
+    if ( compress )
+        texture_atlas_set_align( atlas, 4 );
+
+    // Offline packing rasterizes once and packs the glyphs densest first,
+    // packing in input order being left for when they do not fit
+    if ( offline )
+    {
+        font = new_font( atlas, auto_size ? OFFLINE_PILOT_SIZE : font_size, font_filename,
+                         padding, rendermode, kerning_mode, threads );
+        if ( font && (font = offline_font( font, font_cache, auto_size, atlas, threads )) )
+        {
+            texture_atlas_delete( atlas );
+            atlas = font->atlas;
+            font_size = font->size;
+            auto_size = 0;
+        }
+        else
+        {
+            fprintf( stderr, "Glyphs do not fit offline, packing them in input order.\n" );
+            offline = 0;
+        }
+    }
     while(!font || auto_size) {
         texture_atlas_clear(atlas);
-        font  = texture_font_new_from_file( atlas, font_size, font_filename );
-        for (int i = 0; i < 4; ++i)
-            if ( 0 != padding[i])
-                switch (i) {
-                    case 0: font->padding_left = padding[i]; break;
-                    case 1: font->padding_right = padding[i]; break;
-                    case 2: font->padding_top = padding[i]; break;
-                    case 3: font->padding_bottom = padding[i]; break;
-                }
-        font->rendermode = rendermode;
+        font  = new_font( atlas, font_size, font_filename, padding, rendermode,
+                          kerning_mode, threads );
 
         missed = texture_font_load_glyphs( font, font_cache );
 
@@ -607,11 +1135,13 @@ int main( int argc, char **argv )
             "\n"
             "Header filename         : %s\n"
             "Variable name           : %s\n"
-            "Render mode             : %s\n",
+            "Render mode             : %s\n"
+            "Kerning storage         : %s\n"
+            "Packing                 : %s\n",
             font_filename,
             font_size,
             font->padding_left, font->padding_right, font->padding_top, font->padding_bottom,
-            strlen(font_cache),
+            utf8_strlen(font_cache),
             vector_glyphs_size( font->glyphs ),
             missed,
             atlas->width, atlas->height, atlas->depth,
@@ -619,24 +1149,58 @@ int main( int argc, char **argv )
             100.0 * atlas->used / (float)(atlas->width * atlas->height),
             base_name(header_filename),
             variable_name,
-            rendermodes[rendermode] );
+            rendermodes[rendermode],
+            kerning_mode == KERNING_COMPACT ? "compact" : "pages",
+            offline ? packers[atlas->packer] : "input order" );
+
+    // BC4 blocks for depth 1, BC7 blocks otherwise, the PNG image and the
+    // baked font keeping the pixels
+    const unsigned char * tex_data = atlas->data;
+    size_t texture_size = atlas->width * atlas->height * atlas->depth;
+    block_format_t tex_format = block_compress_format( atlas->depth );
+    if ( compress )
+    {
+        if ( !(tex_data = texture_atlas_compress( atlas, threads )) )
+        {
+            fprintf( stderr, "Cannot compress texture.\n" );
+            exit( 1 );
+        }
+        texture_size = block_compress_size( tex_format, atlas->width, atlas->height );
+        printf( "Compression             : %s, %" PRIzu " bytes (%.1f:1), PSNR %.2f dB\n",
+                block_compress_name( tex_format ), texture_size,
+                (double) (atlas->width * atlas->height * atlas->depth) / texture_size,
+                block_compress_psnr( tex_format, atlas->data, atlas->width, atlas->height,
+                                     atlas->depth, tex_data ) );
+    }
+
+    if ( binary_filename )
+    {
+        if ( !baked_font_save( font, binary_filename ) )
+        {
+            fprintf( stderr, "Cannot write binary file \"%s\".\n", binary_filename );
+            exit( 1 );
+        }
+        printf( "Binary filename         : %s\n", binary_filename );
+    }
+
+    // Glyphs in codepoint order, each once
+    const size_t glyph_count = vector_glyphs_size( font->glyphs );
+    texture_glyph_t **glyphs = malloc( (glyph_count + 1) * sizeof(texture_glyph_t *) );
+    k = 0;
+    GLYPHS_ITERATOR(i, glyph, font->glyphs) {
+        glyphs[k++] = glyph;
+    }
+    GLYPHS_ITERATOR_END
+    qsort( glyphs, glyph_count, sizeof(texture_glyph_t *), glyph_compare );
 
-    const size_t texture_size = atlas->width * atlas->height * atlas->depth;
-    const size_t glyph_count = vector_size( font->glyphs );
+    // The generated header keeps a two-stage table of 256 glyph pages
+    const size_t page_count = glyph_count ? (glyphs[glyph_count-1]->codepoint >> 8) + 1 : 0;
     size_t max_kerning_count = 1;
     for( i=0; i < glyph_count; ++i )
     {
-        texture_glyph_t **glyph_0x100 = *(texture_glyph_t ***) vector_get( font->glyphs, i );
-        if(glyph_0x100) {
-            for( j=0; j < 0x100; ++j ) {
-                texture_glyph_t *glyph;
-                if(( glyph = glyph_0x100[j] )) {
-                    size_t new_max = vector_size(glyph->kerning);
-                    if( new_max > max_kerning_count )
-                        max_kerning_count = new_max;
-                }
-            }
-        }
+        size_t new_max = vector_size(glyphs[i]->kerning);
+        if( new_max > max_kerning_count )
+            max_kerning_count = new_max;
     }
 
 
@@ -785,23 +1349,15 @@ int main( int argc, char **argv )
     fprintf( bfile, "<chars count=\"%" PRIzu "\">\n", glyph_count );
     for( i=0; i < glyph_count; ++i )
     {
-        texture_glyph_t **glyph_0x100 = *(texture_glyph_t ***) vector_get( font->glyphs, i );
-        if (glyph_0x100)
-        {
-            for( j=0; j < 0x100; ++j ) {
-                texture_glyph_t *glyph;
-                if(( glyph = glyph_0x100[j] )) {
-                    fprintf( bfile, "  <char id=\"%u\" code=\"%u\" x=\"%" PRIzu "\" y=\"%" PRIzu "\" width=\"%" PRIzu "\" height=\"%" PRIzu "\" data_x=\"%" PRIzu "\" data_y=\"%" PRIzu "\" data_width=\"%" PRIzu "\" data_height=\"%" PRIzu "\" xoffset=\"%d\" yoffset=\"%d\" xadvance=\"%d\" page=\"0\" chnl=\"0\" letter=\"%s\"/>\n",
+        glyph = glyphs[i];
+        fprintf( bfile, "  <char id=\"%u\" code=\"%u\" x=\"%" PRIzu "\" y=\"%" PRIzu "\" width=\"%" PRIzu "\" height=\"%" PRIzu "\" data_x=\"%" PRIzu "\" data_y=\"%" PRIzu "\" data_width=\"%" PRIzu "\" data_height=\"%" PRIzu "\" xoffset=\"%d\" yoffset=\"%d\" xadvance=\"%d\" page=\"0\" chnl=\"0\" letter=\"%s\"/>\n",
                         glyph->codepoint, glyph->codepoint,
                         glyph->x, glyph->y, glyph->width, glyph->height,
                         glyph->data_x, glyph->data_y, glyph->data_width, glyph->data_height,
                         roundi(glyph->offset_x), roundi(font->ascender - glyph->offset_y),
                         roundi(glyph->advance_x),
                         xml_entity(glyph->codepoint)
-                    );
-                }
-            }
-        }
+        );
     }
     fprintf( bfile, "</chars>\n</font>\n" );
 
@@ -857,9 +1413,12 @@ int main( int argc, char **argv )
         " * Texture width: %" PRIzu "\n"
         " * Texture height: %" PRIzu "\n"
         " * Texture depth: %" PRIzu "\n"
+        "%s"
         " * ===============================================================================\n"
         " */\n\n", 
-        font_size, atlas->width, atlas->height, atlas->depth);
+        font_size, atlas->width, atlas->height, atlas->depth,
+        !compress ? "" : tex_format == BLOCK_BC4 ? " * Texture compression: BC4\n"
+                                                 : " * Texture compression: BC7\n");
 
 
     // ----------------------
@@ -873,17 +1432,39 @@ int main( int argc, char **argv )
 	     "#endif\n"
 	     "\n" );
 
-    fprintf( file,
-        "typedef struct\n"
-        "{\n"
-        "    uint32_t codepoint;\n"
-        "    int width, height;\n"
-        "    int offset_x, offset_y;\n"
-        "    float advance_x, advance_y;\n"
-        "    float s0, t0, s1, t1;\n"
-        "    size_t kerning_count;\n"
-        "    float kerning[%" PRIzu "][0x100];\n"
-        "} texture_glyph_t;\n\n", max_kerning_count );
+    if( kerning_mode == KERNING_COMPACT ) {
+        fprintf( file,
+            "/* Kerning against the preceding codepoint, in 1/%d pixels */\n"
+            "typedef struct\n"
+            "{\n"
+            "    uint32_t codepoint;\n"
+            "    int16_t kerning;\n"
+            "} texture_glyph_kerning_t;\n\n", KERNING_COMPACT_SCALE );
+
+        fprintf( file,
+            "typedef struct\n"
+            "{\n"
+            "    uint32_t codepoint;\n"
+            "    int width, height;\n"
+            "    int offset_x, offset_y;\n"
+            "    float advance_x, advance_y;\n"
+            "    float s0, t0, s1, t1;\n"
+            "    size_t kerning_count;\n"
+            "    const texture_glyph_kerning_t *kerning; /* sorted by codepoint */\n"
+            "} texture_glyph_t;\n\n" );
+    } else {
+        fprintf( file,
+            "typedef struct\n"
+            "{\n"
+            "    uint32_t codepoint;\n"
+            "    int width, height;\n"
+            "    int offset_x, offset_y;\n"
+            "    float advance_x, advance_y;\n"
+            "    float s0, t0, s1, t1;\n"
+            "    size_t kerning_count;\n"
+            "    float kerning[%" PRIzu "][0x100];\n"
+            "} texture_glyph_t;\n\n", max_kerning_count );
+    }
 
     fprintf( file,
 	     "typedef struct\n"
@@ -897,6 +1478,7 @@ int main( int argc, char **argv )
         "    size_t tex_width;\n"
         "    size_t tex_height;\n"
         "    size_t tex_depth;\n"
+        "%s"
         "    unsigned char tex_data[%" PRIzu "];\n"
         "    float size;\n"
         "    float height;\n"
@@ -905,13 +1487,19 @@ int main( int argc, char **argv )
         "    float descender;\n"
         "    size_t glyphs_count;\n"
         "    texture_glyph_0x100_t glyphs[%" PRIzu "];\n"
-        "} texture_font_t;\n\n", texture_size, glyph_count );
+        "} texture_font_t;\n\n",
+        compress ? "    unsigned int tex_format; /* of glCompressedTexImage2D */\n" : "",
+        texture_size, page_count );
 
-    GLYPHS_ITERATOR(i, glyph, font->glyphs) {
-        fprintf( file, "texture_glyph_t %s_glyph_%08x = ", variable_name, glyph->codepoint );
-        print_glyph(file, glyph);
+    for( i=0; i < glyph_count; ++i )
+    {
+        if( kerning_mode == KERNING_COMPACT ) {
+            print_glyph_compact(file, glyphs[i], variable_name);
+            continue;
+        }
+        fprintf( file, "texture_glyph_t %s_glyph_%08x = ", variable_name, glyphs[i]->codepoint );
+        print_glyph(file, glyphs[i]);
     }
-    GLYPHS_ITERATOR_END
 
     fprintf( file, "texture_font_t %s = {\n", variable_name );
 
@@ -920,6 +1508,9 @@ int main( int argc, char **argv )
     // Texture data
     // ------------
     fprintf( file, " %" PRIzu ", %" PRIzu ", %" PRIzu ",\n", atlas->width, atlas->height, atlas->depth );
+    // GL_COMPRESSED_RED_RGTC1 or GL_COMPRESSED_RGBA_BPTC_UNORM
+    if ( compress )
+        fprintf( file, " 0x%X,\n", tex_format == BLOCK_BC4 ? 0x8DBB : 0x8E8C );
     fprintf( file, " {" );
     for( i=0; i < texture_size; i+=32 )
     {
@@ -927,11 +1518,11 @@ int main( int argc, char **argv )
         {
             if( (j+i) < (texture_size-1) )
             {
-                fprintf( file, "%d,", atlas->data[i+j] );
+                fprintf( file, "%d,", tex_data[i+j] );
             }
             else
             {
-                fprintf( file, "%d", atlas->data[i+j] );
+                fprintf( file, "%d", tex_data[i+j] );
             }
         }
         if( (j+i) < texture_size )
@@ -948,22 +1539,25 @@ int main( int argc, char **argv )
     fprintf( file, " %ff, %ff, %ff, %ff, %ff, %" PRIzu ", \n",
             font->size, font->height,
             font->linegap,font->ascender, font->descender,
-            glyph_count );
+            page_count );
 
     // --------------
     // Texture glyphs
     // --------------
     fprintf( file, " {\n" );
-    GLYPHS_ITERATOR1(i, glyph, font->glyphs) {
+    for( i=0; i < page_count; ++i )
+    {
         fprintf( file, " {\n" );
-        GLYPHS_ITERATOR2(i, glyph, font->glyphs) {
-            fprintf( file, "  &%s_glyph_%08x,\n", variable_name, glyph->codepoint );
-        } else {
-            fprintf( file, "  NULL,\n" );
+        for( j=0; j < 0x100; ++j ) {
+            // Codepoints missing from the face point to the glyph they share
+            if(( glyph = texture_font_find_glyph_gi( font, (uint32_t)(i << 8 | j) ) )) {
+                fprintf( file, "  &%s_glyph_%08x,\n", variable_name, glyph->codepoint );
+            } else {
+                fprintf( file, "  NULL,\n" );
+            }
         }
-        GLYPHS_ITERATOR_END1;
         fprintf( file, " },\n" );
-    } GLYPHS_ITERATOR_END2;
+    }
     fprintf( file, " }\n};\n" );
     fprintf( file,
         "#ifdef __cplusplus\n"
@@ -971,6 +1565,8 @@ int main( int argc, char **argv )
         "#endif\n" );
 
     fclose( file );
+    free( glyphs );
+    free( charset );
 
     return 0;
 }
@@ -1400,7 +1996,6 @@ void libattopng_destroy(libattopng_t *png) {
     free(png);
 }
 
-#ifdef __APPLE__
 /*
  * The strrstr() function finds the last occurrence of the substring needle
  * in the string haystack. The terminating nul characters are not compared.
@@ -1419,4 +2014,3 @@ char *strrstr(const char *haystack, const char *needle)
 		haystack = p + 1;
 	}
 }
-#endif
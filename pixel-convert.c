@@ -0,0 +1,425 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include "pixel-convert.h"
+
+#ifndef FTGL_NO_SIMD
+# if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define PIXEL_SSE2
+#  include <emmintrin.h>
+#  if defined(__GNUC__) || defined(__clang__)
+/* AVX2 kernels are compiled for AVX2 whatever the build flags, and only
+ * called when the processor has it */
+#   define PIXEL_AVX2
+#   define PIXEL_AVX2_TARGET __attribute__((target("avx2")))
+#   include <immintrin.h>
+#  endif
+# elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define PIXEL_NEON
+#  include <arm_neon.h>
+# endif
+#endif
+
+/* Instruction set conversions are restricted to, -1 for the best one */
+static int pixel_isa = -1;
+
+/* Weights of red, green and blue in the luminosity, in 1/256 */
+#define LUMA_R 77
+#define LUMA_G 151
+#define LUMA_B 28
+
+
+// ------------------------------------------------------ scalar conversions ---
+static void
+bgra_to_rgba_scalar( unsigned char *dst, const unsigned char *src, size_t count )
+{
+    size_t i;
+
+    for( i = 0; i < count; i++, dst += 4, src += 4 ) {
+        unsigned char b = src[0];
+
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = b;
+        dst[3] = src[3];
+    }
+}
+
+static void
+bgra_to_grey_scalar( unsigned char *dst, const unsigned char *src, size_t count )
+{
+    size_t i;
+
+    for( i = 0; i < count; i++, src += 4 ) {
+        unsigned int luma = (LUMA_B * src[0] + LUMA_G * src[1] + LUMA_R * src[2] + 128) >> 8;
+        unsigned int t = luma * src[3] + 128;
+
+        /* t / 255, rounded, for t up to 255 * 255 + 128 */
+        dst[i] = (unsigned char) ((t + (t >> 8)) >> 8);
+    }
+}
+
+static void
+grey_to_rgba_scalar( unsigned char *dst, const unsigned char *src, size_t count )
+{
+    size_t i;
+
+    for( i = 0; i < count; i++, dst += 4 ) {
+        dst[0] = dst[1] = dst[2] = 255;
+        dst[3] = src[i];
+    }
+}
+
+
+#ifdef PIXEL_SSE2
+// -------------------------------------------------------- SSE2 conversions ---
+/* Each returns the number of pixels it converted, the rest being left to
+ * the scalar version */
+static size_t
+bgra_to_rgba_sse2( unsigned char *dst, const unsigned char *src, size_t count )
+{
+    const __m128i ga = _mm_set1_epi32( (int) 0xFF00FF00 );
+    const __m128i low = _mm_set1_epi32( 0xFF );
+    size_t i;
+
+    for( i = 0; i + 4 <= count; i += 4 ) {
+        __m128i v = _mm_loadu_si128( (const __m128i *) (src + 4 * i) );
+        __m128i r = _mm_and_si128( _mm_srli_epi32( v, 16 ), low );
+        __m128i b = _mm_slli_epi32( _mm_and_si128( v, low ), 16 );
+
+        _mm_storeu_si128( (__m128i *) (dst + 4 * i),
+                          _mm_or_si128( _mm_and_si128( v, ga ), _mm_or_si128( r, b ) ) );
+    }
+    return i;
+}
+
+static size_t
+bgra_to_grey_sse2( unsigned char *dst, const unsigned char *src, size_t count )
+{
+    const __m128i low = _mm_set1_epi32( 0xFF );
+    const __m128i half = _mm_set1_epi16( 128 );
+    size_t i;
+
+    for( i = 0; i + 8 <= count; i += 8 ) {
+        __m128i v0 = _mm_loadu_si128( (const __m128i *) (src + 4 * i) );
+        __m128i v1 = _mm_loadu_si128( (const __m128i *) (src + 4 * i + 16) );
+        /* Channels of the 8 pixels as 16 bits integers */
+        __m128i b = _mm_packs_epi32( _mm_and_si128( v0, low ), _mm_and_si128( v1, low ) );
+        __m128i g = _mm_packs_epi32( _mm_and_si128( _mm_srli_epi32( v0, 8 ), low ),
+                                     _mm_and_si128( _mm_srli_epi32( v1, 8 ), low ) );
+        __m128i r = _mm_packs_epi32( _mm_and_si128( _mm_srli_epi32( v0, 16 ), low ),
+                                     _mm_and_si128( _mm_srli_epi32( v1, 16 ), low ) );
+        __m128i a = _mm_packs_epi32( _mm_srli_epi32( v0, 24 ), _mm_srli_epi32( v1, 24 ) );
+        __m128i luma, t;
+
+        luma = _mm_add_epi16( _mm_mullo_epi16( r, _mm_set1_epi16( LUMA_R ) ),
+                              _mm_mullo_epi16( g, _mm_set1_epi16( LUMA_G ) ) );
+        luma = _mm_add_epi16( luma, _mm_mullo_epi16( b, _mm_set1_epi16( LUMA_B ) ) );
+        luma = _mm_srli_epi16( _mm_add_epi16( luma, half ), 8 );
+        t = _mm_add_epi16( _mm_mullo_epi16( luma, a ), half );
+        t = _mm_srli_epi16( _mm_add_epi16( t, _mm_srli_epi16( t, 8 ) ), 8 );
+        _mm_storel_epi64( (__m128i *) (dst + i), _mm_packus_epi16( t, t ) );
+    }
+    return i;
+}
+
+static size_t
+grey_to_rgba_sse2( unsigned char *dst, const unsigned char *src, size_t count )
+{
+    const __m128i ones = _mm_set1_epi8( (char) 0xFF );
+    size_t i;
+
+    for( i = 0; i + 16 <= count; i += 16 ) {
+        __m128i g = _mm_loadu_si128( (const __m128i *) (src + i) );
+        /* 0xFF then the grey level, twice */
+        __m128i lo = _mm_unpacklo_epi8( ones, g );
+        __m128i hi = _mm_unpackhi_epi8( ones, g );
+        __m128i *out = (__m128i *) (dst + 4 * i);
+
+        _mm_storeu_si128( out,     _mm_unpacklo_epi16( ones, lo ) );
+        _mm_storeu_si128( out + 1, _mm_unpackhi_epi16( ones, lo ) );
+        _mm_storeu_si128( out + 2, _mm_unpacklo_epi16( ones, hi ) );
+        _mm_storeu_si128( out + 3, _mm_unpackhi_epi16( ones, hi ) );
+    }
+    return i;
+}
+#endif
+
+
+#ifdef PIXEL_AVX2
+// -------------------------------------------------------- AVX2 conversions ---
+PIXEL_AVX2_TARGET static size_t
+bgra_to_rgba_avx2( unsigned char *dst, const unsigned char *src, size_t count )
+{
+    const __m256i swap = _mm256_setr_epi8( 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                                           2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15 );
+    size_t i;
+
+    for( i = 0; i + 8 <= count; i += 8 ) {
+        __m256i v = _mm256_loadu_si256( (const __m256i *) (src + 4 * i) );
+
+        _mm256_storeu_si256( (__m256i *) (dst + 4 * i), _mm256_shuffle_epi8( v, swap ) );
+    }
+    return i;
+}
+
+PIXEL_AVX2_TARGET static size_t
+bgra_to_grey_avx2( unsigned char *dst, const unsigned char *src, size_t count )
+{
+    const __m256i low = _mm256_set1_epi32( 0xFF );
+    const __m256i half = _mm256_set1_epi16( 128 );
+    const __m256i order = _mm256_setr_epi32( 0, 4, 1, 5, 0, 4, 1, 5 );
+    size_t i;
+
+    for( i = 0; i + 16 <= count; i += 16 ) {
+        __m256i v0 = _mm256_loadu_si256( (const __m256i *) (src + 4 * i) );
+        __m256i v1 = _mm256_loadu_si256( (const __m256i *) (src + 4 * i + 32) );
+        /* Packing works within 128 bits lanes: the pixels are shuffled the
+         * same way in every channel, and put back in order at the end */
+        __m256i b = _mm256_packs_epi32( _mm256_and_si256( v0, low ), _mm256_and_si256( v1, low ) );
+        __m256i g = _mm256_packs_epi32( _mm256_and_si256( _mm256_srli_epi32( v0, 8 ), low ),
+                                        _mm256_and_si256( _mm256_srli_epi32( v1, 8 ), low ) );
+        __m256i r = _mm256_packs_epi32( _mm256_and_si256( _mm256_srli_epi32( v0, 16 ), low ),
+                                        _mm256_and_si256( _mm256_srli_epi32( v1, 16 ), low ) );
+        __m256i a = _mm256_packs_epi32( _mm256_srli_epi32( v0, 24 ), _mm256_srli_epi32( v1, 24 ) );
+        __m256i luma, t;
+
+        luma = _mm256_add_epi16( _mm256_mullo_epi16( r, _mm256_set1_epi16( LUMA_R ) ),
+                                 _mm256_mullo_epi16( g, _mm256_set1_epi16( LUMA_G ) ) );
+        luma = _mm256_add_epi16( luma, _mm256_mullo_epi16( b, _mm256_set1_epi16( LUMA_B ) ) );
+        luma = _mm256_srli_epi16( _mm256_add_epi16( luma, half ), 8 );
+        t = _mm256_add_epi16( _mm256_mullo_epi16( luma, a ), half );
+        t = _mm256_srli_epi16( _mm256_add_epi16( t, _mm256_srli_epi16( t, 8 ) ), 8 );
+        t = _mm256_permutevar8x32_epi32( _mm256_packus_epi16( t, t ), order );
+        _mm_storeu_si128( (__m128i *) (dst + i), _mm256_castsi256_si128( t ) );
+    }
+    return i;
+}
+
+PIXEL_AVX2_TARGET static size_t
+grey_to_rgba_avx2( unsigned char *dst, const unsigned char *src, size_t count )
+{
+    const __m256i white = _mm256_set1_epi32( 0x00FFFFFF );
+    size_t i;
+
+    for( i = 0; i + 8 <= count; i += 8 ) {
+        __m256i g = _mm256_cvtepu8_epi32( _mm_loadl_epi64( (const __m128i *) (src + i) ) );
+
+        _mm256_storeu_si256( (__m256i *) (dst + 4 * i),
+                             _mm256_or_si256( _mm256_slli_epi32( g, 24 ), white ) );
+    }
+    return i;
+}
+#endif
+
+
+#ifdef PIXEL_NEON
+// -------------------------------------------------------- NEON conversions ---
+static size_t
+bgra_to_rgba_neon( unsigned char *dst, const unsigned char *src, size_t count )
+{
+    size_t i;
+
+    for( i = 0; i + 16 <= count; i += 16 ) {
+        uint8x16x4_t p = vld4q_u8( src + 4 * i );
+        uint8x16_t b = p.val[0];
+
+        p.val[0] = p.val[2];
+        p.val[2] = b;
+        vst4q_u8( dst + 4 * i, p );
+    }
+    return i;
+}
+
+static size_t
+bgra_to_grey_neon( unsigned char *dst, const unsigned char *src, size_t count )
+{
+    size_t i;
+
+    for( i = 0; i + 8 <= count; i += 8 ) {
+        uint8x8x4_t p = vld4_u8( src + 4 * i );
+        uint16x8_t luma, t;
+
+        luma = vmull_u8( p.val[2], vdup_n_u8( LUMA_R ) );
+        luma = vmlal_u8( luma, p.val[1], vdup_n_u8( LUMA_G ) );
+        luma = vmlal_u8( luma, p.val[0], vdup_n_u8( LUMA_B ) );
+        t = vmull_u8( vrshrn_n_u16( luma, 8 ), p.val[3] );
+        t = vaddq_u16( t, vdupq_n_u16( 128 ) );
+        t = vsraq_n_u16( t, t, 8 );
+        vst1_u8( dst + i, vshrn_n_u16( t, 8 ) );
+    }
+    return i;
+}
+
+static size_t
+grey_to_rgba_neon( unsigned char *dst, const unsigned char *src, size_t count )
+{
+    size_t i;
+
+    for( i = 0; i + 16 <= count; i += 16 ) {
+        uint8x16x4_t p;
+
+        p.val[0] = p.val[1] = p.val[2] = vdupq_n_u8( 255 );
+        p.val[3] = vld1q_u8( src + i );
+        vst4q_u8( dst + 4 * i, p );
+    }
+    return i;
+}
+#endif
+
+
+// ------------------------------------------------- pixel_convert_supports ---
+int
+pixel_convert_supports( pixel_isa_t isa )
+{
+    switch( isa ) {
+    case PIXEL_ISA_SCALAR:
+        return 1;
+#ifdef PIXEL_SSE2
+    case PIXEL_ISA_SSE2:
+        return 1;
+#endif
+#ifdef PIXEL_AVX2
+    case PIXEL_ISA_AVX2:
+        return __builtin_cpu_supports( "avx2" ) != 0;
+#endif
+#ifdef PIXEL_NEON
+    case PIXEL_ISA_NEON:
+        return 1;
+#endif
+    default:
+        return 0;
+    }
+}
+
+// -------------------------------------------------- pixel_convert_set_isa ---
+int
+pixel_convert_set_isa( pixel_isa_t isa )
+{
+    if( !pixel_convert_supports( isa ) )
+        return 0;
+    pixel_isa = (int) isa;
+    return 1;
+}
+
+// -------------------------------------------------- pixel_convert_get_isa ---
+pixel_isa_t
+pixel_convert_get_isa( void )
+{
+    if( pixel_isa >= 0 )
+        return (pixel_isa_t) pixel_isa;
+    if( pixel_convert_supports( PIXEL_ISA_AVX2 ) )
+        return PIXEL_ISA_AVX2;
+    if( pixel_convert_supports( PIXEL_ISA_SSE2 ) )
+        return PIXEL_ISA_SSE2;
+    if( pixel_convert_supports( PIXEL_ISA_NEON ) )
+        return PIXEL_ISA_NEON;
+    return PIXEL_ISA_SCALAR;
+}
+
+// ------------------------------------------------- pixel_convert_isa_name ---
+const char *
+pixel_convert_isa_name( pixel_isa_t isa )
+{
+    switch( isa ) {
+    case PIXEL_ISA_SCALAR: return "scalar";
+    case PIXEL_ISA_SSE2:   return "sse2";
+    case PIXEL_ISA_AVX2:   return "avx2";
+    case PIXEL_ISA_NEON:   return "neon";
+    }
+    return "unknown";
+}
+
+// --------------------------------------------- pixel_convert_bgra_to_rgba ---
+void
+pixel_convert_bgra_to_rgba( unsigned char * dst,
+                            const unsigned char * src,
+                            size_t count )
+{
+    size_t done = 0;
+
+    switch( pixel_convert_get_isa( ) ) {
+#ifdef PIXEL_AVX2
+    case PIXEL_ISA_AVX2:
+        done = bgra_to_rgba_avx2( dst, src, count );
+        break;
+#endif
+#ifdef PIXEL_SSE2
+    case PIXEL_ISA_SSE2:
+        done = bgra_to_rgba_sse2( dst, src, count );
+        break;
+#endif
+#ifdef PIXEL_NEON
+    case PIXEL_ISA_NEON:
+        done = bgra_to_rgba_neon( dst, src, count );
+        break;
+#endif
+    default:
+        break;
+    }
+    bgra_to_rgba_scalar( dst + 4 * done, src + 4 * done, count - done );
+}
+
+// --------------------------------------------- pixel_convert_bgra_to_grey ---
+void
+pixel_convert_bgra_to_grey( unsigned char * dst,
+                            const unsigned char * src,
+                            size_t count )
+{
+    size_t done = 0;
+
+    switch( pixel_convert_get_isa( ) ) {
+#ifdef PIXEL_AVX2
+    case PIXEL_ISA_AVX2:
+        done = bgra_to_grey_avx2( dst, src, count );
+        break;
+#endif
+#ifdef PIXEL_SSE2
+    case PIXEL_ISA_SSE2:
+        done = bgra_to_grey_sse2( dst, src, count );
+        break;
+#endif
+#ifdef PIXEL_NEON
+    case PIXEL_ISA_NEON:
+        done = bgra_to_grey_neon( dst, src, count );
+        break;
+#endif
+    default:
+        break;
+    }
+    bgra_to_grey_scalar( dst + done, src + 4 * done, count - done );
+}
+
+// --------------------------------------------- pixel_convert_grey_to_rgba ---
+void
+pixel_convert_grey_to_rgba( unsigned char * dst,
+                            const unsigned char * src,
+                            size_t count )
+{
+    size_t done = 0;
+
+    switch( pixel_convert_get_isa( ) ) {
+#ifdef PIXEL_AVX2
+    case PIXEL_ISA_AVX2:
+        done = grey_to_rgba_avx2( dst, src, count );
+        break;
+#endif
+#ifdef PIXEL_SSE2
+    case PIXEL_ISA_SSE2:
+        done = grey_to_rgba_sse2( dst, src, count );
+        break;
+#endif
+#ifdef PIXEL_NEON
+    case PIXEL_ISA_NEON:
+        done = grey_to_rgba_neon( dst, src, count );
+        break;
+#endif
+    default:
+        break;
+    }
+    grey_to_rgba_scalar( dst + 4 * done, src + done, count - done );
+}
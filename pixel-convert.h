@@ -0,0 +1,153 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#ifndef __PIXEL_CONVERT_H__
+#define __PIXEL_CONVERT_H__
+
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+namespace ftgl {
+#endif
+
+/**
+ * @file   pixel-convert.h
+ *
+ * @defgroup pixel-convert Pixel conversion
+ *
+ * Conversions of rows of pixels between the formats FreeType renders
+ * (grey levels, BGRA for color fonts) and the ones of the atlas (grey
+ * levels, RGBA), used by @ref texture-font when copying glyphs.
+ *
+ * Each conversion has a scalar version and vector ones (SSE2 and AVX2 on
+ * x86, NEON on ARM), the best one the processor supports being chosen at
+ * run time. They all compute the same integer results. Building with
+ * FTGL_NO_SIMD keeps the scalar versions only.
+ *
+ * <b>Example Usage</b>:
+ * @code
+ * #include "pixel-convert.h"
+ *
+ * int main( int arrgc, char *argv[] )
+ * {
+ *   unsigned char bgra[4] = { 0, 0, 255, 255 }, grey;
+ *
+ *   pixel_convert_bgra_to_grey( &grey, bgra, 1 );
+ *
+ *   return 0;
+ * }
+ * @endcode
+ *
+ * @{
+ */
+
+/**
+ * Instruction sets conversions may use.
+ */
+typedef enum pixel_isa_t
+{
+    PIXEL_ISA_SCALAR = 0,
+    PIXEL_ISA_SSE2,
+    PIXEL_ISA_AVX2,
+    PIXEL_ISA_NEON
+} pixel_isa_t;
+
+
+/**
+ * Tells whether the processor and the build support an instruction set.
+ *
+ * @param   isa  an instruction set
+ * @return       1 if conversions can use it, 0 otherwise
+ */
+  int
+  pixel_convert_supports( pixel_isa_t isa );
+
+
+/**
+ * Restricts conversions to an instruction set, e.g. to compare them. This
+ * is not thread-safe: no conversion may run meanwhile.
+ *
+ * @param   isa  an instruction set, PIXEL_ISA_SCALAR for no vectors
+ * @return       1 on success, 0 if the instruction set is not supported
+ */
+  int
+  pixel_convert_set_isa( pixel_isa_t isa );
+
+
+/**
+ * Returns the instruction set conversions use, the best one supported
+ * unless restricted by pixel_convert_set_isa.
+ *
+ * @return the instruction set in use
+ */
+  pixel_isa_t
+  pixel_convert_get_isa( void );
+
+
+/**
+ * Returns the name of an instruction set.
+ *
+ * @param   isa  an instruction set
+ * @return       its name, such as "sse2"
+ */
+  const char *
+  pixel_convert_isa_name( pixel_isa_t isa );
+
+
+/**
+ * Swaps the blue and red channels of BGRA pixels. dst and src may be the
+ * same.
+ *
+ * @param  dst    count RGBA pixels
+ * @param  src    count BGRA pixels
+ * @param  count  number of pixels
+ */
+  void
+  pixel_convert_bgra_to_rgba( unsigned char * dst,
+                              const unsigned char * src,
+                              size_t count );
+
+
+/**
+ * Converts BGRA pixels to grey levels: the luminosity of the color
+ * (0.30 red, 0.59 green, 0.11 blue, in 1/256) multiplied by its alpha,
+ * both rounded to the nearest.
+ *
+ * @param  dst    count grey levels
+ * @param  src    count BGRA pixels
+ * @param  count  number of pixels
+ */
+  void
+  pixel_convert_bgra_to_grey( unsigned char * dst,
+                              const unsigned char * src,
+                              size_t count );
+
+
+/**
+ * Expands grey levels to white RGBA pixels with the grey level as alpha.
+ *
+ * @param  dst    count RGBA pixels
+ * @param  src    count grey levels
+ * @param  count  number of pixels
+ */
+  void
+  pixel_convert_grey_to_rgba( unsigned char * dst,
+                              const unsigned char * src,
+                              size_t count );
+
+/** @} */
+
+#ifdef __cplusplus
+}
+}
+#endif
+
+#endif /* __PIXEL_CONVERT_H__ */
@@ -4,10 +4,11 @@
  * file `LICENSE` for more details.
  */
 uniform sampler2D u_texture;
+varying vec4 vchannel;
 
 void main(void)
 {
-    float dist = texture2D(u_texture, gl_TexCoord[0].st).r;
+    float dist = dot(texture2D(u_texture, gl_TexCoord[0].st), vchannel);
     float width = fwidth(dist);
     float alpha = smoothstep(0.5-width, 0.5+width, dist);
     gl_FragColor = vec4(gl_Color.rgb, alpha*gl_Color.a);
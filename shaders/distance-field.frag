@@ -4,6 +4,7 @@
  * file `LICENSE` for more details.
  */
 uniform sampler2D u_texture;
+varying vec4 vchannel;
 
        vec3 glyph_color    = vec3(1.0,1.0,1.0);
 const float glyph_center   = 0.50;
@@ -15,7 +16,7 @@ const float glow_center    = 1.25;
 void main(void)
 {
     vec4  color = texture2D(u_texture, gl_TexCoord[0].st);
-    float dist  = color.r;
+    float dist  = dot(color, vchannel);
     float width = fwidth(dist);
     float alpha = smoothstep(glyph_center-width, glyph_center+width, dist);
 
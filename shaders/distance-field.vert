@@ -11,10 +11,14 @@ uniform vec4 u_color;
 attribute vec3 vertex;
 attribute vec2 tex_coord;
 attribute vec4 color;
+attribute float achannel;
+
+varying vec4 vchannel;
 
 void main(void)
 {
     gl_TexCoord[0].xy = tex_coord.xy;
     gl_FrontColor     = color * u_color;
+    vchannel          = vec4(equal(vec4(achannel), vec4(0.0, 1.0, 2.0, 3.0)));
     gl_Position       = u_projection*(u_view*(u_model*vec4(vertex,1.0)));
 }
@@ -0,0 +1,33 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+attribute vec3 vertex;
+attribute vec4 color;
+attribute vec2 tex_coord;
+attribute float ashift;
+attribute float agamma;
+attribute float alayer;
+attribute float achannel;
+
+varying vec4 vcolor;
+varying vec3 vtex_coord;
+varying float vshift;
+varying float vgamma;
+varying vec4 vchannel;
+
+void main()
+{
+    vshift = ashift;
+    vgamma = agamma;
+    vcolor = color;
+    vtex_coord = vec3(tex_coord, alayer);
+    // Channel of the atlas the glyph is in, when packed apart
+    vchannel = vec4(equal(vec4(achannel), vec4(0.0, 1.0, 2.0, 3.0)));
+    gl_Position = projection*(view*(model*vec4(vertex,1.0)));
+}
@@ -56,13 +56,14 @@ varying vec4 vcolor;
 varying vec2 vtex_coord;
 varying float vshift;
 varying float vgamma;
+varying vec4 vchannel;
 
 void main()
 {
     // LCD Off
     if( pixel.z == 1.0)
     {
-        float a = texture2D(tex, vtex_coord).r;
+        float a = dot(texture2D(tex, vtex_coord), vchannel);
         gl_FragColor = vcolor * pow( a, 1.0/vgamma );
         return;
     }
@@ -14,11 +14,13 @@ attribute vec4 color;
 attribute vec2 tex_coord;
 attribute float ashift;
 attribute float agamma;
+attribute float achannel;
 
 varying vec4 vcolor;
 varying vec2 vtex_coord;
 varying float vshift;
 varying float vgamma;
+varying vec4 vchannel;
 
 void main()
 {
@@ -26,5 +28,7 @@ void main()
     vgamma = agamma;
     vcolor = color;
     vtex_coord = tex_coord;
+    // Channel of the atlas the glyph is in, when packed apart
+    vchannel = vec4(equal(vec4(achannel), vec4(0.0, 1.0, 2.0, 3.0)));
     gl_Position = projection*(view*(model*vec4(vertex,1.0)));
 }
@@ -0,0 +1,220 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freetype-gl.h"
+#include "text-buffer.h"
+#include "utf8-utils.h"
+#include "bench.h"
+
+/* Distance fields of a font at several sizes, in an RGBA atlas packing its
+ * channels apart against atlases of depth 1 of as many pixels and of as
+ * many bytes */
+#define FILENAME "fonts/Vera.ttf"
+#define ATLAS    256
+#define GLYPHS   0x800
+static const float sizes[] = { 16, 24, 32, 48 };
+#define SIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+typedef struct fill_t {
+    texture_atlas_t *atlas;
+    texture_font_t *fonts[SIZES];
+    texture_glyph_t *glyphs[GLYPHS];
+    size_t fonts_of[GLYPHS];
+    size_t count, area;
+    double time;
+} fill_t;
+
+// ------------------------------------------------------------------ fill ---
+/* Latin glyphs at each size, those that still fit once the atlas is full,
+ * returns 0 if a font cannot be loaded */
+static int
+fill( fill_t *self, size_t width, size_t depth, size_t channels )
+{
+    texture_glyph_t *glyph;
+    size_t i;
+    char utf8[5];
+    uint32_t c;
+
+    memset( self, 0, sizeof(*self) );
+    self->atlas = texture_atlas_new( width, width, depth );
+    if( channels > 1 )
+        texture_atlas_set_channels( self->atlas, channels );
+    for( i = 0; i < SIZES; i++ ) {
+        if( !(self->fonts[i] = texture_font_new_from_file( self->atlas, sizes[i], FILENAME )) ) {
+            fprintf( stderr, "Cannot load %s\n", FILENAME );
+            return 0;
+        }
+        self->fonts[i]->rendermode = RENDER_SIGNED_DISTANCE_FIELD;
+    }
+    self->time = now( );
+    for( i = 0; i < SIZES; i++ )
+        for( c = 0x21; c < 0x250; c++ ) {
+            if( !texture_font_covers( self->fonts[i], c ) )
+                continue;
+            utf32_to_utf8( c, utf8 );
+            if( !(glyph = texture_font_get_glyph( self->fonts[i], utf8 )) )
+                continue;
+            self->area += glyph->width * glyph->height;
+            self->fonts_of[self->count] = i;
+            self->glyphs[self->count++] = glyph;
+        }
+    self->time = now( ) - self->time;
+    return 1;
+}
+
+// ---------------------------------------------------------------- delete ---
+static void
+delete( fill_t *self )
+{
+    size_t i;
+
+    for( i = 0; i < SIZES; i++ )
+        if( self->fonts[i] )
+            texture_font_delete( self->fonts[i] );
+    texture_atlas_delete( self->atlas );
+}
+
+// ------------------------------------------------------------------ same ---
+/* Whether a glyph has, in its channel, the pixels of a glyph of an atlas of
+ * depth 1 */
+static int
+same( const texture_atlas_t *atlas, const texture_glyph_t *glyph,
+      const texture_atlas_t *reference, const texture_glyph_t *expected )
+{
+    size_t x, y;
+
+    if( glyph->width != expected->width || glyph->height != expected->height )
+        return 0;
+    for( y = 0; y < glyph->height; y++ )
+        for( x = 0; x < glyph->width; x++ )
+            if( atlas->data[((glyph->y + y) * atlas->width + glyph->x + x) * 4 + glyph->channel] !=
+                reference->data[(expected->y + y) * reference->width + expected->x + x] )
+                return 0;
+    return 1;
+}
+
+// ------------------------------------------------------------------- main ---
+int main( void )
+{
+    fill_t packed, pixels, bytes;
+    texture_glyph_t *glyph, *expected, *other;
+    text_buffer_t *buffer = text_buffer_new( );
+    unsigned char *before;
+    size_t used[4] = { 0 }, i, k, n, c;
+    vec2 pen = {{0, 0}};
+    markup_t markup;
+    char utf8[5];
+    int failed = 0;
+
+    if( !fill( &packed, ATLAS, 4, 4 ) || !fill( &pixels, ATLAS, 1, 1 ) ||
+        !fill( &bytes, 2 * ATLAS, 1, 1 ) )
+        return EXIT_FAILURE;
+
+    /* A plain RGBA atlas holds the glyphs of a grey one of its size */
+    printf( "%-12s %9s %9s %7s %9s %9s\n",
+            "atlas", "size", "bytes", "glyphs", "pixels", "time(ms)" );
+    printf( "%-12s %4d x %-2d %9" PRIzu " %7" PRIzu " %9" PRIzu " %9.2f\n",
+            "RGBA apart", ATLAS, 4, (size_t) ATLAS * ATLAS * 4,
+            packed.count, packed.area, packed.time * 1e3 );
+    printf( "%-12s %4d x %-2d %9" PRIzu " %7" PRIzu " %9" PRIzu " %9.2f\n",
+            "grey", ATLAS, 1, (size_t) ATLAS * ATLAS,
+            pixels.count, pixels.area, pixels.time * 1e3 );
+    printf( "%-12s %4d x %-2d %9" PRIzu " %7" PRIzu " %9" PRIzu " %9.2f\n",
+            "grey", 2 * ATLAS, 1, (size_t) ATLAS * ATLAS * 4,
+            bytes.count, bytes.area, bytes.time * 1e3 );
+
+    /* Four channels hold about four times the glyph pixels of one, as
+     * many as an atlas of depth 1 of as many bytes */
+    if( packed.area < 3 * pixels.area || 10 * packed.area < 9 * bytes.area ) {
+        fprintf( stderr, "%" PRIzu " pixels of glyphs packed apart\n", packed.area );
+        failed = 1;
+    }
+
+    /* Each glyph has the pixels of the same glyph in its channel, without
+     * overlapping another of the channel */
+    for( i = 0; i < packed.count; i++ ) {
+        glyph = packed.glyphs[i];
+        used[glyph->channel]++;
+        if( glyph->page ) {
+            fprintf( stderr, "glyph %u in page %" PRIzu "\n", glyph->codepoint, glyph->page );
+            failed = 1;
+        }
+        utf32_to_utf8( glyph->codepoint, utf8 );
+        expected = texture_font_find_glyph( bytes.fonts[packed.fonts_of[i]], utf8 );
+        if( expected && !same( packed.atlas, glyph, bytes.atlas, expected ) ) {
+            fprintf( stderr, "glyph %u damaged\n", glyph->codepoint );
+            failed = 1;
+        }
+        for( k = 0; k < i && glyph->width && glyph->height; k++ ) {
+            other = packed.glyphs[k];
+            if( other->channel == glyph->channel && other->width && other->height &&
+                glyph->x < other->x + other->width && other->x < glyph->x + glyph->width &&
+                glyph->y < other->y + other->height && other->y < glyph->y + glyph->height ) {
+                fprintf( stderr, "glyphs %u and %u overlap\n",
+                         glyph->codepoint, other->codepoint );
+                failed = 1;
+            }
+        }
+    }
+    for( c = 0; c < 4; c++ )
+        if( !used[c] ) {
+            fprintf( stderr, "channel %" PRIzu " unused\n", c );
+            failed = 1;
+        }
+
+    /* Vertices of each glyph sample its channel, the largest glyphs having
+     * been spread over all of them */
+    memset( &markup, 0, sizeof(markup) );
+    markup.font = packed.fonts[SIZES - 1];
+    markup.gamma = 1.0f;
+    markup.foreground_color.a = 1.0f;
+    for( i = 0, n = 0; i < packed.count; i++ ) {
+        const glyph_vertex_t *vertex;
+
+        if( packed.fonts_of[i] != SIZES - 1 )
+            continue;
+        utf32_to_utf8( packed.glyphs[i]->codepoint, utf8 );
+        text_buffer_add_char( buffer, &pen, &markup, utf8, NULL );
+        vertex = (glyph_vertex_t *) vector_get( buffer->buffer->vertices, 4 * n++ );
+        if( vertex->channel != (float) packed.glyphs[i]->channel ) {
+            fprintf( stderr, "glyph %u drawn from channel %g instead of %" PRIzu "\n",
+                     packed.glyphs[i]->codepoint, vertex->channel,
+                     packed.glyphs[i]->channel );
+            failed = 1;
+        }
+    }
+
+    /* A glyph given back clears its channel alone */
+    glyph = packed.glyphs[packed.count - 1];
+    n = packed.atlas->width * packed.atlas->height * 4;
+    before = (unsigned char *) malloc( n );
+    memcpy( before, packed.atlas->data, n );
+    texture_atlas_free_channel_region( packed.atlas, glyph->x, glyph->y,
+                                       glyph->width, glyph->height, glyph->channel );
+    for( i = 0; i < n; i++ ) {
+        size_t x = i / 4 % packed.atlas->width, y = i / 4 / packed.atlas->width;
+        int inside = x >= glyph->x && x < glyph->x + glyph->width &&
+                     y >= glyph->y && y < glyph->y + glyph->height &&
+                     i % 4 == glyph->channel;
+
+        if( packed.atlas->data[i] != (inside ? 0 : before[i]) ) {
+            fprintf( stderr, "pixel %" PRIzu " of channel %" PRIzu " %s\n",
+                     i / 4, i % 4, inside ? "not cleared" : "cleared" );
+            failed = 1;
+            break;
+        }
+    }
+    free( before );
+
+    text_buffer_delete( buffer );
+    delete( &packed );
+    delete( &pixels );
+    delete( &bytes );
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
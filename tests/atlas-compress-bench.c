@@ -0,0 +1,139 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freetype-gl.h"
+#include "block-compress.h"
+#include "utf8-utils.h"
+#include "bench.h"
+
+/* Glyphs of a font compressed in an atlas of grey levels (BC4) and one of
+ * RGBA pixels (BC7), then more glyphs compressed only where they land */
+#define FILENAME "fonts/Vera.ttf"
+#define ATLAS    512
+#define THREADS  4
+#define PSNR_MIN 35.0
+
+// ------------------------------------------------------------------ load ---
+/* Load the glyphs of a range of codepoints, returns how many are not
+ * aligned to blocks or -1 if the atlas is full */
+static int
+load( texture_font_t *font, uint32_t first, uint32_t last )
+{
+    texture_glyph_t *glyph;
+    int misaligned = 0;
+    char utf8[5];
+    uint32_t c;
+
+    for( c = first; c < last; c++ ) {
+        if( !texture_font_covers( font, c ) )
+            continue;
+        utf32_to_utf8( c, utf8 );
+        if( !(glyph = texture_font_get_glyph( font, utf8 )) )
+            return -1;
+        misaligned += glyph->x % 4 || glyph->y % 4;
+    }
+    return misaligned;
+}
+
+// ------------------------------------------------------------------- run ---
+static int
+run( size_t depth )
+{
+    texture_atlas_t *atlas = texture_atlas_new( ATLAS, ATLAS, depth );
+    texture_font_t *font;
+    block_format_t format = block_compress_format( depth );
+    size_t size = block_compress_size( format, ATLAS, ATLAS );
+    size_t blocks = (ATLAS / 4) * (ATLAS / 4), touched = 0, i;
+    unsigned char *single = (unsigned char *) malloc( size );
+    unsigned char *full = (unsigned char *) malloc( size );
+    double one, many, partial, psnr;
+    int misaligned, more, fine = 1;
+
+    texture_atlas_set_align( atlas, 4 );
+    if( !(font = texture_font_new_from_file( atlas, 20, FILENAME )) ) {
+        fprintf( stderr, "Cannot load %s\n", FILENAME );
+        return 0;
+    }
+
+    /* Latin-1, compressed whole on one thread and on several */
+    misaligned = load( font, 0x21, 0x100 );
+    if( misaligned < 0 ) {
+        fprintf( stderr, "depth %" PRIzu ": atlas full\n", depth );
+        return 0;
+    }
+    one = now( );
+    block_compress( format, atlas->data, ATLAS, ATLAS, depth, single, 1 );
+    one = now( ) - one;
+    many = now( );
+    texture_atlas_compress( atlas, THREADS );
+    many = now( ) - many;
+    if( memcmp( single, atlas->blocks, size ) ) {
+        fprintf( stderr, "depth %" PRIzu ": threads compress otherwise\n", depth );
+        fine = 0;
+    }
+    texture_atlas_clean( atlas );
+
+    /* Latin Extended, compressed where it lands against compressing it all */
+    if( (more = load( font, 0x100, 0x250 )) < 0 ) {
+        fprintf( stderr, "depth %" PRIzu ": atlas full\n", depth );
+        return 0;
+    }
+    misaligned += more;
+    for( i = 0; i < texture_atlas_dirty_count( atlas ); i++ ) {
+        ivec4 r = texture_atlas_get_dirty( atlas, i );
+        touched += (size_t) ((r.x + r.width + 3) / 4 - r.x / 4) *
+                   ((r.y + r.height + 3) / 4 - r.y / 4);
+    }
+    partial = now( );
+    texture_atlas_compress( atlas, THREADS );
+    partial = now( ) - partial;
+    block_compress( format, atlas->data, ATLAS, ATLAS, depth, full, THREADS );
+    if( memcmp( full, atlas->blocks, size ) ) {
+        fprintf( stderr, "depth %" PRIzu ": partial compression differs\n", depth );
+        fine = 0;
+    }
+    if( misaligned ) {
+        fprintf( stderr, "depth %" PRIzu ": %d glyphs not aligned\n", depth, misaligned );
+        fine = 0;
+    }
+    psnr = block_compress_psnr( format, atlas->data, ATLAS, ATLAS, depth,
+                                atlas->blocks );
+    if( psnr < PSNR_MIN ) {
+        fprintf( stderr, "depth %" PRIzu ": PSNR %.2f dB\n", depth, psnr );
+        fine = 0;
+    }
+
+    printf( "%-6s %5" PRIzu " %9" PRIzu " %8" PRIzu " %6.1f %9.2f %9.2f %7" PRIzu
+            "/%-7" PRIzu " %9.2f\n",
+            block_compress_name( format ), depth,
+            (size_t) ATLAS * ATLAS * depth, size,
+            (double) ATLAS * ATLAS * depth / size, psnr,
+            one * 1e3, touched, blocks, partial * 1e3 );
+    printf( "%-6s %5s %9s %8s %6s %9s %9.2f (%d threads)\n",
+            "", "", "", "", "", "", many * 1e3, THREADS );
+
+    free( single );
+    free( full );
+    texture_font_delete( font );
+    texture_atlas_delete( atlas );
+    return fine;
+}
+
+// ------------------------------------------------------------------- main ---
+int main( void )
+{
+    int failed = 0;
+
+    printf( "%-6s %5s %9s %8s %6s %9s %9s %15s %9s\n",
+            "format", "depth", "bytes", "blocks", "ratio", "psnr(dB)",
+            "full(ms)", "touched/blocks", "part(ms)" );
+    failed |= !run( 1 );
+    failed |= !run( 4 );
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
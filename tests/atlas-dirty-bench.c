@@ -0,0 +1,166 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freetype-gl.h"
+#include "utf8-utils.h"
+#include "bench.h"
+
+/* Atlas glyphs get loaded in as text shows up, a few new ones a frame */
+#define ATLAS  1024
+#define FRAME  8
+#define DIRTY_MAX 32
+
+// --------------------------------------------------------------- covered ---
+/* Whether a rectangle is inside the dirty rectangles */
+static int
+covered( const texture_atlas_t *atlas, size_t x, size_t y,
+         size_t width, size_t height )
+{
+    size_t i, j, k;
+    int inside;
+
+    for( j = y; j < y + height; j++ )
+        for( i = x; i < x + width; i++ ) {
+            for( k = 0, inside = 0; k < texture_atlas_dirty_count( atlas ) && !inside; k++ ) {
+                ivec4 r = texture_atlas_get_dirty( atlas, k );
+                inside = (int) i >= r.x && (int) i < r.x + r.width &&
+                         (int) j >= r.y && (int) j < r.y + r.height;
+            }
+            if( !inside )
+                return 0;
+        }
+    return 1;
+}
+
+// ----------------------------------------------------------------- whole ---
+/* Whether the atlas is to be uploaded whole */
+static int
+whole( const texture_atlas_t *atlas )
+{
+    ivec4 r;
+
+    if( texture_atlas_dirty_count( atlas ) != 1 )
+        return 0;
+    r = texture_atlas_get_dirty( atlas, 0 );
+    return !r.x && !r.y && r.width == (int) atlas->width &&
+           r.height == (int) atlas->height;
+}
+
+// ------------------------------------------------------------------- run ---
+/* Load the glyphs of a font a frame at a time, checking the dirty
+ * rectangles of each frame cover its glyphs, and summing the bytes
+ * uploaded against uploading the whole atlas every frame. */
+static int
+run( const char *filename )
+{
+    texture_atlas_t *atlas = texture_atlas_new( ATLAS, ATLAS, 1 );
+    texture_font_t *font = texture_font_new_from_file( atlas, 16, filename );
+    texture_glyph_t *glyphs[FRAME];
+    size_t i, k, n = 0, frames = 0, rects = 0, bytes = 0, most = 0;
+    int fine = 1;
+    char utf8[5];
+    uint32_t c;
+
+    if( !font ) {
+        fprintf( stderr, "Cannot load %s\n", filename );
+        return 0;
+    }
+    if( !whole( atlas ) ) {
+        fprintf( stderr, "%s: new atlas not whole\n", filename );
+        fine = 0;
+    }
+    texture_atlas_clean( atlas );
+
+    /* Latin, Greek and Cyrillic */
+    for( c = 0x21; c < 0x800; c++ ) {
+        if( !texture_font_covers( font, c ) )
+            continue;
+        utf32_to_utf8( c, utf8 );
+        if( !(glyphs[n] = texture_font_get_glyph( font, utf8 )) ) {
+            fprintf( stderr, "%s: atlas full\n", filename );
+            return 0;
+        }
+        if( ++n < FRAME && c < 0x7FF )
+            continue;
+
+        /* End of frame: what is to be uploaded */
+        for( i = 0; i < n; i++ )
+            if( !covered( atlas, glyphs[i]->x, glyphs[i]->y,
+                          glyphs[i]->width, glyphs[i]->height ) ) {
+                fprintf( stderr, "%s: glyph %" PRIzu " of frame %" PRIzu
+                         " not dirty\n", filename, i, frames );
+                fine = 0;
+            }
+        for( k = 0; k < texture_atlas_dirty_count( atlas ); k++ ) {
+            ivec4 r = texture_atlas_get_dirty( atlas, k );
+            if( r.x < 0 || r.y < 0 || r.x + r.width > ATLAS ||
+                r.y + r.height > ATLAS ) {
+                fprintf( stderr, "%s: dirty rectangle out of the atlas\n", filename );
+                fine = 0;
+            }
+            bytes += (size_t) r.width * r.height * atlas->depth;
+        }
+        rects += texture_atlas_dirty_count( atlas );
+        if( texture_atlas_dirty_count( atlas ) > most )
+            most = texture_atlas_dirty_count( atlas );
+        texture_atlas_clean( atlas );
+        if( atlas->modified || texture_atlas_dirty_count( atlas ) ) {
+            fprintf( stderr, "%s: not clean\n", filename );
+            fine = 0;
+        }
+        frames++;
+        n = 0;
+    }
+    if( most > DIRTY_MAX ) {
+        fprintf( stderr, "%s: %" PRIzu " dirty rectangles\n", filename, most );
+        fine = 0;
+    }
+    /* Glyphs loaded a few a frame hardly touch the atlas */
+    if( bytes * 8 > frames * ATLAS * ATLAS * atlas->depth ) {
+        fprintf( stderr, "%s: %" PRIzu " bytes uploaded\n", filename, bytes );
+        fine = 0;
+    }
+
+    printf( "%-34s %7" PRIzu " %7.2f %7" PRIzu " %10" PRIzu " %10" PRIzu "\n",
+            filename, frames, (double) rects / frames, most,
+            bytes / frames, (size_t) ATLAS * ATLAS * atlas->depth );
+
+    /* Created again: uploaded whole */
+    texture_atlas_enlarge_texture( atlas, 2 * ATLAS, 2 * ATLAS );
+    if( !whole( atlas ) ) {
+        fprintf( stderr, "%s: enlarged atlas not whole\n", filename );
+        fine = 0;
+    }
+    texture_atlas_clean( atlas );
+    texture_atlas_clear( atlas );
+    if( !whole( atlas ) ) {
+        fprintf( stderr, "%s: cleared atlas not whole\n", filename );
+        fine = 0;
+    }
+
+    texture_font_delete( font );
+    texture_atlas_delete( atlas );
+    return fine;
+}
+
+// ------------------------------------------------------------------- main ---
+int main( void )
+{
+    size_t i;
+    int failed = 0;
+
+    printf( "%-34s %7s %7s %7s %10s %10s\n",
+            "font", "frames", "rects", "most", "bytes", "whole" );
+    printf( "%-34s %7s %7s %7s %10s %10s\n",
+            "", "", "/frame", "rects", "/frame", "atlas" );
+    for( i = 0; i < BENCH_FONTS; i++ )
+        if( !run( bench_fonts[i] ) )
+            failed = 1;
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
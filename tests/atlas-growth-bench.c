@@ -0,0 +1,136 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "freetype-gl.h"
+#include "font-manager.h"
+#include "utf8-utils.h"
+#include "bench.h"
+
+/* Fonts of a manager sharing an atlas that starts small and grows, against
+ * the same fonts in an atlas of the final size */
+static const float sizes[] = { 12, 16, 24 };
+#define START 64
+#define MAX   2048
+
+// ----------------------------------------------------------------- check ---
+/* Whether the glyphs of a font have the texture coordinates of where they
+ * are in its atlas, and the pixels of the same glyphs of a reference font.
+ * Returns the number of glyphs that do not. */
+static size_t
+check( const texture_font_t *font, texture_font_t *reference )
+{
+    const texture_atlas_t *a = font->atlas, *b = reference->atlas;
+    texture_glyph_t *glyph, *expected;
+    size_t i, y, wrong = 0;
+    char utf8[5];
+
+    GLYPHS_ITERATOR( i, glyph, font->glyphs ) {
+        utf32_to_utf8( glyph->codepoint, utf8 );
+        expected = texture_font_get_glyph( reference, utf8 );
+        if( fabs( glyph->s0 * a->width - glyph->x ) > 1e-3 ||
+            fabs( glyph->t0 * a->height - glyph->y ) > 1e-3 ||
+            fabs( glyph->s1 * a->width - (glyph->x + glyph->width) ) > 1e-3 ||
+            fabs( glyph->t1 * a->height - (glyph->y + glyph->height) ) > 1e-3 ||
+            !expected || glyph->width != expected->width ||
+            glyph->height != expected->height ) {
+            wrong++;
+            continue;
+        }
+        for( y = 0; y < glyph->height; y++ )
+            if( memcmp( a->data + (glyph->y + y) * a->width + glyph->x,
+                        b->data + (expected->y + y) * b->width + expected->x,
+                        glyph->width ) ) {
+                wrong++;
+                break;
+            }
+    } GLYPHS_ITERATOR_END
+    return wrong;
+}
+
+// ------------------------------------------------------------------- main ---
+int main( void )
+{
+    font_manager_t *manager = font_manager_new( START, START, 1 );
+    texture_atlas_t *atlas = manager->atlas;
+    texture_atlas_t *reference_atlas = texture_atlas_new( MAX, MAX, 1 );
+    texture_font_t *fonts[BENCH_FONTS], *references[BENCH_FONTS];
+    texture_glyph_t *special;
+    size_t i, glyphs = 0, growths = 0, wrong = 0, width, height;
+    double grown = 0, fixed = 0, start;
+    int failed = 0;
+    char utf8[5];
+    uint32_t c;
+
+    atlas->max_width = atlas->max_height = MAX;
+    for( i = 0; i < BENCH_FONTS; i++ ) {
+        fonts[i] = font_manager_get_from_filename( manager, bench_fonts[i], sizes[i] );
+        references[i] = texture_font_new_from_file( reference_atlas, sizes[i], bench_fonts[i] );
+        if( !fonts[i] || !references[i] ) {
+            fprintf( stderr, "Cannot load %s\n", bench_fonts[i] );
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* Latin, Greek and Cyrillic, a glyph of each font in turn */
+    for( c = 0x21; c < 0x800; c++ ) {
+        utf32_to_utf8( c, utf8 );
+        for( i = 0; i < BENCH_FONTS; i++ ) {
+            if( !texture_font_covers( fonts[i], c ) )
+                continue;
+            width = atlas->width;
+            height = atlas->height;
+            start = now( );
+            if( !texture_font_get_glyph( fonts[i], utf8 ) ) {
+                fprintf( stderr, "%s: atlas full at %" PRIzu "x%" PRIzu "\n",
+                         bench_fonts[i], atlas->width, atlas->height );
+                return EXIT_FAILURE;
+            }
+            grown += now( ) - start;
+            growths += atlas->width != width || atlas->height != height;
+            start = now( );
+            texture_font_get_glyph( references[i], utf8 );
+            fixed += now( ) - start;
+            glyphs++;
+        }
+    }
+    for( i = 0; i < BENCH_FONTS; i++ )
+        wrong += check( fonts[i], references[i] );
+    special = (texture_glyph_t *) atlas->special;
+    if( fabs( special->s0 * atlas->width - roundf( special->s0 * atlas->width ) ) > 1e-3 ) {
+        fprintf( stderr, "special glyph not scaled\n" );
+        failed = 1;
+    }
+
+    printf( "%-8s %7s %7s %9s %10s %10s\n",
+            "fonts", "glyphs", "growths", "size", "grown(ms)", "fixed(ms)" );
+    printf( "%-8" PRIzu " %7" PRIzu " %7" PRIzu " %4" PRIzu "x%-4" PRIzu " %10.2f %10.2f\n",
+            BENCH_FONTS, glyphs, growths, atlas->width, atlas->height,
+            grown * 1e3, fixed * 1e3 );
+
+    /* Enlarged through one font, all of them follow */
+    width = atlas->width;
+    texture_font_enlarge_atlas( fonts[0], atlas->width, 2 * atlas->height );
+    for( i = 0; i < BENCH_FONTS; i++ )
+        wrong += check( fonts[i], references[i] );
+    if( wrong ) {
+        fprintf( stderr, "%" PRIzu " glyphs with other coordinates or pixels\n", wrong );
+        failed = 1;
+    }
+    if( growths < 4 || atlas->width != width ) {
+        fprintf( stderr, "atlas grew %" PRIzu " times\n", growths );
+        failed = 1;
+    }
+
+    for( i = 0; i < BENCH_FONTS; i++ )
+        texture_font_delete( references[i] );
+    texture_atlas_delete( reference_atlas );
+    font_manager_delete( manager );
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,158 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freetype-gl.h"
+#include "utf8-utils.h"
+#include "bench.h"
+
+static const float sizes[] = { 9, 12, 16, 24 };
+#define SIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+static const struct {
+    texture_atlas_packer_t packer;
+    const char *name;
+} packers[] = {
+    { PACKER_SKYLINE,    "skyline" },
+    { PACKER_MAXRECTS,   "maxrects" },
+    { PACKER_GUILLOTINE, "guillotine" },
+    { PACKER_SHELF,      "shelf" },
+};
+#define PACKERS (sizeof(packers) / sizeof(packers[0]))
+
+/* Atlas the glyphs are packed in until it is full, with the spacing of
+ * fonts sampled with linear filtering */
+#define ATLAS   1024
+#define SPACING 1
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+// ----------------------------------------------------------------- cover ---
+/* Count the glyphs over each pixel of a glyph at a region, returns 0 if it
+ * is out of the atlas or over another glyph */
+static int
+cover( unsigned char *coverage, const ivec4 *region, const ivec2 *glyph, int count )
+{
+    int x, y, fine = 1;
+
+    if( region->x < 1 || region->y < 1 ||
+        region->x + glyph->x > ATLAS - 1 || region->y + glyph->y > ATLAS - 1 )
+        return 0;
+    for( y = region->y; y < region->y + glyph->y; y++ )
+        for( x = region->x; x < region->x + glyph->x; x++ ) {
+            coverage[y * ATLAS + x] += count;
+            fine &= coverage[y * ATLAS + x] <= 1;
+        }
+    return fine;
+}
+
+// ------------------------------------------------------------------- run ---
+/* Pack the glyphs with a packer, give every other one back and pack the
+ * rest again. Returns 0 if regions overlap. */
+static int
+run( const ivec2 *glyphs, size_t count, size_t p )
+{
+    texture_atlas_t *atlas =
+        texture_atlas_new_with_packer( ATLAS, ATLAS, 1, packers[p].packer );
+    unsigned char *coverage = calloc( ATLAS * ATLAS, 1 );
+    ivec4 *regions = malloc( count * sizeof(ivec4) );
+    size_t i, packed = 0, repacked = 0;
+    double start, time;
+    float occupancy;
+    int fine = 1;
+
+    atlas->spacing_horiz = atlas->spacing_vert = SPACING;
+
+    start = now( );
+    for( i = 0; i < count; i++ ) {
+        regions[i] = texture_atlas_get_region( atlas, glyphs[i].x, glyphs[i].y );
+        packed += regions[i].x >= 0;
+    }
+    time = now( ) - start;
+    occupancy = 100.0f * atlas->used / ((ATLAS - 2) * (ATLAS - 2));
+
+    for( i = 0; i < count; i++ )
+        if( regions[i].x >= 0 )
+            fine &= cover( coverage, regions + i, glyphs + i, 1 );
+
+    /* Space given back is allocated again, with the spacing that fits in
+     * the atlas as fonts give it back */
+    for( i = 0; i < count; i += 2 )
+        if( regions[i].x >= 0 ) {
+            texture_atlas_free_region( atlas, regions[i].x, regions[i].y,
+                MIN( glyphs[i].x + SPACING, ATLAS - 1 - regions[i].x ),
+                MIN( glyphs[i].y + SPACING, ATLAS - 1 - regions[i].y ) );
+            cover( coverage, regions + i, glyphs + i, -1 );
+        }
+    for( i = 0; i < count; i += 2 ) {
+        regions[i] = texture_atlas_get_region( atlas, glyphs[i].x, glyphs[i].y );
+        if( regions[i].x >= 0 ) {
+            fine &= cover( coverage, regions + i, glyphs + i, 1 );
+            repacked++;
+        }
+    }
+
+    printf( "%-10s %8" PRIzu " %9.1f%% %10.2f %10.3f %9" PRIzu "\n", packers[p].name,
+            packed, occupancy, time * 1e3, time * 1e6 / count, repacked );
+    if( !fine )
+        fprintf( stderr, "%s: regions overlap\n", packers[p].name );
+
+    free( regions );
+    free( coverage );
+    texture_atlas_delete( atlas );
+    return fine;
+}
+
+// ------------------------------------------------------------------- main ---
+int main( void )
+{
+    texture_atlas_t *atlas = texture_atlas_new( 4096, 4096, 1 );
+    ivec2 *glyphs = malloc( BENCH_FONTS * SIZES * 0x3000 * sizeof(ivec2) );
+    size_t count = 0, i, k;
+    int failed = 0;
+    char utf8[5];
+    uint32_t c;
+
+    /* The sizes of the glyphs of real fonts, in codepoint order as text
+     * would load them */
+    for( i = 0; i < BENCH_FONTS; i++ ) {
+        for( k = 0; k < SIZES; k++ ) {
+            texture_font_t *font = texture_font_new_from_file( atlas, sizes[k], bench_fonts[i] );
+            texture_glyph_t *glyph;
+
+            if( !font ) {
+                fprintf( stderr, "Cannot load %s\n", bench_fonts[i] );
+                return EXIT_FAILURE;
+            }
+            for( c = 0x21; c < 0x3000; c++ ) {
+                if( (c >= 0xD800 && c < 0xE000) || !texture_font_covers( font, c ) )
+                    continue;
+                utf32_to_utf8( c, utf8 );
+                if( !(glyph = texture_font_get_glyph( font, utf8 )) ) {
+                    fprintf( stderr, "atlas full\n" );
+                    return EXIT_FAILURE;
+                }
+                glyphs[count].x = glyph->width;
+                glyphs[count++].y = glyph->height;
+            }
+            texture_font_delete( font );
+            texture_atlas_clear( atlas );
+        }
+    }
+    texture_atlas_delete( atlas );
+
+    printf( "%" PRIzu " glyphs in a %dx%d atlas\n", count, ATLAS, ATLAS );
+    printf( "%-10s %8s %10s %10s %10s %9s\n",
+            "packer", "packed", "occupancy", "time(ms)", "us/region", "repacked" );
+    for( i = 0; i < PACKERS; i++ )
+        if( !run( glyphs, count, i ) )
+            failed = 1;
+
+    free( glyphs );
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,160 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freetype-gl.h"
+#include "text-buffer.h"
+#include "utf8-utils.h"
+#include "bench.h"
+
+/* Pages of a texture array for a large glyph set */
+#define PAGE      128
+#define MAX_PAGES 16
+
+// ------------------------------------------------------------------ same ---
+/* Whether a glyph has the pixels of the same glyph in a reference atlas */
+static int
+same( texture_atlas_t *atlas, const texture_glyph_t *glyph,
+      const texture_atlas_t *reference, const texture_glyph_t *expected )
+{
+    const texture_atlas_t *page = texture_atlas_get_page( atlas, glyph->page );
+    size_t y;
+
+    if( glyph->width != expected->width || glyph->height != expected->height ||
+        glyph->s0 != glyph->x / (float) PAGE || glyph->t0 != glyph->y / (float) PAGE )
+        return 0;
+    for( y = 0; y < glyph->height; y++ )
+        if( memcmp( page->data + (glyph->y + y) * page->width + glyph->x,
+                    reference->data + (expected->y + y) * reference->width + expected->x,
+                    glyph->width ) )
+            return 0;
+    return 1;
+}
+
+// ------------------------------------------------------------------- main ---
+int main( int argc, char **argv )
+{
+    const char *filename = argc > 1 ? argv[1] : "fonts/Liberastika-Regular.ttf";
+    texture_atlas_t *reference_atlas = texture_atlas_new( 1024, 1024, 1 );
+    texture_font_t *reference = texture_font_new_from_file( reference_atlas, 16, filename );
+    texture_atlas_t *atlas = texture_atlas_new( PAGE, PAGE, 1 );
+    texture_font_t *font = texture_font_new_from_file( atlas, 16, filename );
+    text_buffer_t *buffer = text_buffer_new( );
+    unsigned char *data[MAX_PAGES] = { NULL };
+    texture_glyph_t *glyphs[0x800], *glyph, *other;
+    texture_font_t *large;
+    markup_t markup;
+    vec2 pen = {{0, 0}};
+    size_t count = 0, i, k, page;
+    char utf8[5];
+    uint32_t c;
+    double start;
+    int failed = 0;
+
+    if( !reference || !font ) {
+        fprintf( stderr, "Cannot load %s\n", filename );
+        return EXIT_FAILURE;
+    }
+    atlas->max_pages = MAX_PAGES;
+    memset( &markup, 0, sizeof(markup) );
+    markup.font = font;
+    markup.gamma = 1.0f;
+    markup.foreground_color.a = 1.0f;
+
+    /* Latin, Greek and Cyrillic: more than a page */
+    for( c = 0x21; c < 0x800; c++ ) {
+        utf32_to_utf8( c, utf8 );
+        if( texture_font_covers( reference, c ) &&
+            !texture_font_get_glyph( reference, utf8 ) ) {
+            fprintf( stderr, "reference atlas full\n" );
+            return EXIT_FAILURE;
+        }
+    }
+    start = now( );
+    for( c = 0x21; c < 0x800; c++ ) {
+        if( !texture_font_covers( font, c ) )
+            continue;
+        utf32_to_utf8( c, utf8 );
+        if( !(glyph = texture_font_get_glyph( font, utf8 )) ) {
+            fprintf( stderr, "glyph %u not loaded\n", c );
+            return EXIT_FAILURE;
+        }
+        glyphs[count++] = glyph;
+        text_buffer_add_char( buffer, &pen, &markup, utf8, NULL );
+
+        /* Pages added leave the others in place */
+        for( page = 0; page < texture_atlas_page_count( atlas ); page++ ) {
+            if( !data[page] )
+                data[page] = texture_atlas_get_page( atlas, page )->data;
+            else if( data[page] != texture_atlas_get_page( atlas, page )->data ) {
+                fprintf( stderr, "page %" PRIzu " moved\n", page );
+                failed = 1;
+            }
+        }
+    }
+    printf( "%8s %6s %10s\n", "glyphs", "pages", "time(ms)" );
+    printf( "%8" PRIzu " %6" PRIzu " %10.2f\n", count,
+            texture_atlas_page_count( atlas ), (now( ) - start) * 1e3 );
+    if( texture_atlas_page_count( atlas ) < 2 ) {
+        fprintf( stderr, "glyphs fit in a page\n" );
+        failed = 1;
+    }
+
+    /* Each glyph has its pixels in its page, without overlapping another */
+    for( i = 0; i < count && !failed; i++ ) {
+        glyph = glyphs[i];
+        if( !same( atlas, glyph, reference_atlas,
+                   texture_font_find_glyph_gi( reference, glyph->codepoint ) ) ) {
+            fprintf( stderr, "glyph %u damaged\n", glyph->codepoint );
+            failed = 1;
+        }
+        for( k = 0; k < i && glyph->width && glyph->height; k++ ) {
+            other = glyphs[k];
+            if( other->page == glyph->page && other->width && other->height &&
+                glyph->x < other->x + other->width && other->x < glyph->x + glyph->width &&
+                glyph->y < other->y + other->height && other->y < glyph->y + glyph->height ) {
+                fprintf( stderr, "glyphs %u and %u overlap\n",
+                         glyph->codepoint, other->codepoint );
+                failed = 1;
+            }
+        }
+    }
+
+    /* Vertices of each glyph sample its layer */
+    for( i = 0; i < count && !failed; i++ ) {
+        const glyph_vertex_t *vertex =
+            (glyph_vertex_t *) vector_get( buffer->buffer->vertices, 4 * i );
+
+        if( vertex->layer != (float) glyphs[i]->page ) {
+            fprintf( stderr, "glyph %u drawn from layer %g instead of %" PRIzu "\n",
+                     glyphs[i]->codepoint, vertex->layer, glyphs[i]->page );
+            failed = 1;
+        }
+    }
+
+    /* Large glyphs fill the pages left, and no more */
+    large = texture_font_new_from_file( atlas, 64, filename );
+    for( c = 0x21; c < 0x800; c++ ) {
+        utf32_to_utf8( c, utf8 );
+        if( texture_font_covers( large, c ) && !texture_font_get_glyph( large, utf8 ) )
+            break;
+    }
+    if( c == 0x800 || texture_atlas_page_count( atlas ) != MAX_PAGES ) {
+        fprintf( stderr, "%" PRIzu " pages out of %d\n",
+                 texture_atlas_page_count( atlas ), MAX_PAGES );
+        failed = 1;
+    }
+
+    text_buffer_delete( buffer );
+    texture_font_delete( large );
+    texture_font_delete( font );
+    texture_font_delete( reference );
+    texture_atlas_delete( atlas );
+    texture_atlas_delete( reference_atlas );
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,140 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freetype-gl.h"
+#include "utf8-utils.h"
+#include "bench.h"
+
+static const char *packers[] = { "skyline", "maxrects", "guillotine", "shelf" };
+
+/* Atlas the glyphs of a font are made offline in, as makefont does, with
+ * the spacing of fonts sampled with linear filtering */
+#define ATLAS   512
+#define SPACING 1
+
+// ------------------------------------------------------------------- run ---
+/* Plan the glyphs of a font and allocate them in the planned order,
+ * against allocating them in codepoint order. Returns 0 if the planned
+ * packing is not reproduced, overlaps, or is less dense: all the glyphs
+ * below a lower bottom. */
+static int
+run( const char *filename, const ivec2 *glyphs, size_t count )
+{
+    texture_atlas_t *atlas = texture_atlas_new( ATLAS, ATLAS, 1 ), *planned;
+    unsigned char *coverage = calloc( ATLAS * ATLAS, 1 );
+    size_t *order = malloc( count * sizeof(size_t) ), *threaded = malloc( count * sizeof(size_t) );
+    size_t i, placed, input = 0, replayed = 0;
+    texture_atlas_packer_t packer, threaded_packer;
+    int x, y, bottom = 0, input_bottom = 0, fine = 1;
+    double time;
+    ivec4 region;
+
+    atlas->spacing_horiz = atlas->spacing_vert = SPACING;
+    for( i = 0; i < count; i++ ) {
+        region = texture_atlas_get_region( atlas, glyphs[i].x, glyphs[i].y );
+        if( region.x < 0 )
+            continue;
+        input++;
+        if( region.y + glyphs[i].y > input_bottom )
+            input_bottom = region.y + glyphs[i].y;
+    }
+
+    time = now( );
+    placed = texture_atlas_plan( atlas, glyphs, count, 1, &packer, order );
+    time = now( ) - time;
+
+    /* The same on threads */
+    if( texture_atlas_plan( atlas, glyphs, count, 4, &threaded_packer, threaded ) != placed ||
+        threaded_packer != packer || memcmp( order, threaded, count * sizeof(size_t) ) ) {
+        fprintf( stderr, "%s: planned otherwise on threads\n", filename );
+        fine = 0;
+    }
+
+    /* Allocated in its order with its packer, every glyph lands once */
+    planned = texture_atlas_new_with_packer( ATLAS, ATLAS, 1, packer );
+    planned->spacing_horiz = planned->spacing_vert = SPACING;
+    for( i = 0; i < count; i++ ) {
+        region = texture_atlas_get_region( planned, glyphs[order[i]].x, glyphs[order[i]].y );
+        if( region.x < 0 )
+            continue;
+        replayed++;
+        if( region.y + glyphs[order[i]].y > bottom )
+            bottom = region.y + glyphs[order[i]].y;
+        for( y = region.y; y < region.y + glyphs[order[i]].y; y++ )
+            for( x = region.x; x < region.x + glyphs[order[i]].x; x++ )
+                fine &= y < ATLAS - 1 && x < ATLAS - 1 && !coverage[y * ATLAS + x]++;
+    }
+    if( !fine )
+        fprintf( stderr, "%s: glyphs overlap\n", filename );
+    if( replayed != placed || placed != count || input != count ) {
+        fprintf( stderr, "%s: %" PRIzu " placed as planned, %" PRIzu " planned, %"
+                 PRIzu " in input order\n", filename, replayed, placed, input );
+        fine = 0;
+    }
+    if( bottom > input_bottom ) {
+        fprintf( stderr, "%s: planned down to %d, input order to %d\n",
+                 filename, bottom, input_bottom );
+        fine = 0;
+    }
+
+    printf( "%-34s %7" PRIzu " %7d %7d %-10s %10.2f\n", filename, count,
+            input_bottom, bottom, packers[packer], time * 1e3 );
+
+    free( order );
+    free( threaded );
+    free( coverage );
+    texture_atlas_delete( planned );
+    texture_atlas_delete( atlas );
+    return fine;
+}
+
+// ------------------------------------------------------------------- main ---
+int main( void )
+{
+    texture_atlas_t *atlas = texture_atlas_new( 2048, 2048, 1 );
+    ivec2 *glyphs = malloc( 0x800 * sizeof(ivec2) );
+    size_t count, i;
+    int failed = 0;
+    char utf8[5];
+    uint32_t c;
+
+    printf( "%-34s %7s %7s %7s %-10s %10s\n",
+            "font", "glyphs", "input", "planned", "packer", "time(ms)" );
+    printf( "%-34s %7s %7s %7s\n", "", "", "bottom", "bottom" );
+    for( i = 0; i < BENCH_FONTS; i++ ) {
+        texture_font_t *font = texture_font_new_from_file( atlas, 16, bench_fonts[i] );
+        texture_glyph_t *glyph;
+
+        if( !font ) {
+            fprintf( stderr, "Cannot load %s\n", bench_fonts[i] );
+            return EXIT_FAILURE;
+        }
+
+        /* Latin, Greek and Cyrillic */
+        for( c = 0x21, count = 0; c < 0x800; c++ ) {
+            if( !texture_font_covers( font, c ) )
+                continue;
+            utf32_to_utf8( c, utf8 );
+            if( !(glyph = texture_font_get_glyph( font, utf8 )) ) {
+                fprintf( stderr, "atlas full\n" );
+                return EXIT_FAILURE;
+            }
+            glyphs[count].x = glyph->width;
+            glyphs[count++].y = glyph->height;
+        }
+        if( !run( bench_fonts[i], glyphs, count ) )
+            failed = 1;
+        texture_font_delete( font );
+        texture_atlas_clear( atlas );
+    }
+
+    texture_atlas_delete( atlas );
+    free( glyphs );
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,131 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freetype-gl.h"
+#include "bench.h"
+
+static const char *text =
+    " !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`"
+    "abcdefghijklmnopqrstuvwxyz{|}~\xc3\xa0\xc3\xa9\xc3\xa8\xc3\xaf\xc3\xb4\xc3\xbc";
+
+/* Distance fields are slow to compute: a few glyphs are enough */
+static const char *sdf_text = "Ag@W";
+
+// ------------------------------------------------------------------- load ---
+/* Load glyphs straight into the atlas, or through a staging buffer when a
+ * glyph cache is set, which needs its own copy of each glyph */
+static texture_font_t *
+load( const char *filename, size_t depth, rendermode_t rendermode, int padding,
+      const char *directory, double *elapsed )
+{
+    texture_atlas_t *atlas = texture_atlas_new( 1024, 1024, depth );
+    texture_font_t *font = texture_font_new_from_file( atlas, 48, filename );
+    double start;
+
+    if( !font || (directory && !texture_font_set_cache( font, directory )) )
+        return NULL;
+    font->threads = 1;
+    font->rendermode = rendermode;
+    font->outline_thickness = rendermode == RENDER_OUTLINE_EDGE ? 2 : 0;
+    font->padding_left = font->padding_top = padding;
+    font->padding_right = font->padding_bottom = padding;
+
+    start = now();
+    if( texture_font_load_glyphs( font,
+                                  rendermode == RENDER_SIGNED_DISTANCE_FIELD ?
+                                  sdf_text : text ) ) {
+        fprintf( stderr, "atlas full\n" );
+        exit( EXIT_FAILURE );
+    }
+    *elapsed = now() - start;
+    return font;
+}
+
+// ---------------------------------------------------------------- release ---
+static void
+release( texture_font_t *font )
+{
+    texture_atlas_t *atlas = font->atlas;
+
+    if( font->cache && font->cache->path )
+        remove( font->cache->path );
+    texture_font_delete( font );
+    texture_atlas_delete( atlas );
+}
+
+// ------------------------------------------------------------------- main ---
+int main( int argc, char **argv )
+{
+    const char *filename = argc > 1 ? argv[1] : "fonts/Vera.ttf";
+    const char *directory = getenv( "TMPDIR" );
+    struct {
+        const char *name;
+        size_t depth;
+        rendermode_t rendermode;
+        int padding;
+    } runs[] = {
+        { "normal",          1, RENDER_NORMAL,                 0 },
+        { "normal padded",   1, RENDER_NORMAL,                 3 },
+        { "outline",         1, RENDER_OUTLINE_EDGE,           0 },
+        { "sdf",             1, RENDER_SIGNED_DISTANCE_FIELD,  0 },
+        { "lcd",             3, RENDER_NORMAL,                 0 },
+        { "rgba",            4, RENDER_NORMAL,                 1 },
+    };
+    size_t run;
+    int failed = 0;
+
+    if( !directory )
+        directory = getenv( "TEMP" );
+    if( !directory )
+        directory = "/tmp";
+
+    /* The staged time includes writing the glyph cache */
+    printf( "%-16s %5s %12s %12s %10s\n",
+            "mode", "depth", "staged(ms)", "direct(ms)", "bytes" );
+    for( run = 0; run < sizeof(runs) / sizeof(runs[0]); run++ ) {
+        texture_font_t *staged, *direct;
+        const texture_atlas_t *a, *b;
+        double t_staged, t_direct;
+        size_t i, bytes = 0;
+        texture_glyph_t *glyph;
+
+        staged = load( filename, runs[run].depth, runs[run].rendermode,
+                       runs[run].padding, directory, &t_staged );
+        direct = load( filename, runs[run].depth, runs[run].rendermode,
+                       runs[run].padding, NULL, &t_direct );
+        if( !staged || !direct || !staged->cache->path ) {
+            fprintf( stderr, "Cannot load %s\n", filename );
+            return EXIT_FAILURE;
+        }
+
+        /* Bytes of the glyphs no longer copied through a staging buffer */
+        GLYPHS_ITERATOR( i, glyph, direct->glyphs ) {
+            bytes += glyph->width * glyph->height * runs[run].depth;
+        } GLYPHS_ITERATOR_END
+        printf( "%-16s %5" PRIzu " %12.2f %12.2f %10" PRIzu "\n", runs[run].name,
+                runs[run].depth, t_staged * 1e3, t_direct * 1e3, bytes );
+
+        a = staged->atlas;
+        b = direct->atlas;
+        if( memcmp( a->data, b->data, a->width * a->height * a->depth ) ||
+            vector_glyphs_size( staged->glyphs ) != vector_glyphs_size( direct->glyphs ) ) {
+            fprintf( stderr, "%s: atlases differ\n", runs[run].name );
+            failed = 1;
+        }
+        if( !b->modified ) {
+            fprintf( stderr, "%s: atlas not marked modified\n", runs[run].name );
+            failed = 1;
+        }
+
+        release( staged );
+        release( direct );
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,272 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "freetype-gl.h"
+#include "font-manager.h"
+#include "text-buffer.h"
+#include "bench.h"
+
+static const char *filenames[] = {
+    "fonts/Vera.ttf",
+    "fonts/VeraMono.ttf",
+    "fonts/SourceSansPro-Regular.ttf",
+};
+#define FILES (sizeof(filenames) / sizeof(filenames[0]))
+
+static const char *charset =
+    " !\"#$%&'()*+,-./0123456789:;<=>?"
+    "@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_"
+    "`abcdefghijklmnopqrstuvwxyz{|}~";
+
+static const char *text = "The quick brown fox jumps over the lazy dog";
+
+// ---------------------------------------------------------------- skyline ---
+/* Height of the skyline, below which regions are allocated */
+static int
+skyline( const texture_atlas_t *atlas )
+{
+    int top = 0;
+    size_t i;
+
+    for( i = 0; i < vector_size( atlas->nodes ); i++ )
+        if( ((ivec3 *) vector_get( atlas->nodes, i ))->y > top )
+            top = ((ivec3 *) vector_get( atlas->nodes, i ))->y;
+    return top;
+}
+
+// ---------------------------------------------------------------- pixels ---
+/* Copy or compare the pixels of the glyphs of the fonts, in their order */
+static int
+pixels( font_manager_t *manager, unsigned char *copy, int compare )
+{
+    const texture_atlas_t *atlas = manager->atlas;
+    texture_glyph_t *glyph;
+    size_t i, k, y;
+
+    for( k = 0; k < vector_size( manager->fonts ); k++ ) {
+        texture_font_t *font = *(texture_font_t **) vector_get( manager->fonts, k );
+
+        GLYPHS_ITERATOR( i, glyph, font->glyphs ) {
+            for( y = 0; y < glyph->height; y++ ) {
+                const unsigned char *row =
+                    atlas->data + (glyph->y + y) * atlas->width + glyph->x;
+
+                if( !compare )
+                    memcpy( copy, row, glyph->width );
+                else if( memcmp( copy, row, glyph->width ) ||
+                         glyph->s0 != glyph->x / (float) atlas->width ||
+                         glyph->t1 != (glyph->y + glyph->height) / (float) atlas->height )
+                    return 0;
+                copy += glyph->width;
+            }
+        } GLYPHS_ITERATOR_END
+    }
+    return 1;
+}
+
+// ------------------------------------------------------------------ show ---
+/* The text in every font of the manager, underlined to use the special
+ * region too */
+static void
+show( font_manager_t *manager, text_buffer_t *buffer )
+{
+    markup_t markup;
+    vec2 pen = {{0, 0}};
+    size_t k;
+
+    memset( &markup, 0, sizeof(markup) );
+    markup.gamma = 1.0f;
+    markup.foreground_color.a = 1.0f;
+    markup.underline = 1;
+    markup.underline_color.a = 1.0f;
+    text_buffer_clear( buffer );
+    for( k = 0; k < vector_size( manager->fonts ); k++ ) {
+        markup.font = *(texture_font_t **) vector_get( manager->fonts, k );
+        text_buffer_add_text( buffer, &pen, &markup, text, 0 );
+    }
+}
+
+// -------------------------------------------------------------- growable ---
+/* An atlas that could grow keeps its size when repacking, whether the
+ * regions fit in it or not */
+static int
+growable( void )
+{
+    texture_atlas_t *atlas = texture_atlas_new( 64, 64, 1 );
+    vector_t *regions = vector_new( sizeof(ivec4) ), *remap;
+    unsigned char copy[64 * 64];
+    unsigned char *data = atlas->data;
+    ivec4 region;
+    size_t i, width, height;
+    int failed = 0;
+
+    atlas->max_width = atlas->max_height = 1024;
+
+    /* Overlapping regions, more than there is room for */
+    for( i = 0; i < 12; i++ ) {
+        region.x = 1 + i % 4;
+        region.y = 1 + i / 4;
+        region.width = region.height = 30;
+        vector_push_back( regions, &region );
+        atlas->data[region.y * atlas->width + region.x] = (unsigned char) (i + 1);
+    }
+    memcpy( copy, atlas->data, sizeof(copy) );
+    if( texture_atlas_repack( atlas, regions ) ) {
+        fprintf( stderr, "overlapping regions repacked\n" );
+        failed = 1;
+    }
+    if( atlas->width != 64 || atlas->height != 64 || atlas->data != data ||
+        memcmp( copy, atlas->data, sizeof(copy) ) ) {
+        fprintf( stderr, "atlas grown or changed by a failed repack\n" );
+        failed = 1;
+    }
+
+    /* The atlas grows to allocate them, not to pack them again */
+    vector_clear( regions );
+    for( i = 0; i < 12; i++ ) {
+        region = texture_atlas_get_region( atlas, 30, 30 );
+        if( region.x < 0 ) {
+            fprintf( stderr, "no room in a growable atlas\n" );
+            failed = 1;
+            break;
+        }
+        vector_push_back( regions, &region );
+    }
+    width = atlas->width;
+    height = atlas->height;
+    remap = texture_atlas_repack( atlas, regions );
+    if( !remap || atlas->width != width || atlas->height != height ) {
+        fprintf( stderr, "grown atlas not repacked at its size\n" );
+        failed = 1;
+    }
+    if( remap )
+        vector_delete( remap );
+
+    vector_delete( regions );
+    texture_atlas_delete( atlas );
+    return failed;
+}
+
+// ------------------------------------------------------------------- main ---
+int main( void )
+{
+    font_manager_t *manager = font_manager_new( 512, 512, 1 );
+    texture_atlas_t *atlas = manager->atlas;
+    text_buffer_t *buffer = text_buffer_new( ), *expected = text_buffer_new( );
+    unsigned char *copy = malloc( 512 * 512 );
+    texture_font_t *font;
+    texture_glyph_t *special;
+    vector_t *remap;
+    size_t i, fonts, used, missed = 0;
+    int before;
+    float size;
+    double start;
+    int failed = 0;
+
+    if( !copy )
+        return EXIT_FAILURE;
+
+    /* Fonts of growing sizes until the atlas is full */
+    for( size = 10, i = 0; !missed; size += 2, i++ ) {
+        font = font_manager_get_from_filename( manager, filenames[i % FILES], size );
+        if( !font ) {
+            fprintf( stderr, "Cannot load %s\n", filenames[i % FILES] );
+            return EXIT_FAILURE;
+        }
+        missed = texture_font_load_glyphs( font, charset );
+    }
+    fonts = vector_size( manager->fonts );
+
+    /* Half of them go, their glyphs left in the atlas */
+    for( i = 0; i < vector_size( manager->fonts ); i++ )
+        font_manager_delete_font( manager, *(texture_font_t **) vector_get( manager->fonts, i ) );
+    if( vector_size( manager->fonts ) != fonts / 2 ) {
+        fprintf( stderr, "%" PRIzu " fonts left out of %" PRIzu "\n",
+                 vector_size( manager->fonts ), fonts );
+        failed = 1;
+    }
+
+    pixels( manager, copy, 0 );
+    show( manager, buffer );
+    used = atlas->used;
+    before = skyline( atlas );
+
+    start = now( );
+    remap = font_manager_repack( manager );
+    if( !remap ) {
+        fprintf( stderr, "repack failed\n" );
+        return EXIT_FAILURE;
+    }
+    printf( "%-8s %8s %8s %8s %10s\n", "fonts", "regions", "before", "after", "time(ms)" );
+    printf( "%2" PRIzu "/%-5" PRIzu " %8" PRIzu " %8d %8d %10.3f\n",
+            vector_size( manager->fonts ), fonts, vector_size( remap ), before,
+            skyline( atlas ), (now( ) - start) * 1e3 );
+
+    /* Glyphs kept their pixels at their new place, the allocated surface
+     * being theirs only */
+    if( !pixels( manager, copy, 1 ) ) {
+        fprintf( stderr, "glyphs moved without their pixels\n" );
+        failed = 1;
+    }
+    if( atlas->used >= used || skyline( atlas ) >= before ) {
+        fprintf( stderr, "nothing reclaimed\n" );
+        failed = 1;
+    }
+    special = (texture_glyph_t *) atlas->special;
+    if( atlas->data[(size_t) (special->t0 * atlas->height) * atlas->width +
+                    (size_t) (special->s0 * atlas->width)] != 255 ) {
+        fprintf( stderr, "special region lost\n" );
+        failed = 1;
+    }
+
+    /* Vertices patched with the remap table are those of the text shown
+     * again */
+    if( !text_buffer_is_stale( buffer ) ) {
+        fprintf( stderr, "text not stale after repacking\n" );
+        failed = 1;
+    }
+    text_buffer_remap( buffer, remap, atlas );
+    show( manager, expected );
+    if( text_buffer_is_stale( buffer ) ||
+        vector_size( buffer->buffer->vertices ) != vector_size( expected->buffer->vertices ) ) {
+        fprintf( stderr, "text not remapped\n" );
+        failed = 1;
+    }
+    for( i = 0; !failed && i < vector_size( buffer->buffer->vertices ); i++ ) {
+        const glyph_vertex_t *a = (glyph_vertex_t *) vector_get( buffer->buffer->vertices, i );
+        const glyph_vertex_t *b = (glyph_vertex_t *) vector_get( expected->buffer->vertices, i );
+
+        if( fabsf( a->u - b->u ) > .25f / atlas->width ||
+            fabsf( a->v - b->v ) > .25f / atlas->height ) {
+            fprintf( stderr, "vertex %" PRIzu " remapped to %g,%g instead of %g,%g\n",
+                     i, a->u, a->v, b->u, b->v );
+            failed = 1;
+        }
+    }
+    vector_delete( remap );
+
+    /* The space of the deleted fonts is allocated again, the largest one
+     * fitting */
+    i = (fonts - 1) & ~(size_t) 1;
+    font = font_manager_get_from_filename( manager, filenames[i % FILES], 10 + 2 * i );
+    if( !font || texture_font_load_glyphs( font, charset ) ) {
+        fprintf( stderr, "no room after repacking\n" );
+        failed = 1;
+    }
+
+    if( growable( ) )
+        failed = 1;
+
+    text_buffer_delete( buffer );
+    text_buffer_delete( expected );
+    font_manager_delete( manager );
+    free( copy );
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
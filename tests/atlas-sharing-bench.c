@@ -0,0 +1,234 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freetype-gl.h"
+#include "utf8-utils.h"
+#include "bench.h"
+
+/* Font sets loaded in an atlas sharing the regions of identical bitmaps,
+ * against the same fonts in an atlas that does not */
+typedef struct font_set_t {
+    const char *name;
+    const char *filenames[6];
+    float size;
+    uint32_t first, last;
+} font_set_t;
+
+static const font_set_t sets[] = {
+    { "Vera Mono family",
+      { "fonts/VeraMono.ttf", "fonts/VeraMoBd.ttf", "fonts/VeraMoIt.ttf",
+        "fonts/VeraMoBI.ttf" }, 16, 0x20, 0x800 },
+    { "User interface",
+      { "fonts/Vera.ttf", "fonts/SourceSansPro-Regular.ttf",
+        "fonts/SourceCodePro-Regular.ttf", "fonts/Liberastika-Regular.ttf",
+        "fonts/OldStandard-Regular.ttf" }, 14, 0x20, 0x800 },
+    { "Arabic",
+      { "fonts/amiri-regular.ttf" }, 24, 0x600, 0x700 },
+    { "Arabic forms",
+      { "fonts/amiri-regular.ttf" }, 24, 0xFB50, 0xFF00 },
+};
+#define SETS  (sizeof(sets) / sizeof(sets[0]))
+#define FONTS 6
+#define ATLAS 1024
+
+// ------------------------------------------------------------------ load ---
+/* Fonts of a set in an atlas, every codepoint of the range looked up */
+static double
+load( const font_set_t *set, texture_atlas_t *atlas, texture_font_t **fonts )
+{
+    double start;
+    char utf8[5];
+    uint32_t c;
+    size_t i;
+
+    for( i = 0; set->filenames[i]; i++ )
+        if( !(fonts[i] = texture_font_new_from_file( atlas, set->size, set->filenames[i] )) ) {
+            fprintf( stderr, "Cannot load %s\n", set->filenames[i] );
+            exit( EXIT_FAILURE );
+        }
+    fonts[i] = NULL;
+    start = now( );
+    for( i = 0; fonts[i]; i++ )
+        for( c = set->first; c < set->last; c++ ) {
+            utf32_to_utf8( c, utf8 );
+            if( !texture_font_get_glyph( fonts[i], utf8 ) ) {
+                fprintf( stderr, "%s: atlas full\n", set->filenames[i] );
+                exit( EXIT_FAILURE );
+            }
+        }
+    return now( ) - start;
+}
+
+// ------------------------------------------------------------------ same ---
+/* Whether a glyph has the pixels of a glyph of another atlas */
+static int
+same( const texture_atlas_t *atlas, const texture_glyph_t *glyph,
+      const texture_atlas_t *reference, const texture_glyph_t *expected )
+{
+    size_t y;
+
+    if( !expected || glyph->width != expected->width ||
+        glyph->height != expected->height )
+        return 0;
+    for( y = 0; y < glyph->height; y++ )
+        if( memcmp( atlas->data + (glyph->y + y) * atlas->width + glyph->x,
+                    reference->data + (expected->y + y) * reference->width + expected->x,
+                    glyph->width ) )
+            return 0;
+    return 1;
+}
+
+// ---------------------------------------------------------------- shared ---
+/* The glyphs of the fonts with a region, checking their pixels against
+ * their references, with their bytes and those of the glyphs in the region
+ * of an earlier one */
+static vector_t *
+shared( texture_font_t **fonts, texture_font_t **references,
+        size_t *bytes, size_t *saved, int *damaged )
+{
+    const texture_atlas_t *atlas = fonts[0]->atlas;
+    vector_t *glyphs = vector_new( sizeof(texture_glyph_t *) );
+    texture_glyph_t *glyph, *other;
+    size_t i, j, k;
+
+    *bytes = *saved = 0;
+    *damaged = 0;
+    for( k = 0; fonts[k]; k++ )
+        GLYPHS_ITERATOR( i, glyph, fonts[k]->glyphs ) {
+            if( !same( atlas, glyph, references[k]->atlas,
+                       texture_font_find_glyph_gi( references[k], glyph->codepoint ) ) ) {
+                fprintf( stderr, "glyph %u of %s damaged\n", glyph->codepoint,
+                         fonts[k]->filename );
+                *damaged = 1;
+            }
+            if( glyph->width && glyph->height )
+                vector_push_back( glyphs, &glyph );
+        } GLYPHS_ITERATOR_END
+
+    for( i = 0; i < vector_size( glyphs ); i++ ) {
+        glyph = *(texture_glyph_t **) vector_get( glyphs, i );
+        *bytes += glyph->width * glyph->height;
+        for( j = 0; j < i; j++ ) {
+            other = *(texture_glyph_t **) vector_get( glyphs, j );
+            if( other->x == glyph->x && other->y == glyph->y ) {
+                *saved += glyph->width * glyph->height;
+                break;
+            }
+        }
+    }
+    return glyphs;
+}
+
+// ----------------------------------------------------------------- count ---
+/* Number of glyphs in the region of a glyph */
+static size_t
+count( const vector_t *glyphs, const texture_glyph_t *glyph )
+{
+    const texture_glyph_t *other;
+    size_t i, n = 0;
+
+    for( i = 0; i < vector_size( glyphs ); i++ ) {
+        other = *(const texture_glyph_t **) vector_get( glyphs, i );
+        n += other->x == glyph->x && other->y == glyph->y;
+    }
+    return n;
+}
+
+// ------------------------------------------------------------------- main ---
+int main( void )
+{
+    texture_font_t *fonts[FONTS], *references[FONTS];
+    texture_atlas_t *atlas, *reference;
+    const texture_glyph_t *glyph, *most;
+    size_t i, k, n, bytes, saved, again, unique;
+    double with, without;
+    vector_t *glyphs, *remap;
+    int failed = 0, damaged;
+
+    printf( "%-18s %5s %7s %9s %9s %9s %6s %9s %9s\n", "font set", "fonts",
+            "glyphs", "bytes", "allocated", "saved", "saved", "with(ms)", "w/o(ms)" );
+    for( k = 0; k < SETS; k++ ) {
+        atlas = texture_atlas_new( ATLAS, ATLAS, 1 );
+        reference = texture_atlas_new( ATLAS, ATLAS, 1 );
+        texture_atlas_set_sharing( atlas, 1 );
+        with = load( &sets[k], atlas, fonts );
+        without = load( &sets[k], reference, references );
+        glyphs = shared( fonts, references, &bytes, &saved, &damaged );
+        failed |= damaged;
+
+        /* What the atlas says it saved, and what it holds */
+        if( saved != atlas->shared_bytes ||
+            atlas->used + atlas->shared_bytes != reference->used ) {
+            fprintf( stderr, "%s: %" PRIzu " bytes shared, %" PRIzu " counted\n",
+                     sets[k].name, atlas->shared_bytes, saved );
+            failed = 1;
+        }
+        for( n = 0; fonts[n]; n++ )
+            ;
+        printf( "%-18s %5" PRIzu " %7" PRIzu " %9" PRIzu " %9" PRIzu " %9" PRIzu
+                " %5.1f%% %9.2f %9.2f\n",
+                sets[k].name, n, vector_size( glyphs ), bytes, bytes - saved, saved,
+                bytes ? 100.0 * saved / bytes : 0.0, with * 1e3, without * 1e3 );
+        vector_delete( glyphs );
+
+        /* Repacked, the glyphs share their regions as before */
+        unique = atlas->used;
+        if( !(remap = texture_font_repack( fonts, n )) ) {
+            fprintf( stderr, "%s: not repacked\n", sets[k].name );
+            failed = 1;
+            glyphs = vector_new( sizeof(texture_glyph_t *) );
+        } else {
+            vector_delete( remap );
+            glyphs = shared( fonts, references, &bytes, &again, &damaged );
+            if( damaged || again != saved || atlas->shared_bytes != saved ) {
+                fprintf( stderr, "%s: sharing lost repacking\n", sets[k].name );
+                failed = 1;
+            }
+        }
+
+        /* The region shared most is given back with its last reference */
+        for( i = 0, most = NULL; i < vector_size( glyphs ); i++ ) {
+            glyph = *(const texture_glyph_t **) vector_get( glyphs, i );
+            if( !most || count( glyphs, glyph ) > count( glyphs, most ) )
+                most = glyph;
+        }
+        if( most && count( glyphs, most ) > 1 ) {
+            size_t middle = (most->y + most->height / 2) * atlas->width +
+                            most->x + most->width / 2;
+            unsigned char pixel = atlas->data[middle];
+
+            for( i = count( glyphs, most ); i > 1; i-- )
+                texture_atlas_release_region( atlas, most->x, most->y,
+                                              most->width, most->height, 0, 0 );
+            if( atlas->used != unique || atlas->data[middle] != pixel ) {
+                fprintf( stderr, "%s: shared region given back\n", sets[k].name );
+                failed = 1;
+            }
+            texture_atlas_release_region( atlas, most->x, most->y,
+                                          most->width, most->height, 0, 0 );
+            if( atlas->used != unique - most->width * most->height ||
+                atlas->data[middle] ) {
+                fprintf( stderr, "%s: shared region kept\n", sets[k].name );
+                failed = 1;
+            }
+        } else {
+            fprintf( stderr, "%s: no region shared\n", sets[k].name );
+            failed = 1;
+        }
+        vector_delete( glyphs );
+
+        for( i = 0; fonts[i]; i++ ) {
+            texture_font_delete( fonts[i] );
+            texture_font_delete( references[i] );
+        }
+        texture_atlas_delete( atlas );
+        texture_atlas_delete( reference );
+    }
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
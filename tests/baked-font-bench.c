@@ -0,0 +1,276 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include "freetype-gl.h"
+#include "utf8-utils.h"
+#include "bench.h"
+
+// ------------------------------------------------------------- codepoints ---
+/* The first count codepoints a font covers as UTF-8, followed by a few it
+ * lacks */
+static char *
+codepoints_new( const char *filename, size_t count )
+{
+    FT_Library library;
+    FT_Face face;
+    FT_ULong c;
+    FT_UInt index;
+    uint32_t extra[] = { 0xE000, 0xE001, 0x10FFFD };
+    char *text = NULL, *p;
+    size_t i, n = 0;
+
+    if( FT_Init_FreeType( &library ) )
+        return NULL;
+    if( !FT_New_Face( library, filename, 0, &face ) &&
+        !FT_Select_Charmap( face, FT_ENCODING_UNICODE ) &&
+        (text = malloc( 4 * (face->num_glyphs + 4) )) ) {
+        p = text;
+        for( c = FT_Get_First_Char( face, &index ); index && n < count;
+             c = FT_Get_Next_Char( face, c, &index ), n++ )
+            p += utf32_to_utf8( (uint32_t) c, p );
+        for( i = 0; i < sizeof(extra) / sizeof(extra[0]); i++ )
+            p += utf32_to_utf8( extra[i], p );
+        *p = 0;
+        FT_Done_Face( face );
+    }
+    FT_Done_FreeType( library );
+    return text;
+}
+
+// ---------------------------------------------------------------- release ---
+static void
+release( texture_font_t *font )
+{
+    texture_atlas_t *atlas = font->atlas;
+
+    texture_font_delete( font );
+    texture_atlas_delete( atlas );
+}
+
+// ---------------------------------------------------------------- compare ---
+/* A baked font must give the glyphs and kerning of the font it was baked
+ * from, the kerning being rounded to 1/64 pixel */
+static int
+compare( const char *name, texture_font_t *reference, texture_font_t *font,
+         const char *text )
+{
+    const texture_atlas_t *a = reference->atlas, *b = font->atlas;
+    size_t i, j, m, n;
+
+    if( a->width != b->width || a->height != b->height || a->depth != b->depth ||
+        memcmp( a->data, b->data, a->width * a->height * a->depth ) ) {
+        fprintf( stderr, "%s: atlases differ\n", name );
+        return 1;
+    }
+    for( i = 0; text[i]; i += utf8_surrogate_len( text + i ) ) {
+        texture_glyph_t *g = texture_font_find_glyph( reference, text + i );
+        texture_glyph_t *h = texture_font_get_glyph( font, text + i );
+
+        if( !g || !h || g->codepoint != h->codepoint ||
+            g->x != h->x || g->y != h->y ||
+            g->width != h->width || g->height != h->height ||
+            g->offset_x != h->offset_x || g->offset_y != h->offset_y ||
+            g->advance_x != h->advance_x || g->advance_y != h->advance_y ||
+            g->s0 != h->s0 || g->t0 != h->t0 || g->s1 != h->s1 || g->t1 != h->t1 ) {
+            fprintf( stderr, "%s: glyph U+%04X differs\n", name,
+                     utf8_to_utf32( text + i ) );
+            return 1;
+        }
+    }
+
+    /* Kerning of the first glyphs, where pairs are */
+    for( i = 0, m = 0; text[i] && m < 256; i += utf8_surrogate_len( text + i ), m++ ) {
+        for( j = 0, n = 0; text[j] && n < 256; j += utf8_surrogate_len( text + j ), n++ ) {
+            uint32_t left = utf8_to_utf32( text + j ), right = utf8_to_utf32( text + i );
+            float k = texture_font_get_kerning( reference, left, right );
+            float l = texture_font_get_kerning( font, left, right );
+
+            if( fabsf( k - l ) > 0.5f / KERNING_COMPACT_SCALE + 1e-6f ) {
+                fprintf( stderr, "%s: kerning of U+%04X U+%04X is %f instead of %f\n",
+                         name, left, right, l, k );
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+// ------------------------------------------------------------------- main ---
+int main( int argc, char **argv )
+{
+    const char *filename = argc > 1 ? argv[1] : "fonts/Liberastika-Regular.ttf";
+    const char *directory = argc > 2 ? argv[2] : getenv( "TMPDIR" );
+    struct {
+        const char *name;
+        rendermode_t rendermode;
+        float outline_thickness;
+        kerning_mode_t kerning_mode;
+    } runs[] = {
+        { "pages",   RENDER_NORMAL,       0, KERNING_EAGER },
+        { "compact", RENDER_NORMAL,       0, KERNING_COMPACT },
+        { "lazy",    RENDER_OUTLINE_EDGE, 1, KERNING_LAZY },
+    };
+    size_t counts[] = { 96, (size_t) -1 };
+    char path[1024];
+    int failed = 0, run, c;
+
+    if( !directory )
+        directory = getenv( "TEMP" );
+    if( !directory )
+        directory = "/tmp";
+    snprintf( path, sizeof(path), "%s/baked-font-bench.ftgl", directory );
+
+    printf( "%-8s %8s %10s %12s %12s %10s\n",
+            "kerning", "glyphs", "bytes", "freetype(ms)", "baked(ms)", "first(ms)" );
+
+    for( run = 0; run < 3; run++ ) {
+        for( c = 0; c < 2; c++ ) {
+            char *text = codepoints_new( filename, counts[c] );
+            texture_atlas_t *atlas = texture_atlas_new( 1024, 1024, 1 );
+            texture_font_t *reference, *font;
+            baked_font_t *baked;
+            double t_freetype, t_baked, t_first, start;
+            texture_glyph_t *glyph;
+            size_t k, glyphs;
+
+            if( !text || !atlas ) {
+                fprintf( stderr, "Cannot read %s\n", filename );
+                return EXIT_FAILURE;
+            }
+
+            /* From FreeType */
+            start = now();
+            reference = texture_font_new_from_file( atlas, 16, filename );
+            if( !reference ) {
+                fprintf( stderr, "Cannot load %s\n", filename );
+                return EXIT_FAILURE;
+            }
+            reference->rendermode = runs[run].rendermode;
+            reference->outline_thickness = runs[run].outline_thickness;
+            reference->kerning_mode = runs[run].kerning_mode;
+            if( texture_font_load_glyphs( reference, text ) ) {
+                fprintf( stderr, "%s: atlas too small\n", runs[run].name );
+                return EXIT_FAILURE;
+            }
+            t_freetype = now() - start;
+            glyphs = vector_glyphs_size( reference->glyphs );
+
+            if( !baked_font_save( reference, path ) ) {
+                fprintf( stderr, "Cannot write %s\n", path );
+                return EXIT_FAILURE;
+            }
+
+            /* Mapped as is: no glyph is decoded until looked up */
+            t_baked = 1e9;
+            for( k = 0; k < 10; k++ ) {
+                start = now();
+                baked = baked_font_load( path );
+                font = baked ? texture_font_new_from_baked( baked ) : NULL;
+                if( baked )
+                    baked_font_release( baked );
+                if( now() - start < t_baked )
+                    t_baked = now() - start;
+                if( !font ) {
+                    fprintf( stderr, "Cannot load %s\n", path );
+                    return EXIT_FAILURE;
+                }
+                if( k < 9 )
+                    release( font );
+            }
+            if( vector_glyphs_size( font->glyphs ) ) {
+                fprintf( stderr, "%s: glyphs decoded at load\n", runs[run].name );
+                failed = 1;
+            }
+
+            start = now();
+            glyph = texture_font_get_glyph( font, "A" );
+            t_first = now() - start;
+            printf( "%-8s %8" PRIzu " %10" PRIzu " %12.2f %12.4f %10.4f\n",
+                    runs[run].name, glyphs, font->baked->size,
+                    t_freetype * 1e3, t_baked * 1e3, t_first * 1e3 );
+
+            failed |= !glyph || compare( runs[run].name, reference, font, text );
+
+            /* Baked fonts render nothing: missing codepoints share glyph 0 */
+            if( texture_font_get_glyph( font, "\xef\x80\x80" ) !=
+                texture_font_find_glyph( font, "\0" ) ) {
+                fprintf( stderr, "%s: missing codepoint not aliased\n", runs[run].name );
+                failed = 1;
+            }
+
+            /* The mapped atlas can grow, leaving the mapping */
+            texture_atlas_enlarge_texture( font->atlas, 2048, 2048 );
+            if( font->atlas->baked ||
+                memcmp( font->atlas->data + 2048 + 1, atlas->data + 1024 + 1, 1022 ) ) {
+                fprintf( stderr, "%s: enlarged atlas differs\n", runs[run].name );
+                failed = 1;
+            }
+
+            release( font );
+            release( reference );
+            free( text );
+        }
+    }
+
+    /* Truncated or foreign files are refused */
+    {
+        FILE *file = fopen( path, "rb" );
+        unsigned char *data = malloc( 4096 );
+        size_t size = file ? fread( data, 1, 4096, file ) : 0;
+
+        if( file )
+            fclose( file );
+        if( size != 4096 || baked_font_new_from_memory( data, size ) ) {
+            fprintf( stderr, "truncated file accepted\n" );
+            failed = 1;
+        }
+        free( data );
+    }
+
+    /* Glyphs whose bitmap is out of the atlas are not found */
+    {
+        FILE *file = fopen( path, "rb" );
+        long size = -1;
+        unsigned char *data = NULL;
+        baked_font_t *baked = NULL;
+        baked_glyph_t record;
+
+        if( file && !fseek( file, 0, SEEK_END ) && (size = ftell( file )) > 0 &&
+            (data = malloc( size )) && !fseek( file, 0, SEEK_SET ) &&
+            fread( data, 1, size, file ) == (size_t) size )
+            baked = baked_font_new_from_memory( data, size );
+        if( file )
+            fclose( file );
+        /* The first glyph record starts with its codepoint, then its x */
+        if( !baked || !baked->glyph_count ||
+            !baked_font_find( baked, baked->glyphs[0] | baked->glyphs[1] << 8 |
+                              baked->glyphs[2] << 16 | (uint32_t) baked->glyphs[3] << 24,
+                              &record ) ) {
+            fprintf( stderr, "baked font not reloaded\n" );
+            failed = 1;
+        }
+        else {
+            memset( data + (baked->glyphs - data) + 4, 0xff, 4 );
+            if( baked_font_find( baked, record.codepoint, &record ) ) {
+                fprintf( stderr, "glyph out of the atlas found\n" );
+                failed = 1;
+            }
+        }
+        if( baked )
+            baked_font_release( baked );
+        free( data );
+    }
+    remove( path );
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
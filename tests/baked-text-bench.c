@@ -0,0 +1,149 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freetype-gl.h"
+#include "font-manager.h"
+#include "text-buffer.h"
+#include "utf8-utils.h"
+#include "bench.h"
+
+/* Lines laid out with the font manager, the last character being missing
+ * from the font */
+static const char *text =
+    "AVA To Wa Yo LT P. \"quoted\" (brackets) {braces}\n"
+    "The quick brown fox jumps over the lazy dog 0123456789\n"
+    "\xc3\xa0\xc3\xa9\xc3\xa8\xc3\xaf\xc3\xb4\xc3\xbc \xee\x80\x80";
+
+// ------------------------------------------------------------------ layout ---
+/* Lay the text out with a font of a font manager, as an application would */
+static text_buffer_t *
+layout( font_manager_t *manager, const char *filename, vec2 *pen, double *elapsed )
+{
+    text_buffer_t *buffer;
+    markup_t markup;
+    double start = now();
+
+    memset( &markup, 0, sizeof(markup) );
+    markup.gamma = 1.0;
+    markup.foreground_color.alpha = 1.0;
+    markup.font = font_manager_get_from_filename( manager, filename, 16 );
+    if( !markup.font ||
+        markup.font != font_manager_get_from_filename( manager, filename, 16 ) )
+        return NULL;
+
+    buffer = text_buffer_new( );
+    pen->x = 0;
+    pen->y = 0;
+    text_buffer_add_text( buffer, pen, &markup, text, 0 );
+    *elapsed = now() - start;
+    return buffer;
+}
+
+// ------------------------------------------------------------------- main ---
+int main( int argc, char **argv )
+{
+    char path[1024];
+    font_manager_t *manager;
+    text_buffer_t *buffer;
+    vec2 pen;
+    double t_baked;
+    size_t i, n, count = 0;
+    int failed = 0;
+
+#ifdef FTGL_NO_FREETYPE
+    /* Nothing to bake with: the baked font is given */
+    if( argc < 2 ) {
+        fprintf( stderr, "Usage: %s <baked font rendered at 16 pt>\n", argv[0] );
+        return EXIT_FAILURE;
+    }
+    snprintf( path, sizeof(path), "%s", argv[1] );
+#else
+    const char *filename = argc > 1 ? argv[1] : "fonts/Vera.ttf";
+    const char *directory = getenv( "TMPDIR" );
+    font_manager_t *reference;
+    text_buffer_t *expected;
+    texture_font_t *font;
+    vec2 expected_pen;
+    double t_freetype;
+
+    if( !directory )
+        directory = getenv( "TEMP" );
+    if( !directory )
+        directory = "/tmp";
+
+    /* Bake the glyphs of the text */
+    snprintf( path, sizeof(path), "%s/baked-text-bench.ftgl", directory );
+    font = texture_font_new_from_file( texture_atlas_new( 256, 256, 1 ), 16, filename );
+    if( !font || texture_font_load_glyphs( font, text ) ||
+        !baked_font_save( font, path ) ) {
+        fprintf( stderr, "Cannot bake %s\n", filename );
+        return EXIT_FAILURE;
+    }
+    texture_atlas_delete( font->atlas );
+    texture_font_delete( font );
+
+    reference = font_manager_new( 512, 512, 1 );
+    expected = layout( reference, filename, &expected_pen, &t_freetype );
+    if( !expected ) {
+        fprintf( stderr, "Cannot load %s\n", filename );
+        return EXIT_FAILURE;
+    }
+#endif
+
+    manager = font_manager_new( 512, 512, 1 );
+    buffer = layout( manager, path, &pen, &t_baked );
+    if( !buffer ) {
+        fprintf( stderr, "Cannot load %s\n", path );
+        return EXIT_FAILURE;
+    }
+    for( i = 0; text[i]; i += utf8_surrogate_len( text + i ) )
+        count += text[i] != '\n';
+    n = vector_size( buffer->buffer->vertices );
+    if( n != 4 * count ) {
+        fprintf( stderr, "%" PRIzu " vertices instead of %" PRIzu "\n", n, 4 * count );
+        failed = 1;
+    }
+
+#ifndef FTGL_NO_FREETYPE
+    /* Glyphs are copied from the baked file in the order FreeType renders
+     * them, so the layout and the atlas are the same, kerning aside */
+    printf( "freetype: %.3f ms, baked: %.3f ms\n", t_freetype * 1e3, t_baked * 1e3 );
+    if( memcmp( manager->atlas->data, reference->atlas->data, 512 * 512 ) ) {
+        fprintf( stderr, "atlases differ\n" );
+        failed = 1;
+    }
+    if( n != vector_size( expected->buffer->vertices ) ||
+        fabsf( pen.x - expected_pen.x ) > 0.5f || pen.y != expected_pen.y ) {
+        fprintf( stderr, "layouts differ\n" );
+        failed = 1;
+    }
+    for( i = 0; !failed && i < n; i++ ) {
+        const glyph_vertex_t *v = vector_get( buffer->buffer->vertices, i );
+        const glyph_vertex_t *w = vector_get( expected->buffer->vertices, i );
+
+        /* Kerning is baked in 1/64 pixels */
+        if( fabsf( (v->x + v->shift) - (w->x + w->shift) ) > 0.5f ||
+            v->y != w->y || v->u != w->u || v->v != w->v ) {
+            fprintf( stderr, "vertex %" PRIzu " differs\n", i );
+            failed = 1;
+        }
+    }
+    text_buffer_delete( expected );
+    font_manager_delete( reference );
+    remove( path );
+#else
+    printf( "baked: %.3f ms\n", t_baked * 1e3 );
+#endif
+
+    text_buffer_delete( buffer );
+    font_manager_delete( manager );
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
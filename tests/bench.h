@@ -0,0 +1,36 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <time.h>
+
+#ifndef WIN32
+#   define PRIzu "zu"
+#else
+#   define PRIzu "Iu"
+#endif
+
+/* Fonts of different designs and coverages */
+static const char * const bench_fonts[] = {
+    "fonts/Vera.ttf",
+    "fonts/SourceSansPro-Regular.ttf",
+    "fonts/Liberastika-Regular.ttf",
+};
+#define BENCH_FONTS (sizeof(bench_fonts) / sizeof(bench_fonts[0]))
+
+// ------------------------------------------------------------------- now ---
+/* Wall clock time in seconds, to time the benchmarks with */
+inline static double
+now( void )
+{
+    struct timespec ts;
+
+    timespec_get( &ts, TIME_UTC );
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#endif /* __BENCH_H__ */
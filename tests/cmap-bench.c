@@ -0,0 +1,126 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include "freetype-gl.h"
+#include "bench.h"
+
+/* Rounds of lookups timed */
+#define ROUNDS 20
+
+// ------------------------------------------------------------------ check ---
+/* The cache must give the glyph index FreeType gives for every codepoint,
+ * then time both on the codepoints of the first planes */
+static int
+check( const char *filename )
+{
+    texture_atlas_t *atlas = texture_atlas_new( 512, 512, 1 );
+    texture_font_t *font = texture_font_new_from_file( atlas, 16, filename );
+    FT_Face face;
+    uint32_t c, sum = 0;
+    size_t covered = 0, k;
+    double t_freetype, t_cache, start;
+    int failed = 0;
+
+    if( !font || !font->cmap ) {
+        fprintf( stderr, "Cannot load %s\n", filename );
+        return 1;
+    }
+    face = font->face;
+
+    for( c = 0; c < 0x110000; c++ ) {
+        FT_UInt index = FT_Get_Char_Index( face, c );
+
+        if( cmap_cache_get( font->cmap, c ) != index ||
+            cmap_cache_covers( font->cmap, c ) != (index != 0) ||
+            texture_font_covers( font, c ) != (index != 0) ) {
+            fprintf( stderr, "%s: U+%04X maps to %u instead of %u\n", filename,
+                     c, cmap_cache_get( font->cmap, c ), index );
+            failed = 1;
+            break;
+        }
+        covered += index != 0;
+    }
+    if( covered != font->cmap->count ) {
+        fprintf( stderr, "%s: %" PRIzu " codepoints counted instead of %" PRIzu "\n",
+                 filename, font->cmap->count, covered );
+        failed = 1;
+    }
+
+    start = now();
+    for( k = 0; k < ROUNDS; k++ )
+        for( c = 0; c < 0x20000; c++ )
+            sum += FT_Get_Char_Index( face, c );
+    t_freetype = now() - start;
+    start = now();
+    for( k = 0; k < ROUNDS; k++ )
+        for( c = 0; c < 0x20000; c++ )
+            sum -= cmap_cache_get( font->cmap, c );
+    t_cache = now() - start;
+
+    printf( "%-32s %8" PRIzu " %10" PRIzu " %12.2f %10.2f\n", filename, covered,
+            cmap_cache_memory( font->cmap ),
+            t_freetype * 1e9 / ((double) ROUNDS * 0x20000),
+            t_cache * 1e9 / ((double) ROUNDS * 0x20000) );
+    if( sum ) {
+        fprintf( stderr, "%s: lookups differ\n", filename );
+        failed = 1;
+    }
+
+    texture_font_delete( font );
+    texture_atlas_delete( atlas );
+    return failed;
+}
+
+// ------------------------------------------------------------------- main ---
+int main( int argc, char **argv )
+{
+    const char *filenames[] = { "fonts/Vera.ttf", "fonts/Liberastika-Regular.ttf" };
+    texture_atlas_t *atlas;
+    texture_font_t *font;
+    texture_glyph_t *glyph;
+    int failed = 0;
+    size_t i;
+
+    printf( "%-32s %8s %10s %12s %10s\n",
+            "font", "covered", "bytes", "freetype(ns)", "cache(ns)" );
+    if( argc > 1 )
+        failed |= check( argv[1] );
+    else
+        for( i = 0; i < sizeof(filenames) / sizeof(filenames[0]); i++ )
+            failed |= check( filenames[i] );
+
+    /* The cache outlives the face: fonts closing it after each glyph still
+     * resolve codepoints, and missing ones need no face at all */
+    texture_font_default_mode( MODE_AUTO_CLOSE );
+    atlas = texture_atlas_new( 512, 512, 1 );
+    font = texture_font_new_from_file( atlas, 16, filenames[0] );
+    if( font )
+        texture_font_close( font, MODE_AUTO_CLOSE, MODE_AUTO_CLOSE );
+    if( !font || font->face ) {
+        fprintf( stderr, "Cannot load %s with its face closed\n", filenames[0] );
+        return EXIT_FAILURE;
+    }
+    glyph = texture_font_get_glyph( font, "A" );
+    if( !glyph || !glyph->width || glyph == texture_font_find_glyph( font, "\0" ) ) {
+        fprintf( stderr, "glyph of a closed face missing\n" );
+        failed = 1;
+    }
+    if( texture_font_get_glyph( font, "\xef\x80\x80" ) !=
+        texture_font_find_glyph( font, "\0" ) || font->face ) {
+        fprintf( stderr, "missing codepoint not aliased\n" );
+        failed = 1;
+    }
+    texture_font_delete( font );
+    texture_atlas_delete( atlas );
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
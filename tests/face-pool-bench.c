@@ -0,0 +1,134 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freetype-gl.h"
+#include "bench.h"
+
+static const char *filenames[] = {
+    "fonts/Vera.ttf",
+    "fonts/VeraMono.ttf",
+    "fonts/VeraMoBd.ttf",
+    "fonts/VeraMoIt.ttf",
+    "fonts/SourceSansPro-Regular.ttf",
+    "fonts/Liberastika-Regular.ttf",
+};
+#define FILES (sizeof(filenames) / sizeof(filenames[0]))
+
+/* Glyphs loaded by every font in turn, as a user interface mixing fonts */
+static const char *text =
+    "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+
+// ------------------------------------------------------------------- run ---
+/* Load the text with two sizes of each file, closing the faces after each
+ * glyph, with a pool of max_faces faces. Returns a checksum of the atlases
+ * or 0 on failure. */
+static unsigned long
+run( size_t max_faces )
+{
+    texture_font_library_t *library = texture_library_new( );
+    texture_atlas_t *atlases[FILES];
+    texture_font_t *fonts[2 * FILES];
+    unsigned long checksum = 5381;
+    const char *c;
+    double start;
+    size_t i, k;
+    int failed = 0;
+
+    library->max_faces = max_faces;
+    freetype_gl_library = library;
+    texture_font_default_mode( MODE_AUTO_CLOSE );
+
+    for( i = 0; i < FILES; i++ ) {
+        atlases[i] = texture_atlas_new( 512, 512, 1 );
+        fonts[2 * i] = texture_font_new_from_file( atlases[i], 16, filenames[i] );
+        if( !fonts[2 * i] ) {
+            fprintf( stderr, "Cannot load %s\n", filenames[i] );
+            exit( EXIT_FAILURE );
+        }
+        texture_font_close( fonts[2 * i], MODE_AUTO_CLOSE, MODE_AUTO_CLOSE );
+        fonts[2 * i + 1] = texture_font_clone( fonts[2 * i], 24 );
+        if( !fonts[2 * i + 1] ||
+            fonts[2 * i + 1]->shared_face != fonts[2 * i]->shared_face ) {
+            fprintf( stderr, "clone of %s does not share its face\n", filenames[i] );
+            exit( EXIT_FAILURE );
+        }
+    }
+
+    start = now( );
+    for( c = text; *c; c++ ) {
+        char codepoint[2] = { *c, 0 };
+
+        for( k = 0; k < 2 * FILES; k++ ) {
+            if( !texture_font_get_glyph( fonts[k], codepoint ) ) {
+                fprintf( stderr, "atlas full\n" );
+                exit( EXIT_FAILURE );
+            }
+            if( library->open_faces > max_faces ) {
+                fprintf( stderr, "%" PRIzu " faces open, %" PRIzu " at most\n",
+                         library->open_faces, max_faces );
+                failed = 1;
+            }
+        }
+    }
+    printf( "%9" PRIzu " %10.2f %8" PRIzu " %8" PRIzu " %8" PRIzu "\n", max_faces,
+            (now( ) - start) * 1e3, library->face_hits, library->face_misses,
+            library->face_reopens );
+
+    /* A face is opened once per file while the pool holds them all */
+    if( library->face_misses != FILES ||
+        (max_faces >= FILES && library->face_reopens) ) {
+        fprintf( stderr, "%" PRIzu " faces opened, %" PRIzu " reopened\n",
+                 library->face_misses, library->face_reopens );
+        failed = 1;
+    }
+
+    /* Done with FreeType with the last face */
+    library->mode = MODE_FREE_CLOSE;
+    for( i = 0; i < FILES; i++ ) {
+        for( k = 0; k < atlases[i]->width * atlases[i]->height; k++ )
+            checksum = checksum * 33 + atlases[i]->data[k];
+        texture_font_delete( fonts[2 * i] );
+        texture_font_delete( fonts[2 * i + 1] );
+        texture_atlas_delete( atlases[i] );
+    }
+
+    /* Faces go with the last font sharing them */
+    if( library->faces || library->open_faces || library->library ) {
+        fprintf( stderr, "faces left open in the pool\n" );
+        failed = 1;
+    }
+    freetype_gl_library = NULL;
+    free( library );
+
+    return failed ? 0 : checksum;
+}
+
+// ------------------------------------------------------------------- main ---
+int main( void )
+{
+    size_t sizes[] = { 16, FILES, 3, 1 };
+    unsigned long expected = 0, checksum;
+    size_t i;
+    int failed = 0;
+
+    printf( "%9s %10s %8s %8s %8s\n", "max_faces", "time(ms)", "hits", "misses", "reopens" );
+    for( i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++ ) {
+        checksum = run( sizes[i] );
+        if( !i )
+            expected = checksum;
+
+        /* Sizes made again on reopened faces render the same glyphs */
+        if( !checksum || checksum != expected ) {
+            fprintf( stderr, "pool of %" PRIzu " faces: atlases differ\n", sizes[i] );
+            failed = 1;
+        }
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
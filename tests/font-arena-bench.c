@@ -0,0 +1,120 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include "freetype-gl.h"
+#include "bench.h"
+
+// ------------------------------------------------------------- codepoints ---
+/* Every codepoint a font covers, 0-terminated */
+static uint32_t *
+codepoints_new( const char *filename, size_t *count )
+{
+    FT_Library library;
+    FT_Face face;
+    FT_ULong c;
+    FT_UInt index;
+    uint32_t *codepoints = NULL;
+
+    *count = 0;
+    if( FT_Init_FreeType( &library ) )
+        return NULL;
+    if( !FT_New_Face( library, filename, 0, &face ) ) {
+        codepoints = malloc( (face->num_glyphs + 1) * sizeof(uint32_t) );
+        for( c = FT_Get_First_Char( face, &index );
+             index && *count < (size_t) face->num_glyphs;
+             c = FT_Get_Next_Char( face, c, &index ) )
+            codepoints[(*count)++] = c;
+        FT_Done_Face( face );
+    }
+    FT_Done_FreeType( library );
+    return codepoints;
+}
+
+// ------------------------------------------------------------------- main ---
+int main( int argc, char **argv )
+{
+    const char *filename = argc > 1 ? argv[1] : "fonts/Liberastika-Regular.ttf";
+    size_t count, loaded = 0, i;
+    uint32_t *codepoints = codepoints_new( filename, &count );
+    texture_atlas_t *atlas = texture_atlas_new( 4096, 4096, 1 );
+    texture_font_t *font = texture_font_new_from_file( atlas, 16, filename );
+    rendermode_t modes[] = { RENDER_NORMAL, RENDER_OUTLINE_EDGE };
+    clock_t start;
+    double t_load, t_delete;
+    int failed = 0, mode;
+    arena_t arena;
+
+    if( !codepoints || !font ) {
+        fprintf( stderr, "Cannot load %s\n", filename );
+        return EXIT_FAILURE;
+    }
+
+    /* Two render modes, so that each codepoint has two glyph variants */
+    start = clock();
+    font->mode = MODE_ALWAYS_OPEN;
+    for( mode = 0; mode < 2; mode++ ) {
+        font->rendermode = modes[mode];
+        font->outline_thickness = mode;
+        for( i = 0; i < count; i++ )
+            loaded += texture_font_load_glyph_gi( font,
+                FT_Get_Char_Index( font->face, codepoints[i] ), codepoints[i] );
+    }
+    t_load = (clock() - start) / (double)CLOCKS_PER_SEC;
+
+    /* Variants must be distinct glyphs that stay where they were loaded */
+    for( i = 0; i < count; i++ ) {
+        texture_glyph_t *normal, *outline;
+        font->rendermode = RENDER_NORMAL;
+        font->outline_thickness = 0;
+        normal = texture_font_find_glyph_gi( font, codepoints[i] );
+        font->rendermode = RENDER_OUTLINE_EDGE;
+        font->outline_thickness = 1;
+        outline = texture_font_find_glyph_gi( font, codepoints[i] );
+        if( !normal || !outline || normal == outline ||
+            normal->rendermode != RENDER_NORMAL ||
+            outline->rendermode != RENDER_OUTLINE_EDGE ) {
+            fprintf( stderr, "Variants of U+%04X are mixed up\n", codepoints[i] );
+            failed = 1;
+            break;
+        }
+    }
+
+    arena = *font->arena;
+    printf( "Glyphs loaded      : %" PRIzu "\n"
+            "Glyphs stored      : %" PRIzu "\n"
+            "Arena blocks       : %" PRIzu "\n"
+            "Arena allocations  : %" PRIzu "\n"
+            "Arena used (KB)    : %.1f\n"
+            "Arena capacity (KB): %.1f\n"
+            "Font memory (KB)   : %.1f\n",
+            loaded, vector_glyphs_size( font->glyphs ),
+            arena.block_count, arena.allocations,
+            arena.used / 1024.0, arena.capacity / 1024.0,
+            texture_font_memory( font ) / 1024.0 );
+
+    if( arena.used > arena.capacity ||
+        arena.allocations < vector_glyphs_size( font->glyphs ) ) {
+        fprintf( stderr, "Arena counters are inconsistent\n" );
+        failed = 1;
+    }
+
+    start = clock();
+    texture_font_delete( font );
+    t_delete = (clock() - start) / (double)CLOCKS_PER_SEC;
+    printf( "Load (s)           : %.4f\n"
+            "Delete (s)         : %.6f\n", t_load, t_delete );
+
+    texture_atlas_delete( atlas );
+    free( codepoints );
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,187 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freetype-gl.h"
+#include "utf8-utils.h"
+#include "bench.h"
+
+static const char *text =
+    " !\"#$%&'()*+,-./0123456789:;<=>?"
+    "@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_"
+    "`abcdefghijklmnopqrstuvwxyz{|}~"
+    "\xc3\xa0\xc3\xa9\xc3\xa8\xc3\xaf\xc3\xb4\xc3\xbc"  /* àéèïôü */
+    "\xee\x80\x80\xee\x80\x81";                          /* missing glyphs */
+
+// ------------------------------------------------------------------- load ---
+/* Load the text in a new font and atlas, through the cache in directory */
+static texture_font_t *
+load( const char *filename, const char *directory, rendermode_t rendermode,
+      double *elapsed )
+{
+    texture_atlas_t *atlas = texture_atlas_new( 512, 512, 1 );
+    texture_font_t *font = texture_font_new_from_file( atlas, 32, filename );
+    double start;
+
+    if( !font || !texture_font_set_cache( font, directory ) )
+        return NULL;
+    font->rendermode = rendermode;
+
+    start = now();
+    texture_font_load_glyphs( font, text );
+    *elapsed = now() - start;
+    return font;
+}
+
+// ---------------------------------------------------------------- release ---
+static void
+release( texture_font_t *font )
+{
+    texture_atlas_t *atlas = font->atlas;
+
+    texture_font_delete( font );
+    texture_atlas_delete( atlas );
+}
+
+// ---------------------------------------------------------------- compare ---
+/* A font loaded through the cache must match the one loaded from FreeType */
+static int
+compare( const char *name, texture_font_t *reference, texture_font_t *font )
+{
+    const texture_atlas_t *a = reference->atlas, *b = font->atlas;
+    size_t i, j;
+
+    if( memcmp( a->data, b->data, a->width * a->height * a->depth ) ) {
+        fprintf( stderr, "%s: atlases differ\n", name );
+        return 1;
+    }
+    for( i = 0; text[i]; i += utf8_surrogate_len( text + i ) ) {
+        texture_glyph_t *g = texture_font_find_glyph( reference, text + i );
+        texture_glyph_t *h = texture_font_find_glyph( font, text + i );
+
+        if( !g || !h || g->codepoint != h->codepoint ||
+            g->x != h->x || g->y != h->y ||
+            g->width != h->width || g->height != h->height ||
+            g->offset_x != h->offset_x || g->offset_y != h->offset_y ||
+            g->advance_x != h->advance_x || g->advance_y != h->advance_y ) {
+            fprintf( stderr, "%s: glyph U+%04X differs\n", name,
+                     utf8_to_utf32( text + i ) );
+            return 1;
+        }
+        for( j = 0; text[j]; j += utf8_surrogate_len( text + j ) ) {
+            if( texture_glyph_get_kerning( g, text + j ) !=
+                texture_glyph_get_kerning( h, text + j ) ) {
+                fprintf( stderr, "%s: kerning of U+%04X U+%04X differs\n", name,
+                         utf8_to_utf32( text + j ), utf8_to_utf32( text + i ) );
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+// ----------------------------------------------------------------- damage ---
+/* Overwrite bytes of a file, at offset from its end if negative, or append
+ * them if offset is 0 */
+static void
+damage( const char *path, long offset, const char *bytes, size_t size )
+{
+    FILE *file = fopen( path, offset ? "r+b" : "ab" );
+
+    if( !file )
+        return;
+    if( offset )
+        fseek( file, offset, offset < 0 ? SEEK_END : SEEK_SET );
+    fwrite( bytes, 1, size, file );
+    fclose( file );
+}
+
+// ------------------------------------------------------------------- main ---
+int main( int argc, char **argv )
+{
+    const char *filename = argc > 1 ? argv[1] : "fonts/Vera.ttf";
+    const char *directory = argc > 2 ? argv[2] : getenv( "TMPDIR" );
+    rendermode_t modes[] = { RENDER_NORMAL, RENDER_SIGNED_DISTANCE_FIELD };
+    const char *names[] = { "normal", "sdf" };
+    int failed = 0, mode;
+
+    if( !directory )
+        directory = getenv( "TEMP" );
+    if( !directory )
+        directory = "/tmp";
+
+    printf( "%-8s %-10s %10s %6s %6s %6s %8s\n",
+            "mode", "run", "load (ms)", "hits", "stores", "dropped", "glyphs" );
+
+    for( mode = 0; mode < 2; mode++ ) {
+        double t_reference, t;
+        texture_font_t *reference, *font;
+        char *path;
+        glyph_cache_t stats;
+        int run;
+
+        /* FreeType only */
+        reference = load( filename, NULL, modes[mode], &t_reference );
+        if( !reference ) {
+            fprintf( stderr, "Cannot load %s\n", filename );
+            return EXIT_FAILURE;
+        }
+        printf( "%-8s %-10s %10.2f %6s %6s %6s %8" PRIzu "\n", names[mode],
+                "uncached", t_reference * 1e3, "-", "-", "-",
+                vector_glyphs_size( reference->glyphs ) );
+
+        /* Cold, warm, then with a garbage tail, a flipped byte in the last
+         * record and a stale header */
+        path = NULL;
+        for( run = 0; run < 5; run++ ) {
+            static const char *runs[] = { "cold", "warm", "garbage", "flipped", "stale" };
+
+            if( path ) {
+                if( run == 2 )
+                    damage( path, 0, "garbage", 7 );
+                else if( run == 3 )
+                    damage( path, -1, "\xff", 1 );
+                else if( run == 4 )
+                    damage( path, 8, "\x7f", 1 );
+            }
+
+            font = load( filename, directory, modes[mode], &t );
+            if( !font || !font->cache->path ) {
+                fprintf( stderr, "Cannot use a glyph cache in %s\n", directory );
+                return EXIT_FAILURE;
+            }
+            if( !path ) {
+                /* Start from an empty cache file */
+                path = strdup( font->cache->path );
+                release( font );
+                remove( path );
+                font = load( filename, directory, modes[mode], &t );
+            }
+            stats = *font->cache;
+            printf( "%-8s %-10s %10.2f %6" PRIzu " %6" PRIzu " %6" PRIzu " %8" PRIzu "\n",
+                    names[mode], runs[run], t * 1e3, stats.hits, stats.stores,
+                    stats.dropped, vector_glyphs_size( font->glyphs ) );
+
+            failed |= compare( runs[run], reference, font );
+            if( (run == 0 && (stats.hits || !stats.stores || stats.dropped)) ||
+                (run == 1 && (!stats.hits || stats.stores || stats.dropped)) ||
+                (run == 2 && (!stats.hits || stats.stores || stats.dropped != 1)) ||
+                (run == 3 && (stats.stores != 1 || stats.dropped != 1)) ||
+                (run == 4 && (stats.hits || !stats.stores || stats.dropped != 1)) ) {
+                fprintf( stderr, "%s: unexpected cache counters\n", runs[run] );
+                failed = 1;
+            }
+            release( font );
+        }
+        remove( path );
+        free( path );
+        release( reference );
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
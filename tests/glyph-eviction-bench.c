@@ -0,0 +1,166 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freetype-gl.h"
+#include "text-buffer.h"
+#include "utf8-utils.h"
+#include "bench.h"
+
+/* A log scrolling through many scripts: each frame shows a line of
+ * LINE codepoints out of those of the font */
+#define FRAMES 400
+#define LINE   48
+
+// ------------------------------------------------------------------ same ---
+/* Whether a glyph has the pixels of the same glyph in a reference atlas */
+static int
+same( const texture_font_t *font, const texture_glyph_t *glyph,
+      const texture_font_t *reference, const texture_glyph_t *expected )
+{
+    const texture_atlas_t *a = font->atlas, *b = reference->atlas;
+    size_t y;
+
+    if( glyph->width != expected->width || glyph->height != expected->height )
+        return 0;
+    for( y = 0; y < glyph->height; y++ )
+        if( memcmp( a->data + (glyph->y + y) * a->width + glyph->x,
+                    b->data + (expected->y + y) * b->width + expected->x,
+                    glyph->width ) )
+            return 0;
+    return 1;
+}
+
+// ------------------------------------------------------------------- run ---
+/* Show the frames, returns the number of glyphs that could not be loaded */
+static size_t
+run( const char *filename, const uint32_t *codepoints, size_t count,
+     int evict, texture_font_t *reference, int *failed )
+{
+    texture_atlas_t *atlas = texture_atlas_new( 192, 192, 1 );
+    texture_font_t *font = texture_font_new_from_file( atlas, 16, filename );
+    text_buffer_t *buffer = text_buffer_new( );
+    markup_t markup;
+    size_t frame, i, k, missed = 0, stale = 0;
+    double start;
+
+    if( !font ) {
+        fprintf( stderr, "Cannot load %s\n", filename );
+        exit( EXIT_FAILURE );
+    }
+    font->evict = (unsigned char) evict;
+    memset( &markup, 0, sizeof(markup) );
+    markup.font = font;
+    markup.gamma = 1.0f;
+    markup.foreground_color.a = 1.0f;
+
+    srand( 1 );
+    start = now( );
+    for( frame = 0; frame < FRAMES; frame++ ) {
+        char text[4 * LINE + 1], *c = text;
+        vec2 pen = {{0, 0}};
+        texture_glyph_t *glyph;
+
+        texture_font_next_frame( font );
+
+        /* The text shown last frame is drawn again unless its glyphs moved */
+        if( text_buffer_is_stale( buffer ) )
+            stale++;
+        else if( frame && font->generation != ((text_buffer_font_t *)
+                 vector_get( buffer->fonts, 0 ))->generation ) {
+            fprintf( stderr, "frame %" PRIzu ": buffer not stale\n", frame );
+            *failed = 1;
+        }
+
+        /* Mostly the same few hundred codepoints, sometimes rare ones */
+        for( k = 0; k < LINE; k++ ) {
+            size_t n = rand( ) % 8 ? rand( ) % (count / 4) : rand( ) % count;
+            c += utf32_to_utf8( codepoints[n], c );
+        }
+        *c = 0;
+        text_buffer_clear( buffer );
+        for( c = text; *c; c += utf8_surrogate_len( c ) ) {
+            if( !texture_font_get_glyph( font, c ) ) {
+                missed++;
+                continue;
+            }
+            text_buffer_add_char( buffer, &pen, &markup, c, NULL );
+        }
+
+        /* Glyphs left in the atlas were not overwritten by others */
+        GLYPHS_ITERATOR( i, glyph, font->glyphs ) {
+            texture_glyph_t *expected =
+                texture_font_find_glyph_gi( reference, glyph->codepoint );
+
+            if( !expected || !same( font, glyph, reference, expected ) ) {
+                fprintf( stderr, "frame %" PRIzu ": glyph %u damaged\n",
+                         frame, glyph->codepoint );
+                *failed = 1;
+                break;
+            }
+        } GLYPHS_ITERATOR_END
+    }
+
+    printf( "%-9s %10.2f %8" PRIzu " %8" PRIzu " %10u %8" PRIzu " %6.1f%%\n",
+            evict ? "lru" : "none", (now( ) - start) * 1e3, missed, font->evicted,
+            font->generation, stale, 100.0 * atlas->used / (atlas->width * atlas->height) );
+
+    text_buffer_delete( buffer );
+    texture_font_delete( font );
+    texture_atlas_delete( atlas );
+    return missed;
+}
+
+// ------------------------------------------------------------------- main ---
+int main( int argc, char **argv )
+{
+    const char *filename = argc > 1 ? argv[1] : "fonts/Liberastika-Regular.ttf";
+    texture_atlas_t *atlas = texture_atlas_new( 2048, 2048, 1 );
+    texture_font_t *reference = texture_font_new_from_file( atlas, 16, filename );
+    uint32_t *codepoints = malloc( 0x3000 * sizeof(uint32_t) );
+    size_t count = 0, missed, evicted;
+    char utf8[5];
+    uint32_t c;
+    int failed = 0;
+
+    if( !reference || !codepoints ) {
+        fprintf( stderr, "Cannot load %s\n", filename );
+        return EXIT_FAILURE;
+    }
+    for( c = 0x21; c < 0x3000; c++ ) {
+        if( (c >= 0xD800 && c < 0xE000) || !texture_font_covers( reference, c ) )
+            continue;
+        utf32_to_utf8( c, utf8 );
+        if( !texture_font_get_glyph( reference, utf8 ) ) {
+            fprintf( stderr, "reference atlas full\n" );
+            return EXIT_FAILURE;
+        }
+        codepoints[count++] = c;
+    }
+
+    printf( "%-9s %10s %8s %8s %10s %8s %7s\n",
+            "eviction", "time(ms)", "missed", "evicted", "generation", "stale", "used" );
+    missed = run( filename, codepoints, count, 0, reference, &failed );
+    if( !missed ) {
+        fprintf( stderr, "atlas large enough without eviction\n" );
+        failed = 1;
+    }
+
+    /* Glyphs of the current frame stay where they are and may fragment the
+     * atlas enough for a few others to miss */
+    evicted = run( filename, codepoints, count, 1, reference, &failed );
+    if( evicted * 100 > missed ) {
+        fprintf( stderr, "%" PRIzu " glyphs missed with eviction\n", evicted );
+        failed = 1;
+    }
+
+    free( codepoints );
+    texture_font_delete( reference );
+    texture_atlas_delete( atlas );
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,161 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "freetype-gl.h"
+#include "bench.h"
+
+#define LOOKUPS (1 << 22)
+
+// ------------------------------------------------------------ page_table_t ---
+/* The former glyph storage, kept as a reference: a vector of pages of 256
+ * glyph pointers, indexed by the high bits of the codepoint */
+typedef struct page_table_t
+{
+    vector_t * pages;
+    size_t page_count;
+} page_table_t;
+
+static void
+page_table_insert( page_table_t *self, texture_glyph_t *glyph )
+{
+    uint32_t i = glyph->codepoint >> 8;
+    texture_glyph_t ***page;
+
+    if( self->pages->size <= i )
+        vector_resize( self->pages, i+1 );
+    page = (texture_glyph_t ***) vector_get( self->pages, i );
+    if( !*page ) {
+        *page = calloc( 0x100, sizeof(texture_glyph_t *) );
+        self->page_count++;
+    }
+    (*page)[glyph->codepoint & 0xFF] = glyph;
+}
+
+static texture_glyph_t *
+page_table_find( const page_table_t *self, uint32_t codepoint )
+{
+    uint32_t i = codepoint >> 8;
+    texture_glyph_t **page;
+
+    if( self->pages->size <= i )
+        return NULL;
+    page = *(texture_glyph_t ***) vector_get( self->pages, i );
+    return page ? page[codepoint & 0xFF] : NULL;
+}
+
+static size_t
+page_table_memory( const page_table_t *self )
+{
+    return sizeof(vector_t) + self->pages->capacity * sizeof(texture_glyph_t **)
+        + self->page_count * 0x100 * sizeof(texture_glyph_t *);
+}
+
+static void
+page_table_free( page_table_t *self )
+{
+    size_t i;
+
+    for( i = 0; i < self->pages->size; i++ )
+        free( *(texture_glyph_t ***) vector_get( self->pages, i ) );
+    vector_delete( self->pages );
+}
+
+// --------------------------------------------------------------- workload ---
+/* Run a workload: index `count` glyphs starting at `first`, `stride` apart,
+ * then look up a shuffled mix of present and absent codepoints */
+static int
+workload( const char *name, const char *filename,
+          uint32_t first, uint32_t stride, size_t count )
+{
+    texture_atlas_t *atlas = texture_atlas_new( 64, 64, 1 );
+    texture_font_t *font = texture_font_new_from_file( atlas, 16, filename );
+    page_table_t pages = { vector_new( sizeof(texture_glyph_t **) ), 0 };
+    uint32_t *queries = malloc( LOOKUPS * sizeof(uint32_t) );
+    size_t i, found_hash = 0, found_pages = 0;
+    clock_t start;
+    double t_hash, t_pages;
+    int failed = 0;
+
+    if( !font ) {
+        fprintf( stderr, "Cannot load %s\n", filename );
+        return 1;
+    }
+
+    for( i = 0; i < count; i++ ) {
+        texture_glyph_t *glyph = texture_glyph_new( );
+        glyph->codepoint = first + i * stride;
+        texture_font_index_glyph( font, glyph, glyph->codepoint );
+        page_table_insert( &pages, glyph );
+    }
+
+    /* One query in eight misses, landing between the indexed codepoints */
+    srand( 1 );
+    for( i = 0; i < LOOKUPS; i++ ) {
+        queries[i] = first + (rand() % count) * stride;
+        if( (i & 7) == 7 )
+            queries[i] += stride > 1 ? 1 : count;
+    }
+
+    start = clock();
+    for( i = 0; i < LOOKUPS; i++ )
+        found_hash += texture_font_find_glyph_gi( font, queries[i] ) != NULL;
+    t_hash = (clock() - start) / (double)CLOCKS_PER_SEC;
+
+    start = clock();
+    for( i = 0; i < LOOKUPS; i++ )
+        found_pages += page_table_find( &pages, queries[i] ) != NULL;
+    t_pages = (clock() - start) / (double)CLOCKS_PER_SEC;
+
+    printf( "%-8s %8" PRIzu " %12.2f %12.2f %12" PRIzu " %12" PRIzu "\n",
+            name, count, 1e9 * t_hash / LOOKUPS, 1e9 * t_pages / LOOKUPS,
+            hash_table_memory( font->glyphs ), page_table_memory( &pages ) );
+
+    if( found_hash != found_pages || found_hash != LOOKUPS - LOOKUPS / 8 ) {
+        fprintf( stderr, "%s: lookups disagree (%" PRIzu " vs %" PRIzu ")\n",
+                 name, found_hash, found_pages );
+        failed = 1;
+    }
+    for( i = 0; i < count; i++ ) {
+        uint32_t codepoint = first + i * stride;
+        texture_glyph_t *glyph = texture_font_find_glyph_gi( font, codepoint );
+        if( !glyph || glyph != page_table_find( &pages, codepoint ) ) {
+            fprintf( stderr, "%s: glyph U+%04X not found\n", name, codepoint );
+            failed = 1;
+            break;
+        }
+    }
+    if( vector_glyphs_size( font->glyphs ) != count ) {
+        fprintf( stderr, "%s: %" PRIzu " glyphs iterated, %" PRIzu " indexed\n",
+                 name, vector_glyphs_size( font->glyphs ), count );
+        failed = 1;
+    }
+
+    page_table_free( &pages );
+    free( queries );
+    texture_font_delete( font );
+    texture_atlas_delete( atlas );
+    return failed;
+}
+
+// ------------------------------------------------------------------- main ---
+int main( int argc, char **argv )
+{
+    const char *filename = argc > 1 ? argv[1] : "fonts/Vera.ttf";
+    int failed = 0;
+
+    printf( "%-8s %8s %12s %12s %12s %12s\n", "workload", "glyphs",
+            "hash ns/op", "pages ns/op", "hash bytes", "pages bytes" );
+
+    failed |= workload( "latin", filename, 0x20, 1, 0x250 - 0x20 );
+    failed |= workload( "cjk", filename, 0x4E00, 7, 3000 );
+    failed |= workload( "emoji", filename, 0x1F300, 31, 64 );
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,178 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include "freetype-gl.h"
+#include "utf8-utils.h"
+#include "bench.h"
+
+// ------------------------------------------------------------- charset_new ---
+/* UTF-8 string of (at most) the first `count` codepoints covered by a font */
+static char *
+charset_new( const char *filename, size_t count, size_t *covered )
+{
+    FT_Library library;
+    FT_Face face;
+    FT_ULong c;
+    FT_UInt index;
+    char *text = calloc( count * 4 + 1, 1 ), *p = text;
+
+    *covered = 0;
+    if( FT_Init_FreeType( &library ) )
+        return text;
+    if( !FT_New_Face( library, filename, 0, &face ) ) {
+        for( c = FT_Get_First_Char( face, &index );
+             index && *covered < count;
+             c = FT_Get_Next_Char( face, c, &index ) ) {
+            if( c < 0x20 )
+                continue;
+            p += utf32_to_utf8( c, p );
+            (*covered)++;
+        }
+        FT_Done_Face( face );
+    }
+    FT_Done_FreeType( library );
+    return text;
+}
+
+// ------------------------------------------------------------- load_timed ---
+static double
+load_timed( texture_font_t *font, const char *text, int batch )
+{
+    size_t i;
+    clock_t start = clock();
+
+    if( batch )
+        texture_font_load_glyphs( font, text );
+    else
+        for( i = 0; i < strlen(text); i += utf8_surrogate_len(text + i) )
+            texture_font_load_glyph( font, text + i );
+
+    return (clock() - start) / (double)CLOCKS_PER_SEC;
+}
+
+// --------------------------------------------------------- kerning_memory ---
+/* Bytes allocated for the kerning tables of a font's glyphs */
+static size_t
+kerning_memory( texture_font_t *font )
+{
+    size_t i, j, total = 0;
+    texture_glyph_t *glyph;
+
+    GLYPHS_ITERATOR(i, glyph, font->glyphs) {
+        total += glyph->kerning->capacity * glyph->kerning->item_size;
+        for( j = 0; j < glyph->kerning->size; j++ )
+            if( *(float **) vector_get( glyph->kerning, j ) )
+                total += 0x100 * sizeof(float);
+        if( glyph->kerning_compact )
+            total += glyph->kerning_compact->capacity *
+                glyph->kerning_compact->item_size;
+    }
+    GLYPHS_ITERATOR_END
+    return total;
+}
+
+// ---------------------------------------------------------- kerning_equal ---
+/* Whether both fonts kern all pairs of text alike, within tolerance pixels */
+static int
+kerning_equal( texture_font_t *a, texture_font_t *b, const char *text,
+               float tolerance )
+{
+    float delta;
+    size_t i, j;
+
+    for( i = 0; i < strlen(text); i += utf8_surrogate_len(text + i) ) {
+        texture_glyph_t *ga = texture_font_find_glyph( a, text + i );
+        texture_glyph_t *gb = texture_font_find_glyph( b, text + i );
+        if( !ga || !gb )
+            return 0;
+        for( j = 0; j < strlen(text); j += utf8_surrogate_len(text + j) )
+        {
+            delta = texture_glyph_get_kerning( ga, text + j ) -
+                    texture_glyph_get_kerning( gb, text + j );
+            if( delta > tolerance || delta < -tolerance )
+                return 0;
+        }
+    }
+    return 1;
+}
+
+// ------------------------------------------------------------------- main ---
+int main( int argc, char **argv )
+{
+    const char *filename = argc > 1 ? argv[1] : "fonts/Liberastika-Regular.ttf";
+    size_t max_count = argc > 2 ? atoi( argv[2] ) : 1024;
+    size_t count, covered;
+    int failed = 0;
+
+    printf( "%8s %12s %12s %12s %12s %14s %14s %12s %12s\n", "glyphs",
+            "single (s)", "batch (s)", "lazy (s)", "compact (s)",
+            "single us/gl", "batch us/gl", "pages KB", "compact KB" );
+
+    for( count = 64; count <= max_count; count *= 2 ) {
+        char *text = charset_new( filename, count, &covered );
+        texture_atlas_t *atlas_a = texture_atlas_new( 2048, 2048, 1 );
+        texture_atlas_t *atlas_b = texture_atlas_new( 2048, 2048, 1 );
+        texture_atlas_t *atlas_c = texture_atlas_new( 2048, 2048, 1 );
+        texture_atlas_t *atlas_d = texture_atlas_new( 2048, 2048, 1 );
+        texture_font_t *single = texture_font_new_from_file( atlas_a, 16, filename );
+        texture_font_t *batch = texture_font_new_from_file( atlas_b, 16, filename );
+        texture_font_t *lazy = texture_font_new_from_file( atlas_c, 16, filename );
+        texture_font_t *compact = texture_font_new_from_file( atlas_d, 16, filename );
+        double t_single, t_batch, t_lazy, t_compact;
+
+        if( !single || !batch || !lazy || !compact ) {
+            fprintf( stderr, "Cannot load %s\n", filename );
+            return EXIT_FAILURE;
+        }
+
+        t_single = load_timed( single, text, 0 );
+        t_batch = load_timed( batch, text, 1 );
+        lazy->kerning_mode = KERNING_LAZY;
+        t_lazy = load_timed( lazy, text, 1 );
+        compact->kerning_mode = KERNING_COMPACT;
+        t_compact = load_timed( compact, text, 1 );
+
+        printf( "%8" PRIzu " %12.4f %12.4f %12.4f %12.4f %14.2f %14.2f %12.1f %12.1f\n",
+                covered, t_single, t_batch, t_lazy, t_compact,
+                1e6 * t_single / covered, 1e6 * t_batch / covered,
+                kerning_memory( batch ) / 1024.0, kerning_memory( compact ) / 1024.0 );
+
+        if( !kerning_equal( single, batch, text, 0 ) ) {
+            fprintf( stderr, "Kerning differs between single and batch loads\n" );
+            failed = 1;
+        }
+        if( !kerning_equal( single, lazy, text, 0 ) ) {
+            fprintf( stderr, "Kerning differs between eager and lazy modes\n" );
+            failed = 1;
+        }
+        if( !kerning_equal( single, compact, text, 0.5f / KERNING_COMPACT_SCALE ) ) {
+            fprintf( stderr, "Kerning differs between eager and compact modes\n" );
+            failed = 1;
+        }
+
+        texture_font_delete( single );
+        texture_font_delete( batch );
+        texture_font_delete( lazy );
+        texture_font_delete( compact );
+        texture_atlas_delete( atlas_a );
+        texture_atlas_delete( atlas_b );
+        texture_atlas_delete( atlas_c );
+        texture_atlas_delete( atlas_d );
+        free( text );
+
+        if( covered < count )
+            break;
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
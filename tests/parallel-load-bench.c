@@ -0,0 +1,161 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include "freetype-gl.h"
+#include "utf8-utils.h"
+#include "bench.h"
+
+// ------------------------------------------------------------- codepoints ---
+/* Every codepoint a font covers, as UTF-8, followed by a few it lacks and
+ * some repeated ones */
+static char *
+codepoints_new( const char *filename )
+{
+    FT_Library library;
+    FT_Face face;
+    FT_ULong c;
+    FT_UInt index;
+    uint32_t extra[] = { 0xE000, 'A', 0xE001, 0x10FFFD, 'A', 0xE000 };
+    char *text = NULL, *p;
+    size_t i, count = 0;
+
+    if( FT_Init_FreeType( &library ) )
+        return NULL;
+    if( !FT_New_Face( library, filename, 0, &face ) ) {
+        p = text = malloc( (face->num_glyphs + 6) * 4 + 1 );
+        for( c = FT_Get_First_Char( face, &index );
+             index && count < (size_t) face->num_glyphs;
+             c = FT_Get_Next_Char( face, c, &index ), count++ )
+            p += utf32_to_utf8( c, p );
+        for( i = 0; i < sizeof(extra) / sizeof(extra[0]); i++ )
+            p += utf32_to_utf8( extra[i], p );
+        *p = 0;
+        FT_Done_Face( face );
+    }
+    FT_Done_FreeType( library );
+    return text;
+}
+
+// ------------------------------------------------------------------- load ---
+static texture_font_t *
+load( const char *filename, const char *text, size_t threads,
+      rendermode_t rendermode, double *elapsed, size_t *missed )
+{
+    texture_atlas_t *atlas = texture_atlas_new( 1024, 1024, 1 );
+    texture_font_t *font = texture_font_new_from_file( atlas, 16, filename );
+    double start;
+
+    if( !font )
+        return NULL;
+    font->threads = threads;
+    font->rendermode = rendermode;
+    font->outline_thickness = rendermode == RENDER_NORMAL ? 0 : 1;
+
+    start = now();
+    *missed = texture_font_load_glyphs( font, text );
+    *elapsed = now() - start;
+    return font;
+}
+
+// ---------------------------------------------------------------- compare ---
+/* The parallel load must leave the same atlas and glyphs as the serial one */
+static int
+compare( const texture_font_t *serial, const texture_font_t *parallel,
+         const char *text )
+{
+    const texture_atlas_t *a = serial->atlas, *b = parallel->atlas;
+    size_t i;
+
+    if( memcmp( a->data, b->data, a->width * a->height * a->depth ) ||
+        a->used != b->used ) {
+        fprintf( stderr, "Atlases differ\n" );
+        return 1;
+    }
+    if( vector_glyphs_size( serial->glyphs ) !=
+        vector_glyphs_size( parallel->glyphs ) ) {
+        fprintf( stderr, "Glyph counts differ\n" );
+        return 1;
+    }
+    for( i = 0; text[i]; i += utf8_surrogate_len( text + i ) ) {
+        texture_glyph_t *g = texture_font_find_glyph( (texture_font_t *) serial, text + i );
+        texture_glyph_t *h = texture_font_find_glyph( (texture_font_t *) parallel, text + i );
+
+        if( !g || !h || g->codepoint != h->codepoint ||
+            g->x != h->x || g->y != h->y ||
+            g->width != h->width || g->height != h->height ||
+            g->offset_x != h->offset_x || g->offset_y != h->offset_y ||
+            g->advance_x != h->advance_x || g->advance_y != h->advance_y ||
+            g->s0 != h->s0 || g->t1 != h->t1 ||
+            texture_glyph_get_kerning( g, "A" ) != texture_glyph_get_kerning( h, "A" ) ) {
+            fprintf( stderr, "Glyph U+%04X differs\n", utf8_to_utf32( text + i ) );
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// ------------------------------------------------------------------- main ---
+int main( int argc, char **argv )
+{
+    const char *filename = argc > 1 ? argv[1] : "fonts/Liberastika-Regular.ttf";
+    char *text = codepoints_new( filename );
+    rendermode_t modes[] = { RENDER_NORMAL, RENDER_OUTLINE_EDGE };
+    size_t threads[] = { 2, 4 };
+    int failed = 0, mode, t;
+
+    if( !text ) {
+        fprintf( stderr, "Cannot load %s\n", filename );
+        return EXIT_FAILURE;
+    }
+
+    printf( "%-8s %8s %8s %12s %8s\n", "mode", "threads", "glyphs", "load (ms)", "speedup" );
+    for( mode = 0; mode < 2; mode++ ) {
+        double t_serial, t_parallel;
+        size_t missed_serial, missed_parallel;
+        texture_atlas_t *atlas;
+        texture_font_t *serial = load( filename, text, 1, modes[mode],
+                                       &t_serial, &missed_serial );
+
+        if( !serial ) {
+            fprintf( stderr, "Cannot load %s\n", filename );
+            return EXIT_FAILURE;
+        }
+        printf( "%-8s %8d %8" PRIzu " %12.2f %8.2f\n", mode ? "outline" : "normal",
+                1, vector_glyphs_size( serial->glyphs ), t_serial * 1e3, 1.0 );
+
+        for( t = 0; t < 2; t++ ) {
+            texture_font_t *parallel = load( filename, text, threads[t], modes[mode],
+                                             &t_parallel, &missed_parallel );
+
+            printf( "%-8s %8" PRIzu " %8" PRIzu " %12.2f %8.2f\n",
+                    mode ? "outline" : "normal", threads[t],
+                    vector_glyphs_size( parallel->glyphs ),
+                    t_parallel * 1e3, t_serial / t_parallel );
+            if( missed_serial != missed_parallel ) {
+                fprintf( stderr, "Missed %" PRIzu " glyphs instead of %" PRIzu "\n",
+                         missed_parallel, missed_serial );
+                failed = 1;
+            }
+            failed |= compare( serial, parallel, text );
+
+            atlas = parallel->atlas;
+            texture_font_delete( parallel );
+            texture_atlas_delete( atlas );
+        }
+        atlas = serial->atlas;
+        texture_font_delete( serial );
+        texture_atlas_delete( atlas );
+    }
+
+    free( text );
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,154 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freetype-gl.h"
+#include "pixel-convert.h"
+#include "bench.h"
+
+/* Pixels converted per timed call, about a large color glyph */
+#define PIXELS (128 * 128)
+
+/* Timed calls */
+#define ROUNDS 200
+
+typedef void (*convert_t)( unsigned char *, const unsigned char *, size_t );
+
+static const struct {
+    const char *name;
+    convert_t convert;
+    size_t src_depth, dst_depth;
+} kernels[] = {
+    { "bgra->rgba", pixel_convert_bgra_to_rgba, 4, 4 },
+    { "bgra->grey", pixel_convert_bgra_to_grey, 4, 1 },
+    { "grey->rgba", pixel_convert_grey_to_rgba, 1, 4 },
+};
+
+// ----------------------------------------------------------------- exact ---
+/* The scalar kernels against their definition */
+static int
+exact( void )
+{
+    unsigned char bgra[4], grey, rgba[4];
+    unsigned int luma, a;
+
+    /* Luminosity times alpha, rounded: grey pixels make the luminosity
+     * exact, so every product is checked */
+    for( luma = 0; luma < 256; luma++ ) {
+        for( a = 0; a < 256; a++ ) {
+            bgra[0] = bgra[1] = bgra[2] = (unsigned char) luma;
+            bgra[3] = (unsigned char) a;
+            pixel_convert_bgra_to_grey( &grey, bgra, 1 );
+            if( grey != (2 * luma * a + 255) / 510 ) {
+                fprintf( stderr, "grey of %u at alpha %u is %u\n", luma, a, grey );
+                return 1;
+            }
+        }
+    }
+
+    /* Pure colors */
+    memcpy( bgra, "\x00\x00\xff\xff", 4 );
+    pixel_convert_bgra_to_grey( &grey, bgra, 1 );
+    pixel_convert_bgra_to_rgba( rgba, bgra, 1 );
+    if( grey != 77 || memcmp( rgba, "\xff\x00\x00\xff", 4 ) ) {
+        fprintf( stderr, "red converted to %u, %02x%02x%02x%02x\n",
+                 grey, rgba[0], rgba[1], rgba[2], rgba[3] );
+        return 1;
+    }
+    grey = 0x80;
+    pixel_convert_grey_to_rgba( rgba, &grey, 1 );
+    if( memcmp( rgba, "\xff\xff\xff\x80", 4 ) ) {
+        fprintf( stderr, "grey converted to %02x%02x%02x%02x\n",
+                 rgba[0], rgba[1], rgba[2], rgba[3] );
+        return 1;
+    }
+    return 0;
+}
+
+// ------------------------------------------------------------------- main ---
+int main( void )
+{
+    pixel_isa_t isas[] = { PIXEL_ISA_SCALAR, PIXEL_ISA_SSE2, PIXEL_ISA_AVX2, PIXEL_ISA_NEON };
+    pixel_isa_t best = pixel_convert_get_isa( );
+    unsigned char *src = malloc( 4 * PIXELS + 64 );
+    unsigned char *expected = malloc( 4 * PIXELS + 64 );
+    unsigned char *dst = malloc( 4 * PIXELS + 64 );
+    double scalar[3] = { 0 };
+    size_t i, k, n, count;
+    int failed = 0;
+
+    if( !src || !expected || !dst )
+        return EXIT_FAILURE;
+    srand( 42 );
+    for( i = 0; i < 4 * PIXELS + 64; i++ )
+        src[i] = (unsigned char) rand( );
+
+    pixel_convert_set_isa( PIXEL_ISA_SCALAR );
+    failed |= exact( );
+
+    printf( "best instruction set: %s\n", pixel_convert_isa_name( best ) );
+    printf( "%-8s %-12s %10s %8s\n", "isa", "kernel", "Mpixel/s", "speedup" );
+    for( i = 0; i < sizeof(isas) / sizeof(isas[0]); i++ ) {
+        if( !pixel_convert_supports( isas[i] ) )
+            continue;
+
+        for( k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++ ) {
+            size_t dst_depth = kernels[k].dst_depth;
+            double start, elapsed;
+
+            /* Same bytes as the scalar kernel, whatever the length and the
+             * alignment, in place too for the swizzle */
+            for( count = 0; count < 80 && !failed; count++ ) {
+                for( n = 0; n < 3; n++ ) {
+                    const unsigned char *in = src + n * kernels[k].src_depth;
+
+                    pixel_convert_set_isa( PIXEL_ISA_SCALAR );
+                    kernels[k].convert( expected, in, count );
+                    pixel_convert_set_isa( isas[i] );
+                    memset( dst, 0xAA, 4 * 80 + 8 );
+                    kernels[k].convert( dst + n, in, count );
+                    if( memcmp( dst + n, expected, count * dst_depth ) ||
+                        dst[n + count * dst_depth] != 0xAA ) {
+                        fprintf( stderr, "%s %s: %" PRIzu " pixels differ\n",
+                                 pixel_convert_isa_name( isas[i] ), kernels[k].name, count );
+                        failed = 1;
+                        break;
+                    }
+                }
+            }
+            if( kernels[k].src_depth == dst_depth && !failed ) {
+                memcpy( dst, src, 4 * PIXELS );
+                kernels[k].convert( dst, dst, PIXELS );
+                pixel_convert_set_isa( PIXEL_ISA_SCALAR );
+                kernels[k].convert( expected, src, PIXELS );
+                pixel_convert_set_isa( isas[i] );
+                if( memcmp( dst, expected, 4 * PIXELS ) ) {
+                    fprintf( stderr, "%s %s: in place conversion differs\n",
+                             pixel_convert_isa_name( isas[i] ), kernels[k].name );
+                    failed = 1;
+                }
+            }
+
+            start = now( );
+            for( n = 0; n < ROUNDS; n++ )
+                kernels[k].convert( dst, src, PIXELS );
+            elapsed = now( ) - start;
+            if( isas[i] == PIXEL_ISA_SCALAR )
+                scalar[k] = elapsed;
+            printf( "%-8s %-12s %10.1f %8.2f\n", pixel_convert_isa_name( isas[i] ),
+                    kernels[k].name, (double) ROUNDS * PIXELS / elapsed * 1e-6,
+                    scalar[k] / elapsed );
+        }
+    }
+    pixel_convert_set_isa( best );
+
+    free( src );
+    free( expected );
+    free( dst );
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,92 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freetype-gl.h"
+#include "utf8-utils.h"
+#include "bench.h"
+
+/* Glyphs loaded in every pass */
+static const char *text =
+    " !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`"
+    "abcdefghijklmnopqrstuvwxyz{|}~\xc3\xa0\xc3\xa9\xc3\xa8\xc3\xaf\xc3\xb4\xc3\xbc";
+
+// ------------------------------------------------------------------- pass ---
+/* Load the text in a render mode, returns the allocations it took */
+static size_t
+pass( texture_font_t *font, const char *name, rendermode_t rendermode,
+      float outline_thickness )
+{
+    size_t allocations = font->raster ? font->raster->allocations : 0;
+    size_t count = utf8_strlen( text );
+    double start;
+
+    font->rendermode = rendermode;
+    font->outline_thickness = outline_thickness;
+    start = now();
+    if( texture_font_load_glyphs( font, text ) ) {
+        fprintf( stderr, "%s: atlas full\n", name );
+        exit( EXIT_FAILURE );
+    }
+    allocations = font->raster->allocations - allocations;
+    printf( "%-24s %5" PRIzu " %10.2f %12" PRIzu " %10" PRIzu "\n", name,
+            (size_t) font->atlas->depth,
+            (now() - start) * 1e6 / count, allocations, font->raster->capacity );
+    return allocations;
+}
+
+// ------------------------------------------------------------------- main ---
+int main( int argc, char **argv )
+{
+    const char *filename = argc > 1 ? argv[1] : "fonts/Vera.ttf";
+    size_t depths[] = { 1, 3 };
+    int failed = 0;
+    size_t d;
+
+    printf( "%-24s %5s %10s %12s %10s\n",
+            "pass", "depth", "us/glyph", "allocations", "scratch" );
+    for( d = 0; d < sizeof(depths) / sizeof(depths[0]); d++ ) {
+        texture_atlas_t *atlas = texture_atlas_new( 1024, 1024, depths[d] );
+        texture_font_t *font = texture_font_new_from_file( atlas, 32, filename );
+
+        if( !font ) {
+            fprintf( stderr, "Cannot load %s\n", filename );
+            return EXIT_FAILURE;
+        }
+        font->threads = 1;
+
+        /* The largest glyphs first: the stroker is created and the scratch
+         * bitmap grows to them, then nothing else is allocated */
+        pass( font, "outline 2 (warm-up)", RENDER_OUTLINE_EDGE, 2 );
+        if( pass( font, "outline 1", RENDER_OUTLINE_EDGE, 1 ) ||
+            pass( font, "outline positive 1", RENDER_OUTLINE_POSITIVE, 1 ) ||
+            pass( font, "outline negative 1.5", RENDER_OUTLINE_NEGATIVE, 1.5f ) ||
+            pass( font, "normal", RENDER_NORMAL, 0 ) ) {
+            fprintf( stderr, "allocations after warm-up at depth %" PRIzu "\n", depths[d] );
+            failed = 1;
+        }
+
+        /* The stroker, then the scratch bitmap doubling */
+        if( font->raster->allocations > 16 ) {
+            fprintf( stderr, "%" PRIzu " allocations during warm-up\n",
+                     font->raster->allocations );
+            failed = 1;
+        }
+
+        /* The LCD filter is set once on the library */
+        if( depths[d] == 3 && font->library->lcd_filter != 2 ) {
+            fprintf( stderr, "LCD filter weights not recorded\n" );
+            failed = 1;
+        }
+
+        texture_font_delete( font );
+        texture_atlas_delete( atlas );
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,214 @@
+/* Freetype GL - A C OpenGL Freetype engine
+ *
+ * Distributed under the OSI-approved BSD 2-Clause License.  See accompanying
+ * file `LICENSE` for more details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "freetype-gl.h"
+#include "utf8-utils.h"
+#include "bench.h"
+
+static const float sizes[] = { 9, 12, 16, 24 };
+#define SIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+/* Widths of the atlases the glyphs are packed in, the wider the more
+ * nodes in their skyline */
+static const size_t atlases[] = { 2048, 8192 };
+#define ATLASES (sizeof(atlases) / sizeof(atlases[0]))
+
+// ---------------------------------------------------------------- linear ---
+/* The skyline packer trying every node and merging the whole skyline after
+ * each region, as texture_atlas_get_region did before, placements being
+ * compared with it */
+typedef struct {
+    vector_t *nodes;
+    size_t width, height, spacing_horiz, spacing_vert;
+} linear_t;
+
+static int
+linear_fit( linear_t *self, size_t index, size_t width, size_t height )
+{
+    ivec3 *node = (ivec3 *) vector_get( self->nodes, index );
+    int x = node->x, y = node->y, width_left = width;
+    size_t i = index;
+
+    if( x + width > self->width - 1 )
+        return -1;
+    while( width_left > 0 ) {
+        node = (ivec3 *) vector_get( self->nodes, i );
+        if( node->y > y )
+            y = node->y;
+        if( y + height > self->height - 1 )
+            return -1;
+        width_left -= node->z;
+        ++i;
+    }
+    return y;
+}
+
+static ivec4
+linear_get_region( linear_t *self, size_t width, size_t height )
+{
+    size_t best_height = UINT_MAX, best_width = UINT_MAX, i;
+    int y, best_index = -1;
+    ivec3 *node, *prev, added;
+    ivec4 region = {{0, 0, width, height}};
+
+    for( i = 0; i < self->nodes->size; ++i ) {
+        size_t awidth = width + self->spacing_horiz, aheight = height + self->spacing_vert;
+
+        node = (ivec3 *) vector_get( self->nodes, i );
+        y = linear_fit( self, i, awidth, aheight );
+        if( y < 0 && self->spacing_vert > 0 )
+            y = linear_fit( self, i, awidth, aheight = height );
+        if( node->x + awidth > self->width - 1 ) {
+            if( y < 0 && self->spacing_horiz > 0 )
+                y = linear_fit( self, i, awidth = width, aheight = height + self->spacing_vert );
+            if( y < 0 && self->spacing_horiz > 0 && self->spacing_vert > 0 )
+                y = linear_fit( self, i, awidth = width, aheight = height );
+        }
+        if( y >= 0 ) {
+            if( y + aheight < best_height ||
+                (y + aheight == best_height && node->z > 0 && (size_t) node->z < best_width) ) {
+                best_height = y + aheight;
+                best_index = i;
+                best_width = node->z;
+                region.x = node->x;
+                region.y = y;
+                region.width = awidth;
+                region.height = aheight;
+            }
+        }
+    }
+    if( best_index < 0 )
+        return (ivec4){{-1, -1, 0, 0}};
+    if( !region.width )
+        return region;
+
+    added.x = region.x;
+    added.y = region.y + region.height;
+    added.z = region.width;
+    vector_insert( self->nodes, best_index, &added );
+    for( i = best_index + 1; i < self->nodes->size; ++i ) {
+        node = (ivec3 *) vector_get( self->nodes, i );
+        prev = (ivec3 *) vector_get( self->nodes, i - 1 );
+        if( node->x >= prev->x + prev->z )
+            break;
+        node->z -= prev->x + prev->z - node->x;
+        node->x = prev->x + prev->z;
+        if( node->z > 0 )
+            break;
+        vector_erase( self->nodes, i-- );
+    }
+    for( i = 0; i + 1 < self->nodes->size; ++i ) {
+        node = (ivec3 *) vector_get( self->nodes, i );
+        prev = (ivec3 *) vector_get( self->nodes, i + 1 );
+        if( node->y == prev->y ) {
+            node->z += prev->z;
+            vector_erase( self->nodes, i + 1 );
+            --i;
+        }
+    }
+    return region;
+}
+
+// ------------------------------------------------------------------- run ---
+/* Pack the sizes both ways, returns 0 if placements differ */
+static int
+run( const ivec2 *glyphs, size_t count, size_t size, size_t spacing )
+{
+    texture_atlas_t *atlas = texture_atlas_new( size, size, 1 );
+    ivec3 node = {{1, 1, (int) size - 2}};
+    linear_t linear = { vector_new( sizeof(ivec3) ), size, size, 0, 0 };
+    ivec4 *pruned = malloc( count * sizeof(ivec4) ), region;
+    double start, time_pruned, time_linear;
+    size_t i, packed = 0;
+    int same = 1;
+
+    /* Both start from the skyline of a new atlas, with its special region */
+    vector_push_back( linear.nodes, &node );
+    linear_get_region( &linear, 5, 5 );
+    linear.spacing_horiz = linear.spacing_vert = spacing;
+    atlas->spacing_horiz = atlas->spacing_vert = spacing;
+
+    start = now( );
+    for( i = 0; i < count; i++ )
+        pruned[i] = texture_atlas_get_region( atlas, glyphs[i].x, glyphs[i].y );
+    time_pruned = now( ) - start;
+
+    start = now( );
+    for( i = 0; i < count; i++ ) {
+        region = linear_get_region( &linear, glyphs[i].x, glyphs[i].y );
+        if( memcmp( &region, pruned + i, sizeof(region) ) && same ) {
+            fprintf( stderr, "glyph %" PRIzu " of %dx%d at %d,%d instead of %d,%d\n",
+                     i, glyphs[i].x, glyphs[i].y, pruned[i].x, pruned[i].y,
+                     region.x, region.y );
+            same = 0;
+        }
+        packed += region.x >= 0;
+    }
+    time_linear = now( ) - start;
+
+    printf( "%6" PRIzu " %7" PRIzu " %8" PRIzu " %8" PRIzu " %11.2f %11.2f %8.1f\n",
+            size, spacing, packed, vector_size( atlas->nodes ), time_linear * 1e3,
+            time_pruned * 1e3, time_linear / time_pruned );
+
+    free( pruned );
+    vector_delete( linear.nodes );
+    texture_atlas_delete( atlas );
+    return same;
+}
+
+// ------------------------------------------------------------------- main ---
+int main( void )
+{
+    texture_atlas_t *atlas = texture_atlas_new( 4096, 4096, 1 );
+    ivec2 *glyphs = malloc( BENCH_FONTS * SIZES * 0x3000 * sizeof(ivec2) );
+    size_t count = 0, i, k, a;
+    int failed = 0;
+    char utf8[5];
+    uint32_t c;
+
+    /* The sizes of the glyphs of real fonts, in codepoint order as text
+     * would load them */
+    for( i = 0; i < BENCH_FONTS; i++ ) {
+        for( k = 0; k < SIZES; k++ ) {
+            texture_font_t *font = texture_font_new_from_file( atlas, sizes[k], bench_fonts[i] );
+            texture_glyph_t *glyph;
+
+            if( !font ) {
+                fprintf( stderr, "Cannot load %s\n", bench_fonts[i] );
+                return EXIT_FAILURE;
+            }
+            for( c = 0x21; c < 0x3000; c++ ) {
+                if( (c >= 0xD800 && c < 0xE000) || !texture_font_covers( font, c ) )
+                    continue;
+                utf32_to_utf8( c, utf8 );
+                if( !(glyph = texture_font_get_glyph( font, utf8 )) ) {
+                    fprintf( stderr, "atlas full\n" );
+                    return EXIT_FAILURE;
+                }
+                glyphs[count].x = glyph->width;
+                glyphs[count++].y = glyph->height;
+            }
+            texture_font_delete( font );
+            texture_atlas_clear( atlas );
+        }
+    }
+    texture_atlas_delete( atlas );
+
+    printf( "%" PRIzu " glyphs\n", count );
+    printf( "%6s %7s %8s %8s %11s %11s %8s\n",
+            "atlas", "spacing", "packed", "nodes", "before(ms)", "after(ms)", "speedup" );
+    for( a = 0; a < ATLASES; a++ )
+        for( i = 0; i < 3; i++ )
+            if( !run( glyphs, count, atlases[a], i ) )
+                failed = 1;
+
+    free( glyphs );
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -14,12 +14,12 @@
 #include "utf8-utils.h"
 #include "ftgl-utils.h"
 
-#define SET_GLYPH_VERTEX(value,x0,y0,z0,s0,t0,r,g,b,a,sh,gm) { \
+#define SET_GLYPH_VERTEX(value,x0,y0,z0,s0,t0,r,g,b,a,sh,gm,ly,ch) { \
     glyph_vertex_t *gv=&value;				       \
     gv->x=x0; gv->y=y0; gv->z=z0;			       \
     gv->u=s0; gv->v=t0;					       \
     gv->r=r; gv->g=g; gv->b=b; gv->a=a;			       \
-    gv->shift=sh; gv->gamma=gm;}
+    gv->shift=sh; gv->gamma=gm; gv->layer=ly; gv->channel=ch;}
 
 // ----------------------------------------------------------------------------
 
@@ -28,7 +28,7 @@ text_buffer_new( )
 {
     text_buffer_t *self = (text_buffer_t *) malloc (sizeof(text_buffer_t));
     self->buffer = vertex_buffer_new(
-                                     "vertex:3f,tex_coord:2f,color:4f,ashift:1f,agamma:1f" );
+                                     "vertex:3f,tex_coord:2f,color:4f,ashift:1f,agamma:1f,alayer:1f,achannel:1f" );
     self->line_start = 0;
     self->line_ascender = 0;
     self->base_color.r = 0.0;
@@ -37,6 +37,7 @@ text_buffer_new( )
     self->base_color.a = 1.0;
     self->line_descender = 0;
     self->lines = vector_new( sizeof(line_info_t) );
+    self->fonts = vector_new( sizeof(text_buffer_font_t) );
     self->bounds.left   = 0.0;
     self->bounds.top    = 0.0;
     self->bounds.width  = 0.0;
@@ -49,6 +50,7 @@ void
 text_buffer_delete( text_buffer_t * self )
 {
     vector_delete( self->lines );
+    vector_delete( self->fonts );
     vertex_buffer_delete( self->buffer );
     free( self );
 }
@@ -64,12 +66,94 @@ text_buffer_clear( text_buffer_t * self )
     self->line_ascender = 0;
     self->line_descender = 0;
     vector_clear( self->lines );
+    vector_clear( self->fonts );
     self->bounds.left   = 0.0;
     self->bounds.top    = 0.0;
     self->bounds.width  = 0.0;
     self->bounds.height = 0.0;
 }
 
+// ----------------------------------------------------------------------------
+int
+text_buffer_is_stale( const text_buffer_t * self )
+{
+    const text_buffer_font_t *used;
+    size_t i;
+
+    assert( self );
+
+    for( i = 0; i < vector_size( self->fonts ); ++i )
+    {
+        used = (const text_buffer_font_t *) vector_get( self->fonts, i );
+        if( used->font->generation != used->generation )
+            return 1;
+    }
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+void
+text_buffer_remap( text_buffer_t * self,
+                   const vector_t * remap,
+                   const texture_atlas_t * atlas )
+{
+    const texture_atlas_remap_t *move;
+    glyph_vertex_t *vertices;
+    text_buffer_font_t *used;
+    float ds, dt;
+    size_t i, k;
+
+    assert( self );
+    assert( remap );
+    assert( atlas );
+
+    /* Quads move with the region of their top left corner, those of empty
+     * glyphs staying */
+    vertices = (glyph_vertex_t *) self->buffer->vertices->items;
+    for( i = 0; i + 3 < vector_size( self->buffer->vertices ); i += 4 )
+    {
+        if( vertices[i].u == vertices[i+2].u || vertices[i].v == vertices[i+2].v )
+            continue;
+        move = texture_atlas_remap_find( remap,
+                                         (int) (vertices[i].u * atlas->width + .5f),
+                                         (int) (vertices[i].v * atlas->height + .5f) );
+        if( !move )
+            continue;
+        ds = (move->to.x - move->from.x) / (float) atlas->width;
+        dt = (move->to.y - move->from.y) / (float) atlas->height;
+        for( k = i; k < i + 4; ++k )
+        {
+            vertices[k].u += ds;
+            vertices[k].v += dt;
+        }
+    }
+    self->buffer->state = 1;
+
+    /* Fonts current before the repack are current again */
+    for( i = 0; i < vector_size( self->fonts ); ++i )
+    {
+        used = (text_buffer_font_t *) vector_get( self->fonts, i );
+        if( used->generation + 1 == used->font->generation )
+            used->generation = used->font->generation;
+    }
+}
+
+// ----------------------------------------------------------------------------
+/* Remember the generation of a font when its first glyph is added */
+static void
+text_buffer_use_font( text_buffer_t * self, texture_font_t * font )
+{
+    text_buffer_font_t used;
+    size_t i;
+
+    for( i = 0; i < vector_size( self->fonts ); ++i )
+        if( ((text_buffer_font_t *) vector_get( self->fonts, i ))->font == font )
+            return;
+    used.font = font;
+    used.generation = font->generation;
+    vector_push_back( self->fonts, &used );
+}
+
 // ----------------------------------------------------------------------------
 void
 text_buffer_printf( text_buffer_t * self, vec2 *pen, ... )
@@ -253,6 +337,8 @@ text_buffer_add_char( text_buffer_t * self,
     texture_glyph_t *black;
     float kerning = 0.0f;
 
+    text_buffer_use_font( self, font );
+
     if( markup->font->ascender > self->line_ascender )
     {
         float y = pen->y;
@@ -300,15 +386,17 @@ text_buffer_add_char( text_buffer_t * self,
         float t0 = black->t0;
         float s1 = black->s1;
         float t1 = black->t1;
+        float layer = black->page;
+        float channel = black->channel;
 
         SET_GLYPH_VERTEX(vertices[vcount+0],
-                         (float)(int)x0,y0,0,  s0,t0,  r,g,b,a,  x0-((int)x0), gamma );
+                         (float)(int)x0,y0,0,  s0,t0,  r,g,b,a,  x0-((int)x0), gamma, layer, channel );
         SET_GLYPH_VERTEX(vertices[vcount+1],
-                         (float)(int)x0,y1,0,  s0,t1,  r,g,b,a,  x0-((int)x0), gamma );
+                         (float)(int)x0,y1,0,  s0,t1,  r,g,b,a,  x0-((int)x0), gamma, layer, channel );
         SET_GLYPH_VERTEX(vertices[vcount+2],
-                         (float)(int)x1,y1,0,  s1,t1,  r,g,b,a,  x1-((int)x1), gamma );
+                         (float)(int)x1,y1,0,  s1,t1,  r,g,b,a,  x1-((int)x1), gamma, layer, channel );
         SET_GLYPH_VERTEX(vertices[vcount+3],
-                         (float)(int)x1,y0,0,  s1,t0,  r,g,b,a,  x1-((int)x1), gamma );
+                         (float)(int)x1,y0,0,  s1,t0,  r,g,b,a,  x1-((int)x1), gamma, layer, channel );
         indices[icount + 0] = vcount+0;
         indices[icount + 1] = vcount+1;
         indices[icount + 2] = vcount+2;
@@ -334,15 +422,17 @@ text_buffer_add_char( text_buffer_t * self,
         float t0 = black->t0;
         float s1 = black->s1;
         float t1 = black->t1;
+        float layer = black->page;
+        float channel = black->channel;
 
         SET_GLYPH_VERTEX(vertices[vcount+0],
-                         (float)(int)x0,y0,0,  s0,t0,  r,g,b,a,  x0-((int)x0), gamma );
+                         (float)(int)x0,y0,0,  s0,t0,  r,g,b,a,  x0-((int)x0), gamma, layer, channel );
         SET_GLYPH_VERTEX(vertices[vcount+1],
-                         (float)(int)x0,y1,0,  s0,t1,  r,g,b,a,  x0-((int)x0), gamma );
+                         (float)(int)x0,y1,0,  s0,t1,  r,g,b,a,  x0-((int)x0), gamma, layer, channel );
         SET_GLYPH_VERTEX(vertices[vcount+2],
-                         (float)(int)x1,y1,0,  s1,t1,  r,g,b,a,  x1-((int)x1), gamma );
+                         (float)(int)x1,y1,0,  s1,t1,  r,g,b,a,  x1-((int)x1), gamma, layer, channel );
         SET_GLYPH_VERTEX(vertices[vcount+3],
-                         (float)(int)x1,y0,0,  s1,t0,  r,g,b,a,  x1-((int)x1), gamma );
+                         (float)(int)x1,y0,0,  s1,t0,  r,g,b,a,  x1-((int)x1), gamma, layer, channel );
         indices[icount + 0] = vcount+0;
         indices[icount + 1] = vcount+1;
         indices[icount + 2] = vcount+2;
@@ -368,14 +458,16 @@ text_buffer_add_char( text_buffer_t * self,
         float t0 = black->t0;
         float s1 = black->s1;
         float t1 = black->t1;
+        float layer = black->page;
+        float channel = black->channel;
         SET_GLYPH_VERTEX(vertices[vcount+0],
-                         (float)(int)x0,y0,0,  s0,t0,  r,g,b,a,  x0-((int)x0), gamma );
+                         (float)(int)x0,y0,0,  s0,t0,  r,g,b,a,  x0-((int)x0), gamma, layer, channel );
         SET_GLYPH_VERTEX(vertices[vcount+1],
-                         (float)(int)x0,y1,0,  s0,t1,  r,g,b,a,  x0-((int)x0), gamma );
+                         (float)(int)x0,y1,0,  s0,t1,  r,g,b,a,  x0-((int)x0), gamma, layer, channel );
         SET_GLYPH_VERTEX(vertices[vcount+2],
-                         (float)(int)x1,y1,0,  s1,t1,  r,g,b,a,  x1-((int)x1), gamma );
+                         (float)(int)x1,y1,0,  s1,t1,  r,g,b,a,  x1-((int)x1), gamma, layer, channel );
         SET_GLYPH_VERTEX(vertices[vcount+3],
-                         (float)(int)x1,y0,0,  s1,t0,  r,g,b,a,  x1-((int)x1), gamma );
+                         (float)(int)x1,y0,0,  s1,t0,  r,g,b,a,  x1-((int)x1), gamma, layer, channel );
         indices[icount + 0] = vcount+0;
         indices[icount + 1] = vcount+1;
         indices[icount + 2] = vcount+2;
@@ -401,14 +493,16 @@ text_buffer_add_char( text_buffer_t * self,
         float t0 = black->t0;
         float s1 = black->s1;
         float t1 = black->t1;
+        float layer = black->page;
+        float channel = black->channel;
         SET_GLYPH_VERTEX(vertices[vcount+0],
-                         (float)(int)x0,y0,0,  s0,t0,  r,g,b,a,  x0-((int)x0), gamma );
+                         (float)(int)x0,y0,0,  s0,t0,  r,g,b,a,  x0-((int)x0), gamma, layer, channel );
         SET_GLYPH_VERTEX(vertices[vcount+1],
-                         (float)(int)x0,y1,0,  s0,t1,  r,g,b,a,  x0-((int)x0), gamma );
+                         (float)(int)x0,y1,0,  s0,t1,  r,g,b,a,  x0-((int)x0), gamma, layer, channel );
         SET_GLYPH_VERTEX(vertices[vcount+2],
-                         (float)(int)x1,y1,0,  s1,t1,  r,g,b,a,  x1-((int)x1), gamma );
+                         (float)(int)x1,y1,0,  s1,t1,  r,g,b,a,  x1-((int)x1), gamma, layer, channel );
         SET_GLYPH_VERTEX(vertices[vcount+3],
-                         (float)(int)x1,y0,0,  s1,t0,  r,g,b,a,  x1-((int)x1), gamma );
+                         (float)(int)x1,y0,0,  s1,t0,  r,g,b,a,  x1-((int)x1), gamma, layer, channel );
         indices[icount + 0] = vcount+0;
         indices[icount + 1] = vcount+1;
         indices[icount + 2] = vcount+2;
@@ -432,15 +526,17 @@ text_buffer_add_char( text_buffer_t * self,
         float t0 = glyph->t0;
         float s1 = glyph->s1;
         float t1 = glyph->t1;
+        float layer = glyph->page;
+        float channel = glyph->channel;
 
         SET_GLYPH_VERTEX(vertices[vcount+0],
-                         (float)(int)x0,y0,0,  s0,t0,  r,g,b,a,  x0-((int)x0), gamma );
+                         (float)(int)x0,y0,0,  s0,t0,  r,g,b,a,  x0-((int)x0), gamma, layer, channel );
         SET_GLYPH_VERTEX(vertices[vcount+1],
-                         (float)(int)x0,y1,0,  s0,t1,  r,g,b,a,  x0-((int)x0), gamma );
+                         (float)(int)x0,y1,0,  s0,t1,  r,g,b,a,  x0-((int)x0), gamma, layer, channel );
         SET_GLYPH_VERTEX(vertices[vcount+2],
-                         (float)(int)x1,y1,0,  s1,t1,  r,g,b,a,  x1-((int)x1), gamma );
+                         (float)(int)x1,y1,0,  s1,t1,  r,g,b,a,  x1-((int)x1), gamma, layer, channel );
         SET_GLYPH_VERTEX(vertices[vcount+3],
-                         (float)(int)x1,y0,0,  s1,t0,  r,g,b,a,  x1-((int)x1), gamma );
+                         (float)(int)x1,y0,0,  s1,t0,  r,g,b,a,  x1-((int)x1), gamma, layer, channel );
         indices[icount + 0] = vcount+0;
         indices[icount + 1] = vcount+1;
         indices[icount + 2] = vcount+2;
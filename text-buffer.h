@@ -47,6 +47,21 @@ namespace ftgl {
  * @{
  */
 
+/**
+ * Font the glyphs of a text buffer are taken from
+ */
+typedef struct text_buffer_font_t {
+    /**
+     * The font
+     */
+    texture_font_t * font;
+
+    /**
+     * Generation of the font when its first glyph was added
+     */
+    unsigned int generation;
+} text_buffer_font_t;
+
 /**
  * Text buffer structure
  */
@@ -101,6 +116,11 @@ typedef struct  text_buffer_t {
      * Current line decender
      */
     float line_descender;
+
+    /**
+     * Fonts the glyphs of the text are taken from (text_buffer_font_t)
+     */
+    vector_t * fonts;
 } text_buffer_t;
 
 
@@ -164,6 +184,17 @@ typedef struct glyph_vertex_t {
      */
     float gamma;
 
+    /**
+     * Atlas page of the glyph, layer of the texture array
+     */
+    float layer;
+
+    /**
+     * Atlas channel of the glyph, 0 unless the atlas packs its channels
+     * apart
+     */
+    float channel;
+
 } glyph_vertex_t;
 
 
@@ -294,6 +325,32 @@ typedef enum Align
   void
   text_buffer_clear( text_buffer_t * self );
 
+/**
+  * Tell whether glyphs of the text may have been evicted from their atlas
+  * since they were added (see texture_font_t.evict), the vertices pointing
+  * to other glyphs: the text must then be cleared and added again.
+  *
+  * @param self a text buffer
+  * @return     1 if the vertices are stale, 0 otherwise
+ */
+  int
+  text_buffer_is_stale( const text_buffer_t * self );
+
+/**
+  * Move the texture coordinates of the text along with the glyphs of a
+  * repacked atlas (see texture_font_repack), instead of adding the text
+  * again. Fonts the text was current with before the repack are current
+  * again. Texture coordinates must be normalized (texture_font_t.scaletex).
+  *
+  * @param self   a text buffer
+  * @param remap  the remap table of the repack
+  * @param atlas  the repacked atlas
+ */
+  void
+  text_buffer_remap( text_buffer_t * self,
+                     const vector_t * remap,
+                     const texture_atlas_t * atlas );
+
 
 /** @} */
 
@@ -8,10 +8,57 @@
 #include <string.h>
 #include <assert.h>
 #include <limits.h>
+#include <stdint.h>
+#ifdef FREETYPE_GL_THREADS
+# if defined(_WIN32) || defined(_WIN64)
+#  define WIN32_LEAN_AND_MEAN
+#  define NOMINMAX
+#  include <windows.h>
+# else
+#  include <pthread.h>
+# endif
+#endif
+#include "opengl.h"
+#include "block-compress.h"
 #include "texture-atlas.h"
 #include "texture-font.h"
+#include "baked-font.h"
 #include "ftgl-utils.h"
 
+/* Dirty rectangles kept before the nearest ones get merged */
+#define TEXTURE_ATLAS_DIRTY_MAX 32
+
+/* Nodes and free regions of a channel packed apart, after the first */
+typedef struct texture_atlas_layer_t
+{
+    vector_t * nodes;
+    vector_t * free_regions;
+} texture_atlas_layer_t;
+
+/* Bitmap of a shared region, its bytes hashed with its size */
+typedef struct texture_atlas_content_t
+{
+    uint64_t hash;
+    uint32_t width;
+    uint32_t height;
+} texture_atlas_content_t;
+
+/* Position of a shared region */
+typedef struct texture_atlas_place_t
+{
+    uint32_t x;
+    uint32_t y;
+    uint32_t page;
+    uint32_t channel;
+} texture_atlas_place_t;
+
+/* References to a shared region */
+typedef struct texture_atlas_share_t
+{
+    texture_atlas_content_t content;
+    size_t references;
+} texture_atlas_share_t;
+
 // -------------------------------------------------- texture_atlas_special ---
 
 void texture_atlas_special ( texture_atlas_t * self )
@@ -26,7 +73,11 @@ void texture_atlas_special ( texture_atlas_t * self )
         freetype_gl_error( Texture_Atlas_Full );
     }
     
-    texture_atlas_set_region( self, region.x, region.y, 4, 4, data, 0 );
+    /* In the first channel of atlases packing channels apart */
+    if( self->channels > 1 )
+        texture_atlas_set_channel_region( self, region.x, region.y, 4, 4, 0, data, 0 );
+    else
+        texture_atlas_set_region( self, region.x, region.y, 4, 4, data, 0 );
     glyph->codepoint = -1;
     glyph->s0 = (region.x+2)/(float)self->width;
     glyph->t0 = (region.y+2)/(float)self->height;
@@ -36,17 +87,116 @@ void texture_atlas_special ( texture_atlas_t * self )
     self->special = (void*)glyph;
 }
 
+// ---------------------------------------------------- texture_atlas_empty ---
+/* Free space of an empty atlas for its packer, inside a one pixel border */
+static void
+texture_atlas_empty( const texture_atlas_t * self,
+                     vector_t * nodes,
+                     vector_t * free_regions )
+{
+    // We want a one pixel border around the whole atlas to avoid any artefact when
+    // sampling texture, a block one if regions are aligned
+    int border = (int)self->align;
+    ivec3 node = {{border,border,(int)self->width-1-border}};
+    ivec4 region = {{border,border,(int)self->width-1-border,(int)self->height-1-border}};
+
+    vector_clear( nodes );
+    vector_clear( free_regions );
+    switch( self->packer )
+    {
+    case PACKER_MAXRECTS:
+    case PACKER_GUILLOTINE:
+        vector_push_back( free_regions, &region );
+        break;
+    case PACKER_SHELF:
+        // An empty shelf at the top
+        node.z = 0;
+        vector_push_back( nodes, &node );
+        break;
+    default:
+        vector_push_back( nodes, &node );
+        break;
+    }
+}
+
+
+// ---------------------------------------------------- texture_atlas_round ---
+/* A size rounded up to the alignment of the regions */
+static size_t
+texture_atlas_round( const texture_atlas_t * self, size_t size )
+{
+    return (size + self->align - 1) / self->align * self->align;
+}
+
+
+// -------------------------------------------- texture_atlas_swap_skyline ---
+static void
+texture_atlas_swap_skyline( texture_atlas_t * self,
+                            vector_t ** nodes,
+                            vector_t ** free_regions )
+{
+    vector_t *swap = self->nodes;
+
+    self->nodes = *nodes;
+    *nodes = swap;
+    swap = self->free_regions;
+    self->free_regions = *free_regions;
+    *free_regions = swap;
+}
+
+// ----------------------------------------------- texture_atlas_swap_layer ---
+/* Swap the nodes and free regions of a channel in and out of the atlas, the
+ * first channel being the atlas' own */
+static void
+texture_atlas_swap_layer( texture_atlas_t * self,
+                          size_t channel )
+{
+    texture_atlas_layer_t *layer;
+
+    if( !channel )
+        return;
+    layer = (texture_atlas_layer_t *) vector_get( self->layers, channel - 1 );
+    texture_atlas_swap_skyline( self, &layer->nodes, &layer->free_regions );
+}
+
+// --------------------------------------------- texture_atlas_delete_layers ---
+static void
+texture_atlas_delete_layers( texture_atlas_t * self )
+{
+    texture_atlas_layer_t *layer;
+    size_t i;
+
+    if( !self->layers )
+        return;
+    for( i = 0; i < vector_size( self->layers ); ++i )
+    {
+        layer = (texture_atlas_layer_t *) vector_get( self->layers, i );
+        vector_delete( layer->nodes );
+        vector_delete( layer->free_regions );
+    }
+    vector_delete( self->layers );
+    self->layers = NULL;
+}
+
+
 // ------------------------------------------------------ texture_atlas_new ---
 texture_atlas_t *
 texture_atlas_new( const size_t width,
                    const size_t height,
                    const size_t depth )
 {
-    texture_atlas_t *self = (texture_atlas_t *) malloc( sizeof(texture_atlas_t) );
+    return texture_atlas_new_with_packer( width, height, depth, PACKER_SKYLINE );
+}
 
-    // We want a one pixel border around the whole atlas to avoid any artefact when
-    // sampling texture
-    ivec3 node = {{1,1,width-2}};
+
+// ------------------------------------------ texture_atlas_new_with_packer ---
+texture_atlas_t *
+texture_atlas_new_with_packer( const size_t width,
+                               const size_t height,
+                               const size_t depth,
+                               const texture_atlas_packer_t packer )
+{
+    texture_atlas_t *self = (texture_atlas_t *) malloc( sizeof(texture_atlas_t) );
 
     assert( (depth == 1) || (depth == 3) || (depth == 4) );
     if( self == NULL)
@@ -55,15 +205,34 @@ texture_atlas_new( const size_t width,
         return NULL;
         /* exit( EXIT_FAILURE ); */ /* Never exit from a library */
     }
+    self->packer = packer;
     self->nodes = vector_new( sizeof(ivec3) );
+    self->free_regions = vector_new( sizeof(ivec4) );
     self->used = 0;
     self->width = width;
     self->height = height;
     self->depth = depth;
+    self->spacing_horiz = 0;
+    self->spacing_vert = 0;
     self->id = 0;
     self->modified = 1;
+    self->dirty = vector_new( sizeof(ivec4) );
+    self->baked = NULL;
+    self->max_pages = 1;
+    self->pages = NULL;
+    self->layers_uploaded = 0;
+    self->max_width = self->width;
+    self->max_height = self->height;
+    self->fonts = vector_new( sizeof(struct texture_font_t *) );
+    self->align = 1;
+    self->blocks = NULL;
+    self->channels = 1;
+    self->layers = NULL;
+    self->shared = NULL;
+    self->shared_at = NULL;
+    self->shared_bytes = 0;
 
-    vector_push_back( self->nodes, &node );
+    texture_atlas_empty( self, self->nodes, self->free_regions );
     self->data = (unsigned char *)
         calloc( width*height*depth, sizeof(unsigned char) );
 
@@ -73,20 +242,109 @@ texture_atlas_new( const size_t width,
         return NULL;
     }
 
+    texture_atlas_mark_dirty( self, 0, 0, width, height );
     texture_atlas_special( self );
     
     return self;
 }
 
 
+// -------------------------------------------- texture_atlas_new_from_baked ---
+texture_atlas_t *
+texture_atlas_new_from_baked( baked_font_t * baked )
+{
+    texture_atlas_t *self;
+    texture_glyph_t *glyph;
+    // A single node at the bottom: nothing fits until the atlas is enlarged
+    ivec3 node = {{1,1,1}};
+
+    assert( baked );
+
+    self = (texture_atlas_t *) malloc( sizeof(texture_atlas_t) );
+    glyph = texture_glyph_new( );
+    if( self == NULL || glyph == NULL )
+    {
+        free( self );
+        if( glyph )
+            texture_glyph_delete( glyph );
+        freetype_gl_error( Out_Of_Memory );
+        return NULL;
+    }
+    self->packer = PACKER_SKYLINE;
+    self->nodes = vector_new( sizeof(ivec3) );
+    self->free_regions = vector_new( sizeof(ivec4) );
+    self->width = baked->atlas_width;
+    self->height = baked->atlas_height;
+    self->depth = baked->atlas_depth;
+    self->used = self->width * self->height;
+    self->spacing_horiz = 0;
+    self->spacing_vert = 0;
+    self->id = 0;
+    self->modified = 1;
+    self->dirty = vector_new( sizeof(ivec4) );
+    self->data = baked->pixels;
+    self->baked = baked;
+    self->max_pages = 1;
+    self->pages = NULL;
+    self->layers_uploaded = 0;
+    self->max_width = self->width;
+    self->max_height = self->height;
+    self->fonts = vector_new( sizeof(struct texture_font_t *) );
+    self->align = 1;
+    self->blocks = NULL;
+    self->channels = 1;
+    self->layers = NULL;
+    self->shared = NULL;
+    self->shared_at = NULL;
+    self->shared_bytes = 0;
+    baked->references++;
+    texture_atlas_mark_dirty( self, 0, 0, self->width, self->height );
+
+    node.y = (int) self->height - 1;
+    node.z = (int) self->width - 2;
+    vector_push_back( self->nodes, &node );
+
+    glyph->codepoint = -1;
+    glyph->s0 = baked->special[0];
+    glyph->t0 = baked->special[1];
+    glyph->s1 = baked->special[2];
+    glyph->t1 = baked->special[3];
+    self->special = (void*)glyph;
+
+    return self;
+}
+
+
 // --------------------------------------------------- texture_atlas_delete ---
 void
 texture_atlas_delete( texture_atlas_t *self )
 {
+    size_t i;
+
     assert( self );
+    if( self->pages )
+    {
+        for( i = 0; i < vector_size( self->pages ); ++i )
+            texture_atlas_delete( *(texture_atlas_t **) vector_get( self->pages, i ) );
+        vector_delete( self->pages );
+    }
+    texture_atlas_delete_layers( self );
+    if( self->shared )
+    {
+        hash_table_delete( self->shared );
+        hash_table_delete( self->shared_at );
+    }
     vector_delete( self->nodes );
+    vector_delete( self->free_regions );
+    vector_delete( self->dirty );
+    vector_delete( self->fonts );
+    free( self->blocks );
     texture_glyph_delete( self->special );
-    if( self->data )
+    if( self->baked )
+    {
+        baked_font_release( self->baked );
+    }
+    else if( self->data )
     {
         free( self->data );
     }
@@ -128,7 +386,416 @@ texture_atlas_set_region( texture_atlas_t * self,
         memcpy( self->data+((y+i)*self->width + x ) * charsize * depth,
                 data + (i*stride) * charsize, width * charsize * depth  );
     }
+    texture_atlas_mark_dirty( self, x, y, width, height );
+}
+
+
+// --------------------------------------- texture_atlas_set_channel_region ---
+void
+texture_atlas_set_channel_region( texture_atlas_t * self,
+                                  const size_t x,
+                                  const size_t y,
+                                  const size_t width,
+                                  const size_t height,
+                                  const size_t channel,
+                                  const unsigned char * data,
+                                  const size_t stride )
+{
+    unsigned char *row;
+    size_t i, j;
+
+    assert( self );
+    assert( channel < self->depth );
+    assert( x > 0 && y > 0 );
+    assert( (x + width) <= (self->width-1) );
+    assert( (y + height) <= (self->height-1) );
+    assert( height == 0 || (data != NULL && width > 0) );
+
+    for( i = 0; i < height; ++i )
+    {
+        row = self->data + ((y + i) * self->width + x) * self->depth + channel;
+        for( j = 0; j < width; ++j )
+            row[j * self->depth] = data[i * stride + j];
+    }
+    texture_atlas_mark_dirty( self, x, y, width, height );
+}
+
+
+// ---------------------------------------------- texture_atlas_mark_dirty ---
+/* Area of the union of two rectangles */
+static size_t
+texture_atlas_union( const ivec4 * a, const ivec4 * b, ivec4 * u )
+{
+    int x1 = a->x + a->width > b->x + b->width ? a->x + a->width : b->x + b->width;
+    int y1 = a->y + a->height > b->y + b->height ? a->y + a->height : b->y + b->height;
+
+    u->x = a->x < b->x ? a->x : b->x;
+    u->y = a->y < b->y ? a->y : b->y;
+    u->width = x1 - u->x;
+    u->height = y1 - u->y;
+    return (size_t)u->width * u->height;
+}
+
+void
+texture_atlas_mark_dirty( texture_atlas_t * self,
+                          const size_t x,
+                          const size_t y,
+                          const size_t width,
+                          const size_t height )
+{
+    ivec4 rect = {{(int)x, (int)y, (int)width, (int)height}};
+    ivec4 u;
+    size_t i, area, best, best_area;
+
+    assert( self );
+    assert( x + width <= self->width );
+    assert( y + height <= self->height );
+
+    if( !width || !height )
+        return;
     self->modified = 1;
+
+    /* Merge with the rectangles the union hardly grows, until none is left:
+     * a glyph next to the last one, or a rectangle already covered */
+    for( i = 0; i < vector_size( self->dirty ); )
+    {
+        ivec4 * other = (ivec4 *) vector_get( self->dirty, i );
+        area = texture_atlas_union( &rect, other, &u );
+        if( 2 * area <= 3 * ((size_t)rect.width * rect.height +
+                             (size_t)other->width * other->height) )
+        {
+            rect = u;
+            vector_erase( self->dirty, i );
+            i = 0;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    /* Too many rectangles: merge with the one the union grows least */
+    while( vector_size( self->dirty ) >= TEXTURE_ATLAS_DIRTY_MAX )
+    {
+        best = 0;
+        best_area = SIZE_MAX;
+        for( i = 0; i < vector_size( self->dirty ); ++i )
+        {
+            ivec4 * other = (ivec4 *) vector_get( self->dirty, i );
+            area = texture_atlas_union( &rect, other, &u ) -
+                (size_t)other->width * other->height;
+            if( area < best_area )
+            {
+                best = i;
+                best_area = area;
+            }
+        }
+        texture_atlas_union( &rect, (ivec4 *) vector_get( self->dirty, best ), &rect );
+        vector_erase( self->dirty, best );
+    }
+    vector_push_back( self->dirty, &rect );
+}
+
+
+// -------------------------------------------- texture_atlas_dirty_count ---
+size_t
+texture_atlas_dirty_count( const texture_atlas_t * self )
+{
+    assert( self );
+
+    return vector_size( self->dirty );
+}
+
+
+// ---------------------------------------------- texture_atlas_get_dirty ---
+ivec4
+texture_atlas_get_dirty( const texture_atlas_t * self,
+                         const size_t index )
+{
+    assert( self );
+    assert( index < vector_size( self->dirty ) );
+
+    return *(const ivec4 *) vector_get( self->dirty, index );
+}
+
+
+// --------------------------------------------------- texture_atlas_clean ---
+void
+texture_atlas_clean( texture_atlas_t * self )
+{
+    assert( self );
+
+    vector_clear( self->dirty );
+    self->modified = 0;
+}
+
+
+// --------------------------------------------------- texture_atlas_whole ---
+/* Whether the whole atlas is dirty */
+static int
+texture_atlas_whole( const texture_atlas_t * self )
+{
+    const ivec4 * rect;
+
+    if( vector_size( self->dirty ) != 1 )
+        return 0;
+    rect = (const ivec4 *) vector_get( self->dirty, 0 );
+    return rect->width == (int)self->width && rect->height == (int)self->height;
+}
+
+
+// ------------------------------------------------ texture_atlas_compress ---
+unsigned char *
+texture_atlas_compress( texture_atlas_t * self,
+                        size_t threads )
+{
+    block_format_t format = block_compress_format( self->depth );
+    const ivec4 * rect;
+    size_t i;
+
+    assert( self );
+
+    if( !self->blocks || texture_atlas_whole( self ) )
+    {
+        if( !self->blocks &&
+            !(self->blocks = (unsigned char *) malloc(
+                  block_compress_size( format, self->width, self->height ) )) )
+        {
+            freetype_gl_error( Out_Of_Memory );
+            return NULL;
+        }
+        block_compress( format, self->data, self->width, self->height,
+                        self->depth, self->blocks, threads );
+        return self->blocks;
+    }
+    for( i = 0; i < vector_size( self->dirty ); ++i )
+    {
+        rect = (const ivec4 *) vector_get( self->dirty, i );
+        block_compress_rect( format, self->data, self->width, self->height,
+                             self->depth, rect->x, rect->y,
+                             rect->width, rect->height, self->blocks );
+    }
+    return self->blocks;
+}
+
+
+#if defined(GL_COMPRESSED_RED_RGTC1) && defined(GL_COMPRESSED_RGBA_BPTC_UNORM)
+// ------------------------------------------- texture_atlas_upload_blocks ---
+/* Upload the blocks of a compressed atlas, compressed again where dirty,
+ * the rows of blocks of each rectangle gathered one after the other */
+static void
+texture_atlas_upload_blocks( texture_atlas_t * self,
+                             int whole )
+{
+    block_format_t format = block_compress_format( self->depth );
+    GLenum internal = format == BLOCK_BC4 ? GL_COMPRESSED_RED_RGTC1
+                                          : GL_COMPRESSED_RGBA_BPTC_UNORM;
+    size_t block = block_compress_size( format, 4, 4 );
+    size_t columns = (self->width + 3) / 4;
+    size_t i, by, x0, y0, x1, y1, row, capacity = 0;
+    unsigned char *gathered = NULL, *grown;
+    const ivec4 * rect;
+
+    if( !texture_atlas_compress( self, 1 ) )
+        return;
+    if( whole )
+    {
+        glCompressedTexImage2D( GL_TEXTURE_2D, 0, internal, (GLsizei)self->width,
+                                (GLsizei)self->height, 0,
+                                (GLsizei)block_compress_size( format, self->width, self->height ),
+                                self->blocks );
+        return;
+    }
+    for( i = 0; i < vector_size( self->dirty ); ++i )
+    {
+        rect = (const ivec4 *) vector_get( self->dirty, i );
+        x0 = rect->x / 4;
+        y0 = rect->y / 4;
+        x1 = (rect->x + rect->width + 3) / 4;
+        y1 = (rect->y + rect->height + 3) / 4;
+        row = (x1 - x0) * block;
+        if( row * (y1 - y0) > capacity )
+        {
+            if( !(grown = (unsigned char *) realloc( gathered, row * (y1 - y0) )) )
+            {
+                freetype_gl_error( Out_Of_Memory );
+                break;
+            }
+            gathered = grown;
+            capacity = row * (y1 - y0);
+        }
+        for( by = y0; by < y1; ++by )
+            memcpy( gathered + (by - y0) * row,
+                    self->blocks + (by * columns + x0) * block, row );
+        /* Whole blocks, but for those the edges of the atlas cut */
+        glCompressedTexSubImage2D( GL_TEXTURE_2D, 0, (GLint)(x0 * 4), (GLint)(y0 * 4),
+                                   (GLsizei)((x1 * 4 < self->width ? x1 * 4 : self->width) - x0 * 4),
+                                   (GLsizei)((y1 * 4 < self->height ? y1 * 4 : self->height) - y0 * 4),
+                                   internal, (GLsizei)(row * (y1 - y0)), gathered );
+    }
+    free( gathered );
+}
+#endif
+
+
+#ifdef GL_TEXTURE_2D_ARRAY
+// -------------------------------------------- texture_atlas_upload_pages ---
+/* Upload the pages to the layers of a texture array, all of them when it
+ * is created again for pages added since */
+static void
+texture_atlas_upload_pages( texture_atlas_t * self,
+                            GLenum format )
+{
+    size_t pages = texture_atlas_page_count( self );
+    texture_atlas_t * page;
+    const ivec4 * rect;
+    size_t i, p;
+    int whole = !self->id || self->layers_uploaded != pages;
+
+    if( !self->id )
+    {
+        glGenTextures( 1, &self->id );
+        glBindTexture( GL_TEXTURE_2D_ARRAY, self->id );
+        glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+        glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+        glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+        glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+    }
+    else
+    {
+        glBindTexture( GL_TEXTURE_2D_ARRAY, self->id );
+    }
+    glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+
+    /* Pages all have the size of the first one */
+    if( whole )
+    {
+        glTexImage3D( GL_TEXTURE_2D_ARRAY, 0, format, (GLsizei)self->width,
+                      (GLsizei)self->height, (GLsizei)pages, 0, format,
+                      GL_UNSIGNED_BYTE, NULL );
+        self->layers_uploaded = pages;
+    }
+
+#ifdef GL_UNPACK_ROW_LENGTH
+    glPixelStorei( GL_UNPACK_ROW_LENGTH, (GLint)self->width );
+#endif
+    for( p = 0; p < pages; ++p )
+    {
+        page = texture_atlas_get_page( self, p );
+        if( whole || texture_atlas_whole( page ) )
+        {
+            glTexSubImage3D( GL_TEXTURE_2D_ARRAY, 0, 0, 0, (GLint)p,
+                             (GLsizei)page->width, (GLsizei)page->height, 1,
+                             format, GL_UNSIGNED_BYTE, page->data );
+            texture_atlas_clean( page );
+            continue;
+        }
+        for( i = 0; i < vector_size( page->dirty ); ++i )
+        {
+            rect = (const ivec4 *) vector_get( page->dirty, i );
+#ifdef GL_UNPACK_ROW_LENGTH
+            glTexSubImage3D( GL_TEXTURE_2D_ARRAY, 0, rect->x, rect->y, (GLint)p,
+                             rect->width, rect->height, 1, format, GL_UNSIGNED_BYTE,
+                             page->data + (rect->y * page->width + rect->x) * page->depth );
+#else
+            glTexSubImage3D( GL_TEXTURE_2D_ARRAY, 0, 0, rect->y, (GLint)p,
+                             (GLsizei)page->width, rect->height, 1, format, GL_UNSIGNED_BYTE,
+                             page->data + rect->y * page->width * page->depth );
+#endif
+        }
+        texture_atlas_clean( page );
+    }
+#ifdef GL_UNPACK_ROW_LENGTH
+    glPixelStorei( GL_UNPACK_ROW_LENGTH, 0 );
+#endif
+}
+#endif
+
+
+// -------------------------------------------------- texture_atlas_upload ---
+void
+texture_atlas_upload( texture_atlas_t * self )
+{
+    GLenum format;
+    ivec4 * rect;
+    size_t i;
+    int whole;
+
+    assert( self );
+    assert( self->depth == 1 || self->depth == 3 || self->depth == 4 );
+
+#ifdef GL_RED
+    format = self->depth == 4 ? GL_RGBA : self->depth == 3 ? GL_RGB : GL_RED;
+#else
+    format = self->depth == 4 ? GL_RGBA : self->depth == 3 ? GL_RGB : GL_ALPHA;
+#endif
+
+#ifdef GL_TEXTURE_2D_ARRAY
+    if( self->max_pages > 1 )
+    {
+        texture_atlas_upload_pages( self, format );
+        return;
+    }
+#else
+    /* No texture arrays to upload pages to */
+    assert( texture_atlas_page_count( self ) == 1 );
+#endif
+    whole = !self->id || texture_atlas_whole( self );
+
+    if( !self->id )
+    {
+        glGenTextures( 1, &self->id );
+        glBindTexture( GL_TEXTURE_2D, self->id );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+    }
+    else
+    {
+        glBindTexture( GL_TEXTURE_2D, self->id );
+    }
+    glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+
+#if defined(GL_COMPRESSED_RED_RGTC1) && defined(GL_COMPRESSED_RGBA_BPTC_UNORM)
+    if( self->blocks )
+    {
+        texture_atlas_upload_blocks( self, whole );
+        texture_atlas_clean( self );
+        return;
+    }
+#endif
+
+    if( whole )
+    {
+        glTexImage2D( GL_TEXTURE_2D, 0, format, (GLsizei)self->width,
+                      (GLsizei)self->height, 0, format, GL_UNSIGNED_BYTE,
+                      self->data );
+        texture_atlas_clean( self );
+        return;
+    }
+
+#ifdef GL_UNPACK_ROW_LENGTH
+    glPixelStorei( GL_UNPACK_ROW_LENGTH, (GLint)self->width );
+#endif
+    for( i = 0; i < vector_size( self->dirty ); ++i )
+    {
+        rect = (ivec4 *) vector_get( self->dirty, i );
+#ifdef GL_UNPACK_ROW_LENGTH
+        glTexSubImage2D( GL_TEXTURE_2D, 0, rect->x, rect->y,
+                         rect->width, rect->height, format, GL_UNSIGNED_BYTE,
+                         self->data + (rect->y * self->width + rect->x) * self->depth );
+#else
+        /* No row length to skip the rest of the rows: upload them whole */
+        glTexSubImage2D( GL_TEXTURE_2D, 0, 0, rect->y,
+                         (GLsizei)self->width, rect->height, format, GL_UNSIGNED_BYTE,
+                         self->data + rect->y * self->width * self->depth );
+#endif
+    }
+#ifdef GL_UNPACK_ROW_LENGTH
+    glPixelStorei( GL_UNPACK_ROW_LENGTH, 0 );
+#endif
+    texture_atlas_clean( self );
 }
 
 
@@ -198,63 +865,746 @@ texture_atlas_merge( texture_atlas_t * self )
 }
 
 
-// ----------------------------------------------- texture_atlas_get_region ---
-ivec4
-texture_atlas_get_region( texture_atlas_t * self,
-                          const size_t width,
-                          const size_t height )
+// ------------------------------------------------- texture_atlas_merge_at ---
+/* Merge the node at i with its neighbours, the rest of the skyline being
+ * merged already */
+static void
+texture_atlas_merge_at( texture_atlas_t * self,
+                        const size_t i )
 {
-    int y, best_index;
-    size_t best_height, best_width;
-    ivec3 *node, *prev;
-    ivec4 region = {{0,0,width,height}};
-    size_t i;
+    ivec3 *node, *next;
 
     assert( self );
 
-    best_height = UINT_MAX;
-    best_index  = -1;
-    best_width = UINT_MAX;
-
-    for( i=0; i<self->nodes->size; ++i )
+    if( i + 1 < self->nodes->size )
     {
-        size_t awidth = width, aheight = height;
-        y = texture_atlas_fit( self, i, width + self->spacing_horiz, height + self->spacing_vert );
-        if( y < 0 && self->spacing_horiz > 0)
-            y = texture_atlas_fit( self, i, width + self->spacing_horiz, height );
-        else
-            awidth = width + self->spacing_horiz, aheight = height + self->spacing_vert;
-        if( y < 0 && self->spacing_vert > 0)
-            y = texture_atlas_fit( self, i, width, height + self->spacing_vert );
-        else
-            awidth = width + self->spacing_horiz, aheight = height;
-        if( y < 0)
-            y = texture_atlas_fit( self, i, width, height );
-        else
-            awidth = width, aheight = height + self->spacing_vert;
-        if( y >= 0 )
-	{
-            node = (ivec3 *) vector_get( self->nodes, i );
-            if( ( (y + aheight) < best_height ) ||
-                ( ((y + aheight) == best_height) && (node->z > 0 && (size_t)node->z < best_width)) )
-            {
-                best_height = y + aheight;
-                best_index = i;
-                best_width = node->z;
-                region.x = node->x;
-                region.y = y;
-                region.width = awidth;
-                region.height = aheight;
-            }
+        node = (ivec3 *) vector_get( self->nodes, i );
+        next = (ivec3 *) vector_get( self->nodes, i + 1 );
+        if( node->y == next->y )
+        {
+            node->z += next->z;
+            vector_erase( self->nodes, i + 1 );
         }
     }
-    
-    if( best_index == -1 )
+    if( i > 0 && i < self->nodes->size )
     {
-        region.x = -1;
-        region.y = -1;
-        region.width = 0;
-        region.height = 0;
+        node = (ivec3 *) vector_get( self->nodes, i - 1 );
+        next = (ivec3 *) vector_get( self->nodes, i );
+        if( node->y == next->y )
+        {
+            node->z += next->z;
+            vector_erase( self->nodes, i );
+        }
+    }
+}
+
+
+// ----------------------------------------------- texture_atlas_split_free ---
+/* Allocate a region in the smallest free region it fits in, splitting the
+ * rest of it along its shorter side: Guillotine Best Area Fit */
+static int
+texture_atlas_split_free( texture_atlas_t * self,
+                          const int awidth,
+                          const int aheight,
+                          ivec4 * region )
+{
+    ivec4 *free_region, rest;
+    size_t i, best = 0, best_area = SIZE_MAX;
+    int x, y, w, h;
+
+    for( i = 0; i < self->free_regions->size; ++i )
+    {
+        free_region = (ivec4 *) vector_get( self->free_regions, i );
+        if( free_region->width >= awidth && free_region->height >= aheight &&
+            (size_t)free_region->width * free_region->height < best_area )
+        {
+            best = i;
+            best_area = (size_t)free_region->width * free_region->height;
+        }
+    }
+    if( best_area == SIZE_MAX )
+        return 0;
+
+    free_region = (ivec4 *) vector_get( self->free_regions, best );
+    x = free_region->x;
+    y = free_region->y;
+    w = free_region->width;
+    h = free_region->height;
+    vector_erase( self->free_regions, best );
+
+    if( w - awidth < h - aheight )
+    {
+        rest = (ivec4){{x + awidth, y, w - awidth, aheight}};
+        if( rest.width > 0 && rest.height > 0 )
+            vector_push_back( self->free_regions, &rest );
+        rest = (ivec4){{x, y + aheight, w, h - aheight}};
+    }
+    else
+    {
+        rest = (ivec4){{x, y + aheight, awidth, h - aheight}};
+        if( rest.width > 0 && rest.height > 0 )
+            vector_push_back( self->free_regions, &rest );
+        rest = (ivec4){{x + awidth, y, w - awidth, h}};
+    }
+    if( rest.width > 0 && rest.height > 0 )
+        vector_push_back( self->free_regions, &rest );
+
+    *region = (ivec4){{x, y, awidth, aheight}};
+    return 1;
+}
+
+
+// --------------------------------------------- texture_atlas_reuse_region ---
+/* Allocate a region and its spacing in the free regions */
+static int
+texture_atlas_reuse_region( texture_atlas_t * self,
+                            const size_t width,
+                            const size_t height,
+                            ivec4 * region )
+{
+    if( !texture_atlas_split_free( self, (int)(width + self->spacing_horiz),
+                                   (int)(height + self->spacing_vert), region ) )
+        return 0;
+    self->used += width * height;
+    self->modified = 1;
+    return 1;
+}
+
+
+// -------------------------------------------- texture_atlas_lower_skyline ---
+/* Give a free region back to the skyline if nothing was allocated above it
+ * across its whole width, the skyline going down to its top */
+static int
+texture_atlas_lower_skyline( texture_atlas_t * self,
+                             const ivec4 * region )
+{
+    int left = region->x, right = region->x + region->width;
+    ivec3 *node, split;
+    size_t i;
+
+    for( i = 0; i < self->nodes->size; ++i )
+    {
+        node = (ivec3 *) vector_get( self->nodes, i );
+        if( node->x + node->z <= left )
+            continue;
+        if( node->x >= right )
+            break;
+        if( node->y != region->y + region->height )
+            return 0;
+    }
+
+    /* Split the nodes across the sides of the region, then lower those in
+     * between */
+    for( i = 0; i < self->nodes->size; ++i )
+    {
+        node = (ivec3 *) vector_get( self->nodes, i );
+        if( node->x >= right )
+            break;
+        if( node->x < left && node->x + node->z > left )
+        {
+            split = *node;
+            split.z = left - node->x;
+            node->z -= split.z;
+            node->x = left;
+            vector_insert( self->nodes, i, &split );
+            continue;
+        }
+        if( node->x >= left && node->x + node->z > right )
+        {
+            split = *node;
+            split.z = right - node->x;
+            node->z -= split.z;
+            node->x = right;
+            split.y = region->y;
+            vector_insert( self->nodes, i, &split );
+            break;
+        }
+        if( node->x >= left )
+            node->y = region->y;
+    }
+    texture_atlas_merge( self );
+    return 1;
+}
+
+
+// ---------------------------------------------- texture_atlas_free_region ---
+void
+texture_atlas_free_region( texture_atlas_t * self,
+                           const size_t x,
+                           const size_t y,
+                           const size_t width,
+                           const size_t height )
+{
+    texture_atlas_free_channel_region( self, x, y, width, height, 0 );
+}
+
+
+// -------------------------------------- texture_atlas_free_channel_region ---
+void
+texture_atlas_free_channel_region( texture_atlas_t * self,
+                                   const size_t x,
+                                   const size_t y,
+                                   size_t width,
+                                   size_t height,
+                                   const size_t channel )
+{
+    ivec4 region;
+    ivec4 *other;
+    size_t i, j;
+
+    assert( self );
+    assert( !self->baked );
+    assert( channel < self->channels );
+    assert( (x + width) <= (self->width-1) );
+    assert( (y + height) <= (self->height-1) );
+
+    if( !width || !height )
+        return;
+    /* Aligned regions were allocated whole blocks, short of the border */
+    if( self->align > 1 )
+    {
+        width = texture_atlas_round( self, width );
+        height = texture_atlas_round( self, height );
+        width = x + width > self->width - 1 ? self->width - 1 - x : width;
+        height = y + height > self->height - 1 ? self->height - 1 - y : height;
+    }
+    region = (ivec4){{(int)x, (int)y, (int)width, (int)height}};
+    for( i = 0; i < height; ++i )
+    {
+        if( self->channels == 1 )
+            memset( self->data + ((y + i) * self->width + x) * self->depth, 0,
+                    width * self->depth );
+        else
+            for( j = 0; j < width; ++j )
+                self->data[((y + i) * self->width + x + j) * self->depth + channel] = 0;
+    }
+    self->used -= width * height < self->used ? width * height : self->used;
+    texture_atlas_mark_dirty( self, x, y, width, height );
+    texture_atlas_swap_layer( self, channel );
+
+    /* Merge with the free regions sharing a whole side, as long as any does */
+    for( i = 0; i < self->free_regions->size; )
+    {
+        other = (ivec4 *) vector_get( self->free_regions, i );
+        if( other->x == region.x && other->width == region.width &&
+            (other->y + other->height == region.y || region.y + region.height == other->y) )
+        {
+            region.y = other->y < region.y ? other->y : region.y;
+            region.height += other->height;
+        }
+        else if( other->y == region.y && other->height == region.height &&
+                 (other->x + other->width == region.x || region.x + region.width == other->x) )
+        {
+            region.x = other->x < region.x ? other->x : region.x;
+            region.width += other->width;
+        }
+        else
+        {
+            ++i;
+            continue;
+        }
+        vector_erase( self->free_regions, i );
+        i = 0;
+    }
+
+    if( self->packer != PACKER_SKYLINE ||
+        !texture_atlas_lower_skyline( self, &region ) )
+    {
+        vector_push_back( self->free_regions, &region );
+        texture_atlas_swap_layer( self, channel );
+        return;
+    }
+
+    /* The free regions the skyline now reaches go back to it as well */
+    for( i = 0; i < self->free_regions->size; )
+    {
+        if( texture_atlas_lower_skyline( self,
+                (ivec4 *) vector_get( self->free_regions, i ) ) )
+        {
+            vector_erase( self->free_regions, i );
+            i = 0;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+    texture_atlas_swap_layer( self, channel );
+}
+
+
+// ------------------------------------------------ texture_atlas_pixel_size ---
+/* Bytes a pixel of the bitmaps set in the atlas */
+static size_t
+texture_atlas_pixel_size( const texture_atlas_t * self )
+{
+    return self->channels > 1 ? 1 : self->depth;
+}
+
+// ---------------------------------------------------- texture_atlas_hash ---
+/* FNV-1a of the bytes of a bitmap, as glyph_cache_hash, row after row of
+ * size bytes step bytes apart */
+static uint64_t
+texture_atlas_hash( const unsigned char * data,
+                    size_t stride,
+                    size_t step,
+                    size_t size,
+                    size_t height )
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    size_t i, j;
+
+    for( i = 0; i < height; ++i )
+        for( j = 0; j < size; ++j )
+        {
+            hash ^= data[i * stride + j * step];
+            hash *= 0x100000001b3ULL;
+        }
+    return hash;
+}
+
+// ---------------------------------------------------- texture_atlas_place ---
+/* Bitmap of a region of a page, its first byte, stride and step */
+static const unsigned char *
+texture_atlas_place( const texture_atlas_t * self,
+                     const texture_atlas_place_t * place,
+                     size_t * stride,
+                     size_t * step )
+{
+    const texture_atlas_t *page = texture_atlas_get_page( (texture_atlas_t *) self,
+                                                          place->page );
+
+    *stride = page->width * page->depth;
+    *step = self->channels > 1 ? page->depth : 1;
+    return page->data + (place->y * page->width + place->x) * page->depth +
+           place->channel;
+}
+
+// ---------------------------------------------- texture_atlas_find_region ---
+ivec4
+texture_atlas_find_region( texture_atlas_t * self,
+                           const size_t width,
+                           const size_t height,
+                           const unsigned char * data,
+                           const size_t stride,
+                           size_t * page,
+                           size_t * channel )
+{
+    const size_t size = width * texture_atlas_pixel_size( self );
+    const texture_atlas_place_t *place;
+    texture_atlas_share_t *share;
+    texture_atlas_content_t content;
+    const unsigned char *pixels;
+    size_t pixels_stride, step, i, j;
+
+    assert( self );
+    assert( page );
+    assert( channel );
+
+    if( !self->shared || !width || !height )
+        return (ivec4){{-1,-1,0,0}};
+    memset( &content, 0, sizeof(content) );
+    content.hash = texture_atlas_hash( data, stride, 1, size, height );
+    content.width = (uint32_t) width;
+    content.height = (uint32_t) height;
+    if( !(place = (const texture_atlas_place_t *) hash_table_get( self->shared, &content )) )
+        return (ivec4){{-1,-1,0,0}};
+
+    /* The same bytes, not merely the same hash */
+    pixels = texture_atlas_place( self, place, &pixels_stride, &step );
+    for( i = 0; i < height; ++i )
+        for( j = 0; j < size; ++j )
+            if( pixels[i * pixels_stride + j * step] != data[i * stride + j] )
+                return (ivec4){{-1,-1,0,0}};
+
+    share = (texture_atlas_share_t *) hash_table_get( self->shared_at, place );
+    share->references++;
+    self->shared_bytes += size * height;
+    *page = place->page;
+    *channel = place->channel;
+    return (ivec4){{(int) place->x, (int) place->y, (int) width, (int) height}};
+}
+
+// --------------------------------------------- texture_atlas_share_region ---
+void
+texture_atlas_share_region( texture_atlas_t * self,
+                            const size_t x,
+                            const size_t y,
+                            const size_t width,
+                            const size_t height,
+                            const size_t page,
+                            const size_t channel )
+{
+    texture_atlas_place_t place;
+    texture_atlas_share_t share;
+    const unsigned char *pixels;
+    size_t stride, step;
+
+    assert( self );
+
+    if( !self->shared || !width || !height )
+        return;
+    memset( &place, 0, sizeof(place) );
+    place.x = (uint32_t) x;
+    place.y = (uint32_t) y;
+    place.page = (uint32_t) page;
+    place.channel = (uint32_t) channel;
+    pixels = texture_atlas_place( self, &place, &stride, &step );
+    memset( &share, 0, sizeof(share) );
+    share.content.hash = texture_atlas_hash( pixels, stride, step,
+                                             width * texture_atlas_pixel_size( self ),
+                                             height );
+    share.content.width = (uint32_t) width;
+    share.content.height = (uint32_t) height;
+    share.references = 1;
+
+    /* Another bitmap of the same hash keeps its region */
+    if( hash_table_get( self->shared, &share.content ) )
+        return;
+    if( !hash_table_set( self->shared, &share.content, &place ) ||
+        !hash_table_set( self->shared_at, &place, &share ) )
+    {
+        hash_table_erase( self->shared, &share.content );
+        freetype_gl_error( Out_Of_Memory );
+    }
+}
+
+// ------------------------------------------- texture_atlas_release_region ---
+void
+texture_atlas_release_region( texture_atlas_t * self,
+                              const size_t x,
+                              const size_t y,
+                              const size_t width,
+                              const size_t height,
+                              const size_t page,
+                              const size_t channel )
+{
+    texture_atlas_place_t place;
+    texture_atlas_share_t *share;
+    const texture_atlas_place_t *owner;
+
+    assert( self );
+
+    memset( &place, 0, sizeof(place) );
+    place.x = (uint32_t) x;
+    place.y = (uint32_t) y;
+    place.page = (uint32_t) page;
+    place.channel = (uint32_t) channel;
+    if( self->shared &&
+        (share = (texture_atlas_share_t *) hash_table_get( self->shared_at, &place )) )
+    {
+        if( --share->references )
+        {
+            self->shared_bytes -= (size_t) share->content.width * share->content.height *
+                                  texture_atlas_pixel_size( self );
+            return;
+        }
+        owner = (const texture_atlas_place_t *) hash_table_get( self->shared, &share->content );
+        if( owner && !memcmp( owner, &place, sizeof(place) ) )
+            hash_table_erase( self->shared, &share->content );
+        hash_table_erase( self->shared_at, &place );
+    }
+    texture_atlas_free_channel_region( texture_atlas_get_page( self, page ),
+                                       x, y, width, height, channel );
+}
+
+// --------------------------------------------- texture_atlas_repack_shared ---
+/* Shared regions moved by a repack, referenced by the regions given to it,
+ * the others being forgotten */
+static void
+texture_atlas_repack_shared( texture_atlas_t * self,
+                             const vector_t * regions,
+                             const vector_t * remap )
+{
+    const texture_atlas_remap_t *move;
+    const texture_atlas_place_t *place;
+    texture_atlas_share_t *share, *old;
+    texture_atlas_place_t moved;
+    hash_table_t *shared_at;
+    const ivec4 *region;
+    size_t i;
+
+    if( !(shared_at = hash_table_new( sizeof(texture_atlas_place_t),
+                                      sizeof(texture_atlas_share_t) )) )
+    {
+        hash_table_clear( self->shared );
+        hash_table_clear( self->shared_at );
+        self->shared_bytes = 0;
+        return;
+    }
+    memset( &moved, 0, sizeof(moved) );
+    for( i = 0; i < vector_size( regions ); ++i )
+    {
+        region = (const ivec4 *) vector_get( regions, i );
+        moved.x = (uint32_t) region->x;
+        moved.y = (uint32_t) region->y;
+        if( region->width <= 0 || region->height <= 0 ||
+            !(old = (texture_atlas_share_t *) hash_table_get( self->shared_at, &moved )) ||
+            !(move = texture_atlas_remap_find( remap, region->x, region->y )) )
+            continue;
+        moved.x = (uint32_t) move->to.x;
+        moved.y = (uint32_t) move->to.y;
+        if( (share = (texture_atlas_share_t *) hash_table_get( shared_at, &moved )) )
+            share->references++;
+        else if( (share = (texture_atlas_share_t *) hash_table_set( shared_at, &moved, old )) )
+            share->references = 1;
+    }
+
+    hash_table_delete( self->shared_at );
+    self->shared_at = shared_at;
+    hash_table_clear( self->shared );
+    self->shared_bytes = 0;
+    for( i = 0; i < hash_table_capacity( shared_at ); ++i )
+    {
+        if( !(place = (const texture_atlas_place_t *) hash_table_key_at( shared_at, i )) )
+            continue;
+        share = (texture_atlas_share_t *) hash_table_value_at( shared_at, i );
+        hash_table_set( self->shared, &share->content, place );
+        self->shared_bytes += (share->references - 1) * share->content.width *
+                              share->content.height * texture_atlas_pixel_size( self );
+    }
+}
+
+
+// ------------------------------------------------ texture_atlas_maxrects ---
+/* Allocate a region in the free rectangle leaving the shortest side, then
+ * cut it out of every free rectangle it overlaps, keeping the maximal
+ * ones: MaxRects Best Short Side Fit */
+static int
+texture_atlas_maxrects( texture_atlas_t * self,
+                        const int awidth,
+                        const int aheight,
+                        ivec4 * region )
+{
+    int best_short = INT_MAX, best_long = INT_MAX, short_side, long_side;
+    ivec4 *free_region, *other, placed, rest, piece;
+    size_t i, j, count;
+
+    for( i = 0; i < self->free_regions->size; ++i )
+    {
+        free_region = (ivec4 *) vector_get( self->free_regions, i );
+        if( free_region->width < awidth || free_region->height < aheight )
+            continue;
+        short_side = free_region->width - awidth;
+        long_side = free_region->height - aheight;
+        if( short_side > long_side )
+        {
+            long_side = short_side;
+            short_side = free_region->height - aheight;
+        }
+        if( short_side < best_short ||
+            (short_side == best_short && long_side < best_long) )
+        {
+            best_short = short_side;
+            best_long = long_side;
+            placed = (ivec4){{free_region->x, free_region->y, awidth, aheight}};
+        }
+    }
+    if( best_short == INT_MAX )
+        return 0;
+    *region = placed;
+    if( !awidth || !aheight )
+        return 1;
+
+    /* The free rectangles overlapping the region leave up to four others
+     * around it */
+    count = self->free_regions->size;
+    for( i = 0; i < count; )
+    {
+        free_region = (ivec4 *) vector_get( self->free_regions, i );
+        if( placed.x >= free_region->x + free_region->width ||
+            placed.x + placed.width <= free_region->x ||
+            placed.y >= free_region->y + free_region->height ||
+            placed.y + placed.height <= free_region->y )
+        {
+            ++i;
+            continue;
+        }
+        rest = *free_region;
+        vector_erase( self->free_regions, i );
+        --count;
+        if( placed.x > rest.x )
+        {
+            piece = (ivec4){{rest.x, rest.y, placed.x - rest.x, rest.height}};
+            vector_push_back( self->free_regions, &piece );
+        }
+        if( placed.x + placed.width < rest.x + rest.width )
+        {
+            piece = (ivec4){{placed.x + placed.width, rest.y,
+                              rest.x + rest.width - placed.x - placed.width, rest.height}};
+            vector_push_back( self->free_regions, &piece );
+        }
+        if( placed.y > rest.y )
+        {
+            piece = (ivec4){{rest.x, rest.y, rest.width, placed.y - rest.y}};
+            vector_push_back( self->free_regions, &piece );
+        }
+        if( placed.y + placed.height < rest.y + rest.height )
+        {
+            piece = (ivec4){{rest.x, placed.y + placed.height, rest.width,
+                              rest.y + rest.height - placed.y - placed.height}};
+            vector_push_back( self->free_regions, &piece );
+        }
+    }
+
+    /* Pieces inside another rectangle are not maximal, the rectangles left
+     * from before being maximal already */
+    for( i = count; i < self->free_regions->size; ++i )
+    {
+        free_region = (ivec4 *) vector_get( self->free_regions, i );
+        for( j = 0; j < self->free_regions->size; ++j )
+        {
+            other = (ivec4 *) vector_get( self->free_regions, j );
+            if( j != i && free_region->x >= other->x && free_region->y >= other->y &&
+                free_region->x + free_region->width <= other->x + other->width &&
+                free_region->y + free_region->height <= other->y + other->height )
+            {
+                vector_erase( self->free_regions, i-- );
+                break;
+            }
+        }
+    }
+
+    return 1;
+}
+
+
+// --------------------------------------------------- texture_atlas_shelf ---
+/* Allocate a region in a free region, or in the current shelf, which grows
+ * as tall as its tallest region, or else in a new shelf below it: Shelf
+ * Next Fit */
+static int
+texture_atlas_shelf( texture_atlas_t * self,
+                     const int awidth,
+                     const int aheight,
+                     ivec4 * region )
+{
+    ivec3 *shelf = (ivec3 *) vector_get( self->nodes, 0 );
+    ivec3 next = *shelf;
+
+    if( texture_atlas_split_free( self, awidth, aheight, region ) )
+        return 1;
+    if( next.x + awidth > (int)self->width - 1 )
+    {
+        next.x = 1;
+        next.y += next.z;
+        next.z = 0;
+    }
+    if( next.x + awidth > (int)self->width - 1 || next.y + aheight > (int)self->height - 1 )
+        return 0;
+
+    *region = (ivec4){{next.x, next.y, awidth, aheight}};
+    next.x += awidth;
+    if( aheight > next.z )
+        next.z = aheight;
+    *shelf = next;
+    return 1;
+}
+
+
+// ---------------------------------------------------- texture_atlas_pack ---
+/* Allocate a region and its spacing with the packer of the atlas, free
+ * regions never reaching past the border: the spacing is kept there too */
+static ivec4
+texture_atlas_pack( texture_atlas_t * self,
+                    const size_t width,
+                    const size_t height )
+{
+    int awidth = (int)(width + self->spacing_horiz);
+    int aheight = (int)(height + self->spacing_vert);
+    ivec4 region;
+    int placed;
+
+    if( self->packer == PACKER_MAXRECTS )
+        placed = texture_atlas_maxrects( self, awidth, aheight, &region );
+    else if( self->packer == PACKER_GUILLOTINE )
+        placed = texture_atlas_split_free( self, awidth, aheight, &region );
+    else
+        placed = texture_atlas_shelf( self, awidth, aheight, &region );
+    if( !placed )
+        return (ivec4){{-1,-1,0,0}};
+
+    self->used += width * height;
+    self->modified = 1;
+    return region;
+}
+
+
+// ----------------------------------------------- texture_atlas_allocate ---
+/* Allocate a region in the skyline, or with the packer of the atlas */
+static ivec4
+texture_atlas_allocate( texture_atlas_t * self,
+                        const size_t width,
+                        const size_t height )
+{
+    int y, best_index;
+    size_t best_height, best_width;
+    ivec3 *node, *prev;
+    ivec4 region = {{0,0,width,height}};
+    size_t i;
+
+    assert( self );
+
+    if( self->packer != PACKER_SKYLINE )
+        return texture_atlas_pack( self, width, height );
+    if( texture_atlas_reuse_region( self, width, height, &region ) )
+        return region;
+
+    best_height = UINT_MAX;
+    best_index  = -1;
+    best_width = UINT_MAX;
+
+    for( i=0; i<self->nodes->size; ++i )
+    {
+        size_t awidth = width + self->spacing_horiz, aheight = height + self->spacing_vert;
+
+        /* The region cannot end up lower on this node than on the best one */
+        node = (ivec3 *) vector_get( self->nodes, i );
+        if( (size_t) node->y + height > best_height )
+            continue;
+
+        /* Without the spacing that does not fit against the border, as the
+         * region is given back with the spacing that fits */
+        y = texture_atlas_fit( self, i, awidth, aheight );
+        if( y < 0 && self->spacing_vert > 0 )
+            y = texture_atlas_fit( self, i, awidth, aheight = height );
+        if( node->x + awidth > self->width - 1 )
+        {
+            if( y < 0 && self->spacing_horiz > 0 )
+                y = texture_atlas_fit( self, i, awidth = width, aheight = height + self->spacing_vert );
+            if( y < 0 && self->spacing_horiz > 0 && self->spacing_vert > 0 )
+                y = texture_atlas_fit( self, i, awidth = width, aheight = height );
+        }
+        if( y >= 0 )
+	{
+            if( ( (y + aheight) < best_height ) ||
+                ( ((y + aheight) == best_height) && (node->z > 0 && (size_t)node->z < best_width)) )
+            {
+                best_height = y + aheight;
+                best_index = i;
+                best_width = node->z;
+                region.x = node->x;
+                region.y = y;
+                region.width = awidth;
+                region.height = aheight;
+            }
+        }
+    }
+    
+    if( best_index == -1 )
+    {
+        region.x = -1;
+        region.y = -1;
+        region.width = 0;
+        region.height = 0;
+        return region;
+    }
+
+    /* An empty region takes no column */
+    if( !region.width )
+    {
+        self->used += width * height;
+        self->modified = 1;
         return region;
     }
 
@@ -294,30 +1644,772 @@ texture_atlas_get_region( texture_atlas_t * self,
             break;
         }
     }
-    texture_atlas_merge( self );
+    texture_atlas_merge_at( self, best_index );
     self->used += width * height;
     self->modified = 1;    
     return region;
 }
 
-
-// ---------------------------------------------------- texture_atlas_clear ---
-void
-texture_atlas_clear( texture_atlas_t * self )
+// ------------------------------------------- texture_atlas_grow_full ---
+/* Grow a full atlas geometrically, doubling its smaller side up to its
+ * maximum size, the height first as rows are not moved. Returns 0 if it
+ * cannot grow or the region could never fit. */
+static int
+texture_atlas_grow_full( texture_atlas_t * self,
+                         const size_t width,
+                         const size_t height )
 {
-    ivec3 node = {{1,1,1}};
+    size_t width_new = self->width, height_new = self->height;
 
-    assert( self );
-    assert( self->data );
+    if( self->pages || (self->width >= self->max_width &&
+                        self->height >= self->max_height) ||
+        width + self->spacing_horiz + 2 > self->max_width ||
+        height + self->spacing_vert + 2 > self->max_height )
+        return 0;
 
-    vector_clear( self->nodes );
-    self->used = 0;
-    // We want a one pixel border around the whole atlas to avoid any artefact when
-    // sampling texture
-    node.z = self->width-2;
+    if( self->height < self->max_height &&
+        (self->height <= self->width || self->width >= self->max_width) )
+        height_new = 2 * self->height < self->max_height ? 2 * self->height : self->max_height;
+    else
+        width_new = 2 * self->width < self->max_width ? 2 * self->width : self->max_width;
+    texture_atlas_grow( self, width_new, height_new );
+    return 1;
+}
 
-    vector_push_back( self->nodes, &node );
+// ----------------------------------------------- texture_atlas_region_in ---
+/* Allocate a region in a channel, growing the atlas if asked to */
+static ivec4
+texture_atlas_region_in( texture_atlas_t * self,
+                         const size_t width,
+                         const size_t height,
+                         const size_t channel,
+                         int grow )
+{
+    size_t awidth = width, aheight = height;
+    ivec4 region;
+
+    /* Aligned regions take whole blocks, their spacing included */
+    if( self->align > 1 && width && height )
+    {
+        awidth = texture_atlas_round( self, width + self->spacing_horiz ) - self->spacing_horiz;
+        aheight = texture_atlas_round( self, height + self->spacing_vert ) - self->spacing_vert;
+    }
+    texture_atlas_swap_layer( self, channel );
+    region = texture_atlas_allocate( self, awidth, aheight );
+    texture_atlas_swap_layer( self, channel );
+    while( region.x < 0 && grow && texture_atlas_grow_full( self, awidth, aheight ) )
+    {
+        texture_atlas_swap_layer( self, channel );
+        region = texture_atlas_allocate( self, awidth, aheight );
+        texture_atlas_swap_layer( self, channel );
+    }
+
+    /* Pixels written to a region without setting it get uploaded too */
+    if( region.x >= 0 )
+        texture_atlas_mark_dirty( self, region.x, region.y, width, height );
+    return region;
+}
+
+// ----------------------------------------------- texture_atlas_get_region ---
+ivec4
+texture_atlas_get_region( texture_atlas_t * self,
+                          const size_t width,
+                          const size_t height )
+{
+    return texture_atlas_region_in( self, width, height, 0, 1 );
+}
+
+
+// ------------------------------------------------ texture_atlas_add_page ---
+/* A new page like the first one, NULL if there are max_pages already */
+static texture_atlas_t *
+texture_atlas_add_page( texture_atlas_t * self )
+{
+    texture_atlas_t *added;
+
+    if( texture_atlas_page_count( self ) >= self->max_pages )
+        return NULL;
+    if( !self->pages && !(self->pages = vector_new( sizeof(texture_atlas_t *) )) )
+    {
+        freetype_gl_error( Out_Of_Memory );
+        return NULL;
+    }
+    if( !(added = texture_atlas_new_with_packer( self->width, self->height,
+                                                 self->depth, self->packer )) )
+        return NULL;
+    added->spacing_horiz = self->spacing_horiz;
+    added->spacing_vert = self->spacing_vert;
+    if( self->align > 1 )
+        texture_atlas_set_align( added, self->align );
+    if( self->channels > 1 )
+        texture_atlas_set_channels( added, self->channels );
+    vector_push_back( self->pages, &added );
+    return added;
+}
+
+
+// ------------------------------------------ texture_atlas_get_page_region ---
+ivec4
+texture_atlas_get_page_region( texture_atlas_t * self,
+                               const size_t width,
+                               const size_t height,
+                               size_t * page )
+{
+    texture_atlas_t *added;
+    ivec4 region;
+    size_t count = texture_atlas_page_count( self );
+
+    assert( self );
+    assert( page );
+
+    for( *page = 0; *page < count; ++*page )
+    {
+        region = texture_atlas_get_region( texture_atlas_get_page( self, *page ),
+                                           width, height );
+        if( region.x >= 0 )
+            return region;
+    }
+
+    /* A new page, without touching the others */
+    *page = 0;
+    if( !(added = texture_atlas_add_page( self )) )
+        return region;
+    *page = count;
+    return texture_atlas_get_region( added, width, height );
+}
+
+
+// --------------------------------------- texture_atlas_get_channel_region ---
+ivec4
+texture_atlas_get_channel_region( texture_atlas_t * self,
+                                  const size_t width,
+                                  const size_t height,
+                                  size_t * page,
+                                  size_t * channel )
+{
+    texture_atlas_t *added;
+    ivec4 region;
+    size_t count = texture_atlas_page_count( self );
+
+    assert( self );
+    assert( page );
+    assert( channel );
+
+    /* Every channel of a page before it grows, as when packed together */
+    for( *page = 0; *page < count; ++*page )
+        for( *channel = 0; *channel < self->channels; ++*channel )
+        {
+            region = texture_atlas_region_in( texture_atlas_get_page( self, *page ),
+                                              width, height, *channel,
+                                              *channel == self->channels - 1 );
+            if( region.x >= 0 )
+                return region;
+        }
+
+    *page = *channel = 0;
+    if( !(added = texture_atlas_add_page( self )) )
+        return region;
+    *page = count;
+    return texture_atlas_region_in( added, width, height, 0, 1 );
+}
+
+
+// ----------------------------------------------- texture_atlas_page_count ---
+size_t
+texture_atlas_page_count( const texture_atlas_t * self )
+{
+    assert( self );
+
+    return self->pages ? 1 + vector_size( self->pages ) : 1;
+}
+
+
+// ------------------------------------------------- texture_atlas_get_page ---
+texture_atlas_t *
+texture_atlas_get_page( texture_atlas_t * self,
+                        const size_t page )
+{
+    assert( self );
+    assert( page < texture_atlas_page_count( self ) );
+
+    if( !page )
+        return self;
+    return *(texture_atlas_t **) vector_get( self->pages, page - 1 );
+}
+
+
+// ---------------------------------------------------- texture_atlas_clear ---
+void
+texture_atlas_clear( texture_atlas_t * self )
+{
+    texture_atlas_layer_t *layer;
+    size_t i;
+
+    assert( self );
+    assert( self->data );
+
+    for( i = 1; i < texture_atlas_page_count( self ); ++i )
+        texture_atlas_clear( texture_atlas_get_page( self, i ) );
+
+    texture_atlas_empty( self, self->nodes, self->free_regions );
+    for( i = 1; i < self->channels; ++i )
+    {
+        layer = (texture_atlas_layer_t *) vector_get( self->layers, i - 1 );
+        texture_atlas_empty( self, layer->nodes, layer->free_regions );
+    }
+    self->used = 0;
+    if( self->shared )
+    {
+        hash_table_clear( self->shared );
+        hash_table_clear( self->shared_at );
+    }
+    self->shared_bytes = 0;
     memset( self->data, 0, self->width*self->height*self->depth );
+    texture_atlas_mark_dirty( self, 0, 0, self->width, self->height );
+}
+
+
+// ----------------------------------------------- texture_atlas_set_align ---
+void
+texture_atlas_set_align( texture_atlas_t * self,
+                         const size_t align )
+{
+    size_t i;
+
+    assert( self );
+    assert( align >= 1 );
+    assert( !self->baked );
+
+    for( i = 1; i < texture_atlas_page_count( self ); ++i )
+        texture_atlas_get_page( self, i )->align = align;
+    self->align = align;
+    texture_atlas_clear( self );
+
+    /* The special glyph, in the first block */
+    texture_glyph_delete( self->special );
+    texture_atlas_special( self );
+}
+
+// -------------------------------------------- texture_atlas_set_channels ---
+void
+texture_atlas_set_channels( texture_atlas_t * self,
+                            const size_t channels )
+{
+    texture_atlas_layer_t layer;
+    size_t i;
+
+    assert( self );
+    assert( channels == 1 || (channels == 4 && self->depth == 4) );
+    assert( !self->baked );
+
+    for( i = 1; i < texture_atlas_page_count( self ); ++i )
+        texture_atlas_set_channels( texture_atlas_get_page( self, i ), channels );
+    texture_atlas_delete_layers( self );
+    if( channels > 1 )
+    {
+        self->layers = vector_new( sizeof(texture_atlas_layer_t) );
+        for( i = 1; i < channels; ++i )
+        {
+            layer.nodes = vector_new( sizeof(ivec3) );
+            layer.free_regions = vector_new( sizeof(ivec4) );
+            vector_push_back( self->layers, &layer );
+        }
+    }
+    self->channels = channels;
+    texture_atlas_clear( self );
+
+    /* The special glyph, in the first channel alone */
+    texture_glyph_delete( self->special );
+    texture_atlas_special( self );
+}
+
+// --------------------------------------------- texture_atlas_set_sharing ---
+void
+texture_atlas_set_sharing( texture_atlas_t * self,
+                           const int sharing )
+{
+    assert( self );
+
+    if( !sharing == !self->shared )
+        return;
+    if( sharing )
+    {
+        self->shared = hash_table_new( sizeof(texture_atlas_content_t),
+                                       sizeof(texture_atlas_place_t) );
+        self->shared_at = hash_table_new( sizeof(texture_atlas_place_t),
+                                          sizeof(texture_atlas_share_t) );
+        if( self->shared && self->shared_at )
+            return;
+        freetype_gl_error( Out_Of_Memory );
+    }
+    if( self->shared )
+        hash_table_delete( self->shared );
+    if( self->shared_at )
+        hash_table_delete( self->shared_at );
+    self->shared = self->shared_at = NULL;
+    self->shared_bytes = 0;
+}
+
+// ---------------------------------------------- texture_atlas_taller_first ---
+/* Packing order of texture_atlas_repack: tallest regions first, then widest */
+static int
+texture_atlas_taller_first( const void * a, const void * b )
+{
+    const ivec4 *first = &((const texture_atlas_remap_t *) a)->from;
+    const ivec4 *second = &((const texture_atlas_remap_t *) b)->from;
+
+    if( first->height != second->height )
+        return second->height - first->height;
+    if( first->width != second->width )
+        return second->width - first->width;
+    if( first->y != second->y )
+        return first->y - second->y;
+    return first->x - second->x;
+}
+
+// ------------------------------------------------ texture_atlas_remap_cmp ---
+/* Order of remap tables: old position, row first */
+static int
+texture_atlas_remap_cmp( const void * a, const void * b )
+{
+    const ivec4 *first = &((const texture_atlas_remap_t *) a)->from;
+    const ivec4 *second = &((const texture_atlas_remap_t *) b)->from;
+
+    if( first->y != second->y )
+        return first->y - second->y;
+    return first->x - second->x;
+}
+
+// --------------------------------------------------- texture_atlas_repack ---
+vector_t *
+texture_atlas_repack( texture_atlas_t * self,
+                      const vector_t * regions )
+{
+    texture_glyph_t *special = (texture_glyph_t *) self->special;
+    vector_t *remap, *nodes, *free_regions;
+    texture_atlas_remap_t move, *moves;
+    unsigned char *data;
+    size_t i, y, used, depth = self->depth;
+    ivec4 region, special_region;
+
+    assert( self );
+    assert( regions );
+
+    if( self->channels > 1 )
+        return NULL;
+    remap = vector_new( sizeof(texture_atlas_remap_t) );
+    nodes = vector_new( sizeof(ivec3) );
+    free_regions = vector_new( sizeof(ivec4) );
+    data = (unsigned char *)
+        calloc( self->width * self->height * depth, sizeof(unsigned char) );
+    if( !remap || !nodes || !free_regions || !data )
+    {
+        if( remap )
+            vector_delete( remap );
+        if( nodes )
+            vector_delete( nodes );
+        if( free_regions )
+            vector_delete( free_regions );
+        free( data );
+        freetype_gl_error( Out_Of_Memory );
+        return NULL;
+    }
+
+    /* The special region goes along, in the 5x5 region it was made in */
+    move.from.x = (int) (special->s0 * self->width + .5f) - 2;
+    move.from.y = (int) (special->t0 * self->height + .5f) - 2;
+    move.from.width = move.from.height = 5;
+    special_region = move.from;
+    vector_push_back( remap, &move );
+    for( i = 0; i < vector_size( regions ); ++i )
+    {
+        move.from = *(const ivec4 *) vector_get( regions, i );
+        if( move.from.width > 0 && move.from.height > 0 )
+            vector_push_back( remap, &move );
+    }
+
+    /* Regions shared by several glyphs are moved once */
+    vector_sort( remap, texture_atlas_remap_cmp );
+    for( i = 1; i < vector_size( remap ); )
+    {
+        moves = (texture_atlas_remap_t *) remap->items;
+        if( !memcmp( &moves[i].from, &moves[i-1].from, sizeof(ivec4) ) )
+            vector_erase( remap, i );
+        else
+            ++i;
+    }
+
+    /* Pack them again from an empty atlas, keeping the old skyline or free
+     * regions to go back to if they do not fit anymore. The atlas does not
+     * grow meanwhile: data and coordinates are those of its current size */
+    texture_atlas_empty( self, nodes, free_regions );
+    texture_atlas_swap_skyline( self, &nodes, &free_regions );
+    used = self->used;
+    self->used = 0;
+    vector_sort( remap, texture_atlas_taller_first );
+    for( i = 0; i < vector_size( remap ); ++i )
+    {
+        moves = (texture_atlas_remap_t *) vector_get( remap, i );
+        region = texture_atlas_region_in( self, moves->from.width,
+                                          moves->from.height, 0, 0 );
+        if( region.x < 0 )
+        {
+            texture_atlas_swap_skyline( self, &nodes, &free_regions );
+            self->used = used;
+            vector_delete( remap );
+            vector_delete( nodes );
+            vector_delete( free_regions );
+            free( data );
+            return NULL;
+        }
+        moves->to.x = region.x;
+        moves->to.y = region.y;
+    }
+    vector_delete( nodes );
+    vector_delete( free_regions );
+
+    /* Every pixel moves once, from the old data to the new */
+    for( i = 0; i < vector_size( remap ); ++i )
+    {
+        moves = (texture_atlas_remap_t *) vector_get( remap, i );
+        for( y = 0; y < (size_t) moves->from.height; ++y )
+            memcpy( data + ((moves->to.y + y) * self->width + moves->to.x) * depth,
+                    self->data + ((moves->from.y + y) * self->width + moves->from.x) * depth,
+                    moves->from.width * depth );
+        if( !memcmp( &moves->from, &special_region, sizeof(ivec4) ) )
+        {
+            special->s0 += (moves->to.x - moves->from.x) / (float) self->width;
+            special->s1 += (moves->to.x - moves->from.x) / (float) self->width;
+            special->t0 += (moves->to.y - moves->from.y) / (float) self->height;
+            special->t1 += (moves->to.y - moves->from.y) / (float) self->height;
+        }
+    }
+    if( self->baked )
+    {
+        baked_font_release( self->baked );
+        self->baked = NULL;
+    }
+    else
+    {
+        free( self->data );
+    }
+    self->data = data;
+    texture_atlas_mark_dirty( self, 0, 0, self->width, self->height );
+
+    vector_sort( remap, texture_atlas_remap_cmp );
+    if( self->shared )
+        texture_atlas_repack_shared( self, regions, remap );
+    return remap;
+}
+
+// ----------------------------------------------- texture_atlas_remap_find ---
+const texture_atlas_remap_t *
+texture_atlas_remap_find( const vector_t * remap,
+                          int x,
+                          int y )
+{
+    const texture_atlas_remap_t *moves;
+    size_t low = 0, high, middle, i;
+
+    assert( remap );
+
+    /* Top left corners first, those of glyphs */
+    moves = (const texture_atlas_remap_t *) remap->items;
+    high = remap->size;
+    while( low < high )
+    {
+        middle = (low + high) / 2;
+        if( moves[middle].from.y < y ||
+            (moves[middle].from.y == y && moves[middle].from.x < x) )
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if( low < remap->size && moves[low].from.x == x && moves[low].from.y == y )
+        return moves + low;
+
+    for( i = 0; i < remap->size; ++i )
+        if( x >= moves[i].from.x && x < moves[i].from.x + moves[i].from.width &&
+            y >= moves[i].from.y && y < moves[i].from.y + moves[i].from.height )
+            return moves + i;
+    return NULL;
+}
+
+// ------------------------------------------------- texture_atlas_trial_t ---
+/* A packing tried by texture_atlas_plan: a packer and an order */
+typedef struct texture_atlas_trial_t
+{
+    texture_atlas_packer_t packer;
+    const size_t *order;
+    size_t placed;
+    int bottom;         /* greatest y + height of the regions placed */
+} texture_atlas_trial_t;
+
+/* Regions of texture_atlas_plan, sorted along with their index */
+typedef struct texture_atlas_key_t
+{
+    ivec2 size;
+    size_t index;
+} texture_atlas_key_t;
+
+/* Trials of texture_atlas_plan run on a thread: first, first + step, ... */
+typedef struct texture_atlas_planner_t
+{
+    const texture_atlas_t *self;
+    const ivec2 *sizes;
+    size_t count;
+    texture_atlas_trial_t *trials;
+    size_t first, step;
+    int started;
+} texture_atlas_planner_t;
+
+/* Orders and packers texture_atlas_plan tries every pair of */
+#define TEXTURE_ATLAS_ORDERS  4
+#define TEXTURE_ATLAS_PACKERS 4
+#define TEXTURE_ATLAS_TRIALS  (TEXTURE_ATLAS_ORDERS * TEXTURE_ATLAS_PACKERS)
+
+// ---------------------------------------------------- texture_atlas_order ---
+/* Orders of texture_atlas_plan: tallest, largest, widest and longest side
+ * first, ties going by index so that sorting is stable */
+static int
+texture_atlas_order( const texture_atlas_key_t * a,
+                     const texture_atlas_key_t * b,
+                     int first, int second, int other_first, int other_second )
+{
+    if( first != other_first )
+        return other_first > first ? 1 : -1;
+    if( second != other_second )
+        return other_second > second ? 1 : -1;
+    return a->index < b->index ? -1 : a->index > b->index;
+}
+
+static int
+texture_atlas_taller( const void * a, const void * b )
+{
+    const texture_atlas_key_t *first = (const texture_atlas_key_t *) a;
+    const texture_atlas_key_t *second = (const texture_atlas_key_t *) b;
+
+    return texture_atlas_order( first, second, first->size.y, first->size.x,
+                                second->size.y, second->size.x );
+}
+
+static int
+texture_atlas_larger( const void * a, const void * b )
+{
+    const texture_atlas_key_t *first = (const texture_atlas_key_t *) a;
+    const texture_atlas_key_t *second = (const texture_atlas_key_t *) b;
+
+    return texture_atlas_order( first, second, first->size.x * first->size.y,
+                                first->size.y, second->size.x * second->size.y,
+                                second->size.y );
+}
+
+static int
+texture_atlas_wider( const void * a, const void * b )
+{
+    const texture_atlas_key_t *first = (const texture_atlas_key_t *) a;
+    const texture_atlas_key_t *second = (const texture_atlas_key_t *) b;
+
+    return texture_atlas_order( first, second, first->size.x, first->size.y,
+                                second->size.x, second->size.y );
+}
+
+static int
+texture_atlas_longer( const void * a, const void * b )
+{
+    const texture_atlas_key_t *first = (const texture_atlas_key_t *) a;
+    const texture_atlas_key_t *second = (const texture_atlas_key_t *) b;
+    int long_a = first->size.x > first->size.y ? first->size.x : first->size.y;
+    int long_b = second->size.x > second->size.y ? second->size.x : second->size.y;
+
+    return texture_atlas_order( first, second, long_a,
+                                first->size.x + first->size.y - long_a, long_b,
+                                second->size.x + second->size.y - long_b );
+}
+
+// ------------------------------------------------------ texture_atlas_try ---
+/* Pack the regions of a trial in a new atlas of the size of self, counting
+ * those placed. It is given up, as placing none, once it cannot beat a
+ * packing of every region with a bottom of bound. */
+static void
+texture_atlas_try( const texture_atlas_t * self,
+                   const ivec2 * sizes,
+                   size_t count,
+                   int bound,
+                   texture_atlas_trial_t * trial )
+{
+    texture_atlas_t *atlas;
+    const ivec2 *size;
+    ivec4 region;
+    size_t i;
+
+    trial->placed = 0;
+    trial->bottom = 0;
+    if( !(atlas = texture_atlas_new_with_packer( self->width, self->height,
+                                                 1, trial->packer )) )
+        return;
+    atlas->spacing_horiz = self->spacing_horiz;
+    atlas->spacing_vert = self->spacing_vert;
+    if( self->align > 1 )
+        texture_atlas_set_align( atlas, self->align );
+    for( i = 0; i < count; ++i )
+    {
+        size = sizes + trial->order[i];
+        region = texture_atlas_get_region( atlas, size->x, size->y );
+        if( region.x >= 0 )
+        {
+            trial->placed++;
+            if( region.y + size->y > trial->bottom )
+                trial->bottom = region.y + size->y;
+        }
+        if( (region.x < 0 && bound < INT_MAX) || trial->bottom > bound )
+        {
+            trial->placed = 0;
+            break;
+        }
+    }
+    texture_atlas_delete( atlas );
+}
+
+// -------------------------------------------------- texture_atlas_planner ---
+#if defined(_WIN32) || defined(_WIN64)
+static DWORD WINAPI
+#else
+static void *
+#endif
+texture_atlas_planner( void * data )
+{
+    texture_atlas_planner_t *planner = (texture_atlas_planner_t *) data;
+    texture_atlas_trial_t *trial;
+    int bound = INT_MAX;
+    size_t i;
+
+    /* Trials given up could not have been the densest, which is then the
+     * same whatever the number of threads */
+    for( i = planner->first; i < TEXTURE_ATLAS_TRIALS; i += planner->step )
+    {
+        trial = planner->trials + i;
+        texture_atlas_try( planner->self, planner->sizes, planner->count, bound, trial );
+        if( trial->placed == planner->count && trial->bottom < bound )
+            bound = trial->bottom;
+    }
+    return 0;
+}
+
+// ----------------------------------------------------- texture_atlas_plan ---
+size_t
+texture_atlas_plan( const texture_atlas_t * self,
+                    const ivec2 * sizes,
+                    size_t count,
+                    size_t threads,
+                    texture_atlas_packer_t * packer,
+                    size_t * order )
+{
+    static int (* const orders[TEXTURE_ATLAS_ORDERS])( const void *, const void * ) = {
+        texture_atlas_taller, texture_atlas_larger,
+        texture_atlas_wider, texture_atlas_longer };
+    /* The slowest last, most of its trials being given up early */
+    static const texture_atlas_packer_t packers[TEXTURE_ATLAS_PACKERS] = {
+        PACKER_SKYLINE, PACKER_SHELF, PACKER_GUILLOTINE, PACKER_MAXRECTS };
+    texture_atlas_trial_t trials[TEXTURE_ATLAS_TRIALS];
+    texture_atlas_planner_t planners[TEXTURE_ATLAS_TRIALS];
+    texture_atlas_key_t *keys;
+    size_t *sorted, i, k, best = 0;
+#ifdef FREETYPE_GL_THREADS
+# if defined(_WIN32) || defined(_WIN64)
+    HANDLE handles[TEXTURE_ATLAS_TRIALS];
+# else
+    pthread_t handles[TEXTURE_ATLAS_TRIALS];
+# endif
+#endif
+
+    assert( self );
+    assert( packer );
+    assert( order );
+
+    keys = (texture_atlas_key_t *) malloc( (count ? count : 1) * sizeof(*keys) );
+    sorted = (size_t *) malloc( (count ? count : 1) * TEXTURE_ATLAS_ORDERS * sizeof(size_t) );
+    if( !keys || !sorted )
+    {
+        free( keys );
+        free( sorted );
+        freetype_gl_error( Out_Of_Memory );
+        return 0;
+    }
+
+    /* Each order is shared by the trials of every packer */
+    for( k = 0; k < TEXTURE_ATLAS_ORDERS; ++k )
+    {
+        for( i = 0; i < count; ++i )
+        {
+            keys[i].size = sizes[i];
+            keys[i].index = i;
+        }
+        qsort( keys, count, sizeof(*keys), orders[k] );
+        for( i = 0; i < count; ++i )
+            sorted[k * count + i] = keys[i].index;
+    }
+    free( keys );
+    for( i = 0; i < TEXTURE_ATLAS_TRIALS; ++i )
+    {
+        trials[i].packer = packers[i / TEXTURE_ATLAS_ORDERS];
+        trials[i].order = sorted + (i % TEXTURE_ATLAS_ORDERS) * count;
+    }
+
+    if( threads < 1 )
+        threads = 1;
+    if( threads > TEXTURE_ATLAS_TRIALS )
+        threads = TEXTURE_ATLAS_TRIALS;
+    for( i = 0; i < threads; ++i )
+    {
+        planners[i].self = self;
+        planners[i].sizes = sizes;
+        planners[i].count = count;
+        planners[i].trials = trials;
+        planners[i].first = i;
+        planners[i].step = threads;
+        planners[i].started = 0;
+#ifdef FREETYPE_GL_THREADS
+        if( threads > 1 )
+        {
+# if defined(_WIN32) || defined(_WIN64)
+            handles[i] = CreateThread( NULL, 0, texture_atlas_planner, planners + i, 0, NULL );
+            planners[i].started = handles[i] != NULL;
+# else
+            planners[i].started = !pthread_create( &handles[i], NULL,
+                                                   texture_atlas_planner, planners + i );
+# endif
+        }
+#endif
+        /* Without a thread, do its share here */
+        if( !planners[i].started )
+            texture_atlas_planner( planners + i );
+    }
+#ifdef FREETYPE_GL_THREADS
+    for( i = 0; i < threads; ++i )
+    {
+        if( !planners[i].started )
+            continue;
+# if defined(_WIN32) || defined(_WIN64)
+        WaitForSingleObject( handles[i], INFINITE );
+        CloseHandle( handles[i] );
+# else
+        pthread_join( handles[i], NULL );
+# endif
+    }
+#endif
+
+    /* The most regions placed, then the lowest bottom: the first trial
+     * wins ties, the skyline packing regions tallest first */
+    for( i = 1; i < TEXTURE_ATLAS_TRIALS; ++i )
+        if( trials[i].placed > trials[best].placed ||
+            (trials[i].placed == trials[best].placed &&
+             trials[i].bottom < trials[best].bottom) )
+            best = i;
+    *packer = trials[best].packer;
+    memcpy( order, trials[best].order, count * sizeof(size_t) );
+    free( sorted );
+    return trials[best].placed;
 }
 
 // -------------------------------------------- texture_atlas_enlarge_atlas ---
@@ -325,6 +2417,7 @@ texture_atlas_clear( texture_atlas_t * self )
 void texture_atlas_enlarge_texture ( texture_atlas_t* self, size_t width_new, size_t height_new)
 {
     assert(self);
+    assert(!self->pages);
     //ensure size increased
     assert(width_new >= self->width);
     assert(height_new >= self->height);
@@ -332,24 +2425,158 @@ void texture_atlas_enlarge_texture ( texture_atlas_t* self, size_t width_new, si
 
     size_t width_old = self->width;
     size_t height_old = self->height;    
-    //allocate new buffer
+    size_t pixel_size = sizeof(char) * self->depth;
+    size_t y, c;
+    //allocate new buffer, growing the data in place unless mapped from a baked font
     unsigned char* data_old = self->data;
-    self->data = calloc(1,width_new*height_new * sizeof(char)*self->depth);    
+    unsigned char* data_new;
+    if( self->baked )
+        data_new = calloc(1,width_new*height_new * pixel_size);
+    else
+        data_new = realloc(self->data, width_new*height_new * pixel_size);
+    if( !data_new )
+    {
+        freetype_gl_error( Out_Of_Memory );
+        return;
+    }
+    self->data = data_new;
     //update atlas size
     self->width = width_new;
     self->height = height_new;
-    //add node reflecting the gained space on the right
-    if( width_new>width_old )
+    //the gained space starts at the old border, or at the next block if regions are aligned
+    int edge_x = self->align > 1 ? (int)width_old : (int)width_old - 1;
+    int edge_y = self->align > 1 ? (int)height_old : (int)height_old - 1;
+    //compressed blocks are of the old size
+    free( self->blocks );
+    self->blocks = NULL;
+    //every channel packed apart gains the space
+    for( c = 0; c < self->channels; ++c )
     {
-        ivec3 node;
-        node.x = width_old - 1;
-        node.y = 1;
-        node.z = width_new - width_old;
-        vector_push_back(self->nodes, &node);    
+        texture_atlas_swap_layer( self, c );
+        //add node reflecting the gained space on the right
+        if( width_new>width_old && self->packer == PACKER_SKYLINE )
+        {
+            ivec3 node;
+            node.x = edge_x;
+            node.y = (int)self->align;
+            node.z = (int)width_new - 1 - edge_x;
+            vector_push_back(self->nodes, &node);    
+            texture_atlas_merge( self );
+        }
+        //or free regions on the right of the regions and below them
+        else if( self->packer != PACKER_SKYLINE )
+        {
+            ivec4 region = {{edge_x, (int)self->align, (int)width_new - 1 - edge_x, edge_y - (int)self->align}};
+
+            //the current shelf and those below it get the width as they go
+            if( self->packer == PACKER_SHELF )
+                region.height = ((ivec3 *) vector_get( self->nodes, 0 ))->y - (int)self->align;
+            if( region.width > 0 && region.height > 0 )
+                vector_push_back( self->free_regions, &region );
+            region = (ivec4){{(int)self->align, edge_y, (int)width_new - 1 - (int)self->align, (int)height_new - 1 - edge_y}};
+            if( region.height > 0 && self->packer != PACKER_SHELF )
+                vector_push_back( self->free_regions, &region );
+        }
+        texture_atlas_swap_layer( self, c );
     }
-    //copy over data from the old buffer, skipping first row and column because of the margin
-    size_t pixel_size = sizeof(char) * self->depth;
     size_t old_row_size = width_old * pixel_size;
-    texture_atlas_set_region(self, 1, 1, width_old - 2, height_old - 2, data_old + old_row_size + pixel_size, old_row_size);
-    free(data_old);    
+    if( self->baked )
+    {
+        //copy over data from the old buffer, skipping first row and column because of the margin
+        texture_atlas_set_region(self, 1, 1, width_old - 2, height_old - 2, data_old + old_row_size + pixel_size, old_row_size);
+        baked_font_release( self->baked );
+        self->baked = NULL;
+    }
+    else
+    {
+        //rows move to their new stride from the last one, none being overwritten before it moves,
+        //the rest of each row being cleared of the rows that were there
+        if( width_new > width_old )
+            for( y = height_old; y-- > 0; )
+            {
+                memmove( self->data + y * width_new * pixel_size,
+                         self->data + y * old_row_size, old_row_size );
+                memset( self->data + y * width_new * pixel_size + old_row_size, 0,
+                        (width_new - width_old) * pixel_size );
+            }
+        memset( self->data + height_old * width_new * pixel_size, 0,
+                (height_new - height_old) * width_new * pixel_size );
+    }    
+    //the texture is created again at its new size
+    texture_atlas_mark_dirty( self, 0, 0, width_new, height_new );
+}
+
+// ---------------------------------------------------- texture_atlas_grow ---
+void
+texture_atlas_grow( texture_atlas_t * self,
+                    size_t width_new,
+                    size_t height_new )
+{
+    texture_font_t *font, *other;
+    texture_glyph_t *special = (texture_glyph_t *) self->special;
+    float mulw = (float) self->width / width_new;
+    float mulh = (float) self->height / height_new;
+    size_t i, k;
+
+    assert( self );
+
+    texture_atlas_enlarge_texture( self, width_new, height_new );
+    if( self->width != width_new || self->height != height_new )
+        return;
+
+    /* Once for each glyph table: clones of the same size share theirs */
+    for( i = 0; i < vector_size( self->fonts ); ++i )
+    {
+        font = *(texture_font_t **) vector_get( self->fonts, i );
+        for( k = 0; k < i; ++k )
+        {
+            other = *(texture_font_t **) vector_get( self->fonts, k );
+            if( other->glyphs == font->glyphs )
+                break;
+        }
+        if( k == i && font->scaletex )
+            texture_font_enlarge_glyphs( font, mulw, mulh );
+    }
+    if( special )
+    {
+        special->s0 *= mulw;
+        special->s1 *= mulw;
+        special->t0 *= mulh;
+        special->t1 *= mulh;
+    }
+}
+
+
+// -------------------------------------------------- texture_atlas_attach ---
+void
+texture_atlas_attach( texture_atlas_t * self,
+                      texture_font_t * font )
+{
+    assert( self );
+    assert( font && font->atlas == self );
+
+    if( font->attached )
+        return;
+    vector_push_back( self->fonts, &font );
+    font->attached = 1;
+}
+
+
+// -------------------------------------------------- texture_atlas_detach ---
+void
+texture_atlas_detach( texture_atlas_t * self,
+                      texture_font_t * font )
+{
+    size_t i;
+
+    assert( self );
+    assert( font );
+
+    for( i = 0; i < vector_size( self->fonts ); ++i )
+        if( *(texture_font_t **) vector_get( self->fonts, i ) == font )
+        {
+            vector_erase( self->fonts, i );
+            break;
+        }
+    font->attached = 0;
 }
@@ -26,6 +26,7 @@ extern "C" {
 
 #include "vector.h"
 #include "vec234.h"
+#include "hash-table.h"
 
 #ifdef __cplusplus
 namespace ftgl {
@@ -46,6 +47,9 @@ namespace ftgl {
  * algorithm based on C++ sources provided by Jukka Jylänki at:
  * http://clb.demon.fi/files/RectangleBinPack/
  *
+ * The MaxRects, Guillotine and Shelf algorithms of the same article may be
+ * chosen instead when creating an atlas (see texture_atlas_packer_t).
+ *
  *
  * Example Usage:
  * @code
@@ -70,16 +74,64 @@ namespace ftgl {
  */
 
 
+/**
+ * Algorithms packing the regions of an atlas, trading the surface they
+ * leave unused against the time they take to allocate a region.
+ */
+typedef enum texture_atlas_packer_t
+{
+    /**
+     * Skyline Bottom-Left: lowest top in the skyline of the regions, then
+     * narrowest node. The default.
+     */
+    PACKER_SKYLINE = 0,
+
+    /**
+     * MaxRects Best Short Side Fit: the maximal free rectangle leaving the
+     * shortest side, free rectangles overlapping one another. The densest,
+     * and the slowest as free rectangles add up.
+     */
+    PACKER_MAXRECTS,
+
+    /**
+     * Guillotine Best Area Fit: the smallest free rectangle, the rest of it
+     * split along its shorter side into two.
+     */
+    PACKER_GUILLOTINE,
+
+    /**
+     * Shelf Next Fit: rows as tall as their first region, the next one
+     * opened when a region does not fit in the current one. The fastest.
+     */
+    PACKER_SHELF
+} texture_atlas_packer_t;
+
+
+struct texture_font_t;
+
 /**
  * A texture atlas is used to pack several small regions into a single texture.
  */
 typedef struct texture_atlas_t
 {
     /**
-     * Allocated nodes
+     * Algorithm packing the regions
+     */
+    texture_atlas_packer_t packer;
+
+    /**
+     * Allocated nodes: the skyline (PACKER_SKYLINE), or the current shelf
+     * as its first free column, top and height (PACKER_SHELF)
      */
     vector_t * nodes;
 
+    /**
+     * Free regions (ivec4): those given back with texture_atlas_free_region,
+     * allocated again before the space above the nodes, or all of the free
+     * space (PACKER_MAXRECTS and PACKER_GUILLOTINE)
+     */
+    vector_t * free_regions;
+
     /**
      *  Width (in pixels) of the underlying texture
      */
@@ -120,18 +172,122 @@ typedef struct texture_atlas_t
      */
     unsigned char modified;
 
+    /**
+     * Rectangles (ivec4) of the data modified since the atlas was last
+     * uploaded, overlapping and neighbouring ones being merged. The whole
+     * atlas when its texture is to be created again.
+     */
+    vector_t * dirty;
+
     /**
      * Atlas special glyph, this is a void*, and will be typecasted as necessary
      */
 
     void * special;
 
+    /**
+     * Baked font the data is mapped from, NULL if data is allocated
+     */
+    struct baked_font_t * baked;
+
+    /**
+     * Maximum number of pages, 1 by default. Regions of an atlas with more
+     * are allocated in the first page with room, pages of the same size
+     * being added as needed: layers of a texture array.
+     */
+    size_t max_pages;
+
+    /**
+     * Pages after the first one, the atlas itself (texture_atlas_t *),
+     * NULL until a page is added
+     */
+    vector_t * pages;
+
+    /**
+     * Layers of the texture array the pages are uploaded to, 0 until the
+     * atlas is uploaded as one (see texture_atlas_upload)
+     */
+    size_t layers_uploaded;
+
+    /**
+     * Size the atlas grows up to when a region does not fit, its width or
+     * height being doubled, the smaller one first. The size of the atlas by
+     * default: it does not grow.
+     */
+    size_t max_width, max_height;
+
+    /**
+     * Fonts with glyphs in the atlas (struct texture_font_t *), their
+     * texture coordinates being updated when it grows
+     * (see texture_atlas_attach)
+     */
+    vector_t * fonts;
+
+    /**
+     * Alignment of the regions allocated, 4 to align them to the blocks of
+     * compressed textures (see texture_atlas_set_align), 1 by default
+     */
+    size_t align;
+
+    /**
+     * Data compressed to BC4 (depth 1) or BC7 blocks, kept up to date by
+     * texture_atlas_compress from the dirty rectangles, NULL until then
+     */
+    unsigned char * blocks;
+
+    /**
+     * Channels packed apart, 1 by default: the regions of an atlas of depth
+     * 4 with 4 channels hold single channel data, each channel with a
+     * skyline or free regions of its own (see texture_atlas_set_channels)
+     */
+    size_t channels;
+
+    /**
+     * Nodes and free regions of the channels after the first one, NULL
+     * unless channels are packed apart
+     */
+    vector_t * layers;
+
+    /**
+     * Regions of identical bitmaps shared by glyphs, by content hash and
+     * size, NULL unless the atlas shares them (see texture_atlas_set_sharing)
+     */
+    hash_table_t * shared;
+
+    /**
+     * References to the shared regions, by position
+     */
+    hash_table_t * shared_at;
+
+    /**
+     * Bytes of the glyphs sharing the region of another, not allocated
+     */
+    size_t shared_bytes;
+
 } texture_atlas_t;
 
 
+/**
+ * Where texture_atlas_repack moved a region.
+ */
+typedef struct texture_atlas_remap_t
+{
+    /**
+     * Region before repacking
+     */
+    ivec4 from;
+
+    /**
+     * Its top left corner after repacking
+     */
+    ivec2 to;
+
+} texture_atlas_remap_t;
+
+
 
 /**
- * Creates a new empty texture atlas.
+ * Creates a new empty texture atlas, packed with PACKER_SKYLINE.
  *
  * @param   width   width of the atlas
  * @param   height  height of the atlas
@@ -145,6 +301,36 @@ typedef struct texture_atlas_t
                      const size_t depth );
 
 
+/**
+ * Creates a new empty texture atlas packed with a given algorithm, which
+ * its pages use as well.
+ *
+ * @param   width   width of the atlas
+ * @param   height  height of the atlas
+ * @param   depth   bit depth of the atlas
+ * @param   packer  algorithm packing the regions
+ * @return          a new empty texture atlas.
+ *
+ */
+  texture_atlas_t *
+  texture_atlas_new_with_packer( const size_t width,
+                                 const size_t height,
+                                 const size_t depth,
+                                 const texture_atlas_packer_t packer );
+
+
+/**
+ * Creates a texture atlas using the pixels of a baked font in place. The
+ * atlas is full: enlarge it to add regions.
+ *
+ * @param   baked  a baked font, which gets a reference
+ * @return         a new texture atlas.
+ *
+ */
+  texture_atlas_t *
+  texture_atlas_new_from_baked( struct baked_font_t * baked );
+
+
 /**
  *  Deletes a texture atlas.
  *
@@ -170,6 +356,176 @@ typedef struct texture_atlas_t
                             const size_t height );
 
 
+/**
+ *  Allocate a new region in a page of the atlas, adding a page if none has
+ *  room and there are less than max_pages. The pixels of the other pages
+ *  never move.
+ *
+ *  @param self   a texture atlas structure
+ *  @param width  width of the region to allocate
+ *  @param height height of the region to allocate
+ *  @param page   set to the index of the page of the region
+ *  @return       Coordinates of the allocated region in its page
+ */
+  ivec4
+  texture_atlas_get_page_region( texture_atlas_t * self,
+                                 const size_t width,
+                                 const size_t height,
+                                 size_t * page );
+
+
+/**
+ *  Allocate a new region for single channel data in a channel of a page of
+ *  the atlas: the first channel with room of the first page with room,
+ *  the atlas growing (see texture_atlas_t.max_width) once its last channel
+ *  is full, a page being added as by texture_atlas_get_page_region if none
+ *  has room. Atlases packing their channels together allocate in channel 0.
+ *
+ *  @param self    a texture atlas structure
+ *  @param width   width of the region to allocate
+ *  @param height  height of the region to allocate
+ *  @param page    set to the index of the page of the region
+ *  @param channel set to the channel of the region
+ *  @return        Coordinates of the allocated region in its page
+ */
+  ivec4
+  texture_atlas_get_channel_region( texture_atlas_t * self,
+                                    const size_t width,
+                                    const size_t height,
+                                    size_t * page,
+                                    size_t * channel );
+
+
+/**
+ *  Get the number of pages of an atlas.
+ *
+ *  @param self   a texture atlas structure
+ *  @return       number of pages, at least 1
+ */
+  size_t
+  texture_atlas_page_count( const texture_atlas_t * self );
+
+
+/**
+ *  Get a page of an atlas, with its own regions and data.
+ *
+ *  @param self   a texture atlas structure
+ *  @param page   index of the page, less than texture_atlas_page_count
+ *  @return       the atlas itself for the first page, the page otherwise
+ */
+  texture_atlas_t *
+  texture_atlas_get_page( texture_atlas_t * self,
+                          const size_t page );
+
+
+/**
+ *  Give a region back to the atlas, to be allocated again, with the spacing
+ *  it was allocated with. Its pixels are cleared.
+ *  @param self   a texture atlas structure
+ *  @param x      x coordinate the region
+ *  @param y      y coordinate the region
+ *  @param width  width of the region
+ *  @param height height of the region
+ */
+  void
+  texture_atlas_free_region( texture_atlas_t * self,
+                             const size_t x,
+                             const size_t y,
+                             const size_t width,
+                             const size_t height );
+
+
+/**
+ *  Give a region of a channel back to the atlas (see
+ *  texture_atlas_free_region), the pixels of the other channels staying.
+ *
+ *  @param self    a texture atlas structure
+ *  @param x       x coordinate the region
+ *  @param y       y coordinate the region
+ *  @param width   width of the region
+ *  @param height  height of the region
+ *  @param channel channel of the region (see texture_atlas_get_channel_region)
+ */
+  void
+  texture_atlas_free_channel_region( texture_atlas_t * self,
+                                     const size_t x,
+                                     const size_t y,
+                                     const size_t width,
+                                     const size_t height,
+                                     const size_t channel );
+
+
+/**
+ *  Find a region of the atlas holding a bitmap already, for the atlas to
+ *  share it (see texture_atlas_set_sharing), taking a reference to it.
+ *
+ *  @param self    a texture atlas structure
+ *  @param width   width of the bitmap
+ *  @param height  height of the bitmap
+ *  @param data    the bitmap, of the depth of the atlas or of a byte a
+ *                 pixel if it packs its channels apart
+ *  @param stride  stride of the data
+ *  @param page    set to the index of the page of the region
+ *  @param channel set to the channel of the region
+ *  @return        Coordinates of the region in its page, x being -1 if the
+ *                 bitmap is not in a shared region
+ */
+  ivec4
+  texture_atlas_find_region( texture_atlas_t * self,
+                             const size_t width,
+                             const size_t height,
+                             const unsigned char * data,
+                             const size_t stride,
+                             size_t * page,
+                             size_t * channel );
+
+
+/**
+ *  Share a region allocated and set, for texture_atlas_find_region to find
+ *  its bitmap, with a single reference. A region of the bitmap of another
+ *  is left alone.
+ *
+ *  @param self    a texture atlas structure sharing regions
+ *  @param x       x coordinate the region
+ *  @param y       y coordinate the region
+ *  @param width   width of the region, without spacing
+ *  @param height  height of the region, without spacing
+ *  @param page    page of the region
+ *  @param channel channel of the region
+ */
+  void
+  texture_atlas_share_region( texture_atlas_t * self,
+                              const size_t x,
+                              const size_t y,
+                              const size_t width,
+                              const size_t height,
+                              const size_t page,
+                              const size_t channel );
+
+
+/**
+ *  Drop a reference to a region of a page, giving it back to the atlas with
+ *  the last one (see texture_atlas_free_channel_region). Regions that are
+ *  not shared are given back at once.
+ *
+ *  @param self    a texture atlas structure
+ *  @param x       x coordinate the region
+ *  @param y       y coordinate the region
+ *  @param width   width of the region, with its spacing
+ *  @param height  height of the region, with its spacing
+ *  @param page    page of the region
+ *  @param channel channel of the region
+ */
+  void
+  texture_atlas_release_region( texture_atlas_t * self,
+                                const size_t x,
+                                const size_t y,
+                                const size_t width,
+                                const size_t height,
+                                const size_t page,
+                                const size_t channel );
+
+
 /**
  *  Upload data to the specified atlas region.
  *
@@ -192,7 +548,153 @@ typedef struct texture_atlas_t
                             const size_t stride );
 
 /**
- *  Remove all allocated regions from the atlas.
+ *  Upload single channel data to a channel of the specified atlas region,
+ *  the other channels of its pixels being left as they are.
+ *
+ *  @param self    a texture atlas structure
+ *  @param x       x coordinate the region
+ *  @param y       y coordinate the region
+ *  @param width   width of the region
+ *  @param height  height of the region
+ *  @param channel channel of the region, below the depth of the atlas
+ *  @param data    one byte a pixel to be uploaded into the channel
+ *  @param stride  stride of the data
+ */
+  void
+  texture_atlas_set_channel_region( texture_atlas_t * self,
+                                    const size_t x,
+                                    const size_t y,
+                                    const size_t width,
+                                    const size_t height,
+                                    const size_t channel,
+                                    const unsigned char *data,
+                                    const size_t stride );
+
+/**
+ *  Record a rectangle of the data as modified, to be uploaded again. Regions
+ *  allocated and set are recorded already: this is for data written to
+ *  otherwise.
+ *
+ *  @param self   a texture atlas structure
+ *  @param x      x coordinate of the rectangle
+ *  @param y      y coordinate of the rectangle
+ *  @param width  width of the rectangle
+ *  @param height height of the rectangle
+ */
+  void
+  texture_atlas_mark_dirty( texture_atlas_t * self,
+                            const size_t x,
+                            const size_t y,
+                            const size_t width,
+                            const size_t height );
+
+/**
+ *  Get the number of modified rectangles of an atlas, to be uploaded.
+ *
+ *  @param self   a texture atlas structure
+ *  @return       number of rectangles, 0 when the atlas is clean
+ */
+  size_t
+  texture_atlas_dirty_count( const texture_atlas_t * self );
+
+/**
+ *  Get a modified rectangle of an atlas.
+ *
+ *  @param self   a texture atlas structure
+ *  @param index  index of the rectangle, less than texture_atlas_dirty_count
+ *  @return       the rectangle
+ */
+  ivec4
+  texture_atlas_get_dirty( const texture_atlas_t * self,
+                           const size_t index );
+
+/**
+ *  Forget the modified rectangles of the atlas, once uploaded.
+ *
+ *  @param self   a texture atlas structure
+ */
+  void
+  texture_atlas_clean( texture_atlas_t * self );
+
+/**
+ *  Upload the modified rectangles of the atlas to its texture, with a
+ *  glTexSubImage2D call for each, creating the texture with glTexImage2D
+ *  when it has no id yet or the whole atlas is modified. Atlases compressed
+ *  with texture_atlas_compress upload their blocks instead, compressed
+ *  again, where GL has the formats. An atlas with max_pages above 1 is a
+ *  GL_TEXTURE_2D_ARRAY instead, a layer per page: the modified rectangles
+ *  of every page are uploaded with glTexSubImage3D, the texture being
+ *  created again with glTexImage3D when pages were added, where GL has
+ *  texture arrays. The atlas and its pages are clean afterwards.
+ *
+ *  @param self   a texture atlas structure, of depth 1, 3 or 4
+ */
+  void
+  texture_atlas_upload( texture_atlas_t * self );
+
+/**
+ *  Align the regions allocated in an empty atlas, their position and their
+ *  size with its spacing rounded up, so that a glyph added to a compressed
+ *  atlas compresses again only the blocks it covers. The atlas is cleared.
+ *
+ *  @param self   a texture atlas structure
+ *  @param align  alignment, 4 for the blocks of compressed textures, 1 not
+ *                to align regions
+ */
+  void
+  texture_atlas_set_align( texture_atlas_t * self,
+                           const size_t align );
+
+/**
+ *  Compress the data of an atlas to BC4 blocks for depth 1, BC7 blocks
+ *  otherwise (see block_compress). The first time, the whole atlas is
+ *  compressed. Afterwards, only the blocks the dirty rectangles touch are,
+ *  so call this before the atlas is cleaned, as texture_atlas_upload does
+ *  for compressed atlases. Compress an atlas before its texture is created
+ *  for the texture to be compressed. Pages are not compressed.
+ *
+ *  @param self     a texture atlas structure
+ *  @param threads  number of threads the whole atlas is compressed on
+ *  @return         the blocks (texture_atlas_t.blocks), NULL if out of
+ *                  memory
+ */
+  unsigned char *
+  texture_atlas_compress( texture_atlas_t * self,
+                          size_t threads );
+
+/**
+ *  Pack the channels of an empty atlas of depth 4 apart, as four atlases
+ *  of depth 1 sharing an RGBA texture, glyphs rasterized in one channel
+ *  (see texture_glyph_t.channel), or together again. Regions of
+ *  texture_atlas_get_region are in channel 0, set in all channels by
+ *  texture_atlas_set_region. The atlas and its pages are cleared.
+ *
+ *  @param self      a texture atlas structure, of depth 4 to pack
+ *                   channels apart
+ *  @param channels  4 to pack channels apart, 1 to pack them together
+ */
+  void
+  texture_atlas_set_channels( texture_atlas_t * self,
+                              const size_t channels );
+
+/**
+ *  Share the regions of identical bitmaps between glyphs, of several fonts
+ *  or codepoints: the bitmaps rendered are hashed with their size, and
+ *  glyphs of a bitmap the atlas holds already point at its region, which
+ *  is given back with the last glyph: a font evicting its glyphs makes
+ *  room only with the regions other fonts do not share. Regions are not
+ *  shared by default.
+ *
+ *  @param self     a texture atlas structure
+ *  @param sharing  1 to share regions, 0 not to, on an empty atlas: regions
+ *                  shared already would be given back with their first glyph
+ */
+  void
+  texture_atlas_set_sharing( texture_atlas_t * self,
+                             const int sharing );
+
+/**
+ *  Remove all allocated regions from the atlas and its pages.
  *
  *  @param self   a texture atlas structure
  */
@@ -200,7 +702,67 @@ typedef struct texture_atlas_t
   texture_atlas_clear( texture_atlas_t * self );
 
 /**
- *  Enlarge a texture atlas
+ *  Pack the regions of an atlas again, tallest first, from an empty
+ *  atlas: the space of the regions given back or lost, such as those of
+ *  deleted fonts, is allocated again. The pixels of the regions move with
+ *  them and any other pixel is cleared. The special region moves as well.
+ *  The atlas keeps its size, even if it could grow.
+ *
+ *  @param self     a texture atlas structure
+ *  @param regions  the regions to keep (ivec4), of the sizes they were
+ *                  allocated with by texture_atlas_get_region
+ *  @return         a remap table (texture_atlas_remap_t) of every region
+ *                  kept, by old position, to be deleted with vector_delete,
+ *                  or NULL if the regions do not fit anymore or the atlas
+ *                  packs its channels apart, the atlas being left as it was
+ */
+  vector_t *
+  texture_atlas_repack( texture_atlas_t * self,
+                        const vector_t * regions );
+
+/**
+ *  Find where a pixel moved in a remap table of texture_atlas_repack. The
+ *  top left corners of the regions are found in logarithmic time.
+ *
+ *  @param remap  a remap table
+ *  @param x      x coordinate of the pixel before repacking
+ *  @param y      y coordinate of the pixel before repacking
+ *  @return       the region with the pixel, or NULL if it was not kept
+ */
+  const texture_atlas_remap_t *
+  texture_atlas_remap_find( const vector_t * remap,
+                            int x,
+                            int y );
+
+/**
+ *  Find the densest packing of regions in an empty atlas, for atlases made
+ *  offline: every packer tries the regions tallest first, largest first,
+ *  widest first and longest side first. The densest places the most regions
+ *  and then has the lowest bottom. A new atlas with its packer, the size and
+ *  spacing of self, given the regions in its order places them the same.
+ *
+ *  @param self     a texture atlas structure, of which only the size and
+ *                  spacing are used
+ *  @param sizes    width and height of each region
+ *  @param count    number of regions
+ *  @param threads  number of threads the packings are tried on, 0 or 1 to
+ *                  try them on the calling thread
+ *  @param packer   set to the packer of the densest packing
+ *  @param order    set to the indices of the regions in the order of the
+ *                  densest packing, count of them
+ *  @return         number of regions the densest packing places
+ */
+  size_t
+  texture_atlas_plan( const texture_atlas_t * self,
+                      const ivec2 * sizes,
+                      size_t count,
+                      size_t threads,
+                      texture_atlas_packer_t * packer,
+                      size_t * order );
+
+/**
+ *  Enlarge a texture atlas, which must have a single page. Its data is
+ *  reallocated, rows being moved in place when the width grows.
  *
  *  @param self       a texture atlas structure
  *  @param width_new  new width
@@ -209,6 +771,42 @@ typedef struct texture_atlas_t
   void
   texture_atlas_enlarge_texture ( texture_atlas_t* self, size_t width_new, size_t height_new);
 
+/**
+ *  Enlarge a texture atlas (see texture_atlas_enlarge_texture) and update
+ *  the texture coordinates of the glyphs of all the fonts attached to it.
+ *
+ *  @param self       a texture atlas structure
+ *  @param width_new  new width
+ *  @param height_new new height
+ */
+  void
+  texture_atlas_grow( texture_atlas_t * self,
+                      size_t width_new,
+                      size_t height_new );
+
+/**
+ *  Attach a font to an atlas, the texture coordinates of its glyphs being
+ *  updated when the atlas grows. Fonts allocating glyphs in an atlas that
+ *  can grow (see texture_atlas_t.max_width) are attached already. An
+ *  attached font must be deleted before its atlas.
+ *
+ *  @param self   a texture atlas structure
+ *  @param font   a font with glyphs in the atlas
+ */
+  void
+  texture_atlas_attach( texture_atlas_t * self,
+                        struct texture_font_t * font );
+
+/**
+ *  Detach a font from an atlas, when the font is deleted.
+ *
+ *  @param self   a texture atlas structure
+ *  @param font   a font attached to the atlas
+ */
+  void
+  texture_atlas_detach( texture_atlas_t * self,
+                        struct texture_font_t * font );
+
 /** @} */
 
 #ifdef __cplusplus
@@ -18,25 +18,30 @@
 # include FT_LCD_FILTER_H
 #include FT_TRUETYPE_TABLES_H
 #endif
+#endif // FTGL_NO_FREETYPE
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 #include <math.h>
-#ifdef __APPLE__
-# include <machine/endian.h>
-# define __BIG_ENDIAN __ORDER_BIG_ENDIAN__
-# define __LITTLE_ENDIAN __ORDER_LITTLE_ENDIAN__
-# define __BYTE_ORDER __BYTE_ORDER__
-#elif defined(_WIN32) || defined(_WIN64)
-# define __LITTLE_ENDIAN 1234
-# define __BIG_ENDIAN 4321
-# define __BYTE_ORDER __LITTLE_ENDIAN
-#else
-# include <endian.h>
+#ifdef FTGL_NO_FREETYPE
+/* Without FreeType nothing is rasterized, so there is nothing to thread */
+# undef FREETYPE_GL_THREADS
+#endif
+#ifdef FREETYPE_GL_THREADS
+# if defined(_WIN32) || defined(_WIN64)
+#  define WIN32_LEAN_AND_MEAN
+#  define NOMINMAX
+#  include <windows.h>
+# else
+#  include <pthread.h>
+# endif
 #endif
 #include "distance-field.h"
+#include "pixel-convert.h"
 #include "texture-font.h"
+#include "baked-font.h"
 #include "platform.h"
 #include "utf8-utils.h"
 #include "ftgl-utils.h"
@@ -45,6 +50,13 @@
 #define HRESf 64.f
 #define DPI   72
 
+/* Size of the blocks of the arenas holding glyphs and their kerning */
+#define TEXTURE_FONT_ARENA_BLOCK (16 * 1024)
+
+/* Faces a new library leaves open in its face pool */
+#define TEXTURE_FONT_MAX_FACES 16
+
+#ifndef FTGL_NO_FREETYPE
 #undef __FTERRORS_H__
 #define AMALGAM_FTERRORS_H
 #define FT_ERRORDEF( e, v, s )  { e, s },
@@ -69,36 +81,48 @@ static FT_F26Dot6 convert_float_to_F26Dot6(float value)
   return (FT_F26Dot6) (value * 64.0);
 }
 
-// per-thread library
-
-__THREAD texture_font_library_t * freetype_gl_library = NULL;
-__THREAD font_mode_t mode_default=MODE_FREE_CLOSE;
-
-// rol8 ror8
-
-#if (defined(_WIN32) || defined(_WIN64)) && !defined(__GNUC__)
-# define inline
-static inline __builtin_bswap32(uint32_t in)
+// ------------------------------------------------- texture_font_read_cmap ---
+/* Read the Unicode charmap of the face once: codepoints are then resolved
+ * without FreeType, even while the face is closed */
+static int
+texture_font_read_cmap( texture_font_t *self )
 {
-    return ((in >> 24) & 0xFF) | ((in >> 8) & 0xFF00) | ((in & 0xFF00) << 8) | ((in & 0xFF) << 24);
+    FT_ULong codepoint;
+    FT_UInt index;
+
+    if( !(self->cmap = cmap_cache_new( )) )
+        return 0;
+    for( codepoint = FT_Get_First_Char( self->face, &index ); index;
+         codepoint = FT_Get_Next_Char( self->face, codepoint, &index ) ) {
+        if( !cmap_cache_set( self->cmap, (uint32_t) codepoint, index ) ) {
+            cmap_cache_delete( self->cmap );
+            self->cmap = NULL;
+            return 0;
+        }
+    }
+    return 1;
 }
-#endif
 
-static inline uint32_t rol(uint32_t in, uint32_t x)
+// ----------------------------------------------- texture_font_glyph_index ---
+/* Glyph index of a codepoint, 0 if the face has no glyph for it */
+static FT_UInt
+texture_font_glyph_index( texture_font_t *self, uint32_t codepoint )
 {
-    return (in >> (32-x)) | (in << x);
+    if( !self->cmap && (!self->face || !texture_font_read_cmap( self )) )
+        return self->face ? FT_Get_Char_Index( self->face, codepoint ) : 0;
+    return cmap_cache_get( self->cmap, codepoint );
 }
+#endif // FTGL_NO_FREETYPE
 
-// ------------------------------------------------------ texture_glyph_new ---
-texture_glyph_t *
-texture_glyph_new(void)
-{
-    texture_glyph_t *self = (texture_glyph_t *) malloc( sizeof(texture_glyph_t) );
-    if(self == NULL) {
-        freetype_gl_error( Out_Of_Memory );
-        return NULL;
-    }
+// per-thread library
+
+__THREAD texture_font_library_t * freetype_gl_library = NULL;
+__THREAD font_mode_t mode_default=MODE_FREE_CLOSE;
 
+// ----------------------------------------------------- texture_glyph_init ---
+static void
+texture_glyph_init( texture_glyph_t *self )
+{
     self->codepoint  = -1;
     self->width     = 0;
     self->height    = 0;
@@ -109,6 +133,8 @@ texture_glyph_new(void)
     /* End of attribute part */
     self->x         = 0;
     self->y         = 0;
+    self->page      = 0;
+    self->channel   = 0;
     self->offset_x  = 0;
     self->offset_y  = 0;
     self->advance_x = 0.0;
@@ -117,10 +143,106 @@ texture_glyph_new(void)
     self->t0        = 0.0;
     self->s1        = 0.0;
     self->t1        = 0.0;
+    self->kerning_compact = NULL;
+    self->font      = NULL;
+}
+
+// ------------------------------------------------------ texture_glyph_new ---
+texture_glyph_t *
+texture_glyph_new(void)
+{
+    texture_glyph_t *self = (texture_glyph_t *) malloc( sizeof(texture_glyph_t) );
+    if(self == NULL) {
+        freetype_gl_error( Out_Of_Memory );
+        return NULL;
+    }
+
+    texture_glyph_init( self );
     self->kerning   = vector_new( sizeof(float**) );
     return self;
 }
 
+// ------------------------------------------------ texture_glyph_new_vector ---
+/* Vectors of glyphs loaded by a font live in the font's arena */
+static vector_t *
+texture_glyph_new_vector( texture_glyph_t *self, size_t item_size )
+{
+    vector_t *vector;
+
+    if( !self->font )
+        return vector_new( item_size );
+
+    vector = (vector_t *) arena_calloc( self->font->arena, 1, sizeof(vector_t) );
+    if( vector )
+        vector->item_size = item_size;
+    return vector;
+}
+
+// -------------------------------------------------- texture_glyph_reserve ---
+/* Make room for size items in a vector of a glyph. Vectors in an arena grow
+ * into a new arena buffer, others are left to the vector functions. */
+static int
+texture_glyph_reserve( texture_glyph_t *self, vector_t *vector, size_t size )
+{
+    size_t capacity;
+    void *items;
+
+    if( !self->font || vector->capacity >= size )
+        return 1;
+
+    capacity = vector->capacity * 2 > size ? vector->capacity * 2 : size;
+    items = arena_calloc( self->font->arena, capacity, vector->item_size );
+    if( !items )
+        return 0;
+    if( vector->capacity )
+        memcpy( items, vector->items, vector->capacity * vector->item_size );
+    vector->items = items;
+    vector->capacity = capacity;
+    return 1;
+}
+
+// ------------------------------------------------- texture_font_new_glyph ---
+/* New empty glyph allocated in the font's arena */
+static texture_glyph_t *
+texture_font_new_glyph( texture_font_t *self )
+{
+    texture_glyph_t *glyph;
+    vector_t *kerning, *kerning_compact;
+    size_t i;
+
+    /* An evicted glyph, with its kerning tables emptied */
+    if( self->free_glyphs && !vector_empty( self->free_glyphs ) ) {
+        glyph = *(texture_glyph_t **) vector_back( self->free_glyphs );
+        vector_pop_back( self->free_glyphs );
+        kerning = glyph->kerning;
+        kerning_compact = glyph->kerning_compact;
+        for( i = 0; i < kerning->size; i++ ) {
+            float *row = *(float **) vector_get( kerning, i );
+            if( row )
+                memset( row, 0, 0x100 * sizeof(float) );
+        }
+        if( kerning_compact )
+            kerning_compact->size = 0;
+        texture_glyph_init( glyph );
+        glyph->font = self;
+        glyph->last_used = self->frame;
+        glyph->kerning = kerning;
+        glyph->kerning_compact = kerning_compact;
+        return glyph;
+    }
+
+    glyph = (texture_glyph_t *) arena_alloc( self->arena, sizeof(texture_glyph_t) );
+    if( !glyph )
+        return NULL;
+
+    texture_glyph_init( glyph );
+    glyph->font = self;
+    glyph->last_used = self->frame;
+    if( !(glyph->kerning = texture_glyph_new_vector( glyph, sizeof(float**) )) )
+        return NULL;
+    return glyph;
+}
+
 // ---------------------------------------------- texture_font_default_mode ---
 void
 texture_font_default_mode(font_mode_t mode)
@@ -134,25 +256,58 @@ texture_glyph_delete( texture_glyph_t *self )
 {
     int i;
     assert( self );
+
+    /* Glyphs loaded by a font are released with its arena */
+    if( self->font )
+        return;
+
     for(i=0; i < self->kerning->size; i++)
         free( *(float **) vector_get( self->kerning, i ) );
     vector_delete( self->kerning );
+    if( self->kerning_compact )
+        vector_delete( self->kerning_compact );
     free( self );
 }
 
-// ---------------------------------------------- texture_glyph_get_kerning ---
-float
-texture_glyph_get_kerning( const texture_glyph_t * self,
-                           const char * codepoint )
+// ------------------------------------- texture_glyph_find_kerning_compact ---
+/* Index of the first pair whose codepoint is not less than ucodepoint */
+static size_t
+texture_glyph_find_kerning_compact( const texture_glyph_t * self,
+                                    uint32_t ucodepoint )
+{
+    const texture_glyph_kerning_t *pairs =
+        (const texture_glyph_kerning_t *) self->kerning_compact->items;
+    size_t low = 0, high = self->kerning_compact->size, middle;
+
+    while( low < high ) {
+        middle = (low + high) / 2;
+        if( pairs[middle].codepoint < ucodepoint )
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+// --------------------------------------------- texture_glyph_find_kerning ---
+static float
+texture_glyph_find_kerning( const texture_glyph_t * self,
+                            uint32_t ucodepoint )
 {
-    uint32_t ucodepoint = utf8_to_utf32( codepoint );
     uint32_t i = ucodepoint >> 8;
     uint32_t j = ucodepoint & 0xFF;
     float *kern_index;
 
-    assert( self );
-    if(ucodepoint == -1)
-        return 0;
+    if( self->kerning_compact ) {
+        const texture_glyph_kerning_t *pair;
+        i = texture_glyph_find_kerning_compact( self, ucodepoint );
+        if( i == self->kerning_compact->size )
+            return 0;
+        pair = (const texture_glyph_kerning_t *) vector_get( self->kerning_compact, i );
+        return pair->codepoint == ucodepoint ?
+            pair->kerning / (float) KERNING_COMPACT_SCALE : 0;
+    }
+
     if(self->kerning->size <= i)
         return 0;
 
@@ -164,6 +319,87 @@ texture_glyph_get_kerning( const texture_glyph_t * self,
         return kern_index[j];
 }
 
+// ---------------------------------------------- texture_glyph_get_kerning ---
+float
+texture_glyph_get_kerning( const texture_glyph_t * self,
+                           const char * codepoint )
+{
+    uint32_t ucodepoint = utf8_to_utf32( codepoint );
+
+    assert( self );
+    if(ucodepoint == -1)
+        return 0;
+
+    if( self->font && self->font->kerning_mode == KERNING_LAZY )
+        return texture_font_get_kerning( self->font, ucodepoint, self->codepoint );
+
+    return texture_glyph_find_kerning( self, ucodepoint );
+}
+
+// ----------------------------------------------- texture_font_get_kerning ---
+
+typedef struct kerning_pair_t {
+    uint32_t left;
+    uint32_t right;
+} kerning_pair_t;
+
+float
+texture_font_get_kerning( texture_font_t * self,
+                          uint32_t left,
+                          uint32_t right )
+{
+    texture_glyph_t *glyph;
+
+    assert( self );
+
+    /* Baked glyphs come with all their pairs, whatever the mode */
+    if( self->kerning_mode != KERNING_LAZY || self->location == TEXTURE_FONT_BAKED ) {
+        glyph = texture_font_find_glyph_gi( self, right );
+        return glyph ? texture_glyph_find_kerning( glyph, left ) : 0;
+    }
+
+#ifdef FTGL_NO_FREETYPE
+    return 0;
+#else
+    kerning_pair_t pair = { left, right };
+    FT_Vector kerning;
+    float value = 0, *cached;
+
+    if( !self->kerning_pairs ) {
+        self->kerning_pairs = hash_table_new( sizeof(kerning_pair_t), sizeof(float) );
+        if( !self->kerning_pairs )
+            return 0;
+    }
+
+    if(( cached = (float *) hash_table_get( self->kerning_pairs, &pair ) ))
+        return *cached;
+
+    if( self->cache && self->cache->available &&
+        glyph_cache_kerning( self->cache, left, right, &value ) ) {
+        hash_table_set( self->kerning_pairs, &pair, &value );
+        return value;
+    }
+
+    /* Not asked for yet: compute it, and remember it even if zero */
+    if( !texture_font_load_face( self, self->size ) )
+        return 0;
+
+    if( FT_HAS_KERNING( self->face ) && !FT_Activate_Size( self->ft_size ) ) {
+        // FT_KERNING_UNFITTED returns FT_F26Dot6 values.
+        FT_Get_Kerning( self->face,
+                        texture_font_glyph_index( self, left ),
+                        texture_font_glyph_index( self, right ),
+                        FT_KERNING_UNFITTED, &kerning );
+        value = convert_F26Dot6_to_float(kerning.x) / HRESf;
+    }
+    hash_table_set( self->kerning_pairs, &pair, &value );
+
+    texture_font_close( self, MODE_AUTO_CLOSE, MODE_AUTO_CLOSE );
+
+    return value;
+#endif
+}
+
 // ---------------------------------------------- texture_font_index_kerning ---
 
 void texture_font_index_kerning( texture_glyph_t * self,
@@ -174,64 +410,152 @@ void texture_font_index_kerning( texture_glyph_t * self,
     uint32_t j = codepoint & 0xFF;
     float ** kerning_index;
 
+    if( self->font && self->font->kerning_mode == KERNING_COMPACT ) {
+        texture_glyph_kerning_t pair, *found;
+        float scaled = kerning * KERNING_COMPACT_SCALE;
+
+        pair.codepoint = codepoint;
+        pair.kerning = (int16_t) (scaled < INT16_MIN ? INT16_MIN :
+                                  scaled > INT16_MAX ? INT16_MAX :
+                                  roundf( scaled ));
+        if( !self->kerning_compact &&
+            !(self->kerning_compact = texture_glyph_new_vector(
+                  self, sizeof(texture_glyph_kerning_t) )) )
+            return;
+        i = texture_glyph_find_kerning_compact( self, codepoint );
+        found = i < self->kerning_compact->size ?
+            (texture_glyph_kerning_t *) vector_get( self->kerning_compact, i ) : NULL;
+        if( found && found->codepoint == codepoint )
+            found->kerning = pair.kerning;
+        else if( pair.kerning &&
+                 texture_glyph_reserve( self, self->kerning_compact,
+                                        self->kerning_compact->size + 1 ) )
+            vector_insert( self->kerning_compact, i, &pair );
+        return;
+    }
+
     if(self->kerning->size <= i) {
+        if( !texture_glyph_reserve( self, self->kerning, i+1 ) )
+            return;
         vector_resize( self->kerning, i+1);
     }
 
     kerning_index = (float **) vector_get( self->kerning, i );
 
     if(!*kerning_index) {
-        *kerning_index = calloc( 0x100, sizeof(float) );
+        *kerning_index = self->font ?
+            (float *) arena_calloc( self->font->arena, 0x100, sizeof(float) ) :
+            (float *) calloc( 0x100, sizeof(float) );
+        if(!*kerning_index)
+            return;
     }
 
     (*kerning_index)[j] = kerning;
 }
 
+#ifndef FTGL_NO_FREETYPE
+// ------------------------------------------------- kerning_entry_compare ---
+
+typedef struct kerning_entry_t {
+    texture_glyph_t *glyph;
+    FT_UInt index;
+} kerning_entry_t;
+
+static int
+kerning_entry_compare( const void *a, const void *b )
+{
+    const texture_glyph_t *ga = ((const kerning_entry_t *)a)->glyph;
+    const texture_glyph_t *gb = ((const kerning_entry_t *)b)->glyph;
+    return (ga > gb) - (ga < gb);
+}
+
+// ---------------------------------------------------- texture_font_kern_pair ---
+/* Store the kerning of the (left, right) pair in right's table */
+static void
+texture_font_kern_pair( texture_font_t *self,
+                        const kerning_entry_t *left,
+                        const kerning_entry_t *right )
+{
+    FT_Vector kerning;
+    float value;
+
+    /* Pairs of glyphs in the glyph cache are known */
+    if( self->cache && self->cache->available &&
+        glyph_cache_kerning( self->cache, left->glyph->codepoint,
+                             right->glyph->codepoint, &value ) ) {
+        if( value )
+            texture_font_index_kerning( right->glyph, left->glyph->codepoint, value );
+        return;
+    }
+
+    // FT_KERNING_UNFITTED returns FT_F26Dot6 values.
+    FT_Get_Kerning( self->face, left->index, right->index, FT_KERNING_UNFITTED, &kerning );
+    if( kerning.x ) {
+        texture_font_index_kerning( right->glyph,
+                                    left->glyph->codepoint,
+                                    convert_F26Dot6_to_float(kerning.x) / HRESf );
+    }
+}
+
 // ------------------------------------------ texture_font_generate_kerning ---
 void
 texture_font_generate_kerning( texture_font_t *self,
-                               FT_Library *library, FT_Face *face )
+                               const uint32_t *codepoints, size_t count )
 {
     size_t i, j, k;
-    FT_UInt glyph_index, prev_index;
-    texture_glyph_t *glyph, *prev_glyph;
-    FT_Vector kerning;
+    texture_glyph_t *glyph;
+    kerning_entry_t *added, entry;
+    size_t added_count = 0;
 
     assert( self );
 
-    /* For each glyph couple combination, check if kerning is necessary */
-    /* Starts at index 1 since 0 is for the special background glyph */
+    if( !count || !FT_HAS_KERNING( self->face ) )
+        return;
+
+    /* Unfitted kerning is scaled by the active size, another font's maybe */
+    if( self->face->size != self->ft_size && FT_Activate_Size( self->ft_size ) )
+        return;
+
+    /* Resolve the glyphs whose pairs are missing, once each */
+    added = malloc( count * sizeof(kerning_entry_t) );
+    if( !added ) {
+        freetype_gl_error( Out_Of_Memory );
+        return;
+    }
+    for( k = 0; k < count; k++ ) {
+        if( !(glyph = texture_font_find_glyph_gi( self, codepoints[k] )) )
+            continue;
+        added[added_count].glyph = glyph;
+        added[added_count].index = texture_font_glyph_index( self, glyph->codepoint );
+        added_count++;
+    }
+    qsort( added, added_count, sizeof(kerning_entry_t), kerning_entry_compare );
+    for( i = 0, k = 0; i < added_count; i++ ) {
+        if( !k || added[k-1].glyph != added[i].glyph )
+            added[k++] = added[i];
+    }
+    added_count = k;
+
+    /* Pairs between an existing glyph and an added one, both directions */
     GLYPHS_ITERATOR(i, glyph, self->glyphs ) {
-        glyph_index = FT_Get_Char_Index( *face, glyph->codepoint );
-//        fprintf(stderr, "Retrieving glyph %p from index %i\n", __glyphs, __i);
-//        fprintf(stderr, "Glpyh %p: Indexing %d, kerning %p\n", glyph, glyph_index, glyph->kerning);
-        for(k=0; k < glyph->kerning->size; k++)
-            free( *(float **) vector_get( glyph->kerning, k ) );
-        vector_clear( glyph->kerning );
-        
-        GLYPHS_ITERATOR(j, prev_glyph, self->glyphs ) {
-            prev_index = FT_Get_Char_Index( *face, prev_glyph->codepoint );
-            // FT_KERNING_UNFITTED returns FT_F26Dot6 values.
-            FT_Get_Kerning( *face, prev_index, glyph_index, FT_KERNING_UNFITTED, &kerning );
-            // printf("%c(%d)-%c(%d): %ld\n",
-            //       prev_glyph->codepoint, prev_glyph->codepoint,
-            //       glyph_index, glyph_index, kerning.x);
-            if( kerning.x ) {
-                texture_font_index_kerning( glyph,
-                                            prev_glyph->codepoint,
-                                            convert_F26Dot6_to_float(kerning.x) / HRESf );
-            }
-            // also insert kerning with the current added element
-            FT_Get_Kerning( *face, glyph_index, prev_index, FT_KERNING_UNFITTED, &kerning );
-            if( kerning.x ) {
-                texture_font_index_kerning( prev_glyph,
-                                            glyph->codepoint,
-                                            kerning.x / (float)(HRESf*HRESf) );
-            }
+        entry.glyph = glyph;
+        if( bsearch( &entry, added, added_count, sizeof(kerning_entry_t),
+                     kerning_entry_compare ) )
+            continue;
+        entry.index = texture_font_glyph_index( self, glyph->codepoint );
+        for( k = 0; k < added_count; k++ ) {
+            texture_font_kern_pair( self, &entry, &added[k] );
+            texture_font_kern_pair( self, &added[k], &entry );
         }
-        GLYPHS_ITERATOR_END
     }
     GLYPHS_ITERATOR_END
+
+    /* Pairs among the added glyphs themselves */
+    for( j = 0; j < added_count; j++ )
+        for( k = 0; k < added_count; k++ )
+            texture_font_kern_pair( self, &added[j], &added[k] );
+
+    free( added );
 }
 
 // -------------------------------------------------- texture_is_color_font ---
@@ -340,7 +664,13 @@ texture_font_init(texture_font_t *self)
         || (self->location == TEXTURE_FONT_MEMORY
             && self->memory.base && self->memory.size));
 
-    self->glyphs = vector_new(sizeof(texture_glyph_t *));
+    self->glyphs = hash_table_new( sizeof(texture_glyph_key_t),
+                                   sizeof(texture_glyph_t *) );
+    self->arena = arena_new( TEXTURE_FONT_ARENA_BLOCK );
+    if( !self->glyphs || !self->arena ) {
+        freetype_gl_error( Out_Of_Memory );
+        return -1;
+    }
     self->height = 0;
     self->ascender = 0;
     self->descender = 0;
@@ -349,6 +679,9 @@ texture_font_init(texture_font_t *self)
     self->outline_thickness = 0.0;
     self->hinting = 1;
     self->kerning = 1;
+    self->kerning_mode = KERNING_EAGER;
+    self->kerning_pairs = NULL;
+    self->threads = 1;
     self->filtering = 1;
     self->scaletex = 1;
     self->scale = 1.0;
@@ -377,6 +710,8 @@ texture_font_init(texture_font_t *self)
     return 0;
 }
 
+#endif // FTGL_NO_FREETYPE
+
 // ---------------------------------------------------- texture_library_new ---
 texture_font_library_t *
 texture_library_new(void)
@@ -384,10 +719,93 @@ texture_library_new(void)
     texture_font_library_t *self = calloc(1, sizeof(*self));
     
     self->mode = MODE_ALWAYS_OPEN;
+    self->max_faces = TEXTURE_FONT_MAX_FACES;
     
     return self;
 }
 
+// ------------------------------------------------- texture_font_new_baked ---
+/* Font of a baked font rendered at pt_size (any size if 0), copying its
+ * glyphs to atlas, or using the baked atlas in place if atlas is NULL */
+static texture_font_t *
+texture_font_new_baked( texture_atlas_t *atlas, float pt_size,
+                        baked_font_t *baked )
+{
+    texture_font_t *self;
+
+    assert(baked);
+
+    if ((pt_size && pt_size != baked->font_size) ||
+        (atlas && (atlas->depth != baked->atlas_depth || atlas->channels > 1))) {
+        freetype_gl_error( Font_Unavailable );
+        return NULL;
+    }
+
+    self = calloc(1, sizeof(*self));
+    if (!self) {
+        freetype_gl_error( Out_Of_Memory );
+        return NULL;
+    }
+
+    self->location = TEXTURE_FONT_BAKED;
+    self->baked = baked;
+    baked->references++;
+    self->mode = mode_default;
+
+    self->glyphs = hash_table_new( sizeof(texture_glyph_key_t),
+                                   sizeof(texture_glyph_t *) );
+    self->arena = arena_new( TEXTURE_FONT_ARENA_BLOCK );
+    self->atlas = atlas ? atlas : texture_atlas_new_from_baked( baked );
+    if (!self->glyphs || !self->arena || !self->atlas) {
+        freetype_gl_error( Out_Of_Memory );
+        if (self->glyphs)
+            hash_table_delete(self->glyphs);
+        if (self->arena)
+            arena_delete(self->arena);
+        if (self->atlas && !atlas)
+            texture_atlas_delete(self->atlas);
+        baked_font_release(baked);
+        free(self);
+        return NULL;
+    }
+
+    /* Everything was rendered with the settings of the baked font */
+    self->size = baked->font_size;
+    self->height = baked->height;
+    self->linegap = baked->linegap;
+    self->ascender = baked->ascender;
+    self->descender = baked->descender;
+    self->underline_position = baked->underline_position;
+    self->underline_thickness = baked->underline_thickness;
+    self->rendermode = baked->rendermode;
+    self->outline_thickness = baked->outline_thickness;
+    self->hinting = 1;
+    self->kerning = 1;
+    self->kerning_mode = KERNING_COMPACT;
+    self->threads = 1;
+    self->filtering = 1;
+    self->scaletex = 1;
+    self->scale = 1.0;
+
+    return self;
+}
+
+// -------------------------------------------------- texture_font_is_baked ---
+/* Whether a file is a baked font rather than one for FreeType */
+static int
+texture_font_is_baked( const char *filename )
+{
+    unsigned char magic[8];
+    FILE *file = fopen( filename, "rb" );
+    size_t size;
+
+    if( !file )
+        return 0;
+    size = fread( magic, 1, sizeof(magic), file );
+    fclose( file );
+    return baked_font_probe( magic, size );
+}
+
 // --------------------------------------------- texture_font_new_from_file ---
 texture_font_t *
 texture_font_new_from_file(texture_atlas_t *atlas, const float pt_size,
@@ -397,6 +815,24 @@ texture_font_new_from_file(texture_atlas_t *atlas, const float pt_size,
 
     assert(filename);
 
+    if (texture_font_is_baked(filename)) {
+        baked_font_t *baked = baked_font_load(filename);
+
+        if (!baked)
+            return NULL;
+        self = texture_font_new_baked(atlas, pt_size, baked);
+        baked_font_release(baked);
+        if (self && !(self->filename = strdup(filename))) {
+            texture_font_delete(self);
+            return NULL;
+        }
+        return self;
+    }
+
+#ifdef FTGL_NO_FREETYPE
+    freetype_gl_error_str( Font_Unavailable, filename );
+    return NULL;
+#else
     self = calloc(1, sizeof(*self));
     if (!self) {
         freetype_gl_error( Out_Of_Memory );
@@ -418,6 +854,7 @@ texture_font_new_from_file(texture_atlas_t *atlas, const float pt_size,
     }
 
     return self;
+#endif
 }
 
 // ------------------------------------------- texture_font_new_from_memory ---
@@ -430,6 +867,22 @@ texture_font_new_from_memory(texture_atlas_t *atlas, float pt_size,
     assert(memory_base);
     assert(memory_size);
 
+    if (baked_font_probe(memory_base, memory_size)) {
+        /* Only read since the glyphs are copied to atlas */
+        baked_font_t *baked = baked_font_new_from_memory((void *) memory_base,
+                                                         memory_size);
+
+        if (!baked)
+            return NULL;
+        self = texture_font_new_baked(atlas, pt_size, baked);
+        baked_font_release(baked);
+        return self;
+    }
+
+#ifdef FTGL_NO_FREETYPE
+    freetype_gl_error( Font_Unavailable );
+    return NULL;
+#else
     self = calloc(1, sizeof(*self));
     if (!self) {
         freetype_gl_error( Out_Of_Memory );
@@ -452,62 +905,301 @@ texture_font_new_from_memory(texture_atlas_t *atlas, float pt_size,
     }
 
     return self;
+#endif
 }
 
-// ----------------------------------------------------- texture_font_clone ---
+// -------------------------------------------- texture_font_new_from_baked ---
 texture_font_t *
-texture_font_clone( texture_font_t *old, float pt_size)
+texture_font_new_from_baked( baked_font_t *baked )
 {
-    texture_font_t *self;
-    FT_Error error = 0;
-    float native_size = old->size / old->scale; // unscale fonts
-    
-    self = calloc(1, sizeof(*self));
-    if (!self) {
-        freetype_gl_error( Out_Of_Memory );
-        return NULL;
-    }
+    return texture_font_new_baked( NULL, 0, baked );
+}
 
-    memcpy(self, old, sizeof(*self));
-    self->size  = pt_size;
+#ifndef FTGL_NO_FREETYPE
+// ---------------------------------------------------- texture_face_unlink ---
+static void
+texture_face_unlink( texture_font_library_t *library, texture_face_t *face )
+{
+    if( face->prev )
+        face->prev->next = face->next;
+    else
+        library->faces = face->next;
+    if( face->next )
+        face->next->prev = face->prev;
+    face->prev = face->next = NULL;
+}
 
-    error = FT_New_Size( self->face, &self->ft_size );
-    if(error) {
-        freetype_error( error );
-        return NULL;
-    }
+// ----------------------------------------------------- texture_face_touch ---
+/* Move a face first in the pool of its library, as the most recently used */
+static void
+texture_face_touch( texture_font_library_t *library, texture_face_t *face )
+{
+    if( library->faces == face )
+        return;
+    texture_face_unlink( library, face );
+    face->next = library->faces;
+    if( face->next )
+        face->next->prev = face;
+    library->faces = face;
+}
 
-    error = FT_Activate_Size( self->ft_size );
-    if(error) {
-        freetype_error( error );
-        return NULL;
-    }
-    
-    if(!texture_font_set_size ( self, pt_size ))
-        return NULL;
+// ------------------------------------------------------ texture_face_done ---
+static void
+texture_face_done( texture_font_library_t *library, texture_face_t *face )
+{
+    FT_Error error = FT_Done_Face( face->face );
 
-    texture_font_init_size( self );
-    
-    if(self->size / self->scale != native_size)
-        self->glyphs = vector_new(sizeof(texture_glyph_t *));
-    return self;
+    if( error )
+        freetype_error( error );
+    face->face = NULL;
+    library->open_faces--;
 }
-// ----------------------------------------------------- texture_font_close ---
+
+// --------------------------------------------------- texture_library_trim ---
+/* Close the least recently used faces no font uses, until at most keep
+ * faces are open */
+static void
+texture_library_trim( texture_font_library_t *library, size_t keep )
+{
+    texture_face_t *face;
+
+    if( library->open_faces <= keep )
+        return;
+    for( face = library->faces; face->next; face = face->next )
+        ;
+    for( ; face && library->open_faces > keep; face = face->prev )
+        if( face->face && !face->users )
+            texture_face_done( library, face );
+}
+
+// -------------------------------------------------- texture_library_close ---
+/* Close the faces no font uses, then the library unless a face is left */
+static void
+texture_library_close( texture_font_library_t *library )
+{
+    texture_library_trim( library, 0 );
+    if( library->open_faces || !library->library )
+        return;
+    if( library->stroker ) {
+        FT_Stroker_Done( library->stroker );
+        library->stroker = NULL;
+    }
+    FT_Done_FreeType( library->library );
+    library->library = NULL;
+}
+
+// ---------------------------------------------- texture_font_acquire_face ---
+/* Find the face of the font in the pool of its library, opening it unless
+ * it is open already */
+static int
+texture_font_acquire_face( texture_font_t *self )
+{
+    texture_font_library_t *library = self->library;
+    texture_face_t *face = self->shared_face;
+    FT_Error error;
+
+    if( !face ) {
+        for( face = library->faces; face; face = face->next ) {
+            if( self->location == TEXTURE_FONT_FILE ?
+                face->filename && !strcmp( face->filename, self->filename ) :
+                !face->filename && face->memory_base == self->memory.base &&
+                face->memory_size == self->memory.size )
+                break;
+        }
+        if( !face ) {
+            face = calloc( 1, sizeof(*face) );
+            if( !face || (self->location == TEXTURE_FONT_FILE &&
+                          !(face->filename = strdup( self->filename ))) ) {
+                freetype_gl_error( Out_Of_Memory );
+                free( face );
+                return 0;
+            }
+            if( self->location == TEXTURE_FONT_MEMORY ) {
+                face->memory_base = self->memory.base;
+                face->memory_size = self->memory.size;
+            }
+            face->next = library->faces;
+            if( face->next )
+                face->next->prev = face;
+            library->faces = face;
+        }
+        face->references++;
+        self->shared_face = face;
+    }
+
+    if( face->face ) {
+        library->face_hits++;
+    } else {
+        if( library->max_faces )
+            texture_library_trim( library, library->max_faces - 1 );
+        if( face->filename )
+            error = FT_New_Face( library->library, face->filename, 0, &face->face );
+        else
+            error = FT_New_Memory_Face( library->library, face->memory_base,
+                                        face->memory_size, 0, &face->face );
+        if( error ) {
+            freetype_error( error );
+            face->face = NULL;
+            return 0;
+        }
+
+        /* Select charmap */
+        error = FT_Select_Charmap( face->face, FT_ENCODING_UNICODE );
+        if( error ) {
+            freetype_error( error );
+            FT_Done_Face( face->face );
+            face->face = NULL;
+            return 0;
+        }
+        if( face->generation++ )
+            library->face_reopens++;
+        else
+            library->face_misses++;
+        library->open_faces++;
+    }
+    face->users++;
+    texture_face_touch( library, face );
+    self->face = face->face;
+    return 1;
+}
+
+// ---------------------------------------------- texture_font_release_face ---
+/* Be done with the face of the font, left open in the pool */
+static void
+texture_font_release_face( texture_font_t *self )
+{
+    self->shared_face->users--;
+    self->face = NULL;
+}
+
+// ------------------------------------------------- texture_font_drop_face ---
+/* Be done with the size and the face of the font for good, the face being
+ * closed with the last font sharing it */
+static void
+texture_font_drop_face( texture_font_t *self )
+{
+    texture_face_t *face = self->shared_face;
+
+    if( !face )
+        return;
+    if( self->face )
+        texture_font_release_face( self );
+    if( self->ft_size && face->face && self->face_generation == face->generation ) {
+        FT_Error error = FT_Done_Size( self->ft_size );
+        if(error) {
+            freetype_error( error );
+        }
+    }
+    self->ft_size = NULL;
+    self->shared_face = NULL;
+
+    if( --face->references )
+        return;
+    if( face->face )
+        texture_face_done( self->library, face );
+    texture_face_unlink( self->library, face );
+    free( face->filename );
+    free( face );
+}
+#endif
+
+// ----------------------------------------------------- texture_font_clone ---
+texture_font_t *
+texture_font_clone( texture_font_t *old, float pt_size)
+{
+    /* A baked font has a single size and no face to render another one */
+    if( old->location == TEXTURE_FONT_BAKED ) {
+        freetype_gl_error( Font_Unavailable );
+        return NULL;
+    }
+
+#ifdef FTGL_NO_FREETYPE
+    (void) pt_size;
+    return NULL;
+#else
+    texture_font_t *self;
+    float native_size = old->size / old->scale; // unscale fonts
+    
+    self = calloc(1, sizeof(*self));
+    if (!self) {
+        freetype_gl_error( Out_Of_Memory );
+        return NULL;
+    }
+
+    memcpy(self, old, sizeof(*self));
+    self->size  = pt_size;
+    self->attached = 0;
+    self->kerning_pending = NULL;
+    self->kerning_pairs = NULL;
+    self->cache = NULL;
+    self->cmap = NULL;
+    self->raster = NULL;
+    self->free_glyphs = NULL;
+    if( self->location == TEXTURE_FONT_FILE &&
+        !(self->filename = strdup( old->filename )) ) {
+        freetype_gl_error( Out_Of_Memory );
+        free( self );
+        return NULL;
+    }
+
+    /* Same face, with a size of its own */
+    self->face = NULL;
+    self->ft_size = NULL;
+    if( self->shared_face )
+        self->shared_face->references++;
+
+    if( !texture_font_load_face( self, pt_size ) ) {
+        texture_font_drop_face( self );
+        if( self->location == TEXTURE_FONT_FILE )
+            free( self->filename );
+        free( self );
+        return NULL;
+    }
+
+    texture_font_init_size( self );
+    
+    if(self->size / self->scale != native_size) {
+        self->glyphs = hash_table_new( sizeof(texture_glyph_key_t),
+                                       sizeof(texture_glyph_t *) );
+        self->arena = arena_new( TEXTURE_FONT_ARENA_BLOCK );
+        if( !self->glyphs || !self->arena ) {
+            freetype_gl_error( Out_Of_Memory );
+            if( self->glyphs )
+                hash_table_delete( self->glyphs );
+            if( self->arena )
+                arena_delete( self->arena );
+            texture_font_drop_face( self );
+            if( self->location == TEXTURE_FONT_FILE )
+                free( self->filename );
+            free( self );
+            return NULL;
+        }
+    }
+    texture_font_close( self, MODE_AUTO_CLOSE, MODE_AUTO_CLOSE );
+    return self;
+#endif
+}
+// ----------------------------------------------------- texture_font_close ---
 
 void
 texture_font_close( texture_font_t *self, font_mode_t face_mode, font_mode_t library_mode )
 {
+#ifdef FTGL_NO_FREETYPE
+    (void) self;
+    (void) face_mode;
+    (void) library_mode;
+#else
     if( self->face && self->mode <= face_mode ) {
-        FT_Done_Face( self->face );
-        self->face = NULL;
+        texture_font_release_face( self );
     } else {
         return; // never close the library when the face stays open
     }
 
-    if( self->library && self->library->library && self->library->mode <= library_mode ) {
-        FT_Done_FreeType( self->library->library );
-        self->library->library = NULL;
-    }
+    if( self->library->library && self->library->mode <= library_mode )
+        texture_library_close( self->library );
+    else if( self->library->max_faces )
+        texture_library_trim( self->library, self->library->max_faces );
+#endif
 }
 
 // ------------------------------------------------- texture_font_load_face ---
@@ -515,6 +1207,15 @@ texture_font_close( texture_font_t *self, font_mode_t face_mode, font_mode_t lib
 int
 texture_font_load_face( texture_font_t *self, float size )
 {
+    if( self->location == TEXTURE_FONT_BAKED ) {
+        freetype_gl_error( Font_Unavailable );
+        return 0;
+    }
+
+#ifdef FTGL_NO_FREETYPE
+    (void) size;
+    return 0;
+#else
     FT_Error error;
 
     if ( !self->library ) {
@@ -530,40 +1231,33 @@ texture_font_load_face( texture_font_t *self, float size )
             freetype_error( error );
             goto cleanup;
         }
+        self->library->lcd_filter = 0;
     }
     
     if( !self->face ) {
-        switch (self->location) {
-        case TEXTURE_FONT_FILE:
-            error = FT_New_Face(self->library->library, self->filename, 0, &self->face);
-            if(error) {
-                freetype_error( error );
-                goto cleanup_library;
-            }
-            break;
-
-        case TEXTURE_FONT_MEMORY:
-            error = FT_New_Memory_Face(self->library->library,
-                                       self->memory.base, self->memory.size, 0, &self->face);
+        if( !texture_font_acquire_face( self ) )
+            goto cleanup_library;
+        if( !self->cmap )
+            texture_font_read_cmap( self );
+
+        /* The size of the font is still there unless the pool closed the
+         * face meanwhile */
+        if( self->ft_size && self->face_generation == self->shared_face->generation ) {
+            error = FT_Activate_Size( self->ft_size );
             if(error) {
                 freetype_error( error );
-                goto cleanup_library;
+                goto cleanup_face;
             }
-            break;
-        }
-
-        /* Select charmap */
-        error = FT_Select_Charmap(self->face, FT_ENCODING_UNICODE);
-        if(error) {
-            freetype_error( error );
-            goto cleanup_face;
+            return 1;
         }
 
         error = FT_New_Size( self->face, &self->ft_size );
         if(error) {
             freetype_error( error );
+            self->ft_size = NULL;
             goto cleanup_face;
         }
+        self->face_generation = self->shared_face->generation;
 
         error = FT_Activate_Size( self->ft_size );
         if(error) {
@@ -584,6 +1278,7 @@ texture_font_load_face( texture_font_t *self, float size )
     texture_font_close( self, MODE_ALWAYS_OPEN, MODE_ALWAYS_OPEN );
   cleanup:
     return 0;
+#endif
 }
 
 // ---------------------------------------------------- texture_font_delete ---
@@ -592,30 +1287,227 @@ texture_font_delete( texture_font_t *self )
 {
     size_t i;
     texture_glyph_t *glyph;
-    FT_Error error=0;
 
     assert( self );
 
-    error = FT_Done_Size( self->ft_size );
-    if(error) {
-        freetype_error( error );
-    }
-
-    texture_font_close( self, MODE_ALWAYS_OPEN, MODE_FREE_CLOSE );
+    if( self->attached )
+        texture_atlas_detach( self->atlas, self );
+#ifndef FTGL_NO_FREETYPE
+    texture_font_drop_face( self );
+    if( self->library && self->library->library &&
+        self->library->mode <= MODE_FREE_CLOSE )
+        texture_library_close( self->library );
+#endif
 
-    if(self->location == TEXTURE_FONT_FILE && self->filename)
+    if(self->location != TEXTURE_FONT_MEMORY && self->filename)
         free( self->filename );
+    if(self->baked)
+        baked_font_release( self->baked );
         
-    GLYPHS_ITERATOR(i, glyph, self->glyphs) {
-        texture_glyph_delete( glyph );
-    } GLYPHS_ITERATOR_END1
-        free( __glyphs );
-    GLYPHS_ITERATOR_END2;
-
-    vector_delete( self->glyphs );
+    /* A font that failed to initialize may have neither */
+    if( self->glyphs ) {
+        GLYPHS_ITERATOR(i, glyph, self->glyphs) {
+            texture_glyph_delete( glyph );
+        } GLYPHS_ITERATOR_END
+        hash_table_delete( self->glyphs );
+    }
+    if( self->arena )
+        arena_delete( self->arena );
+    if( self->kerning_pairs )
+        hash_table_delete( self->kerning_pairs );
+    if( self->cache )
+        glyph_cache_delete( self->cache );
+    if( self->cmap )
+        cmap_cache_delete( self->cmap );
+    if( self->free_glyphs )
+        vector_delete( self->free_glyphs );
+    if( self->raster ) {
+        free( self->raster->scratch );
+        free( self->raster );
+    }
     free( self );
 }
 
+// ----------------------------------------------------- texture_font_covers ---
+int
+texture_font_covers( texture_font_t * self,
+                     uint32_t codepoint )
+{
+    baked_glyph_t record;
+
+    assert( self );
+
+    if( self->location == TEXTURE_FONT_BAKED )
+        return codepoint && baked_font_find( self->baked, codepoint, &record );
+#ifdef FTGL_NO_FREETYPE
+    return 0;
+#else
+    if( !self->cmap ) {
+        if( !texture_font_load_face( self, self->size ) )
+            return 0;
+        texture_font_close( self, MODE_AUTO_CLOSE, MODE_AUTO_CLOSE );
+    }
+    return self->cmap ? cmap_cache_covers( self->cmap, codepoint ) :
+        texture_font_glyph_index( self, codepoint ) != 0;
+#endif
+}
+
+// ------------------------------------------------- texture_font_next_frame ---
+void
+texture_font_next_frame( texture_font_t * self )
+{
+    assert( self );
+
+    self->frame++;
+}
+
+// ----------------------------------------------------- texture_font_memory ---
+size_t
+texture_font_memory( const texture_font_t * self )
+{
+    assert( self );
+
+    return hash_table_memory( self->glyphs ) + arena_memory( self->arena ) +
+        (self->kerning_pairs ? hash_table_memory( self->kerning_pairs ) : 0) +
+        (self->cmap ? cmap_cache_memory( self->cmap ) : 0) +
+        (self->free_glyphs ? self->free_glyphs->capacity * sizeof(texture_glyph_t *) : 0) +
+        (self->raster ? sizeof(raster_context_t) + self->raster->capacity : 0);
+}
+
+// -------------------------------------------------- texture_font_set_cache ---
+int
+texture_font_set_cache( texture_font_t * self,
+                        const char * directory )
+{
+    uint64_t hash = GLYPH_CACHE_HASH_SEED;
+
+    assert( self );
+
+    if( self->cache ) {
+        glyph_cache_delete( self->cache );
+        self->cache = NULL;
+    }
+    if( !directory )
+        return 1;
+
+    /* Glyphs of a baked font are never rendered */
+    if( self->location == TEXTURE_FONT_BAKED ) {
+        freetype_gl_error( Font_Unavailable );
+        return 0;
+    }
+
+    /* Cache files are keyed by the font contents, not its name */
+    if( self->location == TEXTURE_FONT_FILE ) {
+        const size_t chunk_size = 64 * 1024;
+        unsigned char *chunk = malloc( chunk_size );
+        size_t size;
+        FILE *file = fopen( self->filename, "rb" );
+
+        if( !file || !chunk ) {
+            if( file )
+                fclose( file );
+            free( chunk );
+            freetype_gl_error( Cannot_Load_File );
+            return 0;
+        }
+        while( (size = fread( chunk, 1, chunk_size, file )) )
+            hash = glyph_cache_hash( chunk, size, hash );
+        fclose( file );
+        free( chunk );
+    } else {
+        hash = glyph_cache_hash( self->memory.base, self->memory.size, hash );
+    }
+
+    if( !(self->cache = glyph_cache_new( directory )) )
+        return 0;
+    self->cache->params.font_hash = hash;
+    return 1;
+}
+
+// ---------------------------------------------- texture_font_evict_glyphs ---
+/* Evict the glyphs of the oldest frame before the current one, giving
+ * their regions back to the atlas. Returns the number of glyphs evicted. */
+static size_t
+texture_font_evict_glyphs( texture_font_t * self )
+{
+    texture_atlas_t *atlas = self->atlas;
+    const texture_glyph_key_t *key;
+    texture_glyph_t *glyph;
+    unsigned int oldest = 0;
+    size_t i, count = 0, width, height;
+    vector_t *keys;
+
+    GLYPHS_ITERATOR( i, glyph, self->glyphs ) {
+        if( self->frame - glyph->last_used > oldest )
+            oldest = self->frame - glyph->last_used;
+    } GLYPHS_ITERATOR_END
+    if( !oldest )
+        return 0;
+
+    if( !self->free_glyphs &&
+        !(self->free_glyphs = vector_new( sizeof(texture_glyph_t *) )) )
+        return 0;
+    if( !(keys = vector_new( sizeof(texture_glyph_key_t) )) )
+        return 0;
+
+    /* All the keys of the glyphs go, those of the codepoints sharing the
+     * missing glyph included, each glyph once under its own key */
+    for( i = 0; i < hash_table_capacity( self->glyphs ); i++ ) {
+        if( !(key = (const texture_glyph_key_t *) hash_table_key_at( self->glyphs, i )) )
+            continue;
+        glyph = *(texture_glyph_t **) hash_table_value_at( self->glyphs, i );
+        if( self->frame - glyph->last_used != oldest )
+            continue;
+        vector_push_back( keys, key );
+        if( glyph->codepoint != key->codepoint )
+            continue;
+
+        width = glyph->width + atlas->spacing_horiz;
+        height = glyph->height + atlas->spacing_vert;
+        if( glyph->x + width > atlas->width - 1 )
+            width = atlas->width - 1 - glyph->x;
+        if( glyph->y + height > atlas->height - 1 )
+            height = atlas->height - 1 - glyph->y;
+        if( glyph->width && glyph->height )
+            texture_atlas_release_region( atlas, glyph->x, glyph->y, width, height,
+                                          glyph->page, glyph->channel );
+        vector_push_back( self->free_glyphs, &glyph );
+        count++;
+    }
+    for( i = 0; i < vector_size( keys ); i++ )
+        hash_table_erase( self->glyphs, vector_get( keys, i ) );
+    vector_delete( keys );
+
+    self->evicted += count;
+    self->generation++;
+    return count;
+}
+
+// ------------------------------------------------ texture_font_get_region ---
+/* Region of the atlas for a new glyph, in a channel or page added if needed
+ * or in the atlas grown, evicting the least recently used glyphs until it
+ * fits if the font evicts */
+static ivec4
+texture_font_get_region( texture_font_t * self,
+                         size_t width,
+                         size_t height,
+                         size_t * page,
+                         size_t * channel )
+{
+    ivec4 region;
+
+    /* Glyphs get their texture coordinates updated when the atlas grows */
+    if( self->atlas->width < self->atlas->max_width ||
+        self->atlas->height < self->atlas->max_height )
+        texture_atlas_attach( self->atlas, self );
+    region = texture_atlas_get_channel_region( self->atlas, width, height, page, channel );
+
+    while( region.x < 0 && self->evict && !self->atlas->baked &&
+           texture_font_evict_glyphs( self ) )
+        region = texture_atlas_get_channel_region( self->atlas, width, height, page, channel );
+    return region;
+}
+
 // ------------------------------------------------ texture_font_find_glyph ---
 texture_glyph_t *
 texture_font_find_glyph( texture_font_t * self,
@@ -627,135 +1519,414 @@ texture_font_find_glyph( texture_font_t * self,
     return texture_font_find_glyph_gi(self, utf8_to_utf32( codepoint ));
 }
 
-// ---------------------------------------------- texture_font_find_glyph_gi ---
-texture_glyph_t *
-texture_font_find_glyph_gi( texture_font_t * self,
-                            uint32_t codepoint )
+// ------------------------------------------------ texture_font_find_baked ---
+/* Record of a glyph in the baked font, if baked for the current settings */
+static int
+texture_font_find_baked( texture_font_t * self,
+                         uint32_t codepoint,
+                         baked_glyph_t * record )
 {
-    uint32_t i = codepoint >> 8;
-    uint32_t j = codepoint & 0xFF;
-    texture_glyph_t **glyph_index1, *glyph;
+    baked_font_t *baked = self->baked;
 
-    if(self->glyphs->size <= i)
-        return NULL;
+    return self->rendermode == baked->rendermode &&
+        self->outline_thickness == baked->outline_thickness &&
+        baked_font_find( baked, codepoint, record );
+}
 
-    glyph_index1 = *(texture_glyph_t ***) vector_get( self->glyphs, i );
+// ------------------------------------------- texture_font_new_baked_glyph ---
+/* Glyph of a baked font made from its record, at its place in the baked
+ * atlas */
+static texture_glyph_t *
+texture_font_new_baked_glyph( texture_font_t * self,
+                              const baked_glyph_t * record )
+{
+    baked_font_t *baked = self->baked;
+    texture_glyph_t *glyph;
 
-    if(!glyph_index1)
+    if( !(glyph = texture_font_new_glyph( self )) )
         return NULL;
-    else
-        glyph = glyph_index1[j];
-
-    while( glyph && // if no glyph is there, we are done here
-           (glyph->rendermode != self->rendermode ||
-            glyph->outline_thickness != self->outline_thickness) ) {
-        if( glyph->glyphmode != GLYPH_CONT)
+    glyph->codepoint = record->codepoint;
+    glyph->x = record->x;
+    glyph->y = record->y;
+    glyph->width = record->width;
+    glyph->height = record->height;
+    glyph->offset_x = record->offset_x;
+    glyph->offset_y = record->offset_y;
+    glyph->advance_x = record->advance_x;
+    glyph->advance_y = record->advance_y;
+    glyph->s0 = record->s0;
+    glyph->t0 = record->t0;
+    glyph->s1 = record->s1;
+    glyph->t1 = record->t1;
+    glyph->data_x = record->data_x;
+    glyph->data_y = record->data_y;
+    glyph->data_width = record->data_width;
+    glyph->data_height = record->data_height;
+    glyph->glyphmode = (glyphmode_t) record->glyphmode;
+    glyph->rendermode = baked->rendermode;
+    glyph->outline_thickness = baked->outline_thickness;
+
+    if( record->kerning_count ) {
+        glyph->kerning_compact =
+            texture_glyph_new_vector( glyph, sizeof(texture_glyph_kerning_t) );
+        if( !glyph->kerning_compact ||
+            !texture_glyph_reserve( glyph, glyph->kerning_compact,
+                                    record->kerning_count ) )
             return NULL;
-        glyph++;
+        baked_font_get_kerning( baked, record,
+                                (texture_glyph_kerning_t *) glyph->kerning_compact->items );
+        glyph->kerning_compact->size = record->kerning_count;
     }
     return glyph;
 }
 
+// ------------------------------------------------ texture_font_unbake_glyph ---
+/* Glyph of a baked font using the baked atlas, made on first lookup */
+static texture_glyph_t *
+texture_font_unbake_glyph( texture_font_t * self,
+                           uint32_t codepoint )
+{
+    baked_glyph_t record;
+    texture_glyph_t *glyph;
+
+    if( self->atlas->baked != self->baked ||
+        !texture_font_find_baked( self, codepoint, &record ) ||
+        !(glyph = texture_font_new_baked_glyph( self, &record )) )
+        return NULL;
+
+    if( !texture_font_index_glyph( self, glyph, codepoint ) )
+        return NULL;
+    return glyph;
+}
+
+// -------------------------------------------- texture_font_load_baked_glyph ---
+/* Copy a glyph of a baked font to the font atlas, as texture_font_commit
+ * does with a rendered one */
+static int
+texture_font_load_baked_glyph( texture_font_t * self,
+                               uint32_t ucodepoint )
+{
+    baked_font_t *baked = self->baked;
+    texture_atlas_t *atlas = self->atlas;
+    baked_glyph_t record;
+    texture_glyph_t *glyph;
+    const unsigned char *pixels;
+    size_t x, y, page, channel, stride;
+    ivec4 region;
+    int status;
+
+    if( !texture_font_find_baked( self, ucodepoint, &record ) ) {
+        /* Nothing to render: use the glyph of missing codepoints */
+        if( !ucodepoint )
+            return 0;
+        if( (status = texture_font_load_glyph_gi( self, 0, 0 )) <= 0 )
+            return status;
+        return texture_font_index_glyph( self, texture_font_find_glyph_gi( self, 0 ),
+                                         ucodepoint );
+    }
+
+    /* The region of the same bitmap if the atlas has it already */
+    pixels = baked->pixels + (record.y * baked->atlas_width + record.x) * baked->atlas_depth;
+    stride = baked->atlas_width * baked->atlas_depth;
+    region = texture_atlas_find_region( atlas, record.width, record.height,
+                                        pixels, stride, &page, &channel );
+    if( region.x < 0 )
+    {
+        region = texture_font_get_region( self, record.width, record.height, &page, &channel );
+        if ( region.x < 0 )
+        {
+            freetype_gl_warning( Texture_Atlas_Full );
+            return -1;
+        }
+        texture_atlas_set_region( texture_atlas_get_page( atlas, page ),
+                                  region.x, region.y, record.width, record.height,
+                                  pixels, stride );
+        texture_atlas_share_region( atlas, region.x, region.y, record.width,
+                                    record.height, page, channel );
+    }
+    x = region.x;
+    y = region.y;
+
+    if( !(glyph = texture_font_new_baked_glyph( self, &record )) )
+        return 0;
+    glyph->x = x;
+    glyph->y = y;
+    glyph->page = page;
+    glyph->data_x = x + (record.data_x - record.x);
+    glyph->data_y = y + (record.data_y - record.y);
+    if(self->scaletex) {
+        glyph->s0       = x/(float)atlas->width;
+        glyph->t0       = y/(float)atlas->height;
+        glyph->s1       = (x + glyph->width)/(float)atlas->width;
+        glyph->t1       = (y + glyph->height)/(float)atlas->height;
+    } else {
+        glyph->s0       = x - 0.5;
+        glyph->t0       = y - 0.5;
+        glyph->s1       = x + glyph->width - 0.5;
+        glyph->t1       = y + glyph->height - 0.5;
+    }
+
+    return texture_font_index_glyph( self, glyph, ucodepoint );
+}
+
+// ---------------------------------------------- texture_font_find_glyph_gi ---
+texture_glyph_t *
+texture_font_find_glyph_gi( texture_font_t * self,
+                            uint32_t codepoint )
+{
+    texture_glyph_key_t key;
+    texture_glyph_t **glyph;
+
+    /* Zero the whole key since it is compared bytewise, and fold -0.0 into
+     * 0.0 so that both thicknesses find the same glyph */
+    memset( &key, 0, sizeof(key) );
+    key.codepoint = codepoint;
+    key.rendermode = self->rendermode;
+    key.outline_thickness = self->outline_thickness + 0.0f;
+
+    glyph = (texture_glyph_t **) hash_table_get( self->glyphs, &key );
+    if( glyph ) {
+        (*glyph)->last_used = self->frame;
+        return *glyph;
+    }
+    if( self->location == TEXTURE_FONT_BAKED )
+        return texture_font_unbake_glyph( self, codepoint );
+    return NULL;
+}
+
+// ----------------------------------------------- texture_font_index_glyph ---
 int
 texture_font_index_glyph( texture_font_t * self,
                           texture_glyph_t *glyph,
                           uint32_t codepoint)
 {
-    uint32_t i = codepoint >> 8;
-    uint32_t j = codepoint & 0xFF;
-    texture_glyph_t ***glyph_index1, *glyph_insert;
+    texture_glyph_key_t key;
+
+    memset( &key, 0, sizeof(key) );
+    key.codepoint = codepoint;
+    key.rendermode = glyph->rendermode;
+    key.outline_thickness = glyph->outline_thickness + 0.0f;
+
+    if( !hash_table_set( self->glyphs, &key, &glyph ) ) {
+        freetype_gl_error( Out_Of_Memory );
+        return 0;
+    }
+    return 1;
+}
+
+// ------------------------------------------------ texture_font_load_glyph ---
+int
+texture_font_load_glyph( texture_font_t * self,
+                         const char * codepoint )
+{
+    return texture_font_load_glyph_2(self, codepoint) > 0;
+}
+
+int
+texture_font_load_glyph_2( texture_font_t * self,
+                           const char * codepoint )
+{
+    /* codepoint NULL is special : it is used for line drawing (overline,
+     * underline, strikethrough) and background.
+     */
+    if( !codepoint ) {
+        return 1;
+    }
+    uint32_t ucodepoint = utf8_to_utf32(codepoint);
+
+#ifdef FTGL_NO_FREETYPE
+    /* Glyphs of baked fonts are found by codepoint */
+    return texture_font_load_glyph_gi( self, 0, ucodepoint );
+#else
+    return texture_font_load_glyph_gi( self,
+                                       texture_font_glyph_index( self, ucodepoint ),
+                                       ucodepoint);
+#endif
+}
+
+#ifndef FTGL_NO_FREETYPE
+
+// ------------------------------------------------------- glyph_raster_t ---
+/* A rasterized glyph, padded and converted to the atlas depth, waiting to
+ * be packed in the atlas */
+typedef struct glyph_raster_t {
+    uint32_t glyph_index;
+    uint32_t ucodepoint;
+    int status;                 /* 1 when rasterized, 0 on error */
+    int scratch;                /* buffer may be, and is, borrowed: the
+                                 * scratch bitmap of the font or a bitmap of
+                                 * its glyph cache, valid until its next glyph */
+    int in_atlas;               /* written straight into the atlas at x, y
+                                 * of page, leaving buffer NULL */
+    size_t x, y, page, channel;
+    unsigned char *buffer;      /* tgt_w * tgt_h * texture_font_depth bytes */
+    size_t src_w, src_h;
+    size_t tgt_w, tgt_h;
+    int padding_left, padding_top;
+    int left, top;
+    float advance_x, advance_y;
+} glyph_raster_t;
+
+// ----------------------------------------------- texture_font_get_raster ---
+/* The rasterization state of the font, created with its first glyph */
+static raster_context_t *
+texture_font_get_raster( texture_font_t * self )
+{
+    if( !self->raster &&
+        !(self->raster = (raster_context_t *) calloc( 1, sizeof(raster_context_t) )) )
+        freetype_gl_error( Out_Of_Memory );
+    return self->raster;
+}
 
-    if(self->glyphs->size <= i) {
-        vector_resize( self->glyphs, i+1);
+// ------------------------------------------------ texture_font_raster_buffer ---
+/* A buffer of size bytes for a raster: the scratch bitmap of the font if the
+ * raster may use it, grown as needed, a new allocation otherwise */
+static unsigned char *
+texture_font_raster_buffer( texture_font_t * self,
+                            glyph_raster_t * raster,
+                            size_t size )
+{
+    raster_context_t *context;
+    unsigned char *scratch;
+
+    if( !size )
+        size = 1;
+    if( !raster->scratch || !(context = texture_font_get_raster( self )) ) {
+        raster->scratch = 0;
+        if( !(raster->buffer = malloc( size )) )
+            freetype_gl_error( Out_Of_Memory );
+        return raster->buffer;
     }
 
-    glyph_index1 = (texture_glyph_t ***) vector_get( self->glyphs, i );
+    if( context->capacity < size ) {
+        if( size < 2 * context->capacity )
+            size = 2 * context->capacity;
+        if( !(scratch = realloc( context->scratch, size )) ) {
+            freetype_gl_error( Out_Of_Memory );
+            return raster->buffer = NULL;
+        }
+        context->scratch = scratch;
+        context->capacity = size;
+        context->allocations++;
+    }
+    return raster->buffer = context->scratch;
+}
 
-    if(!*glyph_index1) {
-        *glyph_index1 = calloc( 0x100, sizeof(texture_glyph_t*) );
+// ------------------------------------------------ texture_font_raster_free ---
+/* Release the buffer of a raster, unless it is the scratch bitmap */
+static void
+texture_font_raster_free( glyph_raster_t * raster )
+{
+    if( !raster->scratch )
+        free( raster->buffer );
+    raster->buffer = NULL;
+}
+
+// -------------------------------------------- texture_font_set_lcd_filter ---
+/* Set the LCD filter of the font on its library, unless it is set already */
+static void
+texture_font_set_lcd_filter( texture_font_t * self )
+{
+    texture_font_library_t *library = self->library;
+
+    if( self->filtering ) {
+        if( library->lcd_filter == 2 &&
+            !memcmp( library->lcd_weights, self->lcd_weights, sizeof(self->lcd_weights) ) )
+            return;
+        FT_Library_SetLcdFilter( library->library, FT_LCD_FILTER_LIGHT );
+        FT_Library_SetLcdFilterWeights( library->library, self->lcd_weights );
+        memcpy( library->lcd_weights, self->lcd_weights, sizeof(self->lcd_weights) );
+        library->lcd_filter = 2;
+    } else if( library->lcd_filter != 1 ) {
+        FT_Library_SetLcdFilter( library->library, FT_LCD_FILTER_LIGHT );
+        library->lcd_filter = 1;
     }
+}
 
-    if(( glyph_insert = (*glyph_index1)[j] )) {
-        int i = 0;
-        // fprintf(stderr, "glyph already there\n");
-        while (glyph_insert[i].glyphmode != GLYPH_END)
-            i++;
-        // fprintf(stderr, "Insert a glyph after position %d\n", i);
-        glyph_insert[i].glyphmode = GLYPH_CONT;
-        (*glyph_index1)[j] = glyph_insert = realloc( glyph_insert, sizeof(texture_glyph_t)*(i+2) );
-        memcpy( glyph_insert+(i+1), glyph, sizeof(texture_glyph_t) );
-        return 1;
-    } else {
-        (*glyph_index1)[j] = glyph;
-        return 0;
+// ------------------------------------------------ texture_font_get_stroker ---
+/* The stroker of the library, set for the outline thickness of the font */
+static FT_Stroker
+texture_font_get_stroker( texture_font_t * self )
+{
+    texture_font_library_t *library = self->library;
+    raster_context_t *context = texture_font_get_raster( self );
+    long radius = (long)(self->outline_thickness * HRES);
+    FT_Error error;
+
+    if( !context )
+        return NULL;
+    if( !library->stroker ) {
+        error = FT_Stroker_New( library->library, &library->stroker );
+        if( error ) {
+            freetype_error( error );
+            library->stroker = NULL;
+            return NULL;
+        }
+        context->allocations++;
+        library->stroker_radius = radius + 1;
+    }
+    if( library->stroker_radius != radius ) {
+        FT_Stroker_Set( library->stroker, radius,
+                        FT_STROKER_LINECAP_ROUND,
+                        FT_STROKER_LINEJOIN_ROUND,
+                        0 );
+        library->stroker_radius = radius;
     }
+    return library->stroker;
 }
 
-// ------------------------------------------------ texture_font_load_glyph ---
-int
-texture_font_load_glyph( texture_font_t * self,
-                         const char * codepoint )
+// ---------------------------------------------------- texture_font_depth ---
+/* Bytes a pixel of the glyphs, a single one in atlases packing channels
+ * apart */
+static size_t
+texture_font_depth( const texture_font_t * self )
 {
-    return texture_font_load_glyph_2(self, codepoint) > 0;
+    return self->atlas->channels > 1 ? 1 : self->atlas->depth;
 }
 
-int
-texture_font_load_glyph_2( texture_font_t * self,
-                           const char * codepoint )
+// ------------------------------------------------------------ clear_padding ---
+/* Zero the border of a padded glyph of width x height pixels, around the
+ * src_w x src_h pixels at (left, top) its bitmap is written to */
+static void
+clear_padding( unsigned char * dst, size_t stride, size_t depth,
+               size_t width, size_t height, size_t left, size_t top,
+               size_t src_w, size_t src_h )
 {
-    /* codepoint NULL is special : it is used for line drawing (overline,
-     * underline, strikethrough) and background.
-     */
-    if( !codepoint ) {
-        return 1;
-    }
-    uint32_t ucodepoint = utf8_to_utf32(codepoint);
+    size_t i;
 
-    return texture_font_load_glyph_gi( self,
-                                       FT_Get_Char_Index( self->face, ucodepoint),
-                                       ucodepoint);
+    for( i = 0; i < height; i++, dst += stride ) {
+        if( i < top || i >= top + src_h ) {
+            memset( dst, 0, width * depth );
+        } else {
+            memset( dst, 0, left * depth );
+            memset( dst + (left + src_w) * depth, 0, (width - left - src_w) * depth );
+        }
+    }
 }
 
-int
-texture_font_load_glyph_gi( texture_font_t * self,
-                            uint32_t glyph_index,
-                            uint32_t ucodepoint )
+// ------------------------------------------------ texture_font_rasterize ---
+/* Render a glyph with the font's face. A raster in_atlas is packed and
+ * written straight into the atlas, its status being -1 if the atlas is full;
+ * otherwise neither the font's atlas nor its glyphs are touched, so that it
+ * can run on a worker thread with its own face */
+static int
+texture_font_rasterize( texture_font_t * self,
+                        glyph_raster_t * raster )
 {
-    size_t i, x, y;
+    size_t i;
 
     FT_Error error;
-    FT_Face face;
     FT_Glyph ft_glyph = NULL;
     FT_GlyphSlot slot;
     FT_Bitmap ft_bitmap;
 
-    texture_glyph_t *glyph;
     FT_Int32 flags = 0;
     int ft_glyph_top = 0;
     int ft_glyph_left = 0;
 
-    ivec4 region;
-    size_t missed = 0;
-
-    /* Check if codepoint has been already loaded */
-    if (texture_font_find_glyph_gi(self, ucodepoint)) {
-        return 1;
-    }
-
-    if (!texture_font_load_face(self, self->size))
-        return 0;
+    raster->status = 0;
+    raster->buffer = NULL;
 
-    flags = 0;
-    ft_glyph_top = 0;
-    ft_glyph_left = 0;
-    if(!glyph_index) {
-        texture_glyph_t * glyph;
-        if ((glyph = texture_font_find_glyph(self, "\0"))) {
-            texture_font_index_glyph( self, glyph, ucodepoint );
-            texture_font_close( self, MODE_AUTO_CLOSE, MODE_AUTO_CLOSE );
-            return 1;
-        }
-    }
     // WARNING: We use texture-atlas depth to guess if user wants
     //          LCD subpixel rendering
 
@@ -777,15 +1948,10 @@ texture_font_load_glyph_gi( texture_font_t * self,
         flags |= FT_LOAD_FORCE_AUTOHINT;
     }
 
-    if( self->atlas->depth == 3 )
+    if( texture_font_depth( self ) == 3 )
     {
-        FT_Library_SetLcdFilter( self->library->library, FT_LCD_FILTER_LIGHT );
+        texture_font_set_lcd_filter( self );
         flags |= FT_LOAD_TARGET_LCD;
-
-        if( self->filtering )
-        {
-            FT_Library_SetLcdFilterWeights( self->library->library, self->lcd_weights );
-        }
     }
     else if (HRES == 1)
     {
@@ -800,7 +1966,7 @@ texture_font_load_glyph_gi( texture_font_t * self,
         flags |= FT_LOAD_TARGET_LIGHT;
     }
 
-    if( self->atlas->depth == 4 )
+    if( texture_font_depth( self ) == 4 )
     {
 #ifdef FT_LOAD_COLOR
         flags |= FT_LOAD_COLOR;
@@ -809,17 +1975,18 @@ texture_font_load_glyph_gi( texture_font_t * self,
 #endif
     }
 
-    error = FT_Activate_Size( self->ft_size );
-    if(error) {
-        freetype_error( error );
-        return 0;
+    if( self->face->size != self->ft_size ) {
+        error = FT_Activate_Size( self->ft_size );
+        if(error) {
+            freetype_error( error );
+            return 0;
+        }
     }
 
-    error = FT_Load_Glyph( self->face, glyph_index, flags );
+    error = FT_Load_Glyph( self->face, raster->glyph_index, flags );
     if( error )
     {
         freetype_error( error );
-        texture_font_close( self, MODE_AUTO_CLOSE, MODE_AUTO_CLOSE );
         return 0;
     }
 
@@ -832,22 +1999,11 @@ texture_font_load_glyph_gi( texture_font_t * self,
     }
     else
     {
-        FT_Stroker stroker;
+        FT_Stroker stroker = texture_font_get_stroker( self );
         FT_BitmapGlyph ft_bitmap_glyph;
 
-        error = FT_Stroker_New( self->library->library, &stroker );
-
-        if( error )
-        {
-            freetype_error( error );
-            goto cleanup_stroker;
-        }
-
-        FT_Stroker_Set(stroker,
-                        (int)(self->outline_thickness * HRES),
-                        FT_STROKER_LINECAP_ROUND,
-                        FT_STROKER_LINEJOIN_ROUND,
-                        0);
+        if( !stroker )
+            return 0;
 
         error = FT_Get_Glyph( self->face->glyph, &ft_glyph);
 
@@ -870,7 +2026,7 @@ texture_font_load_glyph_gi( texture_font_t * self,
             goto cleanup_stroker;
         }
 
-        switch( self->atlas->depth ) {
+        switch( texture_font_depth( self ) ) {
         case 1:
             error = FT_Glyph_To_Bitmap( &ft_glyph, FT_RENDER_MODE_NORMAL, 0, 1);
             break;
@@ -894,11 +2050,10 @@ texture_font_load_glyph_gi( texture_font_t * self,
         ft_glyph_left   = ft_bitmap_glyph->left;
 
 cleanup_stroker:
-        FT_Stroker_Done( stroker );
-
         if( error )
         {
-            texture_font_close( self, MODE_AUTO_CLOSE, MODE_AUTO_CLOSE );
+            if( ft_glyph )
+                FT_Done_Glyph( ft_glyph );
             return 0;
         }
     }
@@ -921,65 +2076,84 @@ cleanup_stroker:
     padding.right += self->padding_right;
     padding.bottom += self->padding_bottom;
 
-    size_t src_w = self->atlas->depth == 3 ? ft_bitmap.width/3 : ft_bitmap.width;
+    size_t src_w = texture_font_depth( self ) == 3 ? ft_bitmap.width/3 : ft_bitmap.width;
     size_t src_h = ft_bitmap.rows;
 
     size_t tgt_w = src_w + padding.left + padding.right;
     size_t tgt_h = src_h + padding.top + padding.bottom;
 
-    region = texture_atlas_get_region( self->atlas, tgt_w, tgt_h );
+    /* Glyphs are converted straight into the atlas when asked to, but for
+     * distance fields, computed from a padded copy of the glyph */
+    const size_t depth = texture_font_depth( self );
+    size_t stride = tgt_w * depth;
+    unsigned char *buffer = NULL, *target = NULL;
 
-    if ( region.x < 0 )
+    if( self->rendermode == RENDER_SIGNED_DISTANCE_FIELD || !raster->in_atlas )
     {
-        freetype_gl_warning( Texture_Atlas_Full );
-        texture_font_close( self, MODE_AUTO_CLOSE, MODE_AUTO_CLOSE );
-        return -1;
+        buffer = texture_font_raster_buffer( self, raster, tgt_h * stride );
+        if( !buffer )
+        {
+            if( ft_glyph )
+                FT_Done_Glyph( ft_glyph );
+            return 0;
+        }
     }
+    if( raster->in_atlas )
+    {
+        ivec4 region = texture_font_get_region( self, tgt_w, tgt_h, &raster->page,
+                                                &raster->channel );
+        texture_atlas_t *page;
 
-    x = region.x;
-    y = region.y;
+        if( region.x < 0 )
+        {
+            freetype_gl_warning( Texture_Atlas_Full );
+            texture_font_raster_free( raster );
+            if( ft_glyph )
+                FT_Done_Glyph( ft_glyph );
+            raster->status = -1;
+            return 0;
+        }
+        raster->x = region.x;
+        raster->y = region.y;
+        page = texture_atlas_get_page( self->atlas, raster->page );
+        target = page->data + (region.y * page->width + region.x) * depth;
+        page->modified = 1;
+        if( !buffer )
+        {
+            buffer = target;
+            stride = self->atlas->width * depth;
+        }
+    }
 
-    // Copy pixel data over
-    const size_t line_bytes = tgt_w * self->atlas->depth;
-    unsigned char *buffer = calloc( tgt_h * line_bytes, sizeof(unsigned char) );
-    unsigned char *dst_ptr = buffer + (padding.top * tgt_w + padding.left) * self->atlas->depth;
+    // Copy pixel data over, the bitmap covering all but the padding
+    clear_padding( buffer, stride, depth, tgt_w, tgt_h,
+                   padding.left, padding.top, src_w, src_h );
+    unsigned char *dst_ptr = buffer + padding.top * stride + padding.left * depth;
     unsigned char *src_ptr = ft_bitmap.buffer;
-    if( ft_bitmap.pixel_mode == FT_PIXEL_MODE_BGRA && self->atlas->depth == 4 )
+    if( ft_bitmap.pixel_mode == FT_PIXEL_MODE_BGRA && depth == 4 )
     {
         // BGRA in, RGBA out
         for( i = 0; i < src_h; i++ ) {
-            int j;
-            for( j = 0; j < ft_bitmap.width; j++ ) {
-                uint32_t bgra, rgba;
-                bgra = ((uint32_t*)src_ptr)[j];
-#if __BYTE_ORDER == __BIG_ENDIAN
-                rgba = rol(__builtin_bswap32(bgra), 8);
-#else
-                rgba = rol(__builtin_bswap32(bgra), 24);
-#endif
-                ((uint32_t*)dst_ptr)[j] = rgba;
-            }
-            dst_ptr += tgt_w * self->atlas->depth;
+            pixel_convert_bgra_to_rgba( dst_ptr, src_ptr, ft_bitmap.width );
+            dst_ptr += stride;
             src_ptr += ft_bitmap.pitch;
         }
     }
-    else if( ft_bitmap.pixel_mode == FT_PIXEL_MODE_BGRA && self->atlas->depth == 1 )
+    else if( ft_bitmap.pixel_mode == FT_PIXEL_MODE_BGRA && depth == 1 )
     {
         // BGRA in, grey out: Use weighted sum for luminosity, and multiply by alpha
-        struct src_pixel_t { uint8_t b; uint8_t g; uint8_t r; uint8_t a; } * src = (struct src_pixel_t *)ft_bitmap.buffer;
-        for( int row = 0; row < src_h; row++, dst_ptr += tgt_w * self->atlas->depth ) {
-            for( int col = 0; col < src_w; col++, src++ ) {
-                dst_ptr[col] = (0.3*src->r + 0.59*src->g + 0.11*src->b) * (src->a/255.0);
-            }
+        for( i = 0; i < src_h; i++ ) {
+            pixel_convert_bgra_to_grey( dst_ptr, src_ptr, src_w );
+            dst_ptr += stride;
+            src_ptr += ft_bitmap.pitch;
         }
     }
-    else if( ft_bitmap.pixel_mode == FT_PIXEL_MODE_GRAY && self->atlas->depth == 4 ) {
+    else if( ft_bitmap.pixel_mode == FT_PIXEL_MODE_GRAY && depth == 4 ) {
         // Grey in, RGBA out: Use grey level for alpha channel, with white color
-        struct dst_pixel_t { uint8_t r; uint8_t g; uint8_t b; uint8_t a; } * dst = (struct dst_pixel_t *)dst_ptr;
-        for( int row = 0; row < src_h; row++, dst += tgt_w ) {
-            for( int col = 0; col < src_w; col++, src_ptr++ ) {
-                dst[col] = (struct dst_pixel_t){ 255, 255, 255, *src_ptr };
-            }
+        for( i = 0; i < src_h; i++ ) {
+            pixel_convert_grey_to_rgba( dst_ptr, src_ptr, src_w );
+            dst_ptr += stride;
+            src_ptr += ft_bitmap.pitch;
         }
     }
     else
@@ -988,33 +2162,241 @@ cleanup_stroker:
         for( i = 0; i < src_h; i++ ) {
             //difference between width and pitch: https://www.freetype.org/freetype2/docs/reference/ft2-basic_types.html#FT_Bitmap
             memcpy( dst_ptr, src_ptr, ft_bitmap.width);
-            dst_ptr += line_bytes;
+            if( ft_bitmap.width < src_w * depth )
+                memset( dst_ptr + ft_bitmap.width, 0, src_w * depth - ft_bitmap.width );
+            dst_ptr += stride;
             src_ptr += ft_bitmap.pitch;
         }
     }
 
     if( self->rendermode == RENDER_SIGNED_DISTANCE_FIELD )
     {
-        unsigned char *sdf = make_distance_mapb( buffer, tgt_w, tgt_h );
-        free( buffer );
-        buffer = sdf;
+        if( target )
+        {
+            make_distance_mapb_rows( buffer, tgt_w, tgt_h,
+                                     target, self->atlas->width * depth );
+            texture_font_raster_free( raster );
+        }
+        else
+        {
+            unsigned char *sdf = make_distance_mapb( buffer, tgt_w, tgt_h );
+            texture_font_raster_free( raster );
+            raster->scratch = 0;
+            buffer = sdf;
+        }
+    }
+
+    raster->buffer       = target ? NULL : buffer;
+    raster->src_w        = src_w;
+    raster->src_h        = src_h;
+    raster->tgt_w        = tgt_w;
+    raster->tgt_h        = tgt_h;
+    raster->padding_left = padding.left;
+    raster->padding_top  = padding.top;
+    raster->left         = ft_glyph_left;
+    raster->top          = ft_glyph_top;
+
+    slot = self->face->glyph;
+    if( FT_HAS_FIXED_SIZES( self->face ) ) {
+        // color fonts use actual pixels, not subpixels
+        raster->advance_x = slot->advance.x;
+        raster->advance_y = slot->advance.y;
+    } else {
+        raster->advance_x = convert_F26Dot6_to_float(slot->advance.x) * self->scale;
+        raster->advance_y = convert_F26Dot6_to_float(slot->advance.y) * self->scale;
+    }
+
+    if( self->rendermode != RENDER_NORMAL && self->rendermode != RENDER_SIGNED_DISTANCE_FIELD )
+        FT_Done_Glyph( ft_glyph );
+
+    raster->status = 1;
+    return 1;
+}
+
+// ------------------------------------------------ texture_font_get_cache ---
+/* The glyph cache, with the file for the current rendering parameters
+ * selected, or NULL if there is none or it cannot be used */
+static glyph_cache_t *
+texture_font_get_cache( texture_font_t * self )
+{
+    glyph_cache_params_t params;
+
+    if( !self->cache )
+        return NULL;
+
+    memset( &params, 0, sizeof(params) );
+    params.font_hash = self->cache->params.font_hash;
+    params.size = self->size;
+    params.outline_thickness = self->rendermode == RENDER_NORMAL ||
+        self->rendermode == RENDER_SIGNED_DISTANCE_FIELD ? 0 : self->outline_thickness;
+    params.padding[0] = self->padding_left;
+    params.padding[1] = self->padding_right;
+    params.padding[2] = self->padding_top;
+    params.padding[3] = self->padding_bottom;
+    params.rendermode = self->rendermode;
+    params.depth = texture_font_depth( self );
+    params.hinting = self->hinting;
+    params.filtering = self->filtering;
+    memcpy( params.lcd_weights, self->lcd_weights, sizeof(params.lcd_weights) );
+
+    return glyph_cache_select( self->cache, &params ) ? self->cache : NULL;
+}
+
+// ------------------------------------------- texture_font_rasterize_cached ---
+/* Fill a raster from the glyph cache, returns 1 if it was there */
+static int
+texture_font_rasterize_cached( texture_font_t * self,
+                               glyph_cache_t * cache,
+                               glyph_raster_t * raster )
+{
+    const glyph_cache_glyph_t *cached;
+    const unsigned char *bitmap;
+    size_t size;
+
+    cached = glyph_cache_find( cache, raster->ucodepoint, &bitmap );
+    if( !cached || cached->glyph_index != raster->glyph_index )
+        return 0;
+
+    /* Packed from the cache itself unless the raster must outlive the
+     * next glyph */
+    size = (size_t) cached->width * cached->height * texture_font_depth( self );
+    if( raster->scratch )
+        raster->buffer = (unsigned char *) bitmap;
+    else if( !texture_font_raster_buffer( self, raster, size ) )
+        return 0;
+    else
+        memcpy( raster->buffer, bitmap, size );
+    raster->in_atlas = 0;
+    raster->tgt_w        = cached->width;
+    raster->tgt_h        = cached->height;
+    raster->src_w        = cached->data_width;
+    raster->src_h        = cached->data_height;
+    raster->padding_left = cached->padding_left;
+    raster->padding_top  = cached->padding_top;
+    raster->left         = cached->left;
+    raster->top          = cached->top;
+    raster->advance_x    = cached->advance_x;
+    raster->advance_y    = cached->advance_y;
+    raster->status       = 1;
+    return 1;
+}
+
+// --------------------------------------------- texture_font_cache_kerning ---
+static float
+texture_font_cache_kerning( void * data,
+                            uint32_t left,
+                            uint32_t right )
+{
+    texture_font_t *self = (texture_font_t *) data;
+    FT_Vector kerning;
+
+    // FT_KERNING_UNFITTED returns FT_F26Dot6 values.
+    FT_Get_Kerning( self->face, left, right, FT_KERNING_UNFITTED, &kerning );
+    return convert_F26Dot6_to_float(kerning.x) / HRESf;
+}
+
+// ------------------------------------------------- texture_font_cache_raster ---
+/* Add a rasterized glyph to the glyph cache */
+static void
+texture_font_cache_raster( texture_font_t * self,
+                           glyph_cache_t * cache,
+                           const glyph_raster_t * raster )
+{
+    glyph_cache_glyph_t cached;
+
+    memset( &cached, 0, sizeof(cached) );
+    cached.codepoint    = raster->ucodepoint;
+    cached.glyph_index  = raster->glyph_index;
+    cached.width        = raster->tgt_w;
+    cached.height       = raster->tgt_h;
+    cached.data_width   = raster->src_w;
+    cached.data_height  = raster->src_h;
+    cached.padding_left = raster->padding_left;
+    cached.padding_top  = raster->padding_top;
+    cached.left         = raster->left;
+    cached.top          = raster->top;
+    cached.advance_x    = raster->advance_x;
+    cached.advance_y    = raster->advance_y;
+
+    if( FT_Activate_Size( self->ft_size ) )
+        return;
+    glyph_cache_add( cache, &cached, raster->buffer,
+                     FT_HAS_KERNING( self->face ) ? texture_font_cache_kerning : NULL,
+                     self );
+}
+
+// --------------------------------------------------- texture_font_commit ---
+/* Pack a rasterized glyph in the atlas, unless it is there already, and
+ * index it. Returns 1 on success, -1 if the atlas is full and 0 on error;
+ * the raster's buffer is freed. */
+static int
+texture_font_commit( texture_font_t * self,
+                     glyph_raster_t * raster )
+{
+    texture_glyph_t *glyph;
+    uint32_t ucodepoint = raster->ucodepoint;
+    size_t x, y;
+    ivec4 region;
+
+    if( raster->in_atlas )
+    {
+        x = raster->x;
+        y = raster->y;
     }
+    else
+    {
+        /* The region of the same bitmap if the atlas has it already */
+        region = texture_atlas_find_region( self->atlas, raster->tgt_w, raster->tgt_h,
+                                            raster->buffer,
+                                            raster->tgt_w * texture_font_depth( self ),
+                                            &raster->page, &raster->channel );
+        if( region.x < 0 )
+        {
+            region = texture_font_get_region( self, raster->tgt_w, raster->tgt_h,
+                                              &raster->page, &raster->channel );
+
+            if ( region.x < 0 )
+            {
+                freetype_gl_warning( Texture_Atlas_Full );
+                texture_font_raster_free( raster );
+                return -1;
+            }
 
-    texture_atlas_set_region( self->atlas, x, y, tgt_w, tgt_h, buffer, line_bytes );
+            if( self->atlas->channels > 1 )
+                texture_atlas_set_channel_region( texture_atlas_get_page( self->atlas, raster->page ),
+                                                  region.x, region.y, raster->tgt_w, raster->tgt_h,
+                                                  raster->channel, raster->buffer,
+                                                  raster->tgt_w );
+            else
+                texture_atlas_set_region( texture_atlas_get_page( self->atlas, raster->page ),
+                                          region.x, region.y, raster->tgt_w, raster->tgt_h,
+                                          raster->buffer, raster->tgt_w * self->atlas->depth );
+            texture_atlas_share_region( self->atlas, region.x, region.y,
+                                        raster->tgt_w, raster->tgt_h,
+                                        raster->page, raster->channel );
+        }
+
+        x = region.x;
+        y = region.y;
 
-    free( buffer );
+        texture_font_raster_free( raster );
+    }
 
-    glyph = texture_glyph_new( );
-    glyph->codepoint = glyph_index ? ucodepoint : 0;
+    glyph = texture_font_new_glyph( self );
+    if( !glyph )
+        return 0;
+    glyph->codepoint = raster->glyph_index ? ucodepoint : 0;
 
     glyph->x          = x;
     glyph->y          = y;
-    glyph->width    = tgt_w;
-    glyph->height   = tgt_h;
+    glyph->page       = raster->page;
+    glyph->channel    = raster->channel;
+    glyph->width    = raster->tgt_w;
+    glyph->height   = raster->tgt_h;
     glyph->rendermode = self->rendermode;
     glyph->outline_thickness = self->outline_thickness;
-    glyph->offset_x   = ft_glyph_left-padding.left;
-    glyph->offset_y   = ft_glyph_top+padding.top;
+    glyph->offset_x   = raster->left-raster->padding_left;
+    glyph->offset_y   = raster->top+raster->padding_top;
     if(self->scaletex) {
         glyph->s0       = x/(float)self->atlas->width;
         glyph->t0       = y/(float)self->atlas->height;
@@ -1027,70 +2409,304 @@ cleanup_stroker:
         // half a pixel each to get crisp rendering
         glyph->s0       = x - 0.5;
         glyph->t0       = y - 0.5;
-        glyph->s1       = x + tgt_w - 0.5;
-        glyph->t1       = y + tgt_h - 0.5;
+        glyph->s1       = x + raster->tgt_w - 0.5;
+        glyph->t1       = y + raster->tgt_h - 0.5;
     }
-    glyph->data_x     = x+padding.left;
-    glyph->data_y     = y+padding.top;
-    glyph->data_width = src_w;
-    glyph->data_height= src_h;
-    slot = self->face->glyph;
-    if( FT_HAS_FIXED_SIZES( self->face ) ) {
-        // color fonts use actual pixels, not subpixels
-        glyph->advance_x = slot->advance.x;
-        glyph->advance_y = slot->advance.y;
-    } else {
-        glyph->advance_x = convert_F26Dot6_to_float(slot->advance.x) * self->scale;
-        glyph->advance_y = convert_F26Dot6_to_float(slot->advance.y) * self->scale;
+    glyph->data_x     = x+raster->padding_left;
+    glyph->data_y     = y+raster->padding_top;
+    glyph->data_width = raster->src_w;
+    glyph->data_height= raster->src_h;
+    glyph->advance_x  = raster->advance_x;
+    glyph->advance_y  = raster->advance_y;
+
+    /* The missing glyph is shared by all codepoints the face lacks */
+    if(!texture_font_index_glyph(self, glyph, ucodepoint) ||
+       (!raster->glyph_index && !texture_font_index_glyph(self, glyph, 0)))
+        return 0;
+
+    /* Lazy kerning pairs are computed when first asked for */
+    if( self->kerning_mode != KERNING_LAZY ) {
+        if( self->kerning_pending )
+            vector_push_back( self->kerning_pending, &ucodepoint );
+        else
+            texture_font_generate_kerning( self, &ucodepoint, 1 );
     }
 
-    int free_glyph = texture_font_index_glyph(self, glyph, ucodepoint);
-    if(!glyph_index) {
-        if(!free_glyph) {
-            texture_glyph_t *new_glyph = malloc(sizeof(texture_glyph_t));
-            memcpy(new_glyph, glyph, sizeof(texture_glyph_t));
-            glyph=new_glyph;
-        }
-        free_glyph = texture_font_index_glyph(self, glyph, 0);
+    return 1;
+}
+
+#endif // FTGL_NO_FREETYPE
+
+// --------------------------------------------- texture_font_load_glyph_gi ---
+int
+texture_font_load_glyph_gi( texture_font_t * self,
+                            uint32_t glyph_index,
+                            uint32_t ucodepoint )
+{
+    /* Check if codepoint has been already loaded */
+    if (texture_font_find_glyph_gi(self, ucodepoint)) {
+        return 1;
     }
-    if(free_glyph) {
-        // fprintf(stderr, "Free glyph\n");
-        free(glyph);
+
+    if (self->location == TEXTURE_FONT_BAKED)
+        return texture_font_load_baked_glyph( self, ucodepoint );
+
+#ifdef FTGL_NO_FREETYPE
+    (void) glyph_index;
+    return 0;
+#else
+    glyph_raster_t raster;
+    glyph_cache_t *cache;
+    int status;
+
+    /* Missing codepoints share the glyph of codepoint 0, without the face */
+    if(!glyph_index) {
+        texture_glyph_t * glyph;
+        if ((glyph = texture_font_find_glyph(self, "\0")))
+            return texture_font_index_glyph( self, glyph, ucodepoint );
     }
-    
-    if( self->rendermode != RENDER_NORMAL && self->rendermode != RENDER_SIGNED_DISTANCE_FIELD )
-        FT_Done_Glyph( ft_glyph );
 
-    texture_font_generate_kerning( self, &self->library->library, &self->face );
+    if (!texture_font_load_face(self, self->size))
+        return 0;
+
+    raster.glyph_index = glyph_index;
+    raster.ucodepoint = ucodepoint;
+    raster.scratch = 1;
+    /* Glyphs added to the glyph cache need their own copy, as do glyphs
+     * packed in a channel or looked up in the regions the atlas shares */
+    cache = texture_font_get_cache( self );
+    raster.in_atlas = !cache && self->atlas->channels == 1 && !self->atlas->shared;
+    if( cache && texture_font_rasterize_cached( self, cache, &raster ) )
+        status = texture_font_commit( self, &raster );
+    else if( texture_font_rasterize( self, &raster ) ) {
+        if( cache )
+            texture_font_cache_raster( self, cache, &raster );
+        status = texture_font_commit( self, &raster );
+    }
+    else
+        status = raster.status;
 
     texture_font_close( self, MODE_AUTO_CLOSE, MODE_AUTO_CLOSE );
 
-    return 1;
+    return status;
+#endif
+}
+
+#ifdef FREETYPE_GL_THREADS
+// ---------------------------------------------------- texture_font_job_t ---
+/* A glyph of a texture_font_load_glyphs batch */
+typedef struct texture_font_job_t {
+    glyph_raster_t raster;
+    size_t offset;      /* offset of the codepoint in the batch string */
+    int alias;          /* missing glyph, shares the one rasterized before */
+    int cached;         /* read from the glyph cache */
+} texture_font_job_t;
+
+/* A rasterizing thread, with its own copy of the font and FreeType library,
+ * handling jobs first, first + step, ... */
+typedef struct texture_font_worker_t {
+    texture_font_t font;
+    texture_font_library_t library;
+    texture_font_job_t *jobs;
+    size_t count, first, step;
+    int started;
+} texture_font_worker_t;
+
+// ------------------------------------------------- texture_font_rasterizer ---
+#if defined(_WIN32) || defined(_WIN64)
+static DWORD WINAPI
+#else
+static void *
+#endif
+texture_font_rasterizer( void * data )
+{
+    texture_font_worker_t *worker = (texture_font_worker_t *) data;
+    texture_font_t *font = &worker->font;
+    size_t i;
+
+    if( texture_font_load_face( font, font->size ) ) {
+        for( i = worker->first; i < worker->count; i += worker->step )
+            if( !worker->jobs[i].alias && !worker->jobs[i].cached )
+                texture_font_rasterize( font, &worker->jobs[i].raster );
+    }
+    texture_font_drop_face( font );
+    texture_library_close( font->library );
+    return 0;
+}
+
+// ------------------------------------------ texture_font_load_glyphs_mt ---
+/* Rasterize the glyphs of a batch on self->threads threads, then pack them
+ * in the atlas on the calling thread, in the order of the batch so that the
+ * atlas is laid out as if they were loaded one by one */
+static size_t
+texture_font_load_glyphs_mt( texture_font_t * self,
+                             const char * codepoints )
+{
+    size_t i, count = 0, length = strlen( codepoints ), missed = 0;
+    size_t thread_count = self->threads;
+    texture_font_job_t *jobs;
+    texture_font_worker_t *workers;
+    hash_table_t *queued;
+    glyph_cache_t *cache = texture_font_get_cache( self );
+    int missing = texture_font_find_glyph( self, "\0" ) != NULL;
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE *threads;
+#else
+    pthread_t *threads;
+#endif
+
+    if( !texture_font_load_face( self, self->size ) )
+        return utf8_strlen( codepoints );
+
+    jobs = (texture_font_job_t *) calloc( length ? length : 1, sizeof(*jobs) );
+    workers = (texture_font_worker_t *) calloc( thread_count, sizeof(*workers) );
+    threads = calloc( thread_count, sizeof(*threads) );
+    queued = hash_table_new( sizeof(uint32_t), sizeof(size_t) );
+    if( !jobs || !workers || !threads || !queued ) {
+        freetype_gl_error( Out_Of_Memory );
+        free( jobs );
+        free( workers );
+        free( threads );
+        if( queued )
+            hash_table_delete( queued );
+        return utf8_strlen( codepoints );
+    }
+
+    /* Queue the codepoints not loaded yet, once each */
+    for( i = 0; i < length; i += utf8_surrogate_len(codepoints + i) ) {
+        texture_font_job_t *job = &jobs[count];
+        uint32_t ucodepoint = utf8_to_utf32( codepoints + i );
+
+        if( texture_font_find_glyph_gi( self, ucodepoint ) ||
+            hash_table_get( queued, &ucodepoint ) )
+            continue;
+        hash_table_set( queued, &ucodepoint, &i );
+
+        job->offset = i;
+        job->raster.ucodepoint = ucodepoint;
+        job->raster.glyph_index = texture_font_glyph_index( self, ucodepoint );
+        if( !job->raster.glyph_index ) {
+            job->alias = missing;
+            missing = 1;
+        }
+        if( cache && !job->alias )
+            job->cached = texture_font_rasterize_cached( self, cache, &job->raster );
+        count++;
+    }
+    hash_table_delete( queued );
+
+    if( count < thread_count )
+        thread_count = count;
+    for( i = 0; i < thread_count; i++ ) {
+        texture_font_worker_t *worker = &workers[i];
+
+        worker->font = *self;
+        worker->font.library = &worker->library;
+        worker->font.face = NULL;
+        worker->font.ft_size = NULL;
+        worker->font.shared_face = NULL;
+        worker->font.raster = NULL;
+        worker->font.mode = MODE_ALWAYS_OPEN;
+        worker->library.mode = MODE_ALWAYS_OPEN;
+        worker->jobs = jobs;
+        worker->count = count;
+        worker->first = i;
+        worker->step = thread_count;
+#if defined(_WIN32) || defined(_WIN64)
+        threads[i] = CreateThread( NULL, 0, texture_font_rasterizer, worker, 0, NULL );
+        worker->started = threads[i] != NULL;
+#else
+        worker->started = !pthread_create( &threads[i], NULL, texture_font_rasterizer, worker );
+#endif
+        /* Without a thread, do the worker's share here */
+        if( !worker->started )
+            texture_font_rasterizer( worker );
+    }
+    for( i = 0; i < thread_count; i++ ) {
+        if( !workers[i].started )
+            continue;
+#if defined(_WIN32) || defined(_WIN64)
+        WaitForSingleObject( threads[i], INFINITE );
+        CloseHandle( threads[i] );
+#else
+        pthread_join( threads[i], NULL );
+#endif
+    }
+    for( i = 0; i < thread_count; i++ )
+        free( workers[i].font.raster );
+
+    /* Pack them in order, stopping at the first failure like the serial
+     * path */
+    for( i = 0; i < count; i++ ) {
+        texture_font_job_t *job = &jobs[i];
+
+        if( job->alias ) {
+            if( !texture_font_index_glyph( self, texture_font_find_glyph( self, "\0" ),
+                                           job->raster.ucodepoint ) ) {
+                missed = utf8_strlen( codepoints + job->offset );
+                break;
+            }
+            continue;
+        }
+        if( job->raster.status && cache && !job->cached )
+            texture_font_cache_raster( self, cache, &job->raster );
+        if( !job->raster.status || texture_font_commit( self, &job->raster ) <= 0 ) {
+            missed = utf8_strlen( codepoints + job->offset );
+            break;
+        }
+    }
+    for( ; i < count; i++ )
+        free( jobs[i].raster.buffer );
+
+    free( jobs );
+    free( workers );
+    free( threads );
+    return missed;
 }
+#endif
 
 // ----------------------------------------------- texture_font_load_glyphs ---
 size_t
 texture_font_load_glyphs( texture_font_t * self,
                           const char * codepoints )
 {
-    size_t i;
+    size_t i, missed = 0;
+    vector_t *pending = NULL;
 
     self->mode++;
 
+    /* Defer kerning to a single pass over the new glyphs, unless an outer
+     * batch already does */
+    if( self->kerning_mode != KERNING_LAZY && !self->kerning_pending )
+        pending = self->kerning_pending = vector_new( sizeof(uint32_t) );
+
+#ifdef FREETYPE_GL_THREADS
+    if( self->threads > 1 && self->location != TEXTURE_FONT_BAKED )
+        missed = texture_font_load_glyphs_mt( self, codepoints );
+    else
+#endif
     /* Load each glyph */
     for( i = 0; i < strlen(codepoints); i += utf8_surrogate_len(codepoints + i) ) {
         if( !texture_font_load_glyph( self, codepoints + i ) ) {
-            self->mode--;
-            texture_font_close( self, MODE_AUTO_CLOSE, MODE_AUTO_CLOSE );
-
-            return utf8_strlen( codepoints + i );
+            missed = utf8_strlen( codepoints + i );
+            break;
         }
     }
 
+    if( pending ) {
+        self->kerning_pending = NULL;
+#ifndef FTGL_NO_FREETYPE
+        if( vector_size( pending ) && texture_font_load_face( self, self->size ) )
+            texture_font_generate_kerning( self, pending->items,
+                                           vector_size( pending ) );
+#endif
+        vector_delete( pending );
+    }
+
     self->mode--;
     texture_font_close( self, MODE_AUTO_CLOSE, MODE_AUTO_CLOSE );
 
-    return 0;
+    return missed;
 }
 
 
@@ -1102,7 +2718,7 @@ texture_font_get_glyph( texture_font_t * self,
     texture_glyph_t *glyph;
 
     assert( self );
-    assert( self->filename );
+    assert( self->filename || self->baked );
     assert( self->atlas );
 
     /* Check if codepoint has been already loaded */
@@ -1122,7 +2738,7 @@ texture_font_get_glyph_gi( texture_font_t * self,
     texture_glyph_t *glyph;
 
     assert( self );
-    assert( self->filename );
+    assert( self->filename || self->baked );
     assert( self->atlas );
 
     /* Check if glyph_index has been already loaded */
@@ -1175,57 +2791,74 @@ texture_font_enlarge_atlas( texture_font_t * self, size_t width_new,
     size_t width_old = ta->width;
     size_t height_old = ta->height;    
 
-    texture_font_enlarge_texture( self, width_new, height_new);
-    if( self->scaletex ) {
+    texture_atlas_grow( ta, width_new, height_new );
+    if( !self->attached && self->scaletex && ta->width == width_new &&
+        ta->height == height_new ) {
         float mulw = (float)width_old / width_new;
         float mulh = (float)height_old / height_new;
         texture_font_enlarge_glyphs( self, mulw, mulh );
     }
 }
 
-#else
-
-  texture_font_t *
-  texture_font_new_from_file( texture_atlas_t * atlas, const float pt_size, const char * filename ) {
-      printf("*** texture_font_new_from_file unsupported\n"); return 0; }
-
-  texture_font_t *
-  texture_font_new_from_memory( texture_atlas_t *atlas, float pt_size, const void *memory_base, size_t memory_size ) { printf("*** texture_font_new_from_memory unsupported\n"); return 0; }
-
-  void
-  texture_font_delete( texture_font_t * self ) { printf("*** texture_font_delete unsupported\n"); }
-
-  texture_glyph_t *
-  texture_font_get_glyph( texture_font_t * self, const char * codepoint ) {
-      printf("*** texture_font_get_glyph unsupported\n"); return 0; }
-
-  texture_glyph_t *
-  texture_font_find_glyph( texture_font_t * self, const char * codepoint ) {
-      printf("*** texture_font_find_glyph unsupported\n"); return 0; }
-
-  int
-  texture_font_load_glyph( texture_font_t * self, const char * codepoint ) {
-      printf("*** texture_font_load_glyph unsupported\n"); return 0; }
-
-  size_t
-  texture_font_load_glyphs( texture_font_t * self, const char * codepoints ) {
-      printf("*** texture_font_load_glyphs unsupported\n"); return 0; }
-
-  void
-  texture_font_enlarge_atlas( texture_font_t * self, size_t width_new, size_t height_new) {
-      printf("*** texture_font_enlarge_atlas unsupported\n"); return; }
 
-  float
-  texture_glyph_get_kerning( const texture_glyph_t * self, const char * codepoint ) {
-      printf("*** texture_glyph_get_kerning unsupported\n"); return 0; }
+// ---------------------------------------------------- texture_font_repack ---
+vector_t *
+texture_font_repack( texture_font_t ** fonts, size_t count )
+{
+    texture_atlas_t *atlas;
+    const texture_atlas_remap_t *move;
+    texture_glyph_t *glyph;
+    vector_t *regions, *remap;
+    ivec4 region;
+    size_t i, k;
 
+    assert( fonts && count );
+    atlas = fonts[0]->atlas;
+    if( texture_atlas_page_count( atlas ) > 1 || atlas->channels > 1 )
+        return NULL;
 
-/**
- * Creates a new empty glyph
- *
- * @return a new empty glyph (not valid)
- */
-texture_glyph_t *
-texture_glyph_new( void );
+    if( !(regions = vector_new( sizeof(ivec4) )) ) {
+        freetype_gl_error( Out_Of_Memory );
+        return NULL;
+    }
+    for( k = 0; k < count; k++ ) {
+        assert( fonts[k]->atlas == atlas );
+        GLYPHS_ITERATOR( i, glyph, fonts[k]->glyphs ) {
+            region.x = glyph->x;
+            region.y = glyph->y;
+            region.width = glyph->width;
+            region.height = glyph->height;
+            vector_push_back( regions, &region );
+        } GLYPHS_ITERATOR_END
+    }
+    remap = texture_atlas_repack( atlas, regions );
+    vector_delete( regions );
+    if( !remap )
+        return NULL;
 
-#endif // FTGL_NO_FREETYPE
+    /* Glyphs follow their region, empty ones staying where they are */
+    for( k = 0; k < count; k++ ) {
+        GLYPHS_ITERATOR( i, glyph, fonts[k]->glyphs ) {
+            if( !glyph->width || !glyph->height ||
+                !(move = texture_atlas_remap_find( remap, glyph->x, glyph->y )) )
+                continue;
+            glyph->data_x += move->to.x - (int) glyph->x;
+            glyph->data_y += move->to.y - (int) glyph->y;
+            glyph->x = move->to.x;
+            glyph->y = move->to.y;
+            if( fonts[k]->scaletex ) {
+                glyph->s0 = glyph->x / (float) atlas->width;
+                glyph->t0 = glyph->y / (float) atlas->height;
+                glyph->s1 = (glyph->x + glyph->width) / (float) atlas->width;
+                glyph->t1 = (glyph->y + glyph->height) / (float) atlas->height;
+            } else {
+                glyph->s0 = glyph->x - 0.5;
+                glyph->t0 = glyph->y - 0.5;
+                glyph->s1 = glyph->x + glyph->width - 0.5;
+                glyph->t1 = glyph->y + glyph->height - 0.5;
+            }
+        } GLYPHS_ITERATOR_END
+        fonts[k]->generation++;
+    }
+    return remap;
+}
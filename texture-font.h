@@ -14,6 +14,10 @@ extern "C" {
 #endif
 
 #include "vector.h"
+#include "hash-table.h"
+#include "arena.h"
+#include "cmap-cache.h"
+#include "glyph-cache.h"
 #include "texture-atlas.h"
 
 #ifndef __THREAD
@@ -73,6 +77,54 @@ typedef enum glyphmode_t
     GLYPH_CONT=1
 } glyphmode_t;
 
+/**
+ * A list of possible ways to compute kerning.
+ */
+typedef enum kerning_mode_t
+{
+    /**
+     * Pairs between loaded glyphs are computed when a glyph is loaded and
+     * stored in each glyph's kerning table
+     */
+    KERNING_EAGER,
+
+    /**
+     * Pairs are computed the first time they are asked for and cached in the
+     * font, so memory grows with the number of distinct pairs drawn
+     */
+    KERNING_LAZY,
+
+    /**
+     * Pairs are computed as with KERNING_EAGER, but each glyph only stores
+     * its non-zero pairs, sorted by codepoint, with fixed-point values
+     */
+    KERNING_COMPACT
+} kerning_mode_t;
+
+/**
+ * Number of steps per pixel of compact kerning values.
+ */
+#define KERNING_COMPACT_SCALE 64
+
+/**
+ * A kerning pair of a glyph stored with KERNING_COMPACT.
+ */
+typedef struct texture_glyph_kerning_t
+{
+    /**
+     * Codepoint of the preceding character in UTF-32 LE encoding
+     */
+    uint32_t codepoint;
+
+    /**
+     * Kerning in 1/KERNING_COMPACT_SCALE pixels
+     */
+    int16_t kerning;
+} texture_glyph_kerning_t;
+
+struct texture_font_t;
+struct baked_font_t;
+
 /*
  * Glyph metrics:
  * --------------
@@ -126,6 +178,18 @@ typedef struct texture_glyph_t
      */
     size_t y;
 
+    /**
+     * Page of the atlas the glyph is in, the layer of its texture array
+     * (see texture_atlas_t.max_pages).
+     */
+    size_t page;
+
+    /**
+     * Channel of the atlas the glyph is in, 0 unless the atlas packs its
+     * channels apart (see texture_atlas_set_channels).
+     */
+    size_t channel;
+
     /**
      * Glyph's width in pixels.
      */
@@ -193,6 +257,18 @@ typedef struct texture_glyph_t
      */
     vector_t * kerning;
 
+    /**
+     * Sorted vector of texture_glyph_kerning_t, used instead of kerning when
+     * the font's kerning mode is KERNING_COMPACT (NULL until the first pair).
+     */
+    vector_t * kerning_compact;
+
+    /**
+     * Font this glyph was loaded from, whose arena holds it, used to compute
+     * lazy kerning pairs (NULL for glyphs made with texture_glyph_new).
+     */
+    struct texture_font_t * font;
+
     /**
      * Mode this glyph was rendered
      */
@@ -208,14 +284,43 @@ typedef struct texture_glyph_t
      */
     glyphmode_t glyphmode;
 
+    /**
+     * Frame of the font the glyph was last looked up in, the glyphs of the
+     * oldest frames being evicted first
+     */
+    unsigned int last_used;
+
 } texture_glyph_t;
 
+/**
+ * Key of a glyph in a font's glyph table: the same codepoint can be
+ * rendered with several render modes and outline thicknesses.
+ */
+typedef struct texture_glyph_key_t
+{
+    /**
+     * Codepoint the glyph is indexed for
+     */
+    uint32_t codepoint;
+
+    /**
+     * Mode the glyph was rendered
+     */
+    rendermode_t rendermode;
+
+    /**
+     * Glyph outline thickness
+     */
+    float outline_thickness;
+} texture_glyph_key_t;
+
 /**
  * Enum type for texture location
  */
 typedef enum font_location_t {
     TEXTURE_FONT_FILE = 0,
-    TEXTURE_FONT_MEMORY
+    TEXTURE_FONT_MEMORY,
+    TEXTURE_FONT_BAKED
 } font_location_t;
 
 /**
@@ -253,6 +358,54 @@ typedef struct FT_SizeRec_* FT_Size;
 typedef struct hb_font_t hb_font_t;
 #endif
 
+/**
+ *  Face of the face pool of a library, shared by the fonts opened from the
+ *  same file or memory, whatever their size.
+ */
+typedef struct texture_face_t
+{
+    /**
+     * File the face is read from, NULL for a face in memory
+     */
+    char * filename;
+
+    /**
+     * Memory the face is read from, if it has no file
+     */
+    const void * memory_base;
+
+    /**
+     * Size of the memory the face is read from, in bytes
+     */
+    size_t memory_size;
+
+    /**
+     * Freetype face pointer, NULL while the face is closed
+     */
+    FT_Face face;
+
+    /**
+     * Number of times the face was opened: the sizes fonts created on an
+     * earlier opening are gone with it
+     */
+    unsigned int generation;
+
+    /**
+     * Number of fonts sharing the face
+     */
+    size_t references;
+
+    /**
+     * Number of fonts using the face open, which keep it from being closed
+     */
+    size_t users;
+
+    /**
+     * More and less recently used faces of the pool
+     */
+    struct texture_face_t * prev, * next;
+} texture_face_t;
+
 /**
  *  Texture font library structure.
  */
@@ -267,18 +420,106 @@ typedef struct texture_font_library_t
      * Freetype library pointer
      */
     FT_Library library;
+
+    /**
+     * Faces of the fonts of the library, the most recently used first.
+     * Fonts done with a face leave it open in the pool, where it is found
+     * again rather than read anew.
+     */
+    texture_face_t * faces;
+
+    /**
+     * Number of faces open in the pool
+     */
+    size_t open_faces;
+
+    /**
+     * Number of faces left open in the pool once fonts are done with them,
+     * the least recently used being closed first; 0 for no limit
+     */
+    size_t max_faces;
+
+    /**
+     * Number of times a font found its face open in the pool
+     */
+    size_t face_hits;
+
+    /**
+     * Number of times a face was opened for the first time
+     */
+    size_t face_misses;
+
+    /**
+     * Number of times a face closed by the pool was opened again
+     */
+    size_t face_reopens;
+
+    /**
+     * Stroker of the outline render modes, created with the first outlined
+     * glyph and done with the library
+     */
+    struct FT_StrokerRec_ * stroker;
+
+    /**
+     * Radius the stroker is set for, in 26.6 pixels
+     */
+    long stroker_radius;
+
+    /**
+     * LCD filter last set on the library by a font, so that it is set again
+     * only when it changes: 0 if none, 1 for FT_LCD_FILTER_LIGHT, 2 for the
+     * weights in lcd_weights
+     */
+    unsigned char lcd_filter;
+
+    /**
+     * LCD filter weights last set on the library, if lcd_filter is 2
+     */
+    unsigned char lcd_weights[5];
 } texture_font_library_t;
 
+/**
+ *  Rasterization state a font keeps between glyphs, so that loading a glyph
+ *  allocates nothing once a few glyphs were loaded.
+ */
+typedef struct raster_context_t
+{
+    /**
+     * Bitmap glyphs are padded and converted to the atlas depth in before
+     * being packed, grown to the largest glyph
+     */
+    unsigned char * scratch;
+
+    /**
+     * Size in bytes of the scratch bitmap
+     */
+    size_t capacity;
+
+    /**
+     * Number of times the font created the stroker of its library or grew
+     * the scratch bitmap
+     */
+    size_t allocations;
+} raster_context_t;
+
 /**
  *  Texture font structure.
  */
 typedef struct texture_font_t
 {
     /**
-     * Vector of glyphs contained in this font.
-     * This is actually a two-stage table, indexing into 256 glyphs each
+     * Glyphs contained in this font, a hash table from texture_glyph_key_t
+     * to texture_glyph_t pointers. Codepoints missing from the face share
+     * the glyph of codepoint 0, which owns it.
+     */
+    hash_table_t * glyphs;
+
+    /**
+     * Arena holding the glyphs loaded by this font and their kerning tables,
+     * released at once when the font is deleted. Its counters report the
+     * memory they take.
      */
-    vector_t * glyphs;
+    arena_t * arena;
 
     /**
      * Atlas structure to store glyphs data.
@@ -305,6 +546,13 @@ typedef struct texture_font_t
         } memory;
     };
 
+    /**
+     * Baked font the glyphs are read from, for when location ==
+     * TEXTURE_FONT_BAKED. filename is then the name of the baked file if it
+     * was opened by name, NULL otherwise.
+     */
+    struct baked_font_t *baked;
+
     /**
      * Font family (optional)
      */
@@ -340,6 +588,65 @@ typedef struct texture_font_t
      */
     unsigned char kerning;
 
+    /**
+     * How kerning pairs are computed and stored, to be set before loading
+     * glyphs
+     */
+    kerning_mode_t kerning_mode;
+
+    /**
+     * Kerning pairs cache for KERNING_LAZY, keyed by (left, right) codepoints
+     */
+    hash_table_t * kerning_pairs;
+
+    /**
+     * Codepoints loaded during a texture_font_load_glyphs batch whose
+     * kerning pairs are resolved once the batch is done (NULL outside a batch)
+     */
+    vector_t * kerning_pending;
+
+    /**
+     * Number of threads texture_font_load_glyphs rasterizes glyphs with,
+     * each with its own FreeType face; 0 or 1 rasterizes on the calling
+     * thread. The atlas is filled in the same order either way.
+     */
+    size_t threads;
+
+    /**
+     * Persistent glyph cache glyphs are looked up in before being rendered,
+     * NULL if none (see texture_font_set_cache)
+     */
+    glyph_cache_t * cache;
+
+    /**
+     * Whether to evict the glyphs least recently looked up when the atlas
+     * is full, freeing their regions for new glyphs. Only glyphs not looked
+     * up in the current frame are evicted.
+     */
+    unsigned char evict;
+
+    /**
+     * Current frame, advanced by texture_font_next_frame
+     */
+    unsigned int frame;
+
+    /**
+     * Incremented each time glyphs are evicted: glyphs looked up before
+     * may have been reused for other codepoints, and the texture
+     * coordinates taken from them point to other glyphs
+     */
+    unsigned int generation;
+
+    /**
+     * Number of glyphs evicted so far
+     */
+    size_t evicted;
+
+    /**
+     * Glyphs evicted, reused for the next glyphs loaded
+     */
+    vector_t * free_glyphs;
+
     /**
      * Whether to use autohint when rendering font
      */
@@ -350,6 +657,12 @@ typedef struct texture_font_t
      */
     unsigned char scaletex;
 
+    /**
+     * Whether the font is attached to its atlas (see texture_atlas_attach),
+     * to be deleted before it
+     */
+    unsigned char attached;
+
     /**
      * LCD filter weights
      */
@@ -416,15 +729,37 @@ typedef struct texture_font_t
     font_mode_t mode;
 
     /**
-     * Freetype face pointer
+     * Freetype face pointer, NULL while the font is done with it
      */
     FT_Face face;
 
     /**
-     * Freetype size pointer
+     * Freetype size pointer, kept while the face is left open in the pool
      */
     FT_Size ft_size;
 
+    /**
+     * Face of the face pool of the library the font uses
+     */
+    texture_face_t * shared_face;
+
+    /**
+     * Generation of the shared face ft_size was created on
+     */
+    unsigned int face_generation;
+
+    /**
+     * Rasterization state kept between glyphs (NULL until the first glyph
+     * is rendered)
+     */
+    raster_context_t * raster;
+
+    /**
+     * Glyph indices of the codepoints of the face, read from its Unicode
+     * charmap when the face is first loaded and kept while it is closed
+     */
+    cmap_cache_t * cmap;
+
     /**
      * Harfbuzz font pointer
      */
@@ -437,7 +772,8 @@ typedef struct texture_font_t
 } texture_font_t;
 
 /**
- * This function creates a new font library
+ * This function creates a new font library, keeping up to 16 faces open in
+ * its face pool
  *
  * @return a new library (no font loaded yet)
  */
@@ -457,6 +793,11 @@ typedef struct texture_font_t
  * RGB (depth = 3) that correspond to subpixel rendering (if available on your
  * freetype implementation), or RGBA (depth = 4) for color fonts.
  *
+ * The file may also be a baked font (see baked-font.h), rendered at pt_size
+ * in the depth of the atlas: its glyphs are then copied to the atlas as they
+ * are loaded. This is the only kind of font available when freetype-gl is
+ * built without FreeType (FTGL_NO_FREETYPE).
+ *
  * @param atlas     A texture atlas
  * @param pt_size   Size of font to be created (in points)
  * @param filename  A font filename
@@ -479,7 +820,8 @@ typedef struct texture_font_t
  *
  * @param atlas       A texture atlas
  * @param pt_size     Size of font to be created (in points)
- * @param memory_base Start of the font file in memory
+ * @param memory_base Start of the font file in memory, or of a baked font
+ *                    as with texture_font_new_from_file
  * @param memory_size Size of the font file memory region, in bytes
  *
  * @return A new empty font (no glyph inside yet)
@@ -491,6 +833,20 @@ typedef struct texture_font_t
                                 const void *memory_base,
                                 size_t memory_size );
 
+/**
+ * This function creates a new texture font from a baked font (see
+ * baked-font.h), with a new atlas using the baked pixels in place. Its
+ * glyphs are read from the baked font as they are looked up; no glyph can
+ * be rendered since there is no face, and codepoints not in the baked font
+ * get the glyph of missing codepoints if it was baked.
+ *
+ * @param baked  A baked font, which gets a reference per user
+ *
+ * @return A new font, or NULL on error
+ */
+  texture_font_t *
+  texture_font_new_from_baked( struct baked_font_t *baked );
+
 /**
  * Clone the freetype-gl font and set a different size
  *
@@ -502,7 +858,9 @@ typedef struct texture_font_t
 		      float size);
 
 /**
- * Close the freetype structures from a font and the associated library
+ * Close the freetype structures from a font and the associated library. The
+ * face of the font is left open in the face pool of the library, up to
+ * max_faces faces, unless the library is closed.
  *
  * @param self         a valid texture font
  * @param face_mode    if the mode of the face is less or equal, be done with it
@@ -561,13 +919,14 @@ typedef struct texture_font_t
                           const char * codepoint );
     
 /** 
- * Index a glyph in a font
- * 
+ * Index a glyph in a font, under its render mode and outline thickness.
+ * The font owns the glyph once it is indexed under its own codepoint.
+ *
  * @param self      A valid texture font
  * @param glyph     The glyph to index in the font
  * @param codepoint The codepoint to insert into
  *
- * @return          1 if glyph was copied, 0 if it was inserted
+ * @return          1 if the glyph was indexed, 0 if out of memory
  */
 int
 texture_font_index_glyph( texture_font_t * self,
@@ -656,7 +1015,8 @@ texture_font_load_glyph_gi( texture_font_t * self,
 /**
  * Increases the size of a fonts texture atlas
  * Invalidates all pointers to font->atlas->data
- * Changes the UV Coordinates of existing glyphs in the font
+ * Changes the UV Coordinates of existing glyphs in the font and in the other
+ * fonts attached to the atlas (see texture_atlas_grow)
  *
  * @param self A valid texture font
  * @param width_new Width of the texture atlas after resizing (must be bigger
@@ -690,6 +1050,86 @@ texture_font_load_glyph_gi( texture_font_t * self,
   void
   texture_font_enlarge_texture( texture_font_t * self, size_t width_new,
 				size_t height_new );
+
+/**
+ * Pack the atlas shared by fonts again (see texture_atlas_repack), to
+ * allocate again the space of evicted glyphs or of deleted fonts. The
+ * glyphs of the fonts move, their coordinates being updated: text buffers
+ * with them are stale and can be fixed with text_buffer_remap.
+ *
+ * @param fonts  all the fonts with glyphs in the atlas: the regions of the
+ *               glyphs of any other font are cleared
+ * @param count  number of fonts, at least one
+ * @return       the remap table of texture_atlas_repack, to be deleted with
+ *               vector_delete, or NULL if the glyphs do not fit anymore or
+ *               the atlas has several pages or packs its channels apart,
+ *               which are not repacked
+ */
+  vector_t *
+  texture_font_repack( texture_font_t ** fonts, size_t count );
+
+/**
+ * Tell whether the font has a glyph for a codepoint, without loading it.
+ * FreeType fonts answer from the charmap read when their face was first
+ * loaded, baked fonts from their glyph list.
+ *
+ * @param self       A valid texture font
+ * @param codepoint  Unicode codepoint
+ *
+ * @return 1 if the font covers the codepoint, 0 otherwise
+ */
+int
+texture_font_covers( texture_font_t * self,
+                     uint32_t codepoint );
+
+/**
+ * Start a new frame: the glyphs looked up until then may be evicted if
+ * evict is set and the atlas gets full.
+ *
+ * @param self  A valid texture font
+ */
+void
+texture_font_next_frame( texture_font_t * self );
+
+/**
+ * Get the memory used by a font for its glyphs and kerning.
+ *
+ * @param self  A valid texture font
+ *
+ * @return bytes allocated for the glyph table, the arena, the lazy kerning
+ *         cache, the charmap cache and the rasterization scratch bitmap
+ */
+size_t
+texture_font_memory( const texture_font_t * self );
+
+/**
+ * Set the directory of a persistent glyph cache: glyphs are then read from
+ * the cache file matching the font contents and rendering parameters when
+ * there, and added to it when rendered.
+ *
+ * @param self       A valid texture font
+ * @param directory  An existing directory, NULL to stop caching
+ *
+ * @return 1 on success, 0 if the font cannot be read
+ */
+int
+texture_font_set_cache( texture_font_t * self, const char * directory );
+
+/**
+ * Get the kerning between two horizontal glyphs of a font. With
+ * KERNING_LAZY, the pair is computed on first use and then cached.
+ *
+ * @param self   A valid texture font
+ * @param left   Codepoint of the preceding character in UTF-32 LE encoding
+ * @param right  Codepoint of the current character in UTF-32 LE encoding
+ *
+ * @return x kerning value
+ */
+float
+texture_font_get_kerning( texture_font_t * self,
+                          uint32_t left,
+                          uint32_t right );
+
 /**
  * Get the kerning between two horizontal glyphs.
  *
@@ -712,7 +1152,8 @@ texture_glyph_t *
 texture_glyph_new( void );
 
 /**
- * Delete a glyph
+ * Delete a glyph. Glyphs loaded by a font belong to its arena and are only
+ * released with the font, so this does nothing for them.
  *
  * @param  self         A valid texture glyph
  */
@@ -721,31 +1162,23 @@ texture_glyph_delete( texture_glyph_t * self );
 
 /** @} */
 
-#define GLYPHS_ITERATOR1(index, name, glyph) \
-    for( index = 0; index < vector_size ( glyph ); index++ ) { \
-        texture_glyph_t ** __glyphs;
-#define GLYPHS_ITERATOR2(index, name, glyph) \
-    if(( __glyphs = *(texture_glyph_t *** ) vector_get ( glyph, index ) )) { \
-        for( int __i = 0; __i < 0x100; __i++ ) { \
-            if(( name = __glyphs[__i] ))
-#define GLYPHS_ITERATOR(index, name, glyph) \
-    GLYPHS_ITERATOR1(index, name, glyph) \
-    GLYPHS_ITERATOR2(index, name, glyph)
-
-#define GLYPHS_ITERATOR_END1 }
-#define GLYPHS_ITERATOR_END2 } }
-#define GLYPHS_ITERATOR_END } } }
+#define GLYPHS_ITERATOR(index, name, glyphs) \
+    for( index = 0; index < hash_table_capacity( glyphs ); index++ ) { \
+        const texture_glyph_key_t * __key = (const texture_glyph_key_t *) \
+            hash_table_key_at( glyphs, index ); \
+        if( __key && \
+            ( name = *(texture_glyph_t **) hash_table_value_at( glyphs, index ) ) && \
+            name->codepoint == __key->codepoint )
+
+#define GLYPHS_ITERATOR_END }
 
 inline static
-size_t vector_glyphs_size( const vector_t *glyph ) {
-    int count = 0;
-    for( int index = 0; index < vector_size ( glyph ); index++ ) {
-        texture_glyph_t ** _glyphs;
-        if(( _glyphs = *(texture_glyph_t *** ) vector_get ( glyph, index ) ))
-            for( int i = 0; i < 0x100; i++ )
-                if( _glyphs[i] )
-                    count++;
-    }
+size_t vector_glyphs_size( const hash_table_t *glyphs ) {
+    size_t count = 0, index;
+    texture_glyph_t *glyph;
+    GLYPHS_ITERATOR( index, glyph, glyphs ) {
+        count++;
+    } GLYPHS_ITERATOR_END
     return count;
 }
 
@@ -81,3 +81,40 @@ utf8_to_utf32( const char * character )
 
     return 0xFFFD; // invalid character
 }
+
+// ---------------------------------------------------------- utf32_to_utf8 ---
+size_t
+utf32_to_utf8( uint32_t codepoint, char * character )
+{
+    size_t length;
+
+    if( codepoint < 0x80 )
+    {
+        character[0] = (char) codepoint;
+        length = 1;
+    }
+    else if( codepoint < 0x800 )
+    {
+        character[0] = (char) ( 0xC0 | ( codepoint >> 6 ) );
+        character[1] = (char) ( 0x80 | ( codepoint & 0x3F ) );
+        length = 2;
+    }
+    else if( codepoint < 0x10000 )
+    {
+        character[0] = (char) ( 0xE0 | ( codepoint >> 12 ) );
+        character[1] = (char) ( 0x80 | ( ( codepoint >> 6 ) & 0x3F ) );
+        character[2] = (char) ( 0x80 | ( codepoint & 0x3F ) );
+        length = 3;
+    }
+    else
+    {
+        character[0] = (char) ( 0xF0 | ( ( codepoint >> 18 ) & 0x07 ) );
+        character[1] = (char) ( 0x80 | ( ( codepoint >> 12 ) & 0x3F ) );
+        character[2] = (char) ( 0x80 | ( ( codepoint >> 6 ) & 0x3F ) );
+        character[3] = (char) ( 0x80 | ( codepoint & 0x3F ) );
+        length = 4;
+    }
+    character[length] = 0;
+
+    return length;
+}
@@ -56,6 +56,19 @@ namespace ftgl {
   uint32_t
   utf8_to_utf32( const char * character );
 
+  /**
+   * Converts a given UTF-32 codepoint to its UTF-8 equivalent, followed
+   * by a NULL terminator
+   *
+   * @param codepoint  An UTF-32 codepoint
+   * @param character  Buffer of at least 5 bytes for the UTF-8 bytes
+   *
+   * @return  The length of the UTF-8 character in bytes, 1 to 4,
+   *          the terminator excluded.
+   */
+  size_t
+  utf32_to_utf8( uint32_t codepoint, char * character );
+
 /**
  * @}
  */